@@ -3,6 +3,7 @@
 //
 
 #include "ImageProxy.h"
+#include "trace.h"
 
 #define TAG "ImageProxy"
 
@@ -27,11 +28,19 @@ ImageProxy::~ImageProxy() {
 }
 
 void ImageProxy::init() {
+    TRACE_SCOPE("ImageProxy setup");
     jclass cls = env->FindClass("android/media/Image");
 
     jmethodID getFormatMethod = env->GetMethodID(cls, "getFormat", "()I");
     format = env->CallIntMethod(image, getFormatMethod);
 
+    jmethodID getDataSpaceMethod = env->GetMethodID(cls, "getDataSpace", "()I");
+    if (getDataSpaceMethod != nullptr) {
+        dataSpace = env->CallIntMethod(image, getDataSpaceMethod);
+    } else {
+        env->ExceptionClear();
+    }
+
     jmethodID getWidthMethod = env->GetMethodID(cls, "getWidth", "()I");
     width = env->CallIntMethod(image, getWidthMethod);
 
@@ -57,6 +66,14 @@ int ImageProxy::getHeight() {
     return height;
 }
 
+int ImageProxy::getFormat() {
+    return format;
+}
+
+int ImageProxy::getDataSpace() {
+    return dataSpace;
+}
+
 int ImageProxy::getPlaneCount() {
     return planeCount;
 }
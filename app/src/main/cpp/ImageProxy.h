@@ -16,6 +16,9 @@ public:
     ImageProxy(ImageProxy &&) = delete;
     ~ImageProxy();
 
+    int getFormat();
+    // android.hardware.DataSpace, 0 (unknown) before API 33
+    int getDataSpace();
     int getPlaneCount();
     int getWidth();
     int getHeight();
@@ -55,6 +58,7 @@ private:
     JNIEnv *env = nullptr;
     jobject image = nullptr;
     int format = 0;
+    int dataSpace = 0;
     PlaneProxy **planes = nullptr;
     int planeCount = 0;
 
@@ -0,0 +1,160 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#include "async_file_writer.h"
+#include "log.h"
+#include "trace.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+using namespace std;
+
+#define TAG "async_file_writer.cpp"
+
+AsyncFileWriter::AsyncFileWriter(int fd, size_t chunkBytes, int chunkCount) : fd(fd), chunkBytes(chunkBytes) {
+    chunks.resize(chunkCount);
+    for (auto &chunk : chunks) {
+        void *data = nullptr;
+        if (posix_memalign(&data, FILE_WRITER_ALIGNMENT, chunkBytes) != 0) {
+            data = nullptr;
+        }
+        chunk.data = (uint8_t *)data;
+        chunk.size = 0;
+        chunk.sync = false;
+        if (chunk.data != nullptr) {
+            freeChunks.push_back(&chunk);
+        }
+    }
+    if (fd < 0 || freeChunks.size() < 2) {
+        LOGE(TAG, "can not create writer, fd = %d, %zu chunks", fd, freeChunks.size());
+        failed = true;
+        return;
+    }
+    current = freeChunks.front();
+    freeChunks.pop_front();
+    ioThread = std::thread(&AsyncFileWriter::ioLoop, this);
+}
+
+AsyncFileWriter::~AsyncFileWriter() {
+    close();
+    for (auto &chunk : chunks) {
+        free(chunk.data);
+    }
+}
+
+bool AsyncFileWriter::write(const void *data, size_t size) {
+    if (failed || current == nullptr) {
+        return false;
+    }
+    const uint8_t *src = (const uint8_t *)data;
+    while (size > 0) {
+        size_t n = min(size, chunkBytes - current->size);
+        memcpy(current->data + current->size, src, n);
+        current->size += n;
+        position += n;
+        src += n;
+        size -= n;
+        if (current->size == chunkBytes && !submit(false)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool AsyncFileWriter::flush(bool sync) {
+    if (failed || current == nullptr) {
+        return false;
+    }
+    if (current->size == 0 && !sync) {
+        return true;
+    }
+    return submit(sync);
+}
+
+bool AsyncFileWriter::submit(bool sync) {
+    unique_lock<std::mutex> lock(mutex);
+    current->sync = sync;
+    pending.push_back(current);
+    TRACE_COUNTER("file writer queue", pending.size());
+    current = nullptr;
+    pendingCondition.notify_one();
+    if (freeChunks.empty()) {
+        stalls++;
+        TRACE_COUNTER("file writer stalls", stalls);
+        TRACE_SCOPE("file writer stall");
+        freeCondition.wait(lock, [this] { return !freeChunks.empty() || failed; });
+        if (freeChunks.empty()) {
+            return false;
+        }
+    }
+    current = freeChunks.front();
+    freeChunks.pop_front();
+    current->size = 0;
+    return !failed;
+}
+
+void AsyncFileWriter::ioLoop() {
+    while (true) {
+        Chunk *chunk;
+        {
+            unique_lock<std::mutex> lock(mutex);
+            pendingCondition.wait(lock, [this] { return !pending.empty() || closing; });
+            if (pending.empty()) {
+                return;
+            }
+            chunk = pending.front();
+            pending.pop_front();
+            TRACE_COUNTER("file writer queue", pending.size());
+        }
+        TRACE_SCOPE("file write");
+        size_t done = 0;
+        while (done < chunk->size && !failed) {
+            ssize_t n = ::write(fd, chunk->data + done, chunk->size - done);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                LOGE(TAG, "write failed: %s", strerror(errno));
+                failed = true;
+                break;
+            }
+            done += (size_t)n;
+        }
+        if (chunk->sync && !failed) {
+            fdatasync(fd);
+        }
+        {
+            lock_guard<std::mutex> lock(mutex);
+            chunk->size = 0;
+            freeChunks.push_back(chunk);
+        }
+        freeCondition.notify_one();
+    }
+}
+
+bool AsyncFileWriter::close() {
+    if (fd < 0) {
+        return !failed;
+    }
+    if (current != nullptr && current->size > 0 && !failed) {
+        submit(false);
+    }
+    {
+        lock_guard<std::mutex> lock(mutex);
+        closing = true;
+    }
+    pendingCondition.notify_one();
+    if (ioThread.joinable()) {
+        ioThread.join();
+    }
+    if (stalls > 0) {
+        LOGE(TAG, "waited for the disk %d times", stalls);
+    }
+    ::close(fd);
+    fd = -1;
+    current = nullptr;
+    return !failed;
+}
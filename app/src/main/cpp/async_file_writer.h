@@ -0,0 +1,98 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#ifndef CAMERAUTIL_ASYNC_FILE_WRITER_H
+#define CAMERAUTIL_ASYNC_FILE_WRITER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * 顺序写文件，写操作不在调用者线程上做：write只把数据拷贝进当前的块（按页对齐分配的大缓冲区），
+ * 块写满后交给I/O线程，由它调用write(2)，调用者（编码器线程）不会被磁盘I/O阻塞。
+ * 块的数量固定，全部在构造时分配；磁盘持续跟不上时write等待空闲的块，而不是无限制地占用内存。
+ *
+ * flush把没写满的块也交出去，可以要求I/O线程写完后fdatasync，
+ * 用于MP4分片边界，让进程崩溃或掉电时已经完成的分片都在文件里。
+ * */
+
+#define FILE_WRITER_CHUNK_BYTES (1 << 20)
+#define FILE_WRITER_CHUNKS 8
+#define FILE_WRITER_ALIGNMENT 4096
+
+class AsyncFileWriter {
+public:
+    /**
+     * Take ownership of fd, which is closed by close() or the destructor.
+     * */
+    explicit AsyncFileWriter(int fd, size_t chunkBytes = FILE_WRITER_CHUNK_BYTES, int chunkCount = FILE_WRITER_CHUNKS);
+    AsyncFileWriter(AsyncFileWriter &) = delete;
+    ~AsyncFileWriter();
+
+    /**
+     * Append size bytes. Return false once a write has failed, the file is incomplete then.
+     * */
+    bool write(const void *data, size_t size);
+
+    /**
+     * Queue the partly filled chunk too, with an fdatasync after it if sync. Does not wait for the disk.
+     * */
+    bool flush(bool sync);
+
+    /**
+     * Write everything queued, stop the I/O thread and close the file. Return false if any write failed.
+     * */
+    bool close();
+
+    /**
+     * Bytes appended so far, the file offset of the next write.
+     * */
+    uint64_t getPosition() const {
+        return position;
+    }
+
+    /**
+     * Times write had to wait for the I/O thread to free a chunk.
+     * */
+    int getStalls() const {
+        return stalls;
+    }
+
+private:
+    struct Chunk {
+        uint8_t *data;
+        size_t size;
+        bool sync;
+    };
+
+    void ioLoop();
+
+    /**
+     * Queue current and take a free chunk, waiting for one if all are queued.
+     * */
+    bool submit(bool sync);
+
+    int fd;
+    size_t chunkBytes;
+    std::vector<Chunk> chunks;
+    std::deque<Chunk *> freeChunks;
+    std::deque<Chunk *> pending;
+    Chunk *current = nullptr;
+    std::mutex mutex;
+    std::condition_variable freeCondition;
+    std::condition_variable pendingCondition;
+    std::thread ioThread;
+    bool closing = false;
+    std::atomic<bool> failed{false};
+    uint64_t position = 0;
+    int stalls = 0;
+};
+
+#endif //CAMERAUTIL_ASYNC_FILE_WRITER_H
@@ -0,0 +1,320 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#include "audio_capture.h"
+#include "log.h"
+#include "trace.h"
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+#if defined(__ANDROID__)
+#include <SLES/OpenSLES.h>
+#include <SLES/OpenSLES_Android.h>
+#include <SLES/OpenSLES_AndroidConfiguration.h>
+#endif
+
+using namespace std;
+
+#define TAG "audio_capture.cpp"
+
+// Buffers in the OpenSL queue, one is filled while the others wait.
+#define OPENSL_BUFFERS 3
+// The consumer polls the ring this often while it waits.
+#define READ_POLL_US 1000
+
+static int period_bytes(int sampleRate, int channels) {
+    return sampleRate * AUDIO_PERIOD_MS / 1000 * channels * AUDIO_SAMPLE_BYTES;
+}
+
+FilePcmSource::FilePcmSource(const char *path, int sampleRate, int channels, bool paced)
+        : sampleRate(sampleRate), channels(channels), paced(paced) {
+    file = fopen(path, "rb");
+    if (file == nullptr) {
+        LOGE(TAG, "can not open %s", path);
+    }
+}
+
+FilePcmSource::~FilePcmSource() {
+    stop();
+    if (file != nullptr) {
+        fclose(file);
+    }
+}
+
+bool FilePcmSource::start(PcmRing *ring) {
+    if (file == nullptr || thread.joinable()) {
+        return false;
+    }
+    stopFlag = false;
+    finished = false;
+    thread = std::thread(&FilePcmSource::readLoop, this, ring);
+    return true;
+}
+
+void FilePcmSource::stop() {
+    stopFlag = true;
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+void FilePcmSource::readLoop(PcmRing *ring) {
+    vector<uint8_t> period(period_bytes(sampleRate, channels));
+    auto next = chrono::steady_clock::now();
+    while (!stopFlag) {
+        size_t size = fread(period.data(), 1, period.size(), file);
+        size -= size % (channels * AUDIO_SAMPLE_BYTES);
+        if (size == 0) {
+            break;
+        }
+        if (paced) {
+            next += chrono::milliseconds(AUDIO_PERIOD_MS);
+            this_thread::sleep_until(next);
+            ring->write(period.data(), size);
+        } else {
+            // Unpaced sources wait for room instead of dropping, so a test sees every byte.
+            while (!stopFlag && ring->writable() < size) {
+                this_thread::sleep_for(chrono::microseconds(READ_POLL_US));
+            }
+            ring->write(period.data(), size);
+        }
+    }
+    finished = true;
+}
+
+#if defined(__ANDROID__)
+class OpenSLPcmSource : public PcmSource {
+public:
+    OpenSLPcmSource(int sampleRate, int channels) : sampleRate(sampleRate), channels(channels) {
+        periodBytes = period_bytes(sampleRate, channels);
+        buffers.resize((size_t)periodBytes * OPENSL_BUFFERS);
+    }
+
+    ~OpenSLPcmSource() override {
+        stop();
+        destroy();
+    }
+
+    bool create() {
+        if (slCreateEngine(&engineObject, 0, nullptr, 0, nullptr, nullptr) != SL_RESULT_SUCCESS ||
+            (*engineObject)->Realize(engineObject, SL_BOOLEAN_FALSE) != SL_RESULT_SUCCESS) {
+            LOGE(TAG, "can not create OpenSL engine");
+            return false;
+        }
+        SLEngineItf engine;
+        (*engineObject)->GetInterface(engineObject, SL_IID_ENGINE, &engine);
+
+        SLDataLocator_IODevice device = {SL_DATALOCATOR_IODEVICE, SL_IODEVICE_AUDIOINPUT,
+                                         SL_DEFAULTDEVICEID_AUDIOINPUT, nullptr};
+        SLDataSource source = {&device, nullptr};
+        SLDataLocator_AndroidSimpleBufferQueue queueLocator = {SL_DATALOCATOR_ANDROIDSIMPLEBUFFERQUEUE,
+                                                              OPENSL_BUFFERS};
+        SLDataFormat_PCM format = {SL_DATAFORMAT_PCM, (SLuint32)channels, (SLuint32)sampleRate * 1000,
+                                   SL_PCMSAMPLEFORMAT_FIXED_16, SL_PCMSAMPLEFORMAT_FIXED_16,
+                                   channels == 2 ? SL_SPEAKER_FRONT_LEFT | SL_SPEAKER_FRONT_RIGHT
+                                                 : SL_SPEAKER_FRONT_CENTER,
+                                   SL_BYTEORDER_LITTLEENDIAN};
+        SLDataSink sink = {&queueLocator, &format};
+        const SLInterfaceID ids[2] = {SL_IID_ANDROIDSIMPLEBUFFERQUEUE, SL_IID_ANDROIDCONFIGURATION};
+        const SLboolean required[2] = {SL_BOOLEAN_TRUE, SL_BOOLEAN_FALSE};
+        if ((*engine)->CreateAudioRecorder(engine, &recorderObject, &source, &sink, 2, ids, required) !=
+            SL_RESULT_SUCCESS) {
+            LOGE(TAG, "can not create OpenSL recorder, %d Hz, %d channels", sampleRate, channels);
+            return false;
+        }
+        SLAndroidConfigurationItf configuration;
+        if ((*recorderObject)->GetInterface(recorderObject, SL_IID_ANDROIDCONFIGURATION, &configuration) ==
+            SL_RESULT_SUCCESS) {
+            // Same microphone tuning as MediaRecorder.AudioSource.CAMCORDER
+            SLuint32 preset = SL_ANDROID_RECORDING_PRESET_CAMCORDER;
+            (*configuration)->SetConfiguration(configuration, SL_ANDROID_KEY_RECORDING_PRESET, &preset,
+                                               sizeof(preset));
+        }
+        if ((*recorderObject)->Realize(recorderObject, SL_BOOLEAN_FALSE) != SL_RESULT_SUCCESS) {
+            LOGE(TAG, "can not realize OpenSL recorder");
+            return false;
+        }
+        (*recorderObject)->GetInterface(recorderObject, SL_IID_RECORD, &record);
+        (*recorderObject)->GetInterface(recorderObject, SL_IID_ANDROIDSIMPLEBUFFERQUEUE, &queue);
+        (*queue)->RegisterCallback(queue, on_buffer, this);
+        return true;
+    }
+
+    bool start(PcmRing *ring) override {
+        this->ring = ring;
+        next = 0;
+        (*queue)->Clear(queue);
+        for (int i = 0; i < OPENSL_BUFFERS; i++) {
+            (*queue)->Enqueue(queue, buffers.data() + (size_t)i * periodBytes, periodBytes);
+        }
+        return (*record)->SetRecordState(record, SL_RECORDSTATE_RECORDING) == SL_RESULT_SUCCESS;
+    }
+
+    void stop() override {
+        if (record != nullptr) {
+            (*record)->SetRecordState(record, SL_RECORDSTATE_STOPPED);
+            (*queue)->Clear(queue);
+        }
+    }
+
+    int getSampleRate() const override {
+        return sampleRate;
+    }
+
+    int getChannels() const override {
+        return channels;
+    }
+
+private:
+    /**
+     * Buffers complete in the order they were enqueued, so the filled one is always next.
+     * */
+    static void on_buffer(SLAndroidSimpleBufferQueueItf queue, void *context) {
+        auto *self = (OpenSLPcmSource *)context;
+        uint8_t *buffer = self->buffers.data() + (size_t)self->next * self->periodBytes;
+        self->ring->write(buffer, self->periodBytes);
+        (*queue)->Enqueue(queue, buffer, self->periodBytes);
+        self->next = (self->next + 1) % OPENSL_BUFFERS;
+    }
+
+    void destroy() {
+        if (recorderObject != nullptr) {
+            (*recorderObject)->Destroy(recorderObject);
+            recorderObject = nullptr;
+            record = nullptr;
+            queue = nullptr;
+        }
+        if (engineObject != nullptr) {
+            (*engineObject)->Destroy(engineObject);
+            engineObject = nullptr;
+        }
+    }
+
+    int sampleRate, channels;
+    int periodBytes;
+    vector<uint8_t> buffers;
+    int next = 0;
+    PcmRing *ring = nullptr;
+    SLObjectItf engineObject = nullptr;
+    SLObjectItf recorderObject = nullptr;
+    SLRecordItf record = nullptr;
+    SLAndroidSimpleBufferQueueItf queue = nullptr;
+};
+
+unique_ptr<PcmSource> pcm_source_opensl(int sampleRate, int channels) {
+    unique_ptr<OpenSLPcmSource> source(new OpenSLPcmSource(sampleRate, channels));
+    if (!source->create()) {
+        return nullptr;
+    }
+    return source;
+}
+#else
+unique_ptr<PcmSource> pcm_source_opensl(int, int) {
+    LOGE(TAG, "OpenSL ES is only available on Android");
+    return nullptr;
+}
+#endif
+
+AudioCapture::AudioCapture(unique_ptr<PcmSource> source, int ringMs, int outputRate, int outputChannels)
+        : source(std::move(source)),
+          ring((size_t)this->source->getSampleRate() * ringMs / 1000 * this->source->getChannels() *
+               AUDIO_SAMPLE_BYTES) {
+    int captureRate = this->source->getSampleRate(), captureChannels = this->source->getChannels();
+    this->outputRate = outputRate > 0 ? outputRate : captureRate;
+    outputChannels = outputChannels > 0 ? outputChannels : captureChannels;
+    captureFrameBytes = captureChannels * AUDIO_SAMPLE_BYTES;
+    frameBytes = outputChannels * AUDIO_SAMPLE_BYTES;
+    if (this->outputRate != captureRate || outputChannels != captureChannels) {
+        int maxFrames = captureRate * AUDIO_CONVERT_MS / 1000;
+        converter.reset(new PcmConverter(captureRate, captureChannels, this->outputRate, outputChannels, maxFrames));
+        scratch.resize((size_t)maxFrames * captureChannels);
+        LOGD(TAG, "convert %d Hz %d channels to %d Hz %d channels", captureRate, captureChannels,
+             this->outputRate, outputChannels);
+    }
+}
+
+AudioCapture::~AudioCapture() {
+    stop();
+}
+
+bool AudioCapture::start() {
+    if (running) {
+        return true;
+    }
+    ring.reset();
+    framesRead = 0;
+    if (converter != nullptr) {
+        converter->reset();
+    }
+    running = source->start(&ring);
+    return running;
+}
+
+void AudioCapture::stop() {
+    if (running) {
+        source->stop();
+        running = false;
+        if (ring.getDropped() > 0) {
+            LOGE(TAG, "%llu bytes dropped, the consumer was too slow", (unsigned long long)ring.getDropped());
+        }
+    }
+}
+
+int AudioCapture::waitReadable(chrono::steady_clock::time_point deadline) {
+    while (ring.readable() < (size_t)captureFrameBytes) {
+        // Checked before the ring, so that the last frames written before finishing are not missed.
+        bool finished = source->isFinished();
+        if (ring.readable() >= (size_t)captureFrameBytes) {
+            break;
+        }
+        if (finished || !running) {
+            return -1;
+        }
+        if (chrono::steady_clock::now() >= deadline) {
+            return 0;
+        }
+        this_thread::sleep_for(chrono::microseconds(READ_POLL_US));
+    }
+    return 1;
+}
+
+int AudioCapture::read(void *dst, int bytes, int timeoutMs) {
+    // Queue depth when the encoder comes for data, and what the capture callback had to drop.
+    TRACE_COUNTER("audio ring bytes", ring.readable());
+    TRACE_COUNTER("audio dropped bytes", ring.getDropped());
+    bytes -= bytes % frameBytes;
+    auto deadline = chrono::steady_clock::now() + chrono::milliseconds(timeoutMs);
+    if (converter == nullptr) {
+        int result = waitReadable(deadline);
+        if (result <= 0) {
+            return result;
+        }
+        size_t available = ring.readable();
+        size_t size = min((size_t)bytes, available - available % frameBytes);
+        size = ring.read(dst, size);
+        framesRead += (int64_t)(size / frameBytes);
+        return (int)size;
+    }
+    // A few input frames may not complete an output frame when downsampling, wait for more then.
+    while (true) {
+        int result = waitReadable(deadline);
+        if (result <= 0) {
+            return result;
+        }
+        int inputFrames = min(converter->getMaxInputFrames(bytes / frameBytes),
+                              (int)(ring.readable() / captureFrameBytes));
+        if (inputFrames == 0) {
+            LOGE(TAG, "read buffer of %d bytes is too small", bytes);
+            return 0;
+        }
+        ring.read(scratch.data(), (size_t)inputFrames * captureFrameBytes);
+        TRACE_SCOPE("audio convert");
+        int frames = converter->process(scratch.data(), inputFrames, (int16_t *)dst);
+        if (frames > 0) {
+            framesRead += frames;
+            return frames * frameBytes;
+        }
+    }
+}
@@ -0,0 +1,165 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#ifndef CAMERAUTIL_AUDIO_CAPTURE_H
+#define CAMERAUTIL_AUDIO_CAPTURE_H
+
+#include "pcm_ring.h"
+#include "audio_dsp.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+/**
+ * 原生音频采集：PcmSource把16位交错PCM写进PcmRing，编码线程通过AudioCapture::read把数据
+ * 直接拷贝进MediaCodec的输入buffer（direct ByteBuffer），整个过程只有这一次拷贝，
+ * 不分配Java对象，每个编码器输入buffer一次JNI调用，而不是每次读麦克风一次。
+ *
+ * PcmSource是可替换的：Android上是OpenSL ES录音（pcm_source_opensl），
+ * 回调里只做一次memcpy进环形缓冲区然后重新入队；
+ * 其他平台（Linux上测试环形缓冲区和消费者）用FilePcmSource从原始PCM文件按实时速度读取。
+ *
+ * 采集格式和输出格式不同时（设备原生采样率、声道数和编码器要求的不一致），
+ * read在消费者线程里用PcmConverter把环形缓冲区里的数据转换后写进dst，转换缓冲区在构造时分配好。
+ * */
+
+// 16 bit little endian PCM only
+#define AUDIO_SAMPLE_BYTES 2
+// Capture period, the OpenSL buffer size and the file source step.
+#define AUDIO_PERIOD_MS 10
+#define AUDIO_RING_MS 500
+// Capture frames converted per step when the output format differs.
+#define AUDIO_CONVERT_MS 40
+
+class PcmSource {
+public:
+    virtual ~PcmSource() = default;
+
+    /**
+     * Start writing whole frames into ring from the source's own thread or callback.
+     * */
+    virtual bool start(PcmRing *ring) = 0;
+
+    virtual void stop() = 0;
+
+    /**
+     * True when the source ended by itself (end of file), nothing more will be written.
+     * */
+    virtual bool isFinished() const {
+        return false;
+    }
+
+    virtual int getSampleRate() const = 0;
+
+    virtual int getChannels() const = 0;
+};
+
+/**
+ * Raw 16 bit PCM from a file, one period at a time. paced sources wait for the wall clock
+ * time of every period like a microphone, the others write as fast as the ring takes it.
+ * */
+class FilePcmSource : public PcmSource {
+public:
+    FilePcmSource(const char *path, int sampleRate, int channels, bool paced = true);
+    ~FilePcmSource() override;
+
+    bool start(PcmRing *ring) override;
+    void stop() override;
+
+    bool isFinished() const override {
+        return finished.load();
+    }
+
+    int getSampleRate() const override {
+        return sampleRate;
+    }
+
+    int getChannels() const override {
+        return channels;
+    }
+
+private:
+    void readLoop(PcmRing *ring);
+
+    FILE *file;
+    int sampleRate, channels;
+    bool paced;
+    std::thread thread;
+    std::atomic<bool> stopFlag{false};
+    std::atomic<bool> finished{false};
+};
+
+/**
+ * The default microphone through OpenSL ES, nullptr where OpenSL ES is not available or
+ * the recorder can not be created (no RECORD_AUDIO permission).
+ * */
+std::unique_ptr<PcmSource> pcm_source_opensl(int sampleRate, int channels);
+
+class AudioCapture {
+public:
+    /**
+     * outputRate and outputChannels are the format read returns, 0 keeps the source's.
+     * */
+    explicit AudioCapture(std::unique_ptr<PcmSource> source, int ringMs = AUDIO_RING_MS, int outputRate = 0,
+                          int outputChannels = 0);
+    AudioCapture(AudioCapture &) = delete;
+    ~AudioCapture();
+
+    /**
+     * Start the source, the ring is emptied and the frame count restarts from 0.
+     * */
+    bool start();
+
+    void stop();
+
+    /**
+     * Consumer side: copy whole output frames, at most bytes, into dst. Wait up to timeoutMs for the
+     * first frame. Return the bytes copied, 0 on timeout, -1 when the source finished and the ring is empty.
+     * When converting, bytes should hold at least AUDIO_PERIOD_MS of output.
+     * */
+    int read(void *dst, int bytes, int timeoutMs);
+
+    /**
+     * Frames read since start, the presentation time of the next read is getFramesRead() / sample rate.
+     * */
+    int64_t getFramesRead() const {
+        return framesRead;
+    }
+
+    int getSampleRate() const {
+        return outputRate;
+    }
+
+    int getFrameBytes() const {
+        return frameBytes;
+    }
+
+    uint64_t getDroppedBytes() const {
+        return ring.getDropped();
+    }
+
+private:
+    /**
+     * Wait until the ring holds a whole capture frame. Return 1 when it does, 0 at deadline,
+     * -1 when the source finished or capture stopped.
+     * */
+    int waitReadable(std::chrono::steady_clock::time_point deadline);
+
+    std::unique_ptr<PcmSource> source;
+    PcmRing ring;
+    int captureFrameBytes;
+    int outputRate;
+    int frameBytes;
+    // nullptr when the capture format is the output format
+    std::unique_ptr<PcmConverter> converter;
+    std::vector<int16_t> scratch;
+    int64_t framesRead = 0;
+    std::atomic<bool> running{false};
+};
+
+#endif //CAMERAUTIL_AUDIO_CAPTURE_H
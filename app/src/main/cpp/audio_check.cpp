@@ -0,0 +1,662 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#include "audio_check.h"
+#include "audio_capture.h"
+#include "audio_dsp.h"
+#include "pcm_ring.h"
+#include "dispatch.h"
+#include "cpu_features.h"
+#include "log.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+#define TAG "audio_check.cpp"
+
+// Stop logging failures after this many, the count is still returned.
+#define MAX_LOGGED_FAILURES 32
+// Not a power of two, the ring rounds it up to 1024.
+#define RING_BYTES 1000
+// uint32 values pushed through the ring by the threaded test.
+#define RING_VALUES (1 << 20)
+// Block sizes in uint32 cycle up to these, co-prime so that writes and reads rarely line up.
+#define RING_WRITE_BLOCK 37
+#define RING_READ_BLOCK 53
+
+#define CAPTURE_RATE 48000
+#define CAPTURE_CHANNELS 2
+#define CAPTURE_FRAME_BYTES (CAPTURE_CHANNELS * AUDIO_SAMPLE_BYTES)
+#define PERIOD_FRAMES (CAPTURE_RATE * AUDIO_PERIOD_MS / 1000)
+// A file that does not end on a period, the last read of the source is short.
+#define TAIL_FRAMES 7
+// Neither a period nor a whole number of frames, like a codec input buffer.
+#define READ_BUFFER_BYTES 4099
+#define READ_TIMEOUT_MS 20
+// The drop test: a ring of two periods and a consumer that starts late.
+#define DROP_RING_MS 20
+#define DROP_CONSUMER_DELAY_MS 100
+
+// Samples per conversion, not a multiple of the vector width so that the scalar tails run as well.
+#define DSP_SAMPLES 4099
+// One second of input per resampler case.
+#define RESAMPLE_SECONDS 1
+#define SINE_HZ 1000
+// Half of full scale
+#define SINE_AMPLITUDE 16384
+// Left out of the SNR at both ends: the filter starts from silence and the last outputs lack their inputs.
+#define SINE_SKIP_MS 50
+#define MIN_SINE_SNR_DB 70.0
+// Tones above the Nyquist frequency of 48000 -> 16000 Hz and how far they must come out down.
+#define STOPBAND_HZ_LOW 10000
+#define STOPBAND_HZ_HIGH 20000
+#define MIN_STOPBAND_DB 60.0
+
+struct Suite {
+    const char *filter;
+    int checks = 0;
+    int failures = 0;
+};
+
+static bool matchFilter(const char *name, const char *filter) {
+    return filter == nullptr || filter[0] == '\0' || strstr(name, filter) != nullptr;
+}
+
+static void check(Suite &suite, bool ok, const char *format, ...) {
+    suite.checks++;
+    if (ok) {
+        return;
+    }
+    suite.failures++;
+    if (suite.failures > MAX_LOGGED_FAILURES) {
+        return;
+    }
+    char message[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+    LOGE(TAG, "%s", message);
+}
+
+/**
+ * Producer and consumer threads move an increasing uint32 sequence through the ring in blocks of
+ * changing sizes. The consumer must see every value once and in order, and the bytes the ring counts
+ * as dropped must be exactly those of the writes the producer saw fail.
+ * */
+static void checkRingThreads(Suite &suite) {
+    const char *name = "ring_threads";
+    if (!matchFilter(name, suite.filter)) {
+        return;
+    }
+    PcmRing ring(RING_BYTES);
+    atomic<bool> consumerDone{false};
+    uint64_t failedBytes = 0;
+    thread producer([&] {
+        uint32_t block[RING_WRITE_BLOCK];
+        uint32_t next = 0;
+        while (next < RING_VALUES && !consumerDone) {
+            uint32_t count = min<uint32_t>(1 + next % RING_WRITE_BLOCK, RING_VALUES - next);
+            for (uint32_t i = 0; i < count; i++) {
+                block[i] = next + i;
+            }
+            if (ring.write(block, count * sizeof(uint32_t))) {
+                next += count;
+            } else {
+                failedBytes += count * sizeof(uint32_t);
+                this_thread::yield();
+            }
+        }
+    });
+
+    uint32_t block[RING_READ_BLOCK];
+    uint32_t expected = 0;
+    int errors = 0, partial = 0;
+    while (expected < RING_VALUES) {
+        size_t size = ring.read(block, (1 + expected % RING_READ_BLOCK) * sizeof(uint32_t));
+        if (size % sizeof(uint32_t) != 0) {
+            partial++;
+            break;
+        }
+        for (size_t i = 0; i < size / sizeof(uint32_t); i++) {
+            if (block[i] != expected) {
+                errors++;
+                // Follow the producer again, so one error does not turn every later value into one.
+                expected = block[i];
+            }
+            expected++;
+        }
+        if (size == 0) {
+            this_thread::yield();
+        }
+    }
+    consumerDone = true;
+    producer.join();
+
+    check(suite, partial == 0, "%s: a read returned part of a value", name);
+    check(suite, errors == 0, "%s: %d values out of sequence", name, errors);
+    check(suite, ring.getDropped() == failedBytes, "%s: dropped %llu bytes, the producer saw %llu fail", name,
+          (unsigned long long)ring.getDropped(), (unsigned long long)failedBytes);
+    check(suite, ring.readable() == 0, "%s: %zu bytes left in the ring", name, ring.readable());
+    LOGD(TAG, "%s: %d values through a %zu byte ring, %llu bytes retried", name, RING_VALUES,
+         ring.getCapacity(), (unsigned long long)failedBytes);
+}
+
+/**
+ * A full ring drops the whole write and counts it, and data that wraps around the end comes back intact.
+ * */
+static void checkRingFull(Suite &suite) {
+    const char *name = "ring_full";
+    if (!matchFilter(name, suite.filter)) {
+        return;
+    }
+    PcmRing ring(RING_BYTES);
+    size_t capacity = ring.getCapacity();
+    check(suite, capacity == 1024, "%s: capacity %zu, expected 1024", name, capacity);
+
+    vector<uint8_t> data(capacity * 2), out(capacity * 2);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = (uint8_t)(i * 7 + i / 251);
+    }
+    check(suite, ring.write(data.data(), RING_BYTES), "%s: the first write failed", name);
+    check(suite, !ring.write(data.data() + RING_BYTES, 100), "%s: a write larger than the room succeeded", name);
+    check(suite, ring.getDropped() == 100, "%s: dropped %llu, expected 100", name,
+          (unsigned long long)ring.getDropped());
+    check(suite, ring.readable() == RING_BYTES, "%s: a failed write changed readable to %zu", name, ring.readable());
+    size_t room = capacity - RING_BYTES;
+    check(suite, ring.writable() == room, "%s: writable %zu, expected %zu", name, ring.writable(), room);
+    check(suite, ring.write(data.data() + RING_BYTES, room), "%s: a write of exactly the room failed", name);
+    check(suite, !ring.write(data.data(), 1), "%s: a write into the full ring succeeded", name);
+    check(suite, ring.getDropped() == 101, "%s: dropped %llu, expected 101", name,
+          (unsigned long long)ring.getDropped());
+
+    // Read part, then write across the end of the buffer and read everything back in order.
+    size_t first = ring.read(out.data(), 600);
+    size_t wrapped = 500;
+    check(suite, ring.write(data.data() + capacity, wrapped), "%s: the wrapping write failed", name);
+    size_t rest = ring.read(out.data() + first, out.size());
+    check(suite, first == 600 && rest == capacity - 600 + wrapped, "%s: read %zu + %zu bytes", name, first, rest);
+    check(suite, memcmp(out.data(), data.data(), first + rest) == 0, "%s: the wrapped data differs", name);
+
+    ring.reset();
+    check(suite, ring.readable() == 0 && ring.getDropped() == 0, "%s: reset left %zu bytes, %llu dropped", name,
+          ring.readable(), (unsigned long long)ring.getDropped());
+}
+
+/**
+ * A stereo file where frame i holds i: the low 16 bits left, the high right.
+ * */
+static string writePcmFile(int frames) {
+    const char *dir = getenv("TMPDIR");
+    string path = string(dir != nullptr && dir[0] != '\0' ? dir : "/tmp") + "/camerautil_audio_XXXXXX";
+    int fd = mkstemp(&path[0]);
+    if (fd < 0) {
+        LOGE(TAG, "can not create %s", path.c_str());
+        return "";
+    }
+    vector<uint16_t> samples((size_t)frames * CAPTURE_CHANNELS);
+    for (int i = 0; i < frames; i++) {
+        samples[(size_t)i * 2] = (uint16_t)i;
+        samples[(size_t)i * 2 + 1] = (uint16_t)(i >> 16);
+    }
+    size_t bytes = samples.size() * sizeof(uint16_t);
+    bool ok = write(fd, samples.data(), bytes) == (ssize_t)bytes;
+    close(fd);
+    if (!ok) {
+        LOGE(TAG, "can not write %s", path.c_str());
+        unlink(path.c_str());
+        return "";
+    }
+    return path;
+}
+
+static uint32_t frame_index(const uint8_t *frame) {
+    uint16_t left, right;
+    memcpy(&left, frame, sizeof(left));
+    memcpy(&right, frame + sizeof(left), sizeof(right));
+    return (uint32_t)right << 16 | left;
+}
+
+/**
+ * Read everything the capture delivers until the source finishes, optionally starting late.
+ * */
+static vector<uint8_t> readAll(AudioCapture &capture, int delayMs, double &seconds) {
+    vector<uint8_t> out, buffer(READ_BUFFER_BYTES);
+    auto start = chrono::steady_clock::now();
+    capture.start();
+    this_thread::sleep_for(chrono::milliseconds(delayMs));
+    while (true) {
+        int size = capture.read(buffer.data(), (int)buffer.size(), READ_TIMEOUT_MS);
+        if (size < 0) {
+            break;
+        }
+        out.insert(out.end(), buffer.begin(), buffer.begin() + size);
+    }
+    seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    capture.stop();
+    return out;
+}
+
+/**
+ * Unpaced and paced file sources: read returns the file byte for byte, counts every frame and drops nothing.
+ * A paced source also takes the wall clock time of the audio.
+ * */
+static void checkCaptureFile(Suite &suite, bool paced) {
+    const char *name = paced ? "capture_file_paced" : "capture_file_unpaced";
+    if (!matchFilter(name, suite.filter)) {
+        return;
+    }
+    // 1 s unpaced, 0.3 s paced so the test stays short.
+    int frames = (paced ? CAPTURE_RATE * 3 / 10 : CAPTURE_RATE) + TAIL_FRAMES;
+    string path = writePcmFile(frames);
+    check(suite, !path.empty(), "%s: can not write the input file", name);
+    if (path.empty()) {
+        return;
+    }
+    AudioCapture capture(unique_ptr<PcmSource>(new FilePcmSource(path.c_str(), CAPTURE_RATE, CAPTURE_CHANNELS,
+                                                                 paced)));
+    double seconds;
+    vector<uint8_t> out = readAll(capture, 0, seconds);
+    vector<uint8_t> expected((size_t)frames * CAPTURE_FRAME_BYTES);
+    FILE *file = fopen(path.c_str(), "rb");
+    size_t fileBytes = file != nullptr ? fread(expected.data(), 1, expected.size(), file) : 0;
+    if (file != nullptr) {
+        fclose(file);
+    }
+    unlink(path.c_str());
+
+    check(suite, fileBytes == expected.size(), "%s: read back %zu bytes of the input", name, fileBytes);
+    check(suite, out.size() == expected.size() && memcmp(out.data(), expected.data(), out.size()) == 0,
+          "%s: got %zu bytes, not the %zu bytes of the file", name, out.size(), expected.size());
+    check(suite, capture.getFramesRead() == frames, "%s: %lld frames read, expected %d", name,
+          (long long)capture.getFramesRead(), frames);
+    check(suite, capture.getDroppedBytes() == 0, "%s: %llu bytes dropped", name,
+          (unsigned long long)capture.getDroppedBytes());
+    if (paced) {
+        // Every period waits for its time, allow one period of scheduling slack.
+        double minSeconds = (double)(frames - PERIOD_FRAMES) / CAPTURE_RATE;
+        check(suite, seconds >= minSeconds, "%s: %.3f s for %.3f s of audio", name, seconds,
+              (double)frames / CAPTURE_RATE);
+    }
+    LOGD(TAG, "%s: %d frames in %.3f s", name, frames, seconds);
+}
+
+/**
+ * A paced source into a ring of two periods while the consumer starts late: the ring drops whole periods,
+ * what arrives is in order, and received plus dropped is the whole file.
+ * */
+static void checkCaptureDrop(Suite &suite) {
+    const char *name = "capture_drop";
+    if (!matchFilter(name, suite.filter)) {
+        return;
+    }
+    int frames = CAPTURE_RATE * 3 / 10;
+    string path = writePcmFile(frames);
+    check(suite, !path.empty(), "%s: can not write the input file", name);
+    if (path.empty()) {
+        return;
+    }
+    AudioCapture capture(unique_ptr<PcmSource>(new FilePcmSource(path.c_str(), CAPTURE_RATE, CAPTURE_CHANNELS,
+                                                                 true)), DROP_RING_MS);
+    double seconds;
+    vector<uint8_t> out = readAll(capture, DROP_CONSUMER_DELAY_MS, seconds);
+    unlink(path.c_str());
+
+    uint64_t dropped = capture.getDroppedBytes();
+    size_t received = out.size() / CAPTURE_FRAME_BYTES;
+    check(suite, dropped > 0, "%s: nothing dropped, the consumer was not late", name);
+    check(suite, dropped % ((uint64_t)PERIOD_FRAMES * CAPTURE_FRAME_BYTES) == 0,
+          "%s: dropped %llu bytes, not whole periods", name, (unsigned long long)dropped);
+    check(suite, out.size() + dropped == (size_t)frames * CAPTURE_FRAME_BYTES,
+          "%s: received %zu + dropped %llu bytes of %zu", name, out.size(), (unsigned long long)dropped,
+          (size_t)frames * CAPTURE_FRAME_BYTES);
+    check(suite, capture.getFramesRead() == (int64_t)received, "%s: %lld frames read, %zu received", name,
+          (long long)capture.getFramesRead(), received);
+    int errors = 0;
+    uint32_t previous = 0;
+    for (size_t i = 0; i < received; i++) {
+        uint32_t index = frame_index(out.data() + i * CAPTURE_FRAME_BYTES);
+        bool next = i > 0 && index == previous + 1;
+        // A gap must skip whole periods: it ends on a period start and moves forward.
+        bool gap = (i == 0 || index > previous) && index % PERIOD_FRAMES == 0;
+        if (!next && !gap) {
+            errors++;
+        }
+        previous = index;
+    }
+    check(suite, errors == 0, "%s: %d frames out of order or inside a dropped period", name, errors);
+    LOGD(TAG, "%s: %zu frames received, %llu dropped", name, received,
+         (unsigned long long)(dropped / CAPTURE_FRAME_BYTES));
+}
+
+struct RateCase {
+    const char *name;
+    int inputRate, outputRate, channels;
+};
+
+// Device rates to RecorderParams rates the capture path converts between.
+static const RateCase RATE_CASES[] = {
+        {"48000_44100_stereo", 48000, 44100, 2},
+        {"44100_48000_stereo", 44100, 48000, 2},
+        {"16000_48000_mono", 16000, 48000, 1},
+        {"48000_16000_mono", 48000, 16000, 1},
+};
+
+// Input block sizes of the streaming test, cycled: single frames, odd sizes and blocks longer than the filter.
+static const int STREAM_BLOCKS[] = {1, 7, 480, 1023, 13, 4096, 2};
+
+static uint32_t next_random(uint32_t &state) {
+    state = state * 1664525u + 1013904223u;
+    return state;
+}
+
+/**
+ * Uniform noise over the whole range, starting with the extremes.
+ * */
+static vector<int16_t> noise_s16(size_t count, uint32_t seed) {
+    vector<int16_t> samples(count);
+    for (size_t i = 0; i < count; i++) {
+        samples[i] = (int16_t)(next_random(seed) >> 16);
+    }
+    if (count >= 2) {
+        samples[0] = INT16_MIN;
+        samples[1] = INT16_MAX;
+    }
+    return samples;
+}
+
+/**
+ * Resample src in blocks of the given sizes, cycled, and collect the output.
+ * overflow is set when a block gives more frames than getMaxOutputFrames promised.
+ * */
+static vector<int16_t> resample(const RateCase &c, const vector<int16_t> &src, const vector<int> &blocks,
+                                bool &overflow) {
+    int frames = (int)(src.size() / c.channels);
+    int maxBlock = *max_element(blocks.begin(), blocks.end());
+    Resampler resampler(c.inputRate, c.outputRate, c.channels, maxBlock);
+    vector<int16_t> out, buffer((size_t)resampler.getMaxOutputFrames(maxBlock) * c.channels);
+    overflow = false;
+    for (int pos = 0, i = 0; pos < frames; i++) {
+        int n = min(blocks[i % blocks.size()], frames - pos);
+        int count = resampler.process(src.data() + (size_t)pos * c.channels, n, buffer.data());
+        overflow |= count > resampler.getMaxOutputFrames(n);
+        out.insert(out.end(), buffer.begin(), buffer.begin() + (size_t)count * c.channels);
+        pos += n;
+    }
+    return out;
+}
+
+static vector<int16_t> resample(const RateCase &c, const vector<int16_t> &src) {
+    bool overflow;
+    return resample(c, src, {(int)(src.size() / c.channels)}, overflow);
+}
+
+/**
+ * Left channel of a sine of hz at rate, the other channels silent.
+ * */
+static vector<int16_t> sine_s16(int rate, int channels, double hz, int frames) {
+    vector<int16_t> samples((size_t)frames * channels);
+    for (int i = 0; i < frames; i++) {
+        samples[(size_t)i * channels] = (int16_t)lrint(SINE_AMPLITUDE * sin(2 * M_PI * hz * i / rate));
+    }
+    return samples;
+}
+
+/**
+ * Least squares fit of a sine of hz to the left channel of frames [first, last), and the
+ * ratio of its power to that of everything else in dB.
+ * */
+static double sine_snr_db(const vector<int16_t> &samples, int channels, int rate, double hz, int first, int last) {
+    double ss = 0, sc = 0, cc = 0, xs = 0, xc = 0;
+    for (int i = first; i < last; i++) {
+        double s = sin(2 * M_PI * hz * i / rate), c = cos(2 * M_PI * hz * i / rate);
+        double x = samples[(size_t)i * channels];
+        ss += s * s;
+        sc += s * c;
+        cc += c * c;
+        xs += x * s;
+        xc += x * c;
+    }
+    double det = ss * cc - sc * sc;
+    double a = (xs * cc - xc * sc) / det, b = (xc * ss - xs * sc) / det;
+    double signal = 0, noise = 0;
+    for (int i = first; i < last; i++) {
+        double fit = a * sin(2 * M_PI * hz * i / rate) + b * cos(2 * M_PI * hz * i / rate);
+        double error = samples[(size_t)i * channels] - fit;
+        signal += fit * fit;
+        noise += error * error;
+    }
+    return 10 * log10(signal / max(noise, 1e-9));
+}
+
+template<typename T>
+static bool same(const vector<T> &a, const vector<T> &b) {
+    return a.size() == b.size() && memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0;
+}
+
+/**
+ * Every conversion, the channel mixing and the resampler (pcm_polyphase) with each kernel variant,
+ * bit for bit against the scalar kernels.
+ * */
+static void checkDspVariants(Suite &suite) {
+    const char *name = "dsp_simd";
+    if (!matchFilter(name, suite.filter)) {
+        return;
+    }
+    vector<int16_t> s16 = noise_s16(DSP_SAMPLES, 1);
+    vector<int32_t> s32(DSP_SAMPLES);
+    vector<float> f32(DSP_SAMPLES);
+    uint32_t seed = 2;
+    for (size_t i = 0; i < s32.size(); i++) {
+        s32[i] = (int32_t)next_random(seed);
+        // Beyond [-1, 1) as well, those must clip the same way.
+        f32[i] = ((int32_t)next_random(seed) >> 8) * (1.5f / (1 << 23));
+    }
+    s32[0] = INT32_MIN;
+    s32[1] = INT32_MAX;
+    vector<int16_t> stereo = noise_s16(DSP_SAMPLES * 2, 3);
+    vector<int16_t> resampleInput = noise_s16((size_t)48000 * RESAMPLE_SECONDS * 2, 4);
+
+    struct Outputs {
+        vector<float> s16ToF32, s32ToF32;
+        vector<int16_t> f32ToS16, s32ToS16, stereoToMono, monoToStereo;
+        vector<int32_t> f32ToS32, s16ToS32;
+        vector<vector<int16_t>> resampled;
+    };
+    char previous[64];
+    cpu_features_to_string(dispatch_features(), previous, sizeof(previous));
+    uint32_t masks[8];
+    int count = dispatch_variants(masks, 8);
+    Outputs scalar;
+    for (int v = 0; v < count; v++) {
+        char features[64];
+        cpu_features_to_string(masks[v], features, sizeof(features));
+        dispatch_set_override(features);
+        Outputs o;
+        o.s16ToF32.resize(DSP_SAMPLES);
+        o.s32ToF32.resize(DSP_SAMPLES);
+        o.f32ToS16.resize(DSP_SAMPLES);
+        o.s32ToS16.resize(DSP_SAMPLES);
+        o.f32ToS32.resize(DSP_SAMPLES);
+        o.s16ToS32.resize(DSP_SAMPLES);
+        o.stereoToMono.resize(DSP_SAMPLES);
+        o.monoToStereo.resize(DSP_SAMPLES * 2);
+        pcm_s16_to_f32(s16.data(), o.s16ToF32.data(), DSP_SAMPLES);
+        pcm_s32_to_f32(s32.data(), o.s32ToF32.data(), DSP_SAMPLES);
+        pcm_f32_to_s16(f32.data(), o.f32ToS16.data(), DSP_SAMPLES);
+        pcm_s32_to_s16(s32.data(), o.s32ToS16.data(), DSP_SAMPLES);
+        pcm_f32_to_s32(f32.data(), o.f32ToS32.data(), DSP_SAMPLES);
+        pcm_s16_to_s32(s16.data(), o.s16ToS32.data(), DSP_SAMPLES);
+        pcm_mix_s16(stereo.data(), 2, o.stereoToMono.data(), 1, DSP_SAMPLES);
+        pcm_mix_s16(s16.data(), 1, o.monoToStereo.data(), 2, DSP_SAMPLES);
+        for (auto &c : RATE_CASES) {
+            vector<int16_t> input(resampleInput.begin(),
+                                  resampleInput.begin() + (size_t)c.inputRate * RESAMPLE_SECONDS * c.channels);
+            o.resampled.push_back(resample(c, input));
+        }
+        if (v == 0) {
+            scalar = o;
+            continue;
+        }
+        check(suite, same(o.s16ToF32, scalar.s16ToF32), "%s: pcm_s16_to_f32 with %s differs from scalar", name,
+              features);
+        check(suite, same(o.s32ToF32, scalar.s32ToF32), "%s: pcm_s32_to_f32 with %s differs from scalar", name,
+              features);
+        check(suite, same(o.f32ToS16, scalar.f32ToS16), "%s: pcm_f32_to_s16 with %s differs from scalar", name,
+              features);
+        check(suite, same(o.s32ToS16, scalar.s32ToS16), "%s: pcm_s32_to_s16 with %s differs from scalar", name,
+              features);
+        check(suite, same(o.f32ToS32, scalar.f32ToS32), "%s: pcm_f32_to_s32 with %s differs from scalar", name,
+              features);
+        check(suite, same(o.s16ToS32, scalar.s16ToS32), "%s: pcm_s16_to_s32 with %s differs from scalar", name,
+              features);
+        check(suite, same(o.stereoToMono, scalar.stereoToMono), "%s: stereo to mono with %s differs from scalar",
+              name, features);
+        check(suite, same(o.monoToStereo, scalar.monoToStereo), "%s: mono to stereo with %s differs from scalar",
+              name, features);
+        for (size_t i = 0; i < o.resampled.size(); i++) {
+            check(suite, same(o.resampled[i], scalar.resampled[i]), "%s: resample %s with %s differs from scalar",
+                  name, RATE_CASES[i].name, features);
+        }
+    }
+    dispatch_set_override(previous);
+    LOGD(TAG, "%s: %d kernel variants", name, count);
+}
+
+/**
+ * s16 -> s32 -> s16 and s16 -> f32 -> s16 give back every s16 value, and s32 -> s16 rounds the high half
+ * to nearest with ties up and saturates, against an int64 reference.
+ * */
+static void checkPcmRounding(Suite &suite) {
+    const char *name = "dsp_rounding";
+    if (!matchFilter(name, suite.filter)) {
+        return;
+    }
+    vector<int16_t> all(1 << 16), back(all.size());
+    for (size_t i = 0; i < all.size(); i++) {
+        all[i] = (int16_t)(i - 32768);
+    }
+    vector<int32_t> s32(all.size());
+    vector<float> f32(all.size());
+    pcm_s16_to_s32(all.data(), s32.data(), (int)all.size());
+    pcm_s32_to_s16(s32.data(), back.data(), (int)all.size());
+    check(suite, back == all, "%s: s16 -> s32 -> s16 changed a value", name);
+    pcm_s16_to_f32(all.data(), f32.data(), (int)all.size());
+    pcm_f32_to_s16(f32.data(), back.data(), (int)all.size());
+    check(suite, back == all, "%s: s16 -> f32 -> s16 changed a value", name);
+
+    // Every high half with the low halves around the rounding point, then the ends of the range.
+    vector<int32_t> values;
+    for (int32_t high = -32768; high < 32768; high += 7) {
+        for (int32_t low : {0, 1, 0x7FFF, 0x8000, 0x8001, 0xFFFF}) {
+            values.push_back((int32_t)((uint32_t)high << 16 | (uint32_t)low));
+        }
+    }
+    values.insert(values.end(), {INT32_MIN, INT32_MIN + 1, INT32_MAX, INT32_MAX - 0x8000, 0x7FFF7FFF, -1, 0});
+    vector<int16_t> rounded(values.size());
+    pcm_s32_to_s16(values.data(), rounded.data(), (int)values.size());
+    int errors = 0;
+    size_t firstError = 0;
+    for (size_t i = 0; i < values.size(); i++) {
+        int64_t expected = ((int64_t)values[i] + 0x8000) >> 16;
+        expected = max<int64_t>(INT16_MIN, min<int64_t>(INT16_MAX, expected));
+        if (rounded[i] != expected && errors++ == 0) {
+            firstError = i;
+        }
+    }
+    check(suite, errors == 0, "%s: pcm_s32_to_s16 wrong for %d values, first %d -> %d", name, errors,
+          errors > 0 ? values[firstError] : 0, errors > 0 ? rounded[firstError] : 0);
+}
+
+/**
+ * Streaming in blocks of changing sizes gives the same samples as one block, and no block writes
+ * more than getMaxOutputFrames.
+ * */
+static void checkResampleBlocks(Suite &suite) {
+    const char *name = "resample_blocks";
+    if (!matchFilter(name, suite.filter)) {
+        return;
+    }
+    vector<int> blocks(STREAM_BLOCKS, STREAM_BLOCKS + sizeof(STREAM_BLOCKS) / sizeof(STREAM_BLOCKS[0]));
+    for (auto &c : RATE_CASES) {
+        vector<int16_t> input = noise_s16((size_t)c.inputRate * RESAMPLE_SECONDS * c.channels, 5);
+        vector<int16_t> whole = resample(c, input);
+        bool overflow;
+        vector<int16_t> streamed = resample(c, input, blocks, overflow);
+        check(suite, streamed == whole, "%s: %s in blocks gives %zu samples, not the %zu of one block", name, c.name,
+              streamed.size(), whole.size());
+        check(suite, !overflow, "%s: %s wrote more than getMaxOutputFrames", name, c.name);
+        // The output lags by the filter delay, but every input frame produces its share.
+        int64_t expected = (int64_t)input.size() / c.channels * c.outputRate / c.inputRate;
+        int64_t frames = (int64_t)whole.size() / c.channels;
+        check(suite, llabs(frames - expected) <= 1, "%s: %s gave %lld frames, expected %lld", name, c.name,
+              (long long)frames, (long long)expected);
+    }
+}
+
+/**
+ * A 1 kHz sine comes out as a sine with MIN_SINE_SNR_DB, and tones above the output Nyquist
+ * frequency come out at least MIN_STOPBAND_DB down.
+ * */
+static void checkResampleQuality(Suite &suite) {
+    const char *name = "resample_quality";
+    if (!matchFilter(name, suite.filter)) {
+        return;
+    }
+    for (auto &c : RATE_CASES) {
+        vector<int16_t> out = resample(c, sine_s16(c.inputRate, c.channels, SINE_HZ, c.inputRate * RESAMPLE_SECONDS));
+        int frames = (int)(out.size() / c.channels);
+        int skip = c.outputRate * SINE_SKIP_MS / 1000;
+        double snr = sine_snr_db(out, c.channels, c.outputRate, SINE_HZ, skip, frames - skip);
+        check(suite, snr >= MIN_SINE_SNR_DB, "%s: %s sine SNR %.1f dB, expected at least %.1f", name, c.name, snr,
+              MIN_SINE_SNR_DB);
+        LOGD(TAG, "%s: %s sine SNR %.1f dB", name, c.name, snr);
+    }
+
+    const RateCase &down = RATE_CASES[3];
+    for (int hz : {STOPBAND_HZ_LOW, STOPBAND_HZ_HIGH}) {
+        vector<int16_t> out = resample(down, sine_s16(down.inputRate, 1, hz, down.inputRate * RESAMPLE_SECONDS));
+        int skip = down.outputRate * SINE_SKIP_MS / 1000;
+        double power = 0;
+        for (size_t i = skip; i + skip < out.size(); i++) {
+            power += (double)out[i] * out[i];
+        }
+        double rms = sqrt(power / max<size_t>(1, out.size() - 2 * skip));
+        double db = 20 * log10(SINE_AMPLITUDE / sqrt(2.0) / max(rms, 1e-9));
+        check(suite, db >= MIN_STOPBAND_DB, "%s: %s %d Hz only %.1f dB down, expected at least %.1f", name,
+              down.name, hz, db, MIN_STOPBAND_DB);
+        LOGD(TAG, "%s: %s %d Hz %.1f dB down", name, down.name, hz, db);
+    }
+}
+
+int run_audio_check(const char *filter) {
+    Suite suite;
+    suite.filter = filter;
+    checkRingThreads(suite);
+    checkRingFull(suite);
+    checkCaptureFile(suite, false);
+    checkCaptureFile(suite, true);
+    checkCaptureDrop(suite);
+    checkDspVariants(suite);
+    checkPcmRounding(suite);
+    checkResampleBlocks(suite);
+    checkResampleQuality(suite);
+    if (suite.failures > 0) {
+        LOGE(TAG, "%d of %d checks failed", suite.failures, suite.checks);
+    } else {
+        LOGD(TAG, "all %d checks passed", suite.checks);
+    }
+    return suite.failures;
+}
@@ -0,0 +1,26 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#ifndef CAMERAUTIL_AUDIO_CHECK_H
+#define CAMERAUTIL_AUDIO_CHECK_H
+
+/**
+ * 音频采集和处理路径的自测，不需要麦克风，在Linux主机上运行（camerautil_host audio）。
+ *
+ * 1. PcmRing：生产者、消费者两个线程以不同的块大小读写递增序列，消费者检查序列没有缺失、重复和错位；
+ *    单线程下检查环满时整块丢弃、丢弃的字节数，以及绕过缓冲区末尾的读写。
+ * 2. AudioCapture + FilePcmSource：每帧写入自己的序号，不限速和按实时速度读取时，
+ *    read得到的字节与文件完全相同，帧数一致且没有丢弃；
+ *    环形缓冲区很小、消费者来晚时，丢弃的是整个周期，收到的帧按顺序，收到的加丢弃的等于文件大小。
+ * 3. audio_dsp：每个kernel变体的格式转换、声道混合和重采样（pcm_polyphase）与scalar逐位相同；
+ *    s16经s32、f32转回s16不变，s32 -> s16按int64参考值四舍五入并饱和；
+ *    重采样分块流式处理与一次处理整段的结果相同；1 kHz正弦的信噪比不低于70 dB，
+ *    48000 -> 16000 Hz时高于输出奈奎斯特频率的单音至少衰减60 dB。
+ *
+ * 临时PCM文件写在$TMPDIR（默认/tmp）下，结束后删除。
+ * filter为空时运行全部测试，否则只运行名字中包含filter的测试。返回失败的检查数，0表示全部通过。
+ * */
+int run_audio_check(const char *filter);
+
+#endif //CAMERAUTIL_AUDIO_CHECK_H
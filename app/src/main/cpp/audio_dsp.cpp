@@ -0,0 +1,452 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#include "audio_dsp.h"
+#include "dispatch.h"
+#include "cpu_features.h"
+#include "simd.h"
+#include "log.h"
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+using namespace std;
+
+#define TAG "audio_dsp.cpp"
+
+// Q14 coefficients: the absolute sum of a phase stays below 2.5, so full scale input can not overflow the int32 sum.
+#define COEFFICIENT_BITS 14
+// Largest float below 2^31, the f32 -> s32 clip.
+#define F32_S32_MAX 2147483520.0f
+
+static inline int16_t sat_s16(int32_t n) {
+    return (int16_t)(n < -32768 ? -32768 : (n > 32767 ? 32767 : n));
+}
+
+static inline float clip_f32(float f) {
+    return f < -1.0f ? -1.0f : (f > 1.0f ? 1.0f : f);
+}
+
+static void pcm_s16_to_f32_c(const int16_t *src, float *dst, int count) {
+    for (int i = 0; i < count; i++) {
+        dst[i] = src[i] * (1.0f / 32768);
+    }
+}
+
+static void pcm_f32_to_s16_c(const float *src, int16_t *dst, int count) {
+    for (int i = 0; i < count; i++) {
+        dst[i] = sat_s16((int32_t)lrintf(clip_f32(src[i]) * 32768));
+    }
+}
+
+static void pcm_s32_to_f32_c(const int32_t *src, float *dst, int count) {
+    for (int i = 0; i < count; i++) {
+        dst[i] = (float)src[i] * (1.0f / 2147483648.0f);
+    }
+}
+
+static void pcm_f32_to_s32_c(const float *src, int32_t *dst, int count) {
+    for (int i = 0; i < count; i++) {
+        dst[i] = (int32_t)lrintf(std::min(clip_f32(src[i]) * 2147483648.0f, F32_S32_MAX));
+    }
+}
+
+/**
+ * (n >> 16) plus bit 15, the rounded high half without the overflow of n + 0x8000.
+ * */
+static void pcm_s32_to_s16_c(const int32_t *src, int16_t *dst, int count) {
+    for (int i = 0; i < count; i++) {
+        dst[i] = sat_s16((src[i] >> 15) - (src[i] >> 16));
+    }
+}
+
+static void pcm_s16_to_s32_c(const int16_t *src, int32_t *dst, int count) {
+    for (int i = 0; i < count; i++) {
+        dst[i] = (int32_t)((uint32_t)(int32_t)src[i] << 16);
+    }
+}
+
+static void pcm_stereo_to_mono_c(const int16_t *src, int16_t *dst, int frames) {
+    for (int i = 0; i < frames; i++) {
+        dst[i] = (int16_t)((src[i * 2] + src[i * 2 + 1] + 1) >> 1);
+    }
+}
+
+static void pcm_mono_to_stereo_c(const int16_t *src, int16_t *dst, int frames) {
+    for (int i = 0; i < frames; i++) {
+        dst[i * 2] = src[i];
+        dst[i * 2 + 1] = src[i];
+    }
+}
+
+/**
+ * count outputs of one channel. Output k is the dot product of phase bank and the
+ * taps inputs ending at index, then (index, phase) advance by step / phases.
+ * */
+static void pcm_polyphase_c(const int16_t *src, const int16_t *bank, int taps, int phases, int step, int index,
+                            int phase, int16_t *dst, int dstStride, int count) {
+    int stepIndex = step / phases, stepPhase = step % phases;
+    for (int k = 0; k < count; k++) {
+        const int16_t *x = src + index - (taps - 1);
+        const int16_t *h = bank + phase * taps;
+        int32_t sum = 0;
+        for (int t = 0; t < taps; t++) {
+            sum += x[t] * h[t];
+        }
+        dst[k * dstStride] = sat_s16((sum + (1 << (COEFFICIENT_BITS - 1))) >> COEFFICIENT_BITS);
+        index += stepIndex;
+        phase += stepPhase;
+        if (phase >= phases) {
+            phase -= phases;
+            index++;
+        }
+    }
+}
+
+#if SIMD_128
+static void pcm_s16_to_f32_simd(const int16_t *src, float *dst, int count) {
+    const v_f32x4 scale = v_dup_f32(1.0f / 32768);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        v_s16x8 s = v_load_s16x8(src + i);
+        v_store(dst + i, v_mul(v_cvt_f32(v_expand_lo(s)), scale));
+        v_store(dst + i + 4, v_mul(v_cvt_f32(v_expand_hi(s)), scale));
+    }
+    pcm_s16_to_f32_c(src + i, dst + i, count - i);
+}
+
+static void pcm_f32_to_s16_simd(const float *src, int16_t *dst, int count) {
+    const v_f32x4 scale = v_dup_f32(32768), low = v_dup_f32(-1.0f), high = v_dup_f32(1.0f);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        v_f32x4 a = v_min(v_max(v_load_f32x4(src + i), low), high);
+        v_f32x4 b = v_min(v_max(v_load_f32x4(src + i + 4), low), high);
+        v_store(dst + i, v_narrow_sat_s16(v_round_s32(v_mul(a, scale)), v_round_s32(v_mul(b, scale))));
+    }
+    pcm_f32_to_s16_c(src + i, dst + i, count - i);
+}
+
+static void pcm_s32_to_f32_simd(const int32_t *src, float *dst, int count) {
+    const v_f32x4 scale = v_dup_f32(1.0f / 2147483648.0f);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        v_store(dst + i, v_mul(v_cvt_f32(v_load_s32x4(src + i)), scale));
+    }
+    pcm_s32_to_f32_c(src + i, dst + i, count - i);
+}
+
+static void pcm_f32_to_s32_simd(const float *src, int32_t *dst, int count) {
+    const v_f32x4 scale = v_dup_f32(2147483648.0f), low = v_dup_f32(-1.0f), high = v_dup_f32(1.0f);
+    const v_f32x4 limit = v_dup_f32(F32_S32_MAX);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        v_f32x4 f = v_min(v_max(v_load_f32x4(src + i), low), high);
+        v_store(dst + i, v_round_s32(v_min(v_mul(f, scale), limit)));
+    }
+    pcm_f32_to_s32_c(src + i, dst + i, count - i);
+}
+
+static void pcm_s32_to_s16_simd(const int32_t *src, int16_t *dst, int count) {
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        v_s32x4 a = v_load_s32x4(src + i), b = v_load_s32x4(src + i + 4);
+        v_store(dst + i, v_narrow_sat_s16(v_sub(v_shr<15>(a), v_shr<16>(a)), v_sub(v_shr<15>(b), v_shr<16>(b))));
+    }
+    pcm_s32_to_s16_c(src + i, dst + i, count - i);
+}
+
+static void pcm_s16_to_s32_simd(const int16_t *src, int32_t *dst, int count) {
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        v_s16x8 s = v_load_s16x8(src + i);
+        v_store(dst + i, v_shl<16>(v_expand_lo(s)));
+        v_store(dst + i + 4, v_shl<16>(v_expand_hi(s)));
+    }
+    pcm_s16_to_s32_c(src + i, dst + i, count - i);
+}
+
+static void pcm_stereo_to_mono_simd(const int16_t *src, int16_t *dst, int frames) {
+    int i = 0;
+    for (; i + 8 <= frames; i += 8) {
+        v_s16x8 left, right;
+        v_load_deinterleave(src + i * 2, left, right);
+        v_s32x4 lo = v_rshr<1>(v_add(v_expand_lo(left), v_expand_lo(right)));
+        v_s32x4 hi = v_rshr<1>(v_add(v_expand_hi(left), v_expand_hi(right)));
+        v_store(dst + i, v_narrow_sat_s16(lo, hi));
+    }
+    pcm_stereo_to_mono_c(src + i * 2, dst + i, frames - i);
+}
+
+static void pcm_mono_to_stereo_simd(const int16_t *src, int16_t *dst, int frames) {
+    int i = 0;
+    for (; i + 8 <= frames; i += 8) {
+        v_s16x8 s = v_load_s16x8(src + i), lo, hi;
+        v_zip(s, s, lo, hi);
+        v_store(dst + i * 2, lo);
+        v_store(dst + i * 2 + 8, hi);
+    }
+    pcm_mono_to_stereo_c(src + i, dst + i * 2, frames - i);
+}
+
+static void pcm_polyphase_simd(const int16_t *src, const int16_t *bank, int taps, int phases, int step, int index,
+                               int phase, int16_t *dst, int dstStride, int count) {
+    int stepIndex = step / phases, stepPhase = step % phases;
+    for (int k = 0; k < count; k++) {
+        const int16_t *x = src + index - (taps - 1);
+        const int16_t *h = bank + phase * taps;
+        v_s32x4 acc = v_dup_s32(0);
+        for (int t = 0; t < taps; t += 8) {
+            acc = v_dotprod(acc, v_load_s16x8(x + t), v_load_s16x8(h + t));
+        }
+        int32_t sum = v_reduce_sum(acc);
+        dst[k * dstStride] = sat_s16((sum + (1 << (COEFFICIENT_BITS - 1))) >> COEFFICIENT_BITS);
+        index += stepIndex;
+        phase += stepPhase;
+        if (phase >= phases) {
+            phase -= phases;
+            index++;
+        }
+    }
+}
+#endif
+
+void audio_dsp_fill_kernels(KernelTable &table, uint32_t features) {
+    table.pcmS16ToF32 = pcm_s16_to_f32_c;
+    table.pcmF32ToS16 = pcm_f32_to_s16_c;
+    table.pcmS32ToF32 = pcm_s32_to_f32_c;
+    table.pcmF32ToS32 = pcm_f32_to_s32_c;
+    table.pcmS32ToS16 = pcm_s32_to_s16_c;
+    table.pcmS16ToS32 = pcm_s16_to_s32_c;
+    table.pcmStereoToMono = pcm_stereo_to_mono_c;
+    table.pcmMonoToStereo = pcm_mono_to_stereo_c;
+    table.pcmPolyphase = pcm_polyphase_c;
+#if SIMD_128
+    if (features & SIMD_128_FEATURE) {
+        table.pcmS16ToF32 = pcm_s16_to_f32_simd;
+        table.pcmF32ToS16 = pcm_f32_to_s16_simd;
+        table.pcmS32ToF32 = pcm_s32_to_f32_simd;
+        table.pcmF32ToS32 = pcm_f32_to_s32_simd;
+        table.pcmS32ToS16 = pcm_s32_to_s16_simd;
+        table.pcmS16ToS32 = pcm_s16_to_s32_simd;
+        table.pcmStereoToMono = pcm_stereo_to_mono_simd;
+        table.pcmMonoToStereo = pcm_mono_to_stereo_simd;
+        table.pcmPolyphase = pcm_polyphase_simd;
+    }
+#endif
+}
+
+void pcm_s16_to_f32(const int16_t *src, float *dst, int count) {
+    kernel_table().pcmS16ToF32(src, dst, count);
+}
+
+void pcm_f32_to_s16(const float *src, int16_t *dst, int count) {
+    kernel_table().pcmF32ToS16(src, dst, count);
+}
+
+void pcm_s32_to_f32(const int32_t *src, float *dst, int count) {
+    kernel_table().pcmS32ToF32(src, dst, count);
+}
+
+void pcm_f32_to_s32(const float *src, int32_t *dst, int count) {
+    kernel_table().pcmF32ToS32(src, dst, count);
+}
+
+void pcm_s32_to_s16(const int32_t *src, int16_t *dst, int count) {
+    kernel_table().pcmS32ToS16(src, dst, count);
+}
+
+void pcm_s16_to_s32(const int16_t *src, int32_t *dst, int count) {
+    kernel_table().pcmS16ToS32(src, dst, count);
+}
+
+void pcm_mix_s16(const int16_t *src, int srcChannels, int16_t *dst, int dstChannels, int frames) {
+    const KernelTable &kt = kernel_table();
+    if (srcChannels == dstChannels) {
+        memcpy(dst, src, sizeof(int16_t) * frames * srcChannels);
+    } else if (srcChannels == 2 && dstChannels == 1) {
+        kt.pcmStereoToMono(src, dst, frames);
+    } else if (srcChannels == 1 && dstChannels == 2) {
+        kt.pcmMonoToStereo(src, dst, frames);
+    } else if (dstChannels == 1) {
+        for (int i = 0; i < frames; i++) {
+            int32_t sum = 0;
+            for (int c = 0; c < srcChannels; c++) {
+                sum += src[i * srcChannels + c];
+            }
+            dst[i] = (int16_t)lrintf((float)sum / srcChannels);
+        }
+    } else {
+        for (int i = 0; i < frames; i++) {
+            for (int c = 0; c < dstChannels; c++) {
+                int16_t s = 0;
+                if (srcChannels == 1) {
+                    s = src[i];
+                } else if (c < srcChannels) {
+                    s = src[i * srcChannels + c];
+                }
+                dst[i * dstChannels + c] = s;
+            }
+        }
+    }
+}
+
+/**
+ * Modified Bessel function of the first kind, order 0.
+ * */
+static double bessel_i0(double x) {
+    double sum = 1, term = 1;
+    for (int k = 1; k < 50 && term > sum * 1e-12; k++) {
+        term *= (x / (2 * k)) * (x / (2 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+static int gcd(int a, int b) {
+    while (b != 0) {
+        int t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+Resampler::Resampler(int inputRate, int outputRate, int channels, int maxInputFrames)
+        : channels(channels), maxInputFrames(maxInputFrames) {
+    int divisor = gcd(inputRate, outputRate);
+    phases = outputRate / divisor;
+    step = inputRate / divisor;
+    taps = RESAMPLER_TAPS;
+    if (step > phases) {
+        taps = (int)(((int64_t)RESAMPLER_TAPS * step / phases + 7) & ~7);
+    }
+    planeLength = taps - 1 + maxInputFrames;
+    if (phases == 1 && step == 1) {
+        // Same rate, process copies.
+        return;
+    }
+    planar.resize((size_t)planeLength * channels);
+
+    // Prototype low pass at the upsampled rate, cut at the lower Nyquist frequency.
+    int length = phases * taps;
+    double center = (length - 1) * 0.5;
+    double cutoff = 0.5 * RESAMPLER_CUTOFF / std::max(phases, step);
+    double windowScale = 1.0 / bessel_i0(RESAMPLER_KAISER_BETA);
+    vector<double> prototype(length);
+    for (int n = 0; n < length; n++) {
+        double t = n - center;
+        double x = 2 * cutoff * t;
+        double sinc = fabs(x) < 1e-12 ? 1.0 : sin(M_PI * x) / (M_PI * x);
+        double r = t / (center + 0.5);
+        double window = bessel_i0(RESAMPLER_KAISER_BETA * sqrt(std::max(0.0, 1 - r * r))) * windowScale;
+        prototype[n] = 2 * cutoff * sinc * window;
+    }
+
+    // Phase p tap t (oldest input first) is prototype[(taps - 1 - t) * phases + p],
+    // every phase normalized to a gain of exactly 1 << COEFFICIENT_BITS.
+    bank.resize((size_t)length);
+    for (int p = 0; p < phases; p++) {
+        double sum = 0;
+        for (int t = 0; t < taps; t++) {
+            sum += prototype[(taps - 1 - t) * phases + p];
+        }
+        int16_t *h = bank.data() + (size_t)p * taps;
+        int32_t total = 0, largest = 0;
+        for (int t = 0; t < taps; t++) {
+            double c = prototype[(taps - 1 - t) * phases + p] / sum * (1 << COEFFICIENT_BITS);
+            h[t] = sat_s16((int32_t)lround(c));
+            total += h[t];
+            if (h[t] > h[largest]) {
+                largest = t;
+            }
+        }
+        h[largest] = sat_s16(h[largest] + (1 << COEFFICIENT_BITS) - total);
+    }
+    LOGD(TAG, "resample %d -> %d Hz, %d phases of %d taps, step %d", inputRate, outputRate, phases, taps, step);
+    reset();
+}
+
+void Resampler::reset() {
+    std::fill(planar.begin(), planar.end(), 0);
+    index = taps - 1;
+    phase = 0;
+}
+
+int Resampler::getMaxOutputFrames(int frames) const {
+    if (bank.empty()) {
+        return frames;
+    }
+    return (int)(((int64_t)frames * phases + step - 1) / step) + 1;
+}
+
+int Resampler::getMaxInputFrames(int outputFrames) const {
+    if (bank.empty()) {
+        return std::min(outputFrames, maxInputFrames);
+    }
+    if (outputFrames <= 1) {
+        return 0;
+    }
+    return (int)std::min((int64_t)maxInputFrames, (int64_t)(outputFrames - 1) * step / phases);
+}
+
+int Resampler::process(const int16_t *src, int frames, int16_t *dst) {
+    frames = std::min(frames, maxInputFrames);
+    if (bank.empty()) {
+        memcpy(dst, src, sizeof(int16_t) * frames * channels);
+        return frames;
+    }
+    const int history = taps - 1;
+    for (int c = 0; c < channels; c++) {
+        int16_t *plane = planar.data() + (size_t)c * planeLength + history;
+        for (int i = 0; i < frames; i++) {
+            plane[i] = src[i * channels + c];
+        }
+    }
+
+    // Outputs whose newest input is in this block: floor((phase + k * step) / phases) <= last - index
+    int last = history + frames - 1;
+    int count = 0;
+    if (index <= last) {
+        count = (int)((((int64_t)last - index + 1) * phases - phase + step - 1) / step);
+    }
+    const KernelTable &kt = kernel_table();
+    for (int c = 0; c < channels; c++) {
+        kt.pcmPolyphase(planar.data() + (size_t)c * planeLength, bank.data(), taps, phases, step, index, phase,
+                        dst + c, channels, count);
+    }
+    int64_t advance = phase + (int64_t)count * step;
+    index += (int)(advance / phases);
+    phase = (int)(advance % phases);
+
+    // Keep the newest inputs as the history of the next block.
+    for (int c = 0; c < channels; c++) {
+        int16_t *plane = planar.data() + (size_t)c * planeLength;
+        memmove(plane, plane + frames, sizeof(int16_t) * history);
+    }
+    index -= frames;
+    return count;
+}
+
+PcmConverter::PcmConverter(int inputRate, int inputChannels, int outputRate, int outputChannels, int maxInputFrames)
+        : inputChannels(inputChannels), outputChannels(outputChannels), mixFirst(outputChannels <= inputChannels),
+          resampler(inputRate, outputRate, mixFirst ? outputChannels : inputChannels, maxInputFrames) {
+    if (mixFirst) {
+        scratch.resize((size_t)maxInputFrames * outputChannels);
+    } else {
+        scratch.resize((size_t)resampler.getMaxOutputFrames(maxInputFrames) * inputChannels);
+    }
+}
+
+int PcmConverter::process(const int16_t *src, int frames, int16_t *dst) {
+    if (mixFirst) {
+        if (inputChannels == outputChannels) {
+            return resampler.process(src, frames, dst);
+        }
+        pcm_mix_s16(src, inputChannels, scratch.data(), outputChannels, frames);
+        return resampler.process(scratch.data(), frames, dst);
+    }
+    int count = resampler.process(src, frames, scratch.data());
+    pcm_mix_s16(scratch.data(), inputChannels, dst, outputChannels, count);
+    return count;
+}
@@ -0,0 +1,124 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#ifndef CAMERAUTIL_AUDIO_DSP_H
+#define CAMERAUTIL_AUDIO_DSP_H
+
+#include <stdint.h>
+#include <vector>
+
+/**
+ * 录音用的PCM处理：采样格式转换、声道混合、重采样，放在采集（audio_capture）和AudioEncoder之间，
+ * 麦克风按设备原生的采样率和声道采集，输出RecorderParams要求的格式，不依赖AudioRecord内部的重采样。
+ *
+ * 重采样是多相（polyphase）加窗sinc滤波：输入输出采样率之比约分为L/M，
+ * 原型低通滤波器（Kaiser窗，截止频率为两者中较低的奈奎斯特频率）拆成L个相位，
+ * 每个相位taps个Q14系数（降采样时按M/L放大，保持过渡带相对输出采样率的宽度），
+ * 构造时一次算好，每个相位的系数和归一化为1。
+ * 每个输出样本是一个相位的系数与最近taps个输入样本的点积（SIMD）。
+ *
+ * 流式处理：每块输入的各声道先拆成平面格式接在上一块留下的taps - 1帧历史后面，
+ * 所有缓冲区在构造时按maxInputFrames分配，处理时不分配内存。
+ * */
+
+// Taps per phase when upsampling, a multiple of 8. Downsampling by M / L uses about M / L times as many.
+#define RESAMPLER_TAPS 64
+// Passband edge as a fraction of the lower Nyquist frequency.
+#define RESAMPLER_CUTOFF 0.92
+// Kaiser window beta, about 80 dB stopband.
+#define RESAMPLER_KAISER_BETA 8.0
+
+/**
+ * Sample format conversions. Floats are in [-1, 1), larger values are clipped, rounding is to nearest.
+ * s32 -> s16 keeps the high 16 bits rounded, s16 -> s32 puts them there.
+ * */
+void pcm_s16_to_f32(const int16_t *src, float *dst, int count);
+void pcm_f32_to_s16(const float *src, int16_t *dst, int count);
+void pcm_s32_to_f32(const int32_t *src, float *dst, int count);
+void pcm_f32_to_s32(const float *src, int32_t *dst, int count);
+void pcm_s32_to_s16(const int32_t *src, int16_t *dst, int count);
+void pcm_s16_to_s32(const int16_t *src, int32_t *dst, int count);
+
+/**
+ * Interleaved s16 channel mixing. Same counts copy, 1 -> n duplicates, n -> 1 averages
+ * and 2 -> n / n -> 2 (n > 2) map front left / right and drop or silence the rest.
+ * src and dst must not overlap.
+ * */
+void pcm_mix_s16(const int16_t *src, int srcChannels, int16_t *dst, int dstChannels, int frames);
+
+class Resampler {
+public:
+    Resampler(int inputRate, int outputRate, int channels, int maxInputFrames);
+    Resampler(Resampler &) = delete;
+
+    /**
+     * Resample frames (at most maxInputFrames) interleaved frames into dst, which must hold
+     * getMaxOutputFrames(frames). Return the frames written.
+     * */
+    int process(const int16_t *src, int frames, int16_t *dst);
+
+    /**
+     * Upper bound of the output of process for frames input frames.
+     * */
+    int getMaxOutputFrames(int frames) const;
+
+    /**
+     * Largest input whose output surely fits outputFrames, limited to maxInputFrames.
+     * */
+    int getMaxInputFrames(int outputFrames) const;
+
+    /**
+     * Forget the history, the next block starts from silence.
+     * */
+    void reset();
+
+private:
+    int channels;
+    int maxInputFrames;
+    // output / input = phases / step
+    int phases, step;
+    // Coefficients per phase, a multiple of 8.
+    int taps;
+    std::vector<int16_t> bank;
+    // Per channel: taps - 1 frames of history, then up to maxInputFrames new frames.
+    std::vector<int16_t> planar;
+    int planeLength;
+    // Newest input of the next output, in planar frames, and its phase.
+    int index, phase;
+};
+
+/**
+ * Channel mixing and resampling of interleaved s16 in one step, for the capture path.
+ * */
+class PcmConverter {
+public:
+    PcmConverter(int inputRate, int inputChannels, int outputRate, int outputChannels, int maxInputFrames);
+    PcmConverter(PcmConverter &) = delete;
+
+    /**
+     * Same contract as Resampler::process, dst holds getMaxOutputFrames(frames) output frames.
+     * */
+    int process(const int16_t *src, int frames, int16_t *dst);
+
+    int getMaxOutputFrames(int frames) const {
+        return resampler.getMaxOutputFrames(frames);
+    }
+
+    int getMaxInputFrames(int outputFrames) const {
+        return resampler.getMaxInputFrames(outputFrames);
+    }
+
+    void reset() {
+        resampler.reset();
+    }
+
+private:
+    int inputChannels, outputChannels;
+    // Mix first when it reduces the channels, resample first otherwise.
+    bool mixFirst;
+    Resampler resampler;
+    std::vector<int16_t> scratch;
+};
+
+#endif //CAMERAUTIL_AUDIO_DSP_H
@@ -0,0 +1,1170 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#include "benchmark.h"
+#include "constants.h"
+#include "log.h"
+#include "convolution.h"
+#include "resize.h"
+#include "yuv_kernels.h"
+#include "yuv10_kernels.h"
+#include "lut3d.h"
+#include "raw_pipeline.h"
+#include "raw_unpack.h"
+#include "lens_shading.h"
+#include "burst_merge.h"
+#include "pyramid.h"
+#include "exposure_fusion.h"
+#include "warp.h"
+#include "lens_distortion.h"
+#include "audio_capture.h"
+#include "yuv_repack.h"
+#include "perf_counters.h"
+#include "frame_arena.h"
+#include "parallel.h"
+#include "dispatch.h"
+#include "cpu_features.h"
+#include "simd.h"
+#include <chrono>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <algorithm>
+#include <atomic>
+
+using namespace std;
+
+#define TAG "benchmark.cpp"
+
+#define FRAME_BUDGET_MS (1000.0 / 30)
+#define BENCHMARK_LOOP 20
+
+#define FRAME_WIDTH 1920
+#define FRAME_HEIGHT 1080
+
+// Buffer of the roofline kernels, well beyond the last level cache of any phone.
+#define ROOFLINE_BYTES (64 << 20)
+// Rows of the buffer handed to parallel_for_stripes
+#define ROOFLINE_BLOCK (64 << 10)
+#define ROOFLINE_LOOP 5
+
+static bool matchFilter(const char *name, const char *filter) {
+    return filter == nullptr || filter[0] == '\0' || strstr(name, filter) != nullptr;
+}
+
+/**
+ * Gradients plus a little pseudo random noise, so that neither flat areas nor edges dominate.
+ * */
+static void fillTestPattern(uint8_t *buffer, int width, int height, int stride, int channels) {
+    uint32_t seed = 0x12345678;
+    for (int row = 0; row < height; row++) {
+        for (int col = 0; col < width * channels; col++) {
+            seed = seed * 1664525 + 1013904223;
+            int value = (row * 255 / height + col * 255 / (width * channels)) / 2 + (int)(seed >> 28);
+            buffer[row * stride + col] = (uint8_t)(value > 255 ? 255 : value);
+        }
+    }
+}
+
+static int countMismatch(const uint8_t *a, const uint8_t *b, int width, int height, int stride, int channels) {
+    int count = 0;
+    for (int row = 0; row < height; row++) {
+        for (int col = 0; col < width * channels; col++) {
+            if (a[row * stride + col] != b[row * stride + col]) {
+                count++;
+            }
+        }
+    }
+    return count;
+}
+
+/**
+ * Largest difference of any channel between two RGBA buffers.
+ * */
+static int maxChannelError(const uint8_t *a, const uint8_t *b, int size) {
+    int maxError = 0;
+    for (int i = 0; i < size; i++) {
+        int error = abs((int)a[i] - (int)b[i]);
+        maxError = error > maxError ? error : maxError;
+    }
+    return maxError;
+}
+
+// Opened by run_native_benchmark, nullptr or unavailable when the system does not allow counting.
+static PerfCounters *perfCounters = nullptr;
+// Totals of the timed loop of the last measureMs.
+static PerfCounterValues lastCounters;
+// Blocks the frame arena took from the system in the timed loop of the last measureMs.
+static uint64_t lastArenaAllocations = 0;
+
+template<typename F>
+static double measureMs(F &&kernel) {
+    // The first run warms up caches and the thread pool.
+    kernel();
+    bool counting = perfCounters != nullptr && perfCounters->isAvailable();
+    FrameArenaStats arenaBefore, arenaAfter;
+    frame_arena_get_stats(arenaBefore);
+    if (counting) {
+        perfCounters->start();
+    }
+    chrono::time_point startTime = chrono::steady_clock::now();
+    for (int i = 0; i < BENCHMARK_LOOP; i++) {
+        kernel();
+    }
+    chrono::time_point endTime = chrono::steady_clock::now();
+    if (counting) {
+        perfCounters->stop(lastCounters);
+    }
+    frame_arena_get_stats(arenaAfter);
+    lastArenaAllocations = arenaAfter.systemAllocations - arenaBefore.systemAllocations;
+    return chrono::duration<double, milli>(endTime - startTime).count() / BENCHMARK_LOOP;
+}
+
+/**
+ * Achievable memory bandwidth in GB/s with every stripe thread busy, each byte read or written counted once.
+ * */
+struct Roofline {
+    double read = 0;
+    double write = 0;
+    double copy = 0;
+};
+
+// Measured by run_native_benchmark in roofline mode, all zero otherwise.
+static Roofline roofline;
+
+/**
+ * Best of ROOFLINE_LOOP runs, after one to fault in the pages.
+ * */
+template<typename F>
+static double bestGBps(double bytes, F &&kernel) {
+    kernel();
+    double best = 0;
+    for (int i = 0; i < ROOFLINE_LOOP; i++) {
+        chrono::time_point startTime = chrono::steady_clock::now();
+        kernel();
+        chrono::time_point endTime = chrono::steady_clock::now();
+        best = max(best, bytes / chrono::duration<double>(endTime - startTime).count() / 1e9);
+    }
+    return best;
+}
+
+/**
+ * Streaming read (a vector max over every byte), write (memset) and copy (memcpy) over a buffer
+ * far bigger than the caches, split into stripes like the kernels.
+ * */
+static Roofline measureRoofline() {
+    vector<uint8_t> a(ROOFLINE_BYTES, 1), b(ROOFLINE_BYTES, 2);
+    int blocks = ROOFLINE_BYTES / ROOFLINE_BLOCK;
+    atomic<uint32_t> sink{0};
+    Roofline result;
+    result.read = bestGBps(ROOFLINE_BYTES, [&] {
+        parallel_for_stripes(blocks, 1, [&](int blockStart, int blockEnd) {
+            const uint8_t *p = a.data() + (size_t)blockStart * ROOFLINE_BLOCK;
+            const uint8_t *end = a.data() + (size_t)blockEnd * ROOFLINE_BLOCK;
+            // Four independent chains so that loads, not the max, set the pace.
+            v_u8x16 m0 = v_dup_u8x16(0), m1 = m0, m2 = m0, m3 = m0;
+            for (; p < end; p += 64) {
+                m0 = v_max(m0, v_load_u8x16(p));
+                m1 = v_max(m1, v_load_u8x16(p + 16));
+                m2 = v_max(m2, v_load_u8x16(p + 32));
+                m3 = v_max(m3, v_load_u8x16(p + 48));
+            }
+            uint8_t lanes[16];
+            v_store(lanes, v_max(v_max(m0, m1), v_max(m2, m3)));
+            sink.fetch_add(lanes[0], memory_order_relaxed);
+        });
+    });
+    result.write = bestGBps(ROOFLINE_BYTES, [&] {
+        parallel_for_stripes(blocks, 1, [&](int blockStart, int blockEnd) {
+            // Not zero, which some libc memsets turn into cache line zeroing without a write stream.
+            size_t offset = (size_t)blockStart * ROOFLINE_BLOCK;
+            memset(b.data() + offset, 0x5A, (size_t)(blockEnd - blockStart) * ROOFLINE_BLOCK);
+        });
+    });
+    result.copy = bestGBps(2.0 * ROOFLINE_BYTES, [&] {
+        parallel_for_stripes(blocks, 1, [&](int blockStart, int blockEnd) {
+            size_t offset = (size_t)blockStart * ROOFLINE_BLOCK;
+            memcpy(b.data() + offset, a.data() + offset, (size_t)(blockEnd - blockStart) * ROOFLINE_BLOCK);
+        });
+    });
+    if (sink.load() == 0) {
+        LOGE(TAG, "roofline read kernel saw no data");
+    }
+    return result;
+}
+
+/**
+ * Memory traffic against the roofline: the shortest time the bytes can take is bounded by the read,
+ * the write and the combined (copy) bandwidth, whichever is slowest for this mix.
+ * */
+static void reportRoofline(const char *name, int width, int height, double readBytes, double writeBytes, double ms) {
+    if (roofline.copy <= 0) {
+        return;
+    }
+    double seconds = ms / 1000.0;
+    double bytes = readBytes + writeBytes;
+    double floorSeconds = max({readBytes / (roofline.read * 1e9), writeBytes / (roofline.write * 1e9),
+                               bytes / (roofline.copy * 1e9)});
+    LOGD(TAG, "%s: %.2f bytes/pixel (%.2f read, %.2f written), %.2f GB/s, %.0f%% of the memory roof", name,
+         bytes / ((double)width * height), readBytes / ((double)width * height), writeBytes / ((double)width * height),
+         bytes / seconds / 1e9, floorSeconds * 100.0 / seconds);
+}
+
+/**
+ * Counters of the last measureMs: instructions per cycle, bytes per cycle and events per 1000 pixels.
+ * */
+static void reportCounters(const char *name, int width, int height, double bytes) {
+    if (perfCounters == nullptr || !perfCounters->isAvailable()) {
+        return;
+    }
+    const PerfCounterValues &v = lastCounters;
+    double cycles = (double)max<int64_t>(v.values[PERF_CYCLES], 1);
+    double kilopixels = (double)width * height * BENCHMARK_LOOP / 1000.0;
+    char misses[160] = "";
+    size_t length = 0;
+    for (int id : {PERF_L1D_MISSES, PERF_LLC_MISSES, PERF_BRANCH_MISSES}) {
+        if (v.has(id)) {
+            length += snprintf(misses + length, sizeof(misses) - length, ", %s %.1f/kpix",
+                               PerfCounters::name(id), v.values[id] / kilopixels);
+        }
+    }
+    char stalled[48] = "";
+    if (v.has(PERF_STALLED_CYCLES)) {
+        snprintf(stalled, sizeof(stalled), ", %.0f%% cycles stalled", v.values[PERF_STALLED_CYCLES] * 100.0 / cycles);
+    }
+    LOGD(TAG, "%s: IPC %.2f, %.2f bytes/cycle, %.0f cycles/kpix%s%s", name, v.values[PERF_INSTRUCTIONS] / cycles,
+         bytes * BENCHMARK_LOOP / cycles, cycles / kilopixels, misses, stalled);
+}
+
+/**
+ * readBytes, writeBytes: what one call has to read and write, from the layout of the planes it takes
+ * and gives, each touched once. Tables and scratch buffers are not counted.
+ * mismatch < 0 means the kernel has no reference implementation to compare with.
+ * */
+static void report(const char *name, int width, int height, double readBytes, double writeBytes, double ms,
+                   int mismatch) {
+    double mpps = (double)width * height / (ms * 1000.0);
+    if (mismatch < 0) {
+        LOGD(TAG, "%s [%dx%d]: avg %.2f ms, %.1f MPix/s, %.0f%% of frame budget",
+             name, width, height, ms, mpps, ms * 100.0 / FRAME_BUDGET_MS);
+    } else {
+        LOGD(TAG, "%s [%dx%d]: avg %.2f ms, %.1f MPix/s, %.0f%% of frame budget, mismatch = %d",
+             name, width, height, ms, mpps, ms * 100.0 / FRAME_BUDGET_MS, mismatch);
+    }
+    reportCounters(name, width, height, readBytes + writeBytes);
+    reportRoofline(name, width, height, readBytes, writeBytes, ms);
+    if (lastArenaAllocations > 0) {
+        // Warm runs should find all their scratch on the free lists.
+        LOGD(TAG, "%s: %llu frame arena blocks allocated from the system after warm up", name,
+             (unsigned long long)lastArenaAllocations);
+    }
+}
+
+/**
+ * Run f(variantName) once for every kernel variant this CPU supports, scalar first.
+ * The previous kernel selection is restored afterwards.
+ * */
+template<typename F>
+static void forEachVariant(const char *name, F &&f) {
+    char previous[64];
+    cpu_features_to_string(dispatch_features(), previous, sizeof(previous));
+    uint32_t masks[8];
+    int count = dispatch_variants(masks, 8);
+    for (int i = 0; i < count; i++) {
+        char features[64];
+        cpu_features_to_string(masks[i], features, sizeof(features));
+        dispatch_set_override(features);
+        char variantName[128];
+        snprintf(variantName, sizeof(variantName), "%s@%s", name, features);
+        f(variantName);
+    }
+    dispatch_set_override(previous);
+}
+
+static void benchmarkConvolution(const char *filter) {
+    struct Case {
+        const char *name;
+        void (*init)(ConvKernel &);
+    } cases[] = {
+            {"sharpen", conv_kernel_sharpen},
+            {"blur", conv_kernel_blur},
+            {"edge", conv_kernel_edge},
+    };
+
+    for (int channels : {1, 4}) {
+        int stride = FRAME_WIDTH * channels;
+        vector<uint8_t> src(stride * FRAME_HEIGHT);
+        vector<uint8_t> dst(src.size()), ref(src.size());
+        fillTestPattern(src.data(), FRAME_WIDTH, FRAME_HEIGHT, stride, channels);
+
+        for (auto &c : cases) {
+            char name[64];
+            snprintf(name, sizeof(name), "conv_%s_%s", c.name, channels == 1 ? "y" : "rgba");
+            if (!matchFilter(name, filter)) {
+                continue;
+            }
+            ConvKernel kernel;
+            c.init(kernel);
+            convolve_reference(src.data(), stride, ref.data(), stride, FRAME_WIDTH, FRAME_HEIGHT, channels,
+                               kernel, BORDER_REPLICATE);
+            forEachVariant(name, [&](const char *variantName) {
+                double ms = measureMs([&] {
+                    if (channels == 1) {
+                        convolve_y(src.data(), stride, dst.data(), stride, FRAME_WIDTH, FRAME_HEIGHT,
+                                   kernel, BORDER_REPLICATE);
+                    } else {
+                        convolve_rgba(src.data(), stride, dst.data(), stride, FRAME_WIDTH, FRAME_HEIGHT,
+                                      kernel, BORDER_REPLICATE);
+                    }
+                });
+                int mismatch = countMismatch(dst.data(), ref.data(), FRAME_WIDTH, FRAME_HEIGHT, stride, channels);
+                report(variantName, FRAME_WIDTH, FRAME_HEIGHT, src.size(), dst.size(), ms, mismatch);
+            });
+        }
+    }
+}
+
+static void benchmarkResize(const char *filter) {
+    struct Case {
+        const char *name;
+        int srcWidth, srcHeight, dstWidth, dstHeight, channels, scaleType, filter;
+    } cases[] = {
+            {"resize_bilinear_rgba_720p", FRAME_WIDTH, FRAME_HEIGHT, 1280, 720, 4, SCALE_TYPE_SCALE_FULL, RESIZE_BILINEAR},
+            {"resize_bicubic_rgba_720p", FRAME_WIDTH, FRAME_HEIGHT, 1280, 720, 4, SCALE_TYPE_SCALE_FULL, RESIZE_BICUBIC},
+            {"resize_bilinear_y_up", 1280, 720, FRAME_WIDTH, FRAME_HEIGHT, 1, SCALE_TYPE_SCALE_FULL, RESIZE_BILINEAR},
+            {"resize_bicubic_y_up", 1280, 720, FRAME_WIDTH, FRAME_HEIGHT, 1, SCALE_TYPE_SCALE_FULL, RESIZE_BICUBIC},
+            {"resize_bilinear_rgba_thumbnail", 4000, 3000, 320, 320, 4, SCALE_TYPE_INSIDE, RESIZE_BILINEAR},
+            {"resize_bicubic_rgba_crop", FRAME_WIDTH, FRAME_HEIGHT, 720, 1280, 4, SCALE_TYPE_FULL, RESIZE_BICUBIC},
+    };
+
+    for (auto &c : cases) {
+        if (!matchFilter(c.name, filter)) {
+            continue;
+        }
+        int srcStride = c.srcWidth * c.channels;
+        int dstStride = c.dstWidth * c.channels;
+        vector<uint8_t> src((size_t)srcStride * c.srcHeight);
+        vector<uint8_t> dst((size_t)dstStride * c.dstHeight), ref;
+        fillTestPattern(src.data(), c.srcWidth, c.srcHeight, srcStride, c.channels);
+        // Variants are compared with the scalar one, which runs first.
+        forEachVariant(c.name, [&](const char *variantName) {
+            double ms = measureMs([&] {
+                resize_fit(src.data(), srcStride, c.srcWidth, c.srcHeight, dst.data(), dstStride,
+                           c.dstWidth, c.dstHeight, c.channels, c.scaleType, c.filter);
+            });
+            if (ref.empty()) {
+                ref = dst;
+            }
+            int mismatch = countMismatch(dst.data(), ref.data(), c.dstWidth, c.dstHeight, dstStride, c.channels);
+            report(variantName, c.dstWidth, c.dstHeight, src.size(), dst.size(), ms, mismatch);
+        });
+    }
+}
+
+static void benchmarkYuv(const char *filter) {
+    struct Case {
+        const char *name;
+        int uvPixelStride, rotation, facing, precision, policy;
+    } cases[] = {
+            {"yuv_nv21_rotation_90", 2, ROTATION_90, FACING_BACK, YUV_PRECISION_FAST, YUV_KERNEL_ARITHMETIC},
+            {"yuv_nv21_rotation_0", 2, ROTATION_0, FACING_BACK, YUV_PRECISION_FAST, YUV_KERNEL_ARITHMETIC},
+            {"yuv_i420_rotation_90_front", 1, ROTATION_90, FACING_FRONT, YUV_PRECISION_FAST, YUV_KERNEL_ARITHMETIC},
+            {"yuv_nv21_rotation_90_precise", 2, ROTATION_90, FACING_BACK, YUV_PRECISION_HIGH, YUV_KERNEL_ARITHMETIC},
+            {"yuv_i420_rotation_90_front_precise", 1, ROTATION_90, FACING_FRONT, YUV_PRECISION_HIGH, YUV_KERNEL_ARITHMETIC},
+            {"yuv_nv21_rotation_90_lut", 2, ROTATION_90, FACING_BACK, YUV_PRECISION_FAST, YUV_KERNEL_LUT},
+            {"yuv_nv21_rotation_90_precise_lut", 2, ROTATION_90, FACING_BACK, YUV_PRECISION_HIGH, YUV_KERNEL_LUT},
+    };
+
+    for (auto &c : cases) {
+        if (!matchFilter(c.name, filter)) {
+            continue;
+        }
+        // NV21 is one buffer with V and U interleaved, I420 has separate planes.
+        int chromaWidth = (FRAME_WIDTH + 1) / 2;
+        int chromaHeight = (FRAME_HEIGHT + 1) / 2;
+        vector<uint8_t> yPlane(FRAME_WIDTH * FRAME_HEIGHT);
+        vector<uint8_t> uvPlane(chromaWidth * 2 * chromaHeight);
+        fillTestPattern(yPlane.data(), FRAME_WIDTH, FRAME_HEIGHT, FRAME_WIDTH, 1);
+        fillTestPattern(uvPlane.data(), chromaWidth * 2, chromaHeight, chromaWidth * 2, 1);
+
+        YuvFrame frame;
+        frame.y = yPlane.data();
+        frame.yRowStride = FRAME_WIDTH;
+        frame.uvPixelStride = c.uvPixelStride;
+        if (c.uvPixelStride == 2) {
+            frame.v = uvPlane.data();
+            frame.u = uvPlane.data() + 1;
+            frame.uvRowStride = chromaWidth * 2;
+        } else {
+            frame.u = uvPlane.data();
+            frame.v = uvPlane.data() + chromaWidth * chromaHeight;
+            frame.uvRowStride = chromaWidth;
+        }
+        frame.width = FRAME_WIDTH;
+        frame.height = FRAME_HEIGHT;
+
+        vector<uint32_t> dst(FRAME_WIDTH * FRAME_HEIGHT), ref, exact(dst.size());
+        yuv420_to_rgba_reference(frame, exact.data(), c.rotation, c.facing);
+        yuv_set_kernel_policy(c.policy);
+        forEachVariant(c.name, [&](const char *variantName) {
+            double ms = measureMs([&] {
+                yuv420_to_rgba(frame, dst.data(), c.rotation, c.facing, c.precision);
+            });
+            if (ref.empty()) {
+                ref = dst;
+            }
+            int mismatch = countMismatch((uint8_t *)dst.data(), (uint8_t *)ref.data(), FRAME_WIDTH, FRAME_HEIGHT,
+                                         FRAME_WIDTH * 4, 4);
+            report(variantName, FRAME_WIDTH, FRAME_HEIGHT, yPlane.size() + uvPlane.size(), dst.size() * 4.0, ms,
+                   mismatch);
+            LOGD(TAG, "%s: max error against exact BT.601 = %d", variantName,
+                 maxChannelError((uint8_t *)dst.data(), (uint8_t *)exact.data(), (int)dst.size() * 4));
+        });
+        yuv_set_kernel_policy(YUV_KERNEL_AUTO);
+    }
+}
+
+static void benchmarkYuv10(const char *filter) {
+    struct Case {
+        const char *name;
+        int uvPixelStride, layout, format, rotation;
+        // -1 for no tone mapping
+        int transfer, curve;
+    } cases[] = {
+            {"yuv10_p010_rotation_90_rgba8888", 4, YUV10_LAYOUT_MSB, OUTPUT_RGBA_8888, ROTATION_90, -1, 0},
+            {"yuv10_p010_rotation_90_rgba1010102", 4, YUV10_LAYOUT_MSB, OUTPUT_RGBA_1010102, ROTATION_90, -1, 0},
+            {"yuv10_p010_rotation_90_rgba_f16", 4, YUV10_LAYOUT_MSB, OUTPUT_RGBA_F16, ROTATION_90, -1, 0},
+            {"yuv10_i010_rotation_0_rgba8888", 2, YUV10_LAYOUT_LSB, OUTPUT_RGBA_8888, ROTATION_0, -1, 0},
+            {"yuv10_p010_rotation_90_pq_bt2390_rgba8888", 4, YUV10_LAYOUT_MSB, OUTPUT_RGBA_8888, ROTATION_90,
+             HDR_TRANSFER_PQ, TONE_CURVE_BT2390},
+            {"yuv10_p010_rotation_90_hlg_reinhard_rgba8888", 4, YUV10_LAYOUT_MSB, OUTPUT_RGBA_8888, ROTATION_90,
+             HDR_TRANSFER_HLG, TONE_CURVE_REINHARD},
+    };
+
+    for (auto &c : cases) {
+        if (!matchFilter(c.name, filter)) {
+            continue;
+        }
+        int chromaWidth = (FRAME_WIDTH + 1) / 2;
+        int chromaHeight = (FRAME_HEIGHT + 1) / 2;
+        int shift = c.layout == YUV10_LAYOUT_MSB ? 6 : 0;
+        vector<uint16_t> yPlane(FRAME_WIDTH * FRAME_HEIGHT);
+        vector<uint16_t> uvPlane(chromaWidth * 2 * chromaHeight);
+        srand(1);
+        for (auto &n : yPlane) {
+            n = (uint16_t)((rand() & 1023) << shift);
+        }
+        for (auto &n : uvPlane) {
+            n = (uint16_t)((rand() & 1023) << shift);
+        }
+
+        Yuv10Frame frame;
+        frame.y = yPlane.data();
+        frame.yRowStride = FRAME_WIDTH * 2;
+        frame.uvPixelStride = c.uvPixelStride;
+        frame.layout = c.layout;
+        if (c.uvPixelStride == 4) {
+            frame.u = uvPlane.data();
+            frame.v = uvPlane.data() + 1;
+            frame.uvRowStride = chromaWidth * 4;
+        } else {
+            frame.u = uvPlane.data();
+            frame.v = uvPlane.data() + chromaWidth * chromaHeight;
+            frame.uvRowStride = chromaWidth * 2;
+        }
+        frame.width = FRAME_WIDTH;
+        frame.height = FRAME_HEIGHT;
+
+        ToneMapParams toneMap;
+        toneMap.transfer = c.transfer;
+        toneMap.curve = c.curve;
+
+        int bytesPerPixel = yuv10_bytes_per_pixel(c.format);
+        vector<uint8_t> dst(FRAME_WIDTH * FRAME_HEIGHT * bytesPerPixel), ref;
+        forEachVariant(c.name, [&](const char *variantName) {
+            double ms = measureMs([&] {
+                yuv10_to_rgba(frame, dst.data(), c.format, YUV_MATRIX_BT2020_LIMITED, c.rotation, FACING_BACK,
+                              c.transfer < 0 ? nullptr : &toneMap);
+            });
+            if (ref.empty()) {
+                ref = dst;
+            }
+            int mismatch = countMismatch(dst.data(), ref.data(), FRAME_WIDTH, FRAME_HEIGHT,
+                                         FRAME_WIDTH * bytesPerPixel, bytesPerPixel);
+            report(variantName, FRAME_WIDTH, FRAME_HEIGHT, (yPlane.size() + uvPlane.size()) * 2.0, dst.size(), ms,
+                   mismatch);
+        });
+    }
+}
+
+/**
+ * A warm S curve look with some channel crosstalk, so neighbouring pixels use different tetrahedra.
+ * */
+static shared_ptr<Lut3D> makeTestLut(int size) {
+    vector<float> rgb((size_t)size * size * size * 3);
+    float *p = rgb.data();
+    for (int b = 0; b < size; b++) {
+        for (int g = 0; g < size; g++) {
+            for (int r = 0; r < size; r++) {
+                float x[3] = {0.9f * r / (size - 1) + 0.1f * g / (size - 1), (float)g / (size - 1),
+                              0.8f * b / (size - 1) + 0.1f * r / (size - 1)};
+                for (float v : x) {
+                    *p++ = v * v * (3.0f - 2.0f * v);
+                }
+            }
+        }
+    }
+    const float domainMin[3] = {0, 0, 0}, domainMax[3] = {1, 1, 1};
+    return make_shared<Lut3D>(size, rgb.data(), domainMin, domainMax);
+}
+
+static void benchmarkLut3d(const char *filter) {
+    struct Case {
+        const char *name;
+        int size, width, height;
+        // Graded inside yuv420_to_rgba instead of on an RGBA frame.
+        bool fused;
+    } cases[] = {
+            {"lut3d_17_1080p", 17, 1920, 1080, false},
+            {"lut3d_33_1080p", 33, 1920, 1080, false},
+            {"lut3d_65_1080p", 65, 1920, 1080, false},
+            {"lut3d_33_4k", 33, 3840, 2160, false},
+            {"lut3d_65_4k", 65, 3840, 2160, false},
+            {"lut3d_33_yuv_nv21_rotation_90_1080p", 33, 1920, 1080, true},
+            {"lut3d_33_yuv_nv21_rotation_90_4k", 33, 3840, 2160, true},
+    };
+
+    for (auto &c : cases) {
+        if (!matchFilter(c.name, filter)) {
+            continue;
+        }
+        auto lut = makeTestLut(c.size);
+        vector<uint32_t> dst((size_t)c.width * c.height), ref;
+        if (c.fused) {
+            int chromaWidth = (c.width + 1) / 2;
+            int chromaHeight = (c.height + 1) / 2;
+            vector<uint8_t> yPlane((size_t)c.width * c.height);
+            vector<uint8_t> uvPlane((size_t)chromaWidth * 2 * chromaHeight);
+            fillTestPattern(yPlane.data(), c.width, c.height, c.width, 1);
+            fillTestPattern(uvPlane.data(), chromaWidth * 2, chromaHeight, chromaWidth * 2, 1);
+            YuvFrame frame;
+            frame.y = yPlane.data();
+            frame.v = uvPlane.data();
+            frame.u = uvPlane.data() + 1;
+            frame.yRowStride = c.width;
+            frame.uvRowStride = chromaWidth * 2;
+            frame.uvPixelStride = 2;
+            frame.width = c.width;
+            frame.height = c.height;
+            forEachVariant(c.name, [&](const char *variantName) {
+                double ms = measureMs([&] {
+                    yuv420_to_rgba(frame, dst.data(), ROTATION_90, FACING_BACK, YUV_PRECISION_FAST, lut.get());
+                });
+                if (ref.empty()) {
+                    ref = dst;
+                }
+                report(variantName, c.width, c.height, yPlane.size() + uvPlane.size(), dst.size() * 4.0, ms,
+                       countMismatch((uint8_t *)dst.data(), (uint8_t *)ref.data(), c.width, c.height, c.width * 4, 4));
+            });
+        } else {
+            vector<uint32_t> src(dst.size());
+            fillTestPattern((uint8_t *)src.data(), c.width, c.height, c.width * 4, 4);
+            forEachVariant(c.name, [&](const char *variantName) {
+                double ms = measureMs([&] {
+                    parallel_for_stripes(c.height, 16, [&](int rowStart, int rowEnd) {
+                        for (int row = rowStart; row < rowEnd; row++) {
+                            lut3d_apply(*lut, src.data() + (size_t)row * c.width, dst.data() + (size_t)row * c.width,
+                                        1, c.width);
+                        }
+                    });
+                });
+                if (ref.empty()) {
+                    ref = dst;
+                }
+                report(variantName, c.width, c.height, src.size() * 4.0, dst.size() * 4.0, ms,
+                       countMismatch((uint8_t *)dst.data(), (uint8_t *)ref.data(), c.width, c.height, c.width * 4, 4));
+            });
+        }
+    }
+}
+
+static void benchmarkRaw(const char *filter) {
+    struct Case {
+        const char *name;
+        int width, height, rotation, demosaic;
+    } cases[] = {
+            {"raw_rggb_gradient_rotation_90_12mp", 4000, 3000, ROTATION_90, RAW_DEMOSAIC_GRADIENT},
+            {"raw_rggb_bilinear_rotation_90_12mp", 4000, 3000, ROTATION_90, RAW_DEMOSAIC_BILINEAR},
+            {"raw_rggb_gradient_rotation_0_12mp", 4000, 3000, ROTATION_0, RAW_DEMOSAIC_GRADIENT},
+            {"raw_rggb_gradient_rotation_90_1080p", 1920, 1080, ROTATION_90, RAW_DEMOSAIC_GRADIENT},
+    };
+
+    for (auto &c : cases) {
+        if (!matchFilter(c.name, filter)) {
+            continue;
+        }
+        // 10 bit sensor values from the 8 bit pattern
+        vector<uint16_t> raw((size_t)c.width * c.height);
+        fillTestPattern((uint8_t *)raw.data(), c.width * 2, c.height, c.width * 2, 1);
+        for (auto &v : raw) {
+            v = (uint16_t)(64 + (v & 0x3FF) * 959 / 1023);
+        }
+        RawFrame frame;
+        frame.data = raw.data();
+        frame.rowStride = c.width * 2;
+        frame.width = c.width;
+        frame.height = c.height;
+        RawParams params;
+        params.demosaic = c.demosaic;
+        params.wbGains[0] = 2.0f;
+        params.wbGains[3] = 1.6f;
+        const float ccm[9] = {1.6f, -0.4f, -0.2f, -0.3f, 1.5f, -0.2f, 0.05f, -0.6f, 1.55f};
+        memcpy(params.ccm, ccm, sizeof(ccm));
+
+        vector<uint32_t> dst((size_t)c.width * c.height), ref;
+        forEachVariant(c.name, [&](const char *variantName) {
+            double ms = measureMs([&] {
+                raw_to_rgba(frame, params, dst.data(), c.rotation, FACING_BACK);
+            });
+            if (ref.empty()) {
+                ref = dst;
+            }
+            report(variantName, c.width, c.height, raw.size() * 2.0, dst.size() * 4.0, ms,
+                   countMismatch((uint8_t *)dst.data(), (uint8_t *)ref.data(), c.width, c.height, c.width * 4, 4));
+        });
+    }
+}
+
+static void benchmarkRawUnpack(const char *filter) {
+    struct Case {
+        const char *name;
+        int packing, width, height;
+        // Unpacked inside raw_to_rgba instead of into a 16 bit frame.
+        bool fused;
+    } cases[] = {
+            {"raw10_unpack_12mp", RAW_PACKING_10, 4000, 3000, false},
+            {"raw12_unpack_12mp", RAW_PACKING_12, 4000, 3000, false},
+            {"raw10_rggb_gradient_rotation_90_12mp", RAW_PACKING_10, 4000, 3000, true},
+    };
+
+    for (auto &c : cases) {
+        if (!matchFilter(c.name, filter)) {
+            continue;
+        }
+        // Padded like the rowStride of a camera buffer
+        int rowStride = raw_row_bytes(c.packing, c.width) + 32;
+        vector<uint8_t> packed((size_t)rowStride * c.height);
+        fillTestPattern(packed.data(), rowStride, c.height, rowStride, 1);
+        if (c.fused) {
+            RawFrame frame;
+            frame.data = packed.data();
+            frame.rowStride = rowStride;
+            frame.packing = c.packing;
+            frame.width = c.width;
+            frame.height = c.height;
+            RawParams params;
+            params.wbGains[0] = 2.0f;
+            params.wbGains[3] = 1.6f;
+            vector<uint32_t> dst((size_t)c.width * c.height), ref;
+            forEachVariant(c.name, [&](const char *variantName) {
+                double ms = measureMs([&] {
+                    raw_to_rgba(frame, params, dst.data(), ROTATION_90, FACING_BACK);
+                });
+                if (ref.empty()) {
+                    ref = dst;
+                }
+                report(variantName, c.width, c.height, packed.size(), dst.size() * 4.0, ms,
+                       countMismatch((uint8_t *)dst.data(), (uint8_t *)ref.data(), c.width, c.height, c.width * 4, 4));
+            });
+        } else {
+            vector<uint16_t> dst((size_t)c.width * c.height), ref;
+            forEachVariant(c.name, [&](const char *variantName) {
+                double ms = measureMs([&] {
+                    raw_unpack(packed.data(), rowStride, c.packing, c.width, c.height, dst.data(), c.width * 2);
+                });
+                if (ref.empty()) {
+                    ref = dst;
+                }
+                report(variantName, c.width, c.height, packed.size(), dst.size() * 2.0, ms,
+                       countMismatch((uint8_t *)dst.data(), (uint8_t *)ref.data(), c.width, c.height, c.width * 2, 2));
+            });
+        }
+    }
+}
+
+/**
+ * Radial falloff like LENS_SHADING_MAP of a wide lens, gains from 1 in the centre to about 3 in the corners.
+ * */
+static vector<float> makeTestShadingMap(int columns, int rows) {
+    vector<float> gains((size_t)columns * rows * 4);
+    for (int j = 0; j < rows; j++) {
+        for (int i = 0; i < columns; i++) {
+            float dx = (i * 2.0f / (columns - 1)) - 1;
+            float dy = (j * 2.0f / (rows - 1)) - 1;
+            for (int c = 0; c < 4; c++) {
+                gains[((size_t)j * columns + i) * 4 + c] = 1 + (0.9f + 0.1f * c) * (dx * dx + dy * dy);
+            }
+        }
+    }
+    return gains;
+}
+
+static void benchmarkLensShading(const char *filter) {
+    struct Case {
+        const char *name;
+        int width, height;
+        // Applied inside raw_to_rgba instead of on a Y plane.
+        bool raw;
+    } cases[] = {
+            {"lens_shading_luma_1080p", 1920, 1080, false},
+            {"lens_shading_luma_4k", 3840, 2160, false},
+            {"lens_shading_raw_rggb_gradient_rotation_90_12mp", 4000, 3000, true},
+    };
+
+    auto grid = makeTestShadingMap(17, 13);
+    LensShadingMap map;
+    map.gains = grid.data();
+    map.columns = 17;
+    map.rows = 13;
+    for (auto &c : cases) {
+        if (!matchFilter(c.name, filter)) {
+            continue;
+        }
+        if (c.raw) {
+            vector<uint16_t> raw((size_t)c.width * c.height);
+            fillTestPattern((uint8_t *)raw.data(), c.width * 2, c.height, c.width * 2, 1);
+            for (auto &v : raw) {
+                v = (uint16_t)(64 + (v & 0x3FF) * 959 / 1023);
+            }
+            RawFrame frame;
+            frame.data = raw.data();
+            frame.rowStride = c.width * 2;
+            frame.width = c.width;
+            frame.height = c.height;
+            RawParams params;
+            params.shading = map;
+            vector<uint32_t> dst((size_t)c.width * c.height), ref;
+            forEachVariant(c.name, [&](const char *variantName) {
+                double ms = measureMs([&] {
+                    raw_to_rgba(frame, params, dst.data(), ROTATION_90, FACING_BACK);
+                });
+                if (ref.empty()) {
+                    ref = dst;
+                }
+                report(variantName, c.width, c.height, raw.size() * 2.0, dst.size() * 4.0, ms,
+                       countMismatch((uint8_t *)dst.data(), (uint8_t *)ref.data(), c.width, c.height, c.width * 4, 4));
+            });
+        } else {
+            vector<uint8_t> src((size_t)c.width * c.height), dst(src.size()), ref;
+            fillTestPattern(src.data(), c.width, c.height, c.width, 1);
+            forEachVariant(c.name, [&](const char *variantName) {
+                double ms = measureMs([&] {
+                    lens_shading_apply_luma(map, src.data(), c.width, dst.data(), c.width, c.width, c.height);
+                });
+                if (ref.empty()) {
+                    ref = dst;
+                }
+                report(variantName, c.width, c.height, src.size(), dst.size(), ms,
+                       countMismatch(dst.data(), ref.data(), c.width, c.height, c.width, 1));
+            });
+        }
+    }
+}
+
+/**
+ * Every frame of the burst is a window of one bigger pattern, moved a few pixels from the last.
+ * */
+static void benchmarkBurst(const char *filter) {
+    struct Case {
+        const char *name;
+        int width, height, frames;
+        bool raw;
+    } cases[] = {
+            {"burst_yuv_8frames_1080p", 1920, 1080, 8, false},
+            {"burst_yuv_8frames_12mp", 4000, 3000, 8, false},
+            {"burst_raw10_4frames_12mp", 4000, 3000, 4, true},
+    };
+    const int margin = 16;
+
+    for (auto &c : cases) {
+        if (!matchFilter(c.name, filter)) {
+            continue;
+        }
+        int sceneWidth = c.width + margin * 2, sceneHeight = c.height + margin * 2;
+        vector<YuvFrame> frames(c.frames);
+        vector<RawFrame> rawFrames(c.frames);
+        vector<uint8_t> scene;
+        vector<uint16_t> rawScene;
+        if (c.raw) {
+            rawScene.resize((size_t)sceneWidth * sceneHeight);
+            fillTestPattern((uint8_t *)rawScene.data(), sceneWidth * 2, sceneHeight, sceneWidth * 2, 1);
+            for (auto &v : rawScene) {
+                v &= 0x3FF;
+            }
+        } else {
+            // The chroma planes follow Y in the same buffer, a quarter of its size each.
+            scene.resize((size_t)sceneWidth * sceneHeight * 3 / 2);
+            fillTestPattern(scene.data(), sceneWidth, sceneHeight * 3 / 2, sceneWidth, 1);
+        }
+        for (int i = 0; i < c.frames; i++) {
+            // Even offsets keep the Bayer phase and line the chroma up with Y.
+            int dx = margin + ((i * 6) % 13 - 6) / 2 * 2, dy = margin + ((i * 10) % 11 - 5) / 2 * 2;
+            if (c.raw) {
+                RawFrame &f = rawFrames[i];
+                f.data = rawScene.data() + (size_t)dy * sceneWidth + dx;
+                f.rowStride = sceneWidth * 2;
+                f.width = c.width;
+                f.height = c.height;
+            } else {
+                YuvFrame &f = frames[i];
+                const uint8_t *u = scene.data() + (size_t)sceneWidth * sceneHeight;
+                f.y = scene.data() + (size_t)dy * sceneWidth + dx;
+                f.u = u + (size_t)(dy / 2) * (sceneWidth / 2) + dx / 2;
+                f.v = f.u + (size_t)(sceneWidth / 2) * (sceneHeight / 2);
+                f.yRowStride = sceneWidth;
+                f.uvRowStride = sceneWidth / 2;
+                f.uvPixelStride = 1;
+                f.width = c.width;
+                f.height = c.height;
+            }
+        }
+        vector<uint8_t> dst((size_t)c.width * c.height * 2), ref;
+        forEachVariant(c.name, [&](const char *variantName) {
+            double ms = measureMs([&] {
+                BurstMerger merger(c.raw ? BURST_FORMAT_RAW : BURST_FORMAT_YUV420, c.width, c.height);
+                for (int i = 0; i < c.frames; i++) {
+                    if (c.raw) {
+                        merger.addRaw(rawFrames[i]);
+                    } else {
+                        merger.addYuv(frames[i]);
+                    }
+                }
+                if (c.raw) {
+                    merger.finishRaw((uint16_t *)dst.data(), c.width * 2);
+                } else {
+                    uint8_t *u = dst.data() + (size_t)c.width * c.height;
+                    merger.finishYuv(dst.data(), c.width, u, u + (size_t)c.width * c.height / 4, c.width / 2, 1);
+                }
+            });
+            if (ref.empty()) {
+                ref = dst;
+            }
+            double frameBytes = (c.raw ? 2.0 : 1.5) * c.width * c.height;
+            report(variantName, c.width, c.height, frameBytes * c.frames, frameBytes, ms,
+                   countMismatch(dst.data(), ref.data(), c.width * 2, c.height, c.width * 2, 1));
+        });
+    }
+}
+
+static void benchmarkExposureFusion(const char *filter) {
+    struct Case {
+        const char *name;
+        int width, height;
+        // Only build and collapse a Laplacian pyramid of Y.
+        bool pyramidOnly;
+    } cases[] = {
+            {"pyramid_laplacian_round_trip_12mp", 4000, 3000, true},
+            {"exposure_fusion_3frames_1080p", 1920, 1080, false},
+            {"exposure_fusion_3frames_12mp", 4000, 3000, false},
+    };
+    const int frameCount = 3;
+
+    for (auto &c : cases) {
+        if (!matchFilter(c.name, filter)) {
+            continue;
+        }
+        size_t frameSize = (size_t)c.width * c.height * 3 / 2;
+        vector<uint8_t> frames(frameSize * frameCount), dst(frameSize), ref;
+        fillTestPattern(frames.data(), c.width, c.height * 3 / 2 * frameCount, c.width, 1);
+        vector<YuvFrame> yuv(frameCount);
+        for (int i = 0; i < frameCount; i++) {
+            uint8_t *base = frames.data() + frameSize * i;
+            // Under, normal and over exposed
+            for (size_t j = 0; j < (size_t)c.width * c.height; j++) {
+                base[j] = (uint8_t)std::min(255, base[j] * (i + 1) / 2);
+            }
+            yuv[i].y = base;
+            yuv[i].u = base + (size_t)c.width * c.height;
+            yuv[i].v = yuv[i].u + (size_t)c.width * c.height / 4;
+            yuv[i].yRowStride = c.width;
+            yuv[i].uvRowStride = c.width / 2;
+            yuv[i].uvPixelStride = 1;
+            yuv[i].width = c.width;
+            yuv[i].height = c.height;
+        }
+        forEachVariant(c.name, [&](const char *variantName) {
+            double ms = measureMs([&] {
+                if (c.pyramidOnly) {
+                    Pyramid pyramid(c.width, c.height, 0);
+                    pyramid_load_u8(pyramid, yuv[0].y, c.width);
+                    pyramid_gaussian(pyramid);
+                    pyramid_laplacian(pyramid);
+                    pyramid_collapse(pyramid);
+                    pyramid_store_u8(pyramid, dst.data(), c.width);
+                } else {
+                    uint8_t *u = dst.data() + (size_t)c.width * c.height;
+                    exposure_fusion_yuv(yuv.data(), frameCount, ExposureFusionParams(), dst.data(), c.width,
+                                        u, u + (size_t)c.width * c.height / 4, c.width / 2, 1);
+                }
+            });
+            if (ref.empty()) {
+                ref = dst;
+            }
+            // The pyramid only reads and writes Y.
+            double written = c.pyramidOnly ? (double)c.width * c.height : (double)frameSize;
+            report(variantName, c.width, c.height, c.pyramidOnly ? written : written * frameCount, written, ms,
+                   countMismatch(dst.data(), ref.data(), c.width, c.height * 3 / 2, c.width, 1));
+        });
+    }
+}
+
+static void benchmarkWarp(const char *filter) {
+    struct Case {
+        const char *name;
+        int width, height, channels;
+        // Horizon correction of 3 degrees, or a keystone correction.
+        bool perspective;
+    } cases[] = {
+            {"warp_rotate_c1_12mp", 4000, 3000, 1, false},
+            {"warp_perspective_c1_12mp", 4000, 3000, 1, true},
+            {"warp_rotate_rgba_1080p", 1920, 1080, 4, false},
+            {"warp_perspective_rgba_1080p", 1920, 1080, 4, true},
+    };
+
+    for (auto &c : cases) {
+        if (!matchFilter(c.name, filter)) {
+            continue;
+        }
+        int stride = c.width * c.channels;
+        vector<uint8_t> src((size_t)stride * c.height), dst(src.size()), ref;
+        fillTestPattern(src.data(), c.width, c.height, stride, c.channels);
+        float cx = c.width * 0.5f, cy = c.height * 0.5f;
+        glm::mat3 m(1.0f);
+        if (c.perspective) {
+            m[0][2] = 0.1f / c.width;
+            m[1][2] = 0.05f / c.height;
+        } else {
+            float s = sinf(3.0f * (float)M_PI / 180.0f), k = cosf(3.0f * (float)M_PI / 180.0f);
+            m[0][0] = k;
+            m[0][1] = s;
+            m[1][0] = -s;
+            m[1][1] = k;
+            m[2][0] = cx - k * cx + s * cy;
+            m[2][1] = cy - s * cx - k * cy;
+        }
+        forEachVariant(c.name, [&](const char *variantName) {
+            double ms = measureMs([&] {
+                warp_plane(src.data(), stride, c.width, c.height, dst.data(), stride, c.width, c.height,
+                           c.channels, m);
+            });
+            if (ref.empty()) {
+                ref = dst;
+            }
+            report(variantName, c.width, c.height, src.size(), dst.size(), ms,
+                   countMismatch(dst.data(), ref.data(), c.width, c.height, stride, c.channels));
+        });
+    }
+}
+
+static void benchmarkLensDistortion(const char *filter) {
+    struct Case {
+        const char *name;
+        int width, height;
+    } cases[] = {
+            {"lens_undistort_rgba_1080p", 1920, 1080},
+            {"lens_undistort_rgba_12mp", 4000, 3000},
+    };
+    // An ultra wide module calibrated on a 4000x3000 array
+    LensDistortion lens;
+    const float intrinsics[5] = {2800, 2800, 2010, 1495, 0};
+    const float distortion[5] = {0.12f, -0.05f, 0.01f, 0.001f, -0.0005f};
+    memcpy(lens.intrinsics, intrinsics, sizeof(intrinsics));
+    memcpy(lens.distortion, distortion, sizeof(distortion));
+    lens.arrayWidth = 4000;
+    lens.arrayHeight = 3000;
+
+    for (auto &c : cases) {
+        if (!matchFilter(c.name, filter)) {
+            continue;
+        }
+        auto remap = lens_remap(lens, c.width, c.height);
+        if (!remap) {
+            continue;
+        }
+        vector<uint8_t> yuv((size_t)c.width * c.height * 3 / 2);
+        fillTestPattern(yuv.data(), c.width, c.height * 3 / 2, c.width, 1);
+        YuvFrame frame;
+        frame.y = yuv.data();
+        frame.u = yuv.data() + (size_t)c.width * c.height;
+        frame.v = frame.u + (size_t)c.width * c.height / 4;
+        frame.yRowStride = c.width;
+        frame.uvRowStride = c.width / 2;
+        frame.uvPixelStride = 1;
+        frame.width = c.width;
+        frame.height = c.height;
+        vector<uint32_t> dst((size_t)c.width * c.height), ref;
+        forEachVariant(c.name, [&](const char *variantName) {
+            double ms = measureMs([&] {
+                lens_undistort_to_rgba(*remap, frame, dst.data(), ROTATION_90, FACING_BACK);
+            });
+            if (ref.empty()) {
+                ref = dst;
+            }
+            report(variantName, c.width, c.height, yuv.size(), dst.size() * 4.0, ms,
+                   countMismatch((const uint8_t *)dst.data(), (const uint8_t *)ref.data(), c.height, c.width,
+                                 c.height * 4, 4));
+        });
+    }
+}
+
+/**
+ * An image of the layout with every row padded by padding bytes, like the planes of a camera buffer.
+ * */
+static YuvImage makePaddedImage(int layout, int width, int height, int padding, vector<uint8_t> &buffer) {
+    YuvImage image;
+    yuv_image_wrap(layout, width, height, nullptr, image);
+    size_t offsets[3] = {}, size = 0;
+    for (int i = 0; i < 3 && image.strides[i] > 0; i++) {
+        offsets[i] = size;
+        size += (size_t)(image.strides[i] + padding) * (i == 0 ? height : (height + 1) / 2);
+    }
+    buffer.assign(size, 0);
+    for (int i = 0; i < 3 && image.strides[i] > 0; i++) {
+        int rowBytes = image.strides[i];
+        image.strides[i] += padding;
+        image.planes[i] = buffer.data() + offsets[i];
+        fillTestPattern(image.planes[i], rowBytes, i == 0 ? height : (height + 1) / 2, image.strides[i], 1);
+    }
+    return image;
+}
+
+static void benchmarkRepack(const char *filter) {
+    struct Case {
+        const char *name;
+        int srcLayout, dstLayout, width, height;
+    } cases[] = {
+            {"repack_nv12_to_i420_1080p", YUV_LAYOUT_NV12, YUV_LAYOUT_I420, 1920, 1080},
+            {"repack_i420_to_nv12_1080p", YUV_LAYOUT_I420, YUV_LAYOUT_NV12, 1920, 1080},
+            {"repack_nv21_to_nv12_1080p", YUV_LAYOUT_NV21, YUV_LAYOUT_NV12, 1920, 1080},
+            {"repack_i420_to_yuyv_1080p", YUV_LAYOUT_I420, YUV_LAYOUT_YUYV, 1920, 1080},
+            {"repack_yuyv_to_i420_1080p", YUV_LAYOUT_YUYV, YUV_LAYOUT_I420, 1920, 1080},
+            {"repack_nv21_to_uyvy_1080p", YUV_LAYOUT_NV21, YUV_LAYOUT_UYVY, 1920, 1080},
+            {"repack_uyvy_to_nv12_1080p", YUV_LAYOUT_UYVY, YUV_LAYOUT_NV12, 1920, 1080},
+            {"repack_yuyv_to_uyvy_1080p", YUV_LAYOUT_YUYV, YUV_LAYOUT_UYVY, 1920, 1080},
+            {"repack_nv12_to_i420_12mp", YUV_LAYOUT_NV12, YUV_LAYOUT_I420, 4000, 3000},
+            // Only strips the padding, the memcpy speed the others are measured against
+            {"repack_nv12_to_nv12_12mp", YUV_LAYOUT_NV12, YUV_LAYOUT_NV12, 4000, 3000},
+    };
+
+    for (auto &c : cases) {
+        if (!matchFilter(c.name, filter)) {
+            continue;
+        }
+        vector<uint8_t> srcBuffer;
+        YuvImage src = makePaddedImage(c.srcLayout, c.width, c.height, 64, srcBuffer);
+        // Padding is not read, only the pixels count.
+        YuvImage tight, dst;
+        size_t srcSize = yuv_image_wrap(c.srcLayout, c.width, c.height, nullptr, tight);
+        vector<uint8_t> dstBuffer(yuv_image_wrap(c.dstLayout, c.width, c.height, nullptr, dst)), ref;
+        size_t dstSize = yuv_image_wrap(c.dstLayout, c.width, c.height, dstBuffer.data(), dst);
+        forEachVariant(c.name, [&](const char *variantName) {
+            double ms = measureMs([&] {
+                yuv_repack(src, dst);
+            });
+            if (ref.empty()) {
+                ref = dstBuffer;
+            }
+            report(variantName, c.width, c.height, srcSize, dstSize, ms,
+                   countMismatch(dstBuffer.data(), ref.data(), (int)dstSize, 1, (int)dstSize, 1));
+        });
+    }
+}
+
+static void benchmarkAudio(const char *filter) {
+    struct Case {
+        const char *name;
+        int inputRate, inputChannels, outputRate, outputChannels;
+    } cases[] = {
+            {"audio_resample_48000_44100_stereo", 48000, 2, 44100, 2},
+            {"audio_resample_48000_16000_mono", 48000, 1, 16000, 1},
+            {"audio_convert_48000_mono_44100_stereo", 48000, 1, 44100, 2},
+    };
+    // One second in blocks of one capture period.
+    const int seconds = 1;
+
+    for (auto &c : cases) {
+        if (!matchFilter(c.name, filter)) {
+            continue;
+        }
+        int block = c.inputRate * AUDIO_PERIOD_MS / 1000;
+        vector<int16_t> src((size_t)c.inputRate * seconds * c.inputChannels);
+        for (size_t i = 0; i < src.size(); i++) {
+            src[i] = (int16_t)(16000 * sin(i * 0.05) + (int)(i * 7919 % 1000) - 500);
+        }
+        vector<int16_t> dst, ref;
+        forEachVariant(c.name, [&](const char *variantName) {
+            PcmConverter converter(c.inputRate, c.inputChannels, c.outputRate, c.outputChannels, block);
+            dst.resize((size_t)converter.getMaxOutputFrames(block) * c.outputChannels *
+                       (c.inputRate * seconds / block));
+            int frames = 0;
+            double ms = measureMs([&] {
+                converter.reset();
+                frames = 0;
+                for (int i = 0; i + block <= c.inputRate * seconds; i += block) {
+                    frames += converter.process(src.data() + (size_t)i * c.inputChannels, block,
+                                                dst.data() + (size_t)frames * c.outputChannels);
+                }
+            });
+            dst.resize((size_t)frames * c.outputChannels);
+            if (ref.empty()) {
+                ref = dst;
+            }
+            LOGD(TAG, "%s: avg %.3f ms per second of audio, %.0fx real time, mismatch = %d", variantName, ms,
+                 1000.0 * seconds / ms, dst == ref ? 0 : 1);
+        });
+    }
+}
+
+void run_native_benchmark(const char *filter, bool rooflineMode) {
+    LOGD(TAG, "run native benchmark, filter = %s", filter == nullptr ? "" : filter);
+    roofline = Roofline();
+    if (rooflineMode) {
+        roofline = measureRoofline();
+        LOGD(TAG, "memory roof with %d threads: read %.2f GB/s, write %.2f GB/s, copy %.2f GB/s",
+             parallel_thread_count(), roofline.read, roofline.write, roofline.copy);
+    }
+    PerfCounters counters;
+    if (counters.isAvailable()) {
+        perfCounters = &counters;
+        if (counters.getError()[0] != '\0') {
+            LOGD(TAG, "some hardware counters are not reported, %s", counters.getError());
+        }
+    }
+    benchmarkConvolution(filter);
+    benchmarkResize(filter);
+    benchmarkYuv(filter);
+    benchmarkYuv10(filter);
+    benchmarkLut3d(filter);
+    benchmarkRaw(filter);
+    benchmarkRawUnpack(filter);
+    benchmarkLensShading(filter);
+    benchmarkBurst(filter);
+    benchmarkExposureFusion(filter);
+    benchmarkWarp(filter);
+    benchmarkLensDistortion(filter);
+    benchmarkRepack(filter);
+    benchmarkAudio(filter);
+    perfCounters = nullptr;
+
+    FrameArenaStats arena;
+    frame_arena_get_stats(arena);
+    LOGD(TAG, "frame arena: peak %.1f MiB, reserved %.1f MiB, %llu system allocations, %.1f%% of %llu reused",
+         arena.peakBytes / 1048576.0, arena.reservedBytes / 1048576.0, (unsigned long long)arena.systemAllocations,
+         arena.allocations > 0 ? arena.reusedAllocations * 100.0 / arena.allocations : 0.0,
+         (unsigned long long)arena.allocations);
+    frame_arena_trim();
+}
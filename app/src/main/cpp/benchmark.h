@@ -0,0 +1,23 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#ifndef CAMERAUTIL_BENCHMARK_H
+#define CAMERAUTIL_BENCHMARK_H
+
+/**
+ * native图像kernel的基准测试，结果通过logcat输出。
+ * 每一项测试都会先与对应的参考实现比较输出是否一致，然后统计平均耗时、吞吐量(MPix/s)
+ * 以及占30fps帧预算(33.3ms)的比例。
+ * 系统允许使用硬件性能计数器时（见perf_counters.h）再输出一行：IPC、每周期读写的字节数、
+ * 每千像素的周期数、L1D / LLC缓存缺失和分支预测失败次数，以及停顿周期的比例。
+ *
+ * roofline模式先用流式读、写、拷贝测出内存带宽上限，再按每个kernel读写的平面算出
+ * 每像素的字节数，输出实际达到的GB/s占上限的比例：接近100%的kernel再做SIMD优化没有意义，
+ * 只能靠合并处理步骤或者降低分辨率减少内存读写。
+ *
+ * filter为空时运行全部测试，否则只运行名字中包含filter的测试。
+ * */
+void run_native_benchmark(const char *filter, bool roofline = false);
+
+#endif //CAMERAUTIL_BENCHMARK_H
@@ -0,0 +1,528 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#include "burst_merge.h"
+#include "dispatch.h"
+#include "cpu_features.h"
+#include "parallel.h"
+#include "simd.h"
+#include "frame_arena.h"
+#include "log.h"
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+using namespace std;
+
+#define TAG "burst_merge.cpp"
+
+// Tile size at every pyramid level, in that level's pixels
+#define TILE 16
+#define MAX_LEVELS 4
+#define MIN_STRIPE_ROWS 16
+// Weights of the robust merge are Q8 before they are scaled to weightMax.
+#define WEIGHT_SCALE_BITS 8
+// Frames compared for sharpness by burst_merge_yuv
+#define REFERENCE_CANDIDATES 3
+
+#define MERGE_NOISE 0
+#define MERGE_RANGE 1
+#define MERGE_INV_RANGE 2
+#define MERGE_TILE_WEIGHT 3
+#define MERGE_WEIGHT_MAX 4
+#define MERGE_PARAM_COUNT 5
+
+static void burst_down2_c(const uint8_t *row0, const uint8_t *row1, uint8_t *dst, int dstWidth) {
+    for (int x = 0; x < dstWidth; x++) {
+        int top = (row0[2 * x] + row0[2 * x + 1] + 1) >> 1;
+        int bottom = (row1[2 * x] + row1[2 * x + 1] + 1) >> 1;
+        dst[x] = (uint8_t)((top + bottom + 1) >> 1);
+    }
+}
+
+static uint32_t burst_sad_c(const uint8_t *a, int aStride, const uint8_t *b, int bStride, int width, int height) {
+    uint32_t sad = 0;
+    for (int y = 0; y < height; y++, a += aStride, b += bStride) {
+        for (int x = 0; x < width; x++) {
+            sad += abs(a[x] - b[x]);
+        }
+    }
+    return sad;
+}
+
+/**
+ * Robust weight of every pixel: full up to the noise level, falling to 0 over range, never
+ * more than the tile's weight. sum and weight accumulate weight * alt and weight.
+ * */
+static inline void burst_merge_tail(int x, const uint16_t *ref, const uint16_t *alt, uint16_t *sum, uint16_t *weight,
+                                    int width, const int16_t *p) {
+    for (; x < width; x++) {
+        int d = abs(alt[x] - ref[x]);
+        int excess = std::min(std::max(d - p[MERGE_NOISE], 0), (int)p[MERGE_RANGE]);
+        int w = p[MERGE_WEIGHT_MAX] - ((excess * p[MERGE_INV_RANGE]) >> WEIGHT_SCALE_BITS);
+        w = std::max(std::min(w, (int)p[MERGE_TILE_WEIGHT]), 0);
+        sum[x] = (uint16_t)(sum[x] + w * alt[x]);
+        weight[x] = (uint16_t)(weight[x] + w);
+    }
+}
+
+static void burst_merge_c(const uint16_t *ref, const uint16_t *alt, uint16_t *sum, uint16_t *weight, int stride,
+                          int width, int height, const int16_t *params) {
+    for (int y = 0; y < height; y++, ref += stride, alt += stride, sum += stride, weight += stride) {
+        burst_merge_tail(0, ref, alt, sum, weight, width, params);
+    }
+}
+
+#if SIMD_128
+static void burst_down2_simd(const uint8_t *row0, const uint8_t *row1, uint8_t *dst, int dstWidth) {
+    int x = 0;
+    for (; x + 16 <= dstWidth; x += 16) {
+        v_u8x16 e0, o0, e1, o1;
+        v_load_deinterleave(row0 + 2 * x, e0, o0);
+        v_load_deinterleave(row1 + 2 * x, e1, o1);
+        v_store(dst + x, v_avg(v_avg(e0, o0), v_avg(e1, o1)));
+    }
+    burst_down2_c(row0 + 2 * x, row1 + 2 * x, dst + x, dstWidth - x);
+}
+
+static uint32_t burst_sad_simd(const uint8_t *a, int aStride, const uint8_t *b, int bStride, int width, int height) {
+    if (width < 16) {
+        return burst_sad_c(a, aStride, b, bStride, width, height);
+    }
+    int vectorWidth = width & ~15;
+    v_s32x4 total = v_dup_s32(0);
+    for (int y = 0; y < height; y++) {
+        const uint8_t *pa = a + (size_t)y * aStride, *pb = b + (size_t)y * bStride;
+        v_s16x8 row = v_dup_s16(0);
+        for (int x = 0; x < vectorWidth; x += 16) {
+            v_u8x16 va = v_load_u8x16(pa + x), vb = v_load_u8x16(pb + x);
+            v_u8x16 d = v_adds(v_subs(va, vb), v_subs(vb, va));
+            row = v_add(row, v_add(v_expand_lo(d), v_expand_hi(d)));
+        }
+        total = v_add(total, v_add(v_expand_lo(row), v_expand_hi(row)));
+    }
+    uint32_t sad = (uint32_t)v_reduce_sum(total);
+    if (vectorWidth < width) {
+        sad += burst_sad_c(a + vectorWidth, aStride, b + vectorWidth, bStride, width - vectorWidth, height);
+    }
+    return sad;
+}
+
+static void burst_merge_simd(const uint16_t *ref, const uint16_t *alt, uint16_t *sum, uint16_t *weight, int stride,
+                             int width, int height, const int16_t *params) {
+    const v_s16x8 noise = v_dup_s16(params[MERGE_NOISE]);
+    const v_s16x8 range = v_dup_s16(params[MERGE_RANGE]);
+    const v_s16x8 tileWeight = v_dup_s16(params[MERGE_TILE_WEIGHT]);
+    const v_s16x8 weightMax = v_dup_s16(params[MERGE_WEIGHT_MAX]);
+    const v_s16x8 zero = v_dup_s16(0);
+    const int16_t invRange = params[MERGE_INV_RANGE];
+    for (int y = 0; y < height; y++, ref += stride, alt += stride, sum += stride, weight += stride) {
+        int x = 0;
+        for (; x + 8 <= width; x += 8) {
+            v_s16x8 r = v_load_s16x8((const int16_t *)ref + x);
+            v_s16x8 a = v_load_s16x8((const int16_t *)alt + x);
+            v_s16x8 d = v_max(v_sub(a, r), v_sub(r, a));
+            v_s16x8 excess = v_min(v_max(v_sub(d, noise), zero), range);
+            v_s16x8 w = v_sub(weightMax, v_shr<WEIGHT_SCALE_BITS>(v_mul_n(excess, invRange)));
+            w = v_max(v_min(w, tileWeight), zero);
+            // Sums are uint16, the int16 lanes wrap the same way.
+            v_store((int16_t *)sum + x, v_add(v_load_s16x8((const int16_t *)sum + x), v_mul(w, a)));
+            v_store((int16_t *)weight + x, v_add(v_load_s16x8((const int16_t *)weight + x), w));
+        }
+        burst_merge_tail(x, ref, alt, sum, weight, width, params);
+    }
+}
+#endif
+
+void burst_merge_fill_kernels(KernelTable &table, uint32_t features) {
+    table.burstDown2 = burst_down2_c;
+    table.burstSad = burst_sad_c;
+    table.burstMerge = burst_merge_c;
+#if SIMD_128
+    if (features & SIMD_128_FEATURE) {
+        table.burstDown2 = burst_down2_simd;
+        table.burstSad = burst_sad_simd;
+        table.burstMerge = burst_merge_simd;
+    }
+#endif
+}
+
+static int bit_length(int n) {
+    int bits = 0;
+    while (n > 0) {
+        bits++;
+        n >>= 1;
+    }
+    return bits;
+}
+
+BurstMerger::BurstMerger(int format, int width, int height, const BurstParams &params, int whiteLevel)
+        : format(format), width(width), height(height), params(params) {
+    int lumaWidth = width, lumaHeight = height;
+    if (format == BURST_FORMAT_RAW) {
+        valueShift = std::max(0, bit_length(whiteLevel) - 10);
+        maxValue = whiteLevel >> valueShift;
+        lumaWidth = width / 2;
+        lumaHeight = height / 2;
+    }
+    weightMax = std::max(1, std::min(16, 65535 / (maxValue * BURST_MAX_FRAMES)));
+
+    levelWidth.push_back(lumaWidth);
+    levelHeight.push_back(lumaHeight);
+    while ((int)levelWidth.size() < MAX_LEVELS && levelWidth.back() >= TILE * 4 && levelHeight.back() >= TILE * 4) {
+        levelWidth.push_back(levelWidth.back() / 2);
+        levelHeight.push_back(levelHeight.back() / 2);
+    }
+    tilesX = (lumaWidth + TILE - 1) / TILE;
+    tilesY = (lumaHeight + TILE - 1) / TILE;
+}
+
+void BurstMerger::allocate(Image &image) const {
+    if (!image.planes.empty()) {
+        return;
+    }
+    if (format == BURST_FORMAT_YUV420) {
+        image.planes.resize(3);
+        image.planes[0].width = width;
+        image.planes[0].height = height;
+        for (int i = 1; i < 3; i++) {
+            image.planes[i].width = (width + 1) / 2;
+            image.planes[i].height = (height + 1) / 2;
+            image.planes[i].shift = 1;
+        }
+    } else {
+        // One plane per position in the 2x2 CFA block, row major
+        image.planes.resize(4);
+        for (auto &plane : image.planes) {
+            plane.width = width / 2;
+            plane.height = height / 2;
+        }
+    }
+    for (auto &plane : image.planes) {
+        plane.data.resize((size_t)plane.width * plane.height);
+    }
+    image.pyramid.resize(levelWidth.size());
+    for (size_t l = 0; l < levelWidth.size(); l++) {
+        image.pyramid[l].resize((size_t)levelWidth[l] * levelHeight[l]);
+    }
+}
+
+void BurstMerger::buildPyramid(Image &image) const {
+    const KernelTable &kt = kernel_table();
+    for (size_t l = 1; l < image.pyramid.size(); l++) {
+        const uint8_t *src = image.pyramid[l - 1].data();
+        uint8_t *dst = image.pyramid[l].data();
+        int srcWidth = levelWidth[l - 1], dstWidth = levelWidth[l];
+        parallel_for_stripes(levelHeight[l], MIN_STRIPE_ROWS, [&](int rowStart, int rowEnd) {
+            for (int row = rowStart; row < rowEnd; row++) {
+                const uint8_t *row0 = src + (size_t)row * 2 * srcWidth;
+                kt.burstDown2(row0, row0 + srcWidth, dst + (size_t)row * dstWidth, dstWidth);
+            }
+        });
+    }
+}
+
+bool BurstMerger::addYuv(const YuvFrame &frame) {
+    if (format != BURST_FORMAT_YUV420 || frame.width != width || frame.height != height ||
+        frameCount >= BURST_MAX_FRAMES) {
+        LOGE(TAG, "can not add %dx%d yuv frame %d", frame.width, frame.height, frameCount);
+        return false;
+    }
+    Image &image = frameCount == 0 ? reference : current;
+    allocate(image);
+    int chromaWidth = image.planes[1].width;
+    parallel_for_stripes(height, MIN_STRIPE_ROWS, [&](int rowStart, int rowEnd) {
+        for (int row = rowStart; row < rowEnd; row++) {
+            const uint8_t *y = frame.y + (size_t)row * frame.yRowStride;
+            uint16_t *out = image.planes[0].data.data() + (size_t)row * width;
+            for (int x = 0; x < width; x++) {
+                out[x] = y[x];
+            }
+            memcpy(image.pyramid[0].data() + (size_t)row * width, y, width);
+            if (row % 2 == 0) {
+                size_t offset = (size_t)(row / 2) * frame.uvRowStride;
+                uint16_t *u = image.planes[1].data.data() + (size_t)(row / 2) * chromaWidth;
+                uint16_t *v = image.planes[2].data.data() + (size_t)(row / 2) * chromaWidth;
+                for (int x = 0; x < chromaWidth; x++) {
+                    u[x] = frame.u[offset + (size_t)x * frame.uvPixelStride];
+                    v[x] = frame.v[offset + (size_t)x * frame.uvPixelStride];
+                }
+            }
+        }
+    });
+    return accept();
+}
+
+bool BurstMerger::addRaw(const RawFrame &frame) {
+    int rowBytes = raw_row_bytes(frame.packing, frame.width);
+    if (format != BURST_FORMAT_RAW || frame.width != width || frame.height != height || (width & 1) ||
+        (height & 1) || rowBytes < 0 || frame.rowStride < rowBytes || frameCount >= BURST_MAX_FRAMES) {
+        LOGE(TAG, "can not add %dx%d raw frame %d", frame.width, frame.height, frameCount);
+        return false;
+    }
+    Image &image = frameCount == 0 ? reference : current;
+    allocate(image);
+    const KernelTable &kt = kernel_table();
+    int halfWidth = width / 2;
+    int lumaShift = 2 + std::max(0, bit_length(maxValue) - 8);
+    parallel_for_stripes(height / 2, MIN_STRIPE_ROWS / 2, [&](int rowStart, int rowEnd) {
+        FrameArena scratch;
+        uint16_t *unpacked = scratch.alloc<uint16_t>((size_t)width * 2);
+        for (int row = rowStart; row < rowEnd; row++) {
+            for (int rp = 0; rp < 2; rp++) {
+                auto src = (const uint8_t *)frame.data + (size_t)(row * 2 + rp) * frame.rowStride;
+                uint16_t *line = unpacked + rp * width;
+                if (frame.packing == RAW_PACKING_10) {
+                    kt.rawUnpack10(src, line, width);
+                } else if (frame.packing == RAW_PACKING_12) {
+                    kt.rawUnpack12(src, line, width);
+                } else {
+                    memcpy(line, src, width * 2);
+                }
+                uint16_t *even = image.planes[rp * 2].data.data() + (size_t)row * halfWidth;
+                uint16_t *odd = image.planes[rp * 2 + 1].data.data() + (size_t)row * halfWidth;
+                for (int x = 0; x < halfWidth; x++) {
+                    even[x] = (uint16_t)std::min(line[2 * x] >> valueShift, maxValue);
+                    odd[x] = (uint16_t)std::min(line[2 * x + 1] >> valueShift, maxValue);
+                }
+            }
+            uint8_t *luma = image.pyramid[0].data() + (size_t)row * halfWidth;
+            const uint16_t *p[4];
+            for (int i = 0; i < 4; i++) {
+                p[i] = image.planes[i].data.data() + (size_t)row * halfWidth;
+            }
+            for (int x = 0; x < halfWidth; x++) {
+                luma[x] = (uint8_t)std::min(255, (p[0][x] + p[1][x] + p[2][x] + p[3][x]) >> lumaShift);
+            }
+        }
+    });
+    return accept();
+}
+
+bool BurstMerger::accept() {
+    if (frameCount == 0) {
+        buildPyramid(reference);
+        sums.resize(reference.planes.size());
+        weights.resize(reference.planes.size());
+        for (size_t i = 0; i < reference.planes.size(); i++) {
+            const Plane &plane = reference.planes[i];
+            sums[i].resize(plane.data.size());
+            weights[i].assign(plane.data.size(), (uint16_t)weightMax);
+            for (size_t j = 0; j < plane.data.size(); j++) {
+                sums[i][j] = (uint16_t)(plane.data[j] * weightMax);
+            }
+        }
+    } else {
+        buildPyramid(current);
+        align();
+        merge();
+    }
+    frameCount++;
+    return true;
+}
+
+void BurstMerger::align() {
+    const KernelTable &kt = kernel_table();
+    int levels = (int)levelWidth.size();
+    vector<int16_t> previous, vectors;
+    int previousTilesX = 0, previousTilesY = 0;
+    tileWeight.resize((size_t)tilesX * tilesY);
+    for (int l = levels - 1; l >= 0; l--) {
+        int lw = levelWidth[l], lh = levelHeight[l];
+        int levelTilesX = (lw + TILE - 1) / TILE, levelTilesY = (lh + TILE - 1) / TILE;
+        vectors.assign((size_t)levelTilesX * levelTilesY * 2, 0);
+        const uint8_t *ref = reference.pyramid[l].data();
+        const uint8_t *alt = current.pyramid[l].data();
+        bool coarsest = l == levels - 1;
+
+        parallel_for_stripes(levelTilesY, 1, [&](int rowStart, int rowEnd) {
+            for (int ty = rowStart; ty < rowEnd; ty++) {
+                for (int tx = 0; tx < levelTilesX; tx++) {
+                    int x0 = tx * TILE, y0 = ty * TILE;
+                    int tw = std::min(TILE, lw - x0), th = std::min(TILE, lh - y0);
+                    int cx = 0, cy = 0, radius = params.searchRadius;
+                    if (!coarsest) {
+                        int parent = std::min(ty / 2, previousTilesY - 1) * previousTilesX +
+                                     std::min(tx / 2, previousTilesX - 1);
+                        cx = previous[parent * 2] * 2;
+                        cy = previous[parent * 2 + 1] * 2;
+                        radius = 1;
+                    }
+                    // Keep the displaced tile inside the frame.
+                    int minX = -x0, maxX = lw - tw - x0, minY = -y0, maxY = lh - th - y0;
+                    cx = std::min(std::max(cx, minX), maxX);
+                    cy = std::min(std::max(cy, minY), maxY);
+                    const uint8_t *refTile = ref + (size_t)y0 * lw + x0;
+                    // The starting point goes first, so ties keep the smaller change.
+                    int bestX = cx, bestY = cy;
+                    uint32_t best = kt.burstSad(refTile, lw, alt + (size_t)(y0 + cy) * lw + x0 + cx, lw, tw, th);
+                    for (int dy = std::max(cy - radius, minY); dy <= std::min(cy + radius, maxY); dy++) {
+                        for (int dx = std::max(cx - radius, minX); dx <= std::min(cx + radius, maxX); dx++) {
+                            uint32_t sad = kt.burstSad(refTile, lw, alt + (size_t)(y0 + dy) * lw + x0 + dx, lw,
+                                                       tw, th);
+                            if (sad < best) {
+                                best = sad;
+                                bestX = dx;
+                                bestY = dy;
+                            }
+                        }
+                    }
+                    size_t index = (size_t)ty * levelTilesX + tx;
+                    vectors[index * 2] = (int16_t)bestX;
+                    vectors[index * 2 + 1] = (int16_t)bestY;
+                    if (l == 0) {
+                        // Mean difference over the tile decides how much of it can be trusted.
+                        float meanDiff = (float)best / (tw * th);
+                        float trust = (params.noise + params.ghostRange - meanDiff) / params.ghostRange;
+                        tileWeight[index] = (int16_t)lroundf(std::min(std::max(trust, 0.0f), 1.0f) * weightMax);
+                    }
+                }
+            }
+        });
+        previous.swap(vectors);
+        previousTilesX = levelTilesX;
+        previousTilesY = levelTilesY;
+    }
+    motion.swap(previous);
+}
+
+void BurstMerger::merge() {
+    const KernelTable &kt = kernel_table();
+    double scale = maxValue / 255.0;
+    int16_t mergeParams[MERGE_PARAM_COUNT];
+    mergeParams[MERGE_NOISE] = (int16_t)lround(params.noise * scale);
+    mergeParams[MERGE_RANGE] = (int16_t)std::max(1L, lround(params.ghostRange * scale));
+    // excess * invRange stays below weightMax << WEIGHT_SCALE_BITS, small enough for int16.
+    mergeParams[MERGE_INV_RANGE] = (int16_t)((weightMax << WEIGHT_SCALE_BITS) / mergeParams[MERGE_RANGE]);
+    mergeParams[MERGE_WEIGHT_MAX] = (int16_t)weightMax;
+
+    for (size_t p = 0; p < reference.planes.size(); p++) {
+        const Plane &refPlane = reference.planes[p];
+        const Plane &altPlane = current.planes[p];
+        int pw = refPlane.width, ph = refPlane.height, shift = refPlane.shift;
+        int tile = TILE >> shift;
+        parallel_for_stripes(tilesY, 1, [&](int rowStart, int rowEnd) {
+            int16_t tileParams[MERGE_PARAM_COUNT];
+            memcpy(tileParams, mergeParams, sizeof(tileParams));
+            for (int ty = rowStart; ty < rowEnd; ty++) {
+                int y0 = ty * tile;
+                int th = std::min(tile, ph - y0);
+                for (int tx = 0; tx < tilesX && th > 0; tx++) {
+                    int x0 = tx * tile;
+                    int tw = std::min(tile, pw - x0);
+                    if (tw <= 0) {
+                        break;
+                    }
+                    size_t index = (size_t)ty * tilesX + tx;
+                    // Chroma moves half as far, rounded down, and must stay inside its plane too.
+                    int dx = std::min(std::max(motion[index * 2] >> shift, -x0), pw - tw - x0);
+                    int dy = std::min(std::max(motion[index * 2 + 1] >> shift, -y0), ph - th - y0);
+                    tileParams[MERGE_TILE_WEIGHT] = tileWeight[index];
+                    size_t offset = (size_t)y0 * pw + x0;
+                    kt.burstMerge(refPlane.data.data() + offset, altPlane.data.data() + offset + (ptrdiff_t)dy * pw + dx,
+                                  sums[p].data() + offset, weights[p].data() + offset, pw, tw, th, tileParams);
+                }
+            }
+        });
+    }
+}
+
+bool BurstMerger::finishYuv(uint8_t *y, int yRowStride, uint8_t *u, uint8_t *v, int uvRowStride,
+                            int uvPixelStride) const {
+    if (format != BURST_FORMAT_YUV420 || frameCount == 0) {
+        LOGE(TAG, "nothing to finish as yuv, %d frames", frameCount);
+        return false;
+    }
+    int chromaWidth = reference.planes[1].width;
+    parallel_for_stripes(height, MIN_STRIPE_ROWS, [&](int rowStart, int rowEnd) {
+        for (int row = rowStart; row < rowEnd; row++) {
+            const uint16_t *sum = sums[0].data() + (size_t)row * width;
+            const uint16_t *weight = weights[0].data() + (size_t)row * width;
+            uint8_t *out = y + (size_t)row * yRowStride;
+            for (int x = 0; x < width; x++) {
+                out[x] = (uint8_t)((sum[x] + weight[x] / 2) / weight[x]);
+            }
+            if (row % 2 == 0) {
+                size_t offset = (size_t)(row / 2) * chromaWidth;
+                uint8_t *outU = u + (size_t)(row / 2) * uvRowStride;
+                uint8_t *outV = v + (size_t)(row / 2) * uvRowStride;
+                for (int x = 0; x < chromaWidth; x++) {
+                    outU[x * uvPixelStride] = (uint8_t)((sums[1][offset + x] + weights[1][offset + x] / 2) /
+                                                        weights[1][offset + x]);
+                    outV[x * uvPixelStride] = (uint8_t)((sums[2][offset + x] + weights[2][offset + x] / 2) /
+                                                        weights[2][offset + x]);
+                }
+            }
+        }
+    });
+    return true;
+}
+
+bool BurstMerger::finishRaw(uint16_t *dst, int rowStride) const {
+    if (format != BURST_FORMAT_RAW || frameCount == 0) {
+        LOGE(TAG, "nothing to finish as raw, %d frames", frameCount);
+        return false;
+    }
+    int halfWidth = width / 2;
+    parallel_for_stripes(height, MIN_STRIPE_ROWS, [&](int rowStart, int rowEnd) {
+        for (int row = rowStart; row < rowEnd; row++) {
+            auto out = (uint16_t *)((uint8_t *)dst + (size_t)row * rowStride);
+            for (int cp = 0; cp < 2; cp++) {
+                int plane = (row & 1) * 2 + cp;
+                const uint16_t *sum = sums[plane].data() + (size_t)(row / 2) * halfWidth;
+                const uint16_t *weight = weights[plane].data() + (size_t)(row / 2) * halfWidth;
+                for (int x = 0; x < halfWidth; x++) {
+                    out[2 * x + cp] = (uint16_t)(((sum[x] + weight[x] / 2) / weight[x]) << valueShift);
+                }
+            }
+        }
+    });
+    return true;
+}
+
+void BurstMerger::reset() {
+    frameCount = 0;
+}
+
+/**
+ * Mean absolute gradient of every 4th row and column of Y.
+ * */
+static double yuv_sharpness(const YuvFrame &frame) {
+    double total = 0;
+    long count = 0;
+    for (int row = 0; row + 1 < frame.height; row += 4) {
+        const uint8_t *y = frame.y + (size_t)row * frame.yRowStride;
+        for (int x = 0; x + 1 < frame.width; x += 4) {
+            total += abs(y[x + 1] - y[x]) + abs(y[x + frame.yRowStride] - y[x]);
+            count++;
+        }
+    }
+    return count > 0 ? total / count : 0;
+}
+
+bool burst_merge_yuv(const YuvFrame *frames, int count, const BurstParams &params,
+                     uint8_t *y, int yRowStride, uint8_t *u, uint8_t *v, int uvRowStride, int uvPixelStride) {
+    if (count <= 0) {
+        return false;
+    }
+    int referenceIndex = 0;
+    double sharpest = -1;
+    for (int i = 0; i < std::min(count, REFERENCE_CANDIDATES); i++) {
+        double sharpness = yuv_sharpness(frames[i]);
+        if (sharpness > sharpest) {
+            sharpest = sharpness;
+            referenceIndex = i;
+        }
+    }
+    BurstMerger merger(BURST_FORMAT_YUV420, frames[0].width, frames[0].height, params);
+    if (!merger.addYuv(frames[referenceIndex])) {
+        return false;
+    }
+    for (int i = 0; i < count && merger.getFrameCount() < BURST_MAX_FRAMES; i++) {
+        if (i != referenceIndex && !merger.addYuv(frames[i])) {
+            return false;
+        }
+    }
+    return merger.finishYuv(y, yRowStride, u, v, uvRowStride, uvPixelStride);
+}
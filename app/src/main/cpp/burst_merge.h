@@ -0,0 +1,136 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#ifndef CAMERAUTIL_BURST_MERGE_H
+#define CAMERAUTIL_BURST_MERGE_H
+
+#include "yuv_kernels.h"
+#include "raw_pipeline.h"
+#include <stdint.h>
+#include <vector>
+
+/**
+ * 多帧合成降噪（夜景），第一帧（或者burst_merge_yuv选出的最清晰的一帧）作为参考帧，
+ * 其余每帧到达时立即对齐并累加，然后就可以释放，内存占用与帧数无关。
+ *
+ * 对齐：在亮度金字塔上逐层分块搜索。亮度对YUV是Y，对RAW是每个2x2 Bayer块的均值，所以RAW的运动
+ * 总是偶数像素，不会打乱CFA。最粗一层在searchRadius内全搜索，更细的层从上一层的父块出发搜索±1，
+ * 匹配度量是SAD。
+ *
+ * 合成：每个像素的权重随它与参考帧的差下降，超过noise + ghostRange时为0（运动物体、对齐失败），
+ * 同时不超过所在块的权重（由块的平均差决定）。加权和与权重和都是16位累加器，
+ * 所以最多BURST_MAX_FRAMES帧，RAW超过10位时按10位合成。
+ *
+ * 对齐和合成都按块行分给多个线程。
+ * */
+
+#define BURST_FORMAT_YUV420 0
+#define BURST_FORMAT_RAW 1
+
+#define BURST_MAX_FRAMES 16
+
+struct BurstParams {
+    // Differences up to this are noise and merged with full weight, in 8 bit units.
+    float noise = 4.0f;
+    // Weight falls to 0 over this much more difference.
+    float ghostRange = 12.0f;
+    // Full search radius at the coarsest pyramid level.
+    int searchRadius = 4;
+};
+
+class BurstMerger {
+public:
+    /**
+     * whiteLevel is the largest sample value of RAW frames, ignored for YUV.
+     * */
+    BurstMerger(int format, int width, int height, const BurstParams &params = BurstParams(),
+                int whiteLevel = 1023);
+    BurstMerger(BurstMerger &) = delete;
+
+    /**
+     * Align and accumulate a frame, the first one becomes the reference. The frame is not used
+     * after the call returns. Return false if it does not match the format and size, or the
+     * burst already has BURST_MAX_FRAMES frames.
+     * */
+    bool addYuv(const YuvFrame &frame);
+    bool addRaw(const RawFrame &frame);
+
+    int getFrameCount() const {
+        return frameCount;
+    }
+
+    int getWidth() const {
+        return width;
+    }
+
+    int getHeight() const {
+        return height;
+    }
+
+    /**
+     * Write the merged frame, uvPixelStride 1 for I420 and 2 for NV12 / NV21 (v = u + 1 or u - 1).
+     * */
+    bool finishYuv(uint8_t *y, int yRowStride, uint8_t *u, uint8_t *v, int uvRowStride, int uvPixelStride) const;
+
+    /**
+     * Write the merged Bayer frame, one uint16 per pixel, rowStride in bytes.
+     * */
+    bool finishRaw(uint16_t *dst, int rowStride) const;
+
+    /**
+     * Drop all frames, the buffers are kept for the next burst.
+     * */
+    void reset();
+
+private:
+    struct Plane {
+        std::vector<uint16_t> data;
+        int width = 0;
+        int height = 0;
+        // log2 of the plane's pixel size in alignment luma pixels, 1 for YUV chroma
+        int shift = 0;
+    };
+
+    struct Image {
+        std::vector<Plane> planes;
+        // Alignment luma, level 0 is full resolution for YUV and half for RAW
+        std::vector<std::vector<uint8_t>> pyramid;
+    };
+
+    void allocate(Image &image) const;
+    void buildPyramid(Image &image) const;
+    void align();
+    void merge();
+    bool accept();
+
+    int format, width, height;
+    BurstParams params;
+    // Samples are stored >> valueShift so that they fit the accumulators.
+    int valueShift = 0;
+    int maxValue = 255;
+    int weightMax = 16;
+    int frameCount = 0;
+
+    std::vector<int> levelWidth, levelHeight;
+
+    Image reference;
+    // The frame being added, reused for every frame
+    Image current;
+    // Weighted sums and weight sums per plane
+    std::vector<std::vector<uint16_t>> sums, weights;
+
+    int tilesX = 0, tilesY = 0;
+    // dx, dy per level 0 tile, in level 0 luma pixels
+    std::vector<int16_t> motion;
+    std::vector<int16_t> tileWeight;
+};
+
+/**
+ * Merge a burst held in memory: the sharpest of the first 3 frames is the reference.
+ * Output as BurstMerger::finishYuv.
+ * */
+bool burst_merge_yuv(const YuvFrame *frames, int count, const BurstParams &params,
+                     uint8_t *y, int yRowStride, uint8_t *u, uint8_t *v, int uvRowStride, int uvPixelStride);
+
+#endif //CAMERAUTIL_BURST_MERGE_H
@@ -0,0 +1,530 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#include "conformance.h"
+#include "constants.h"
+#include "log.h"
+#include "yuv_kernels.h"
+#include "yuv10_kernels.h"
+#include "parallel.h"
+#include "dispatch.h"
+#include "cpu_features.h"
+#include <vector>
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <algorithm>
+
+using namespace std;
+
+#define TAG "conformance.cpp"
+
+// Largest difference of a channel from the double precision reference, in LSB of the output.
+// FAST truncates with 7 bit coefficients but still stays within 1 on every pattern here,
+// a faster kernel must not do worse.
+#define YUV_FAST_MAX_ERROR 1
+#define YUV_HIGH_MAX_ERROR 1
+// 10 bit paths: half an LSB of rounding plus the fixed point error, the dithered 8 bit output
+// adds up to another half.
+#define YUV10_MAX_ERROR_1010102 1.0
+#define YUV10_MAX_ERROR_F16 1.0
+#define YUV10_MAX_ERROR_8888 1.5
+
+// Threads of the multi threaded run, fixed so that the stripes are really split on any device.
+#define CONFORMANCE_THREADS 4
+// Stop logging failures after this many, the count is still returned.
+#define MAX_LOGGED_FAILURES 32
+// Written into row padding, a kernel reading it shows up as a mismatch between layouts.
+#define PADDING_FILL 0xA5
+
+enum Pattern {
+    PATTERN_RAMP,
+    PATTERN_BARS,
+    PATTERN_NOISE,
+    PATTERN_EXTREME,
+    PATTERN_COUNT
+};
+
+static const char *PATTERN_NAMES[PATTERN_COUNT] = {"ramp", "bars", "noise", "extreme"};
+
+// Width and height, covering 2x2 blocks, SIMD tails, odd sizes and several stripes.
+static const int SIZES[][2] = {{2, 2}, {17, 11}, {64, 32}, {131, 67}, {320, 240}};
+
+// Extra bytes (samples for 10 bit) at the end of each row, odd to break any alignment.
+static const int PADDINGS[] = {0, 13};
+
+// 75% color bars: white, yellow, cyan, green, magenta, red, blue, black.
+static const double BARS[8][3] = {
+        {0.75, 0.75, 0.75}, {0.75, 0.75, 0.0}, {0.0, 0.75, 0.75}, {0.0, 0.75, 0.0},
+        {0.75, 0.0, 0.75}, {0.75, 0.0, 0.0}, {0.0, 0.0, 0.75}, {0.0, 0.0, 0.0},
+};
+
+struct Suite {
+    const char *filter;
+    int checks = 0;
+    int failures = 0;
+};
+
+static bool matchFilter(const char *name, const char *filter) {
+    return filter == nullptr || filter[0] == '\0' || strstr(name, filter) != nullptr;
+}
+
+static void fail(Suite &suite, const char *format, ...) {
+    suite.failures++;
+    if (suite.failures > MAX_LOGGED_FAILURES) {
+        return;
+    }
+    char message[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+    LOGE(TAG, "%s", message);
+}
+
+static inline uint32_t xorshift(uint32_t &state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+/**
+ * One sample of plane (0 Y, 1 U, 2 V) at (x, y) of that plane, in [0, maxValue].
+ * Bars use the BT.601 full range matrix, which puts them in range for every matrix.
+ * */
+static int pattern_sample(int pattern, int plane, int x, int y, int planeWidth, int planeHeight, int maxValue,
+                          uint32_t &seed) {
+    switch (pattern) {
+        case PATTERN_RAMP: {
+            if (plane == 0) {
+                return planeWidth > 1 ? x * maxValue / (planeWidth - 1) : 0;
+            }
+            int position = plane == 1 ? y : x + y;
+            int range = plane == 1 ? planeHeight - 1 : planeWidth + planeHeight - 2;
+            return range > 0 ? position * maxValue / range : maxValue / 2;
+        }
+        case PATTERN_BARS: {
+            const double *rgb = BARS[x * 8 / planeWidth];
+            double luma = 0.299 * rgb[0] + 0.587 * rgb[1] + 0.114 * rgb[2];
+            double value = plane == 0 ? luma : 0.5 + (plane == 1 ? (rgb[2] - luma) / 1.772 : (rgb[0] - luma) / 1.402);
+            return (int)lround(value * maxValue);
+        }
+        case PATTERN_NOISE:
+            return (int)(xorshift(seed) % (uint32_t)(maxValue + 1));
+        default: {
+            // Every combination of 0 and maxValue, the largest overshoot of each channel.
+            int bit = plane == 0 ? ((x >> 1) ^ (y >> 1)) & 1 : plane == 1 ? x & 1 : (x >> 1 ^ y) & 1;
+            return bit ? maxValue : 0;
+        }
+    }
+}
+
+enum Layout8 {
+    LAYOUT_I420,
+    LAYOUT_NV12,
+    LAYOUT_NV21,
+    LAYOUT_8_COUNT
+};
+
+static const char *LAYOUT_8_NAMES[LAYOUT_8_COUNT] = {"I420", "NV12", "NV21"};
+
+struct TestFrame {
+    vector<uint8_t> y;
+    vector<uint8_t> u;
+    vector<uint8_t> v;
+    YuvFrame frame;
+};
+
+static void make_frame(int pattern, int layout, int width, int height, int padding, TestFrame &out) {
+    int chromaWidth = (width + 1) / 2, chromaHeight = (height + 1) / 2;
+    int pixelStride = layout == LAYOUT_I420 ? 1 : 2;
+    YuvFrame &frame = out.frame;
+    frame.width = width;
+    frame.height = height;
+    frame.yRowStride = width + padding;
+    frame.uvRowStride = chromaWidth * pixelStride + padding;
+    frame.uvPixelStride = pixelStride;
+    out.y.assign((size_t)frame.yRowStride * height, PADDING_FILL);
+    out.u.assign((size_t)frame.uvRowStride * chromaHeight, PADDING_FILL);
+    out.v.assign(layout == LAYOUT_I420 ? out.u.size() : 0, PADDING_FILL);
+    uint8_t *u = out.u.data(), *v = layout == LAYOUT_I420 ? out.v.data() : out.u.data();
+    if (layout == LAYOUT_NV12) {
+        v++;
+    } else if (layout == LAYOUT_NV21) {
+        u++;
+    }
+
+    uint32_t seed = 0x2545F491u + (uint32_t)(width * 31 + height);
+    for (int row = 0; row < height; row++) {
+        for (int col = 0; col < width; col++) {
+            out.y[row * frame.yRowStride + col] = (uint8_t)pattern_sample(pattern, 0, col, row, width, height, 255, seed);
+        }
+    }
+    for (int row = 0; row < chromaHeight; row++) {
+        for (int col = 0; col < chromaWidth; col++) {
+            int index = row * frame.uvRowStride + col * pixelStride;
+            u[index] = (uint8_t)pattern_sample(pattern, 1, col, row, chromaWidth, chromaHeight, 255, seed);
+            v[index] = (uint8_t)pattern_sample(pattern, 2, col, row, chromaWidth, chromaHeight, 255, seed);
+        }
+    }
+    frame.y = out.y.data();
+    frame.u = u;
+    frame.v = v;
+}
+
+/**
+ * Passes over all cases: the first with the scalar kernels on one thread, checked against the reference,
+ * then every variant and thread count, checked against the output hashes of the first. Switching kernels
+ * once per pass rather than once per case keeps the dispatch table and thread pool out of the loop.
+ * */
+struct Pass {
+    char features[64];
+    int threads;
+    int policy;
+};
+
+static vector<Pass> make_passes(bool policies) {
+    vector<Pass> passes;
+    uint32_t masks[8];
+    int count = dispatch_variants(masks, 8);
+    for (int threads : {1, CONFORMANCE_THREADS}) {
+        for (int i = 0; i < count; i++) {
+            for (int policy : {YUV_KERNEL_ARITHMETIC, YUV_KERNEL_LUT}) {
+                if (policy == YUV_KERNEL_LUT && !policies) {
+                    continue;
+                }
+                Pass pass;
+                cpu_features_to_string(masks[i], pass.features, sizeof(pass.features));
+                pass.threads = threads;
+                pass.policy = policy;
+                passes.push_back(pass);
+            }
+        }
+    }
+    // masks[0] is scalar, the first pass gives the reference output of the rest.
+    return passes;
+}
+
+static void apply_pass(const Pass &pass) {
+    dispatch_set_override(pass.features);
+    parallel_set_thread_count(pass.threads);
+    yuv_set_kernel_policy(pass.policy);
+}
+
+static uint64_t hash_bytes(const void *data, size_t size) {
+    auto bytes = (const uint8_t *)data;
+    uint64_t hash = 0xCBF29CE484222325ull;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, bytes + i, sizeof(word));
+        hash = (hash ^ word) * 0x100000001B3ull;
+        hash ^= hash >> 29;
+    }
+    for (; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+    }
+    return hash;
+}
+
+/**
+ * Every 8 bit frame, orientation and precision, in every pass.
+ * */
+static void conformanceYuv420(Suite &suite) {
+    static const int PRECISIONS[] = {YUV_PRECISION_FAST, YUV_PRECISION_HIGH};
+    static const int BOUNDS[] = {YUV_FAST_MAX_ERROR, YUV_HIGH_MAX_ERROR};
+    static const char *PRECISION_NAMES[] = {"fast", "high"};
+
+    vector<Pass> passes = make_passes(true);
+    vector<uint64_t> hashes;
+    // Per precision, per channel
+    int maxError[2][4] = {};
+    for (size_t p = 0; p < passes.size(); p++) {
+        const Pass &pass = passes[p];
+        apply_pass(pass);
+        size_t index = 0;
+        for (auto &size : SIZES) {
+            int width = size[0], height = size[1];
+            size_t pixels = (size_t)width * height;
+            vector<uint32_t> out(pixels), reference(pixels);
+            for (int layout = 0; layout < LAYOUT_8_COUNT; layout++) {
+                for (int padding : PADDINGS) {
+                    for (int pattern = 0; pattern < PATTERN_COUNT; pattern++) {
+                        char name[96];
+                        snprintf(name, sizeof(name), "yuv420 %dx%d %s+%d %s", width, height, LAYOUT_8_NAMES[layout],
+                                 padding, PATTERN_NAMES[pattern]);
+                        if (!matchFilter(name, suite.filter)) {
+                            continue;
+                        }
+                        TestFrame test;
+                        make_frame(pattern, layout, width, height, padding, test);
+                        for (int orientation = 0; orientation < 8; orientation++) {
+                            int rotation = orientation / 2, facing = orientation % 2;
+                            if (p == 0) {
+                                yuv420_to_rgba_reference(test.frame, reference.data(), rotation, facing);
+                            }
+                            for (int precision = 0; precision < 2; precision++) {
+                                yuv420_to_rgba(test.frame, out.data(), rotation, facing, PRECISIONS[precision]);
+                                uint64_t hash = hash_bytes(out.data(), pixels * sizeof(uint32_t));
+                                suite.checks++;
+                                if (p > 0) {
+                                    if (hash != hashes[index++]) {
+                                        fail(suite, "%s rotation %d facing %d %s@%s %s %d threads: "
+                                                    "differs from scalar", name, rotation, facing,
+                                             PRECISION_NAMES[precision], pass.features,
+                                             pass.policy == YUV_KERNEL_LUT ? "lut" : "arithmetic", pass.threads);
+                                    }
+                                    continue;
+                                }
+                                hashes.push_back(hash);
+                                int error[4] = {};
+                                for (size_t i = 0; i < pixels; i++) {
+                                    for (int c = 0; c < 4; c++) {
+                                        int a = (int)(out[i] >> (c * 8) & 0xFF);
+                                        int b = (int)(reference[i] >> (c * 8) & 0xFF);
+                                        error[c] = max(error[c], abs(a - b));
+                                    }
+                                }
+                                if (max(max(error[0], error[1]), error[2]) > BOUNDS[precision] || error[3] != 0) {
+                                    fail(suite, "%s rotation %d facing %d %s: error R %d G %d B %d A %d, bound %d",
+                                         name, rotation, facing, PRECISION_NAMES[precision], error[0], error[1],
+                                         error[2], error[3], BOUNDS[precision]);
+                                }
+                                for (int c = 0; c < 4; c++) {
+                                    maxError[precision][c] = max(maxError[precision][c], error[c]);
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+    if (!hashes.empty()) {
+        for (int precision = 0; precision < 2; precision++) {
+            LOGD(TAG, "yuv420 %s: %zu cases x %zu passes, max error R %d G %d B %d A %d, bound %d",
+                 PRECISION_NAMES[precision], hashes.size() / 2, passes.size(), maxError[precision][0],
+                 maxError[precision][1], maxError[precision][2], maxError[precision][3], BOUNDS[precision]);
+        }
+    }
+}
+
+enum Layout10 {
+    LAYOUT_P010,
+    LAYOUT_I010,
+    LAYOUT_10_COUNT
+};
+
+static const char *LAYOUT_10_NAMES[LAYOUT_10_COUNT] = {"P010", "I010"};
+
+struct TestFrame10 {
+    vector<uint16_t> y;
+    vector<uint16_t> u;
+    vector<uint16_t> v;
+    Yuv10Frame frame;
+};
+
+static void make_frame10(int pattern, int layout, int width, int height, int padding, TestFrame10 &out) {
+    int chromaWidth = (width + 1) / 2, chromaHeight = (height + 1) / 2;
+    int pixelStride = layout == LAYOUT_P010 ? 2 : 1;
+    int yStride = width + padding, uvStride = chromaWidth * pixelStride + padding;
+    int shift = layout == LAYOUT_P010 ? 6 : 0;
+    Yuv10Frame &frame = out.frame;
+    frame.width = width;
+    frame.height = height;
+    frame.yRowStride = yStride * (int)sizeof(uint16_t);
+    frame.uvRowStride = uvStride * (int)sizeof(uint16_t);
+    frame.uvPixelStride = pixelStride * (int)sizeof(uint16_t);
+    frame.layout = layout == LAYOUT_P010 ? YUV10_LAYOUT_MSB : YUV10_LAYOUT_LSB;
+    uint16_t fill = PADDING_FILL * 0x101;
+    out.y.assign((size_t)yStride * height, fill);
+    out.u.assign((size_t)uvStride * chromaHeight, fill);
+    out.v.assign(layout == LAYOUT_I010 ? out.u.size() : 0, fill);
+    uint16_t *u = out.u.data(), *v = layout == LAYOUT_I010 ? out.v.data() : out.u.data() + 1;
+
+    uint32_t seed = 0x9E3779B9u + (uint32_t)(width * 31 + height);
+    for (int row = 0; row < height; row++) {
+        for (int col = 0; col < width; col++) {
+            out.y[row * yStride + col] =
+                    (uint16_t)(pattern_sample(pattern, 0, col, row, width, height, 1023, seed) << shift);
+        }
+    }
+    for (int row = 0; row < chromaHeight; row++) {
+        for (int col = 0; col < chromaWidth; col++) {
+            int index = row * uvStride + col * pixelStride;
+            u[index] = (uint16_t)(pattern_sample(pattern, 1, col, row, chromaWidth, chromaHeight, 1023, seed) << shift);
+            v[index] = (uint16_t)(pattern_sample(pattern, 2, col, row, chromaWidth, chromaHeight, 1023, seed) << shift);
+        }
+    }
+    frame.y = out.y.data();
+    frame.u = u;
+    frame.v = v;
+}
+
+/**
+ * Exact RGB in [0, 1], 3 per output pixel, from the matrix definitions rather than yuv10_coefficients.
+ * */
+static void yuv10_reference(const Yuv10Frame &frame, int matrix, int rotation, int facing, double *dst) {
+    double kr = 0.299, kb = 0.114, yOffset = 0, yScale = 1.0, cScale = 1.0;
+    if (matrix != YUV_MATRIX_BT601_FULL) {
+        kr = matrix == YUV_MATRIX_BT709_LIMITED ? 0.2126 : 0.2627;
+        kb = matrix == YUV_MATRIX_BT709_LIMITED ? 0.0722 : 0.0593;
+        yOffset = 64;
+        yScale = 1023.0 / 876.0;
+        cScale = 1023.0 / 896.0;
+    }
+    double kg = 1.0 - kr - kb;
+    int shift = frame.layout == YUV10_LAYOUT_MSB ? 6 : 0;
+    int origin, rowStep, colStep;
+    yuv_output_layout(frame.width, frame.height, rotation, facing, origin, rowStep, colStep);
+    for (int row = 0; row < frame.height; row++) {
+        auto y = (const uint16_t *)((const uint8_t *)frame.y + (size_t)row * frame.yRowStride);
+        auto u = (const uint16_t *)((const uint8_t *)frame.u + (size_t)(row / 2) * frame.uvRowStride);
+        auto v = (const uint16_t *)((const uint8_t *)frame.v + (size_t)(row / 2) * frame.uvRowStride);
+        for (int col = 0; col < frame.width; col++) {
+            int c = col / 2 * frame.uvPixelStride / (int)sizeof(uint16_t);
+            double luma = ((y[col] >> shift) - yOffset) * yScale;
+            double cb = ((u[c] >> shift) - 512.0) * cScale;
+            double cr = ((v[c] >> shift) - 512.0) * cScale;
+            double rgb[3] = {
+                    luma + 2.0 * (1.0 - kr) * cr,
+                    luma - 2.0 * kb * (1.0 - kb) / kg * cb - 2.0 * kr * (1.0 - kr) / kg * cr,
+                    luma + 2.0 * (1.0 - kb) * cb,
+            };
+            double *out = dst + (size_t)(origin + row * rowStep + col * colStep) * 3;
+            for (int i = 0; i < 3; i++) {
+                out[i] = min(max(rgb[i] / 1023.0, 0.0), 1.0);
+            }
+        }
+    }
+}
+
+static float half_to_float(uint16_t half) {
+    int exponent = (half >> 10) & 0x1F;
+    int mantissa = half & 0x3FF;
+    float value = exponent == 0 ? ldexpf((float)mantissa, -24) : ldexpf((float)(mantissa | 0x400), exponent - 25);
+    return (half & 0x8000) ? -value : value;
+}
+
+/**
+ * Channel i in [0, 1] of pixel index of dst in format, alpha is channel 3.
+ * */
+static double output_channel(const void *dst, int format, size_t index, int i) {
+    if (format == OUTPUT_RGBA_F16) {
+        return half_to_float((uint16_t)(((const uint64_t *)dst)[index] >> (i * 16)));
+    }
+    uint32_t pixel = ((const uint32_t *)dst)[index];
+    if (format == OUTPUT_RGBA_1010102) {
+        return i == 3 ? (pixel >> 30) / 3.0 : (pixel >> (i * 10) & 0x3FF) / 1023.0;
+    }
+    return (pixel >> (i * 8) & 0xFF) / 255.0;
+}
+
+/**
+ * Every 10 bit frame, matrix, format and orientation, in every pass.
+ * */
+static void conformanceYuv10(Suite &suite) {
+    static const int FORMATS[] = {OUTPUT_RGBA_8888, OUTPUT_RGBA_F16, OUTPUT_RGBA_1010102};
+    static const char *FORMAT_NAMES[] = {"8888", "f16", "1010102"};
+    // Error unit of each format, in LSB
+    static const double SCALES[] = {255.0, 1023.0, 1023.0};
+    static const double BOUNDS[] = {YUV10_MAX_ERROR_8888, YUV10_MAX_ERROR_F16, YUV10_MAX_ERROR_1010102};
+    static const char *MATRIX_NAMES[] = {"bt601", "bt709", "bt2020"};
+
+    vector<Pass> passes = make_passes(false);
+    vector<uint64_t> hashes;
+    double maxError[3] = {};
+    for (size_t p = 0; p < passes.size(); p++) {
+        const Pass &pass = passes[p];
+        apply_pass(pass);
+        size_t index = 0;
+        for (auto &size : SIZES) {
+            int width = size[0], height = size[1];
+            size_t pixels = (size_t)width * height;
+            // Largest output is F16, 8 bytes per pixel.
+            vector<uint64_t> out(pixels);
+            vector<double> reference(pixels * 3);
+            for (int layout = 0; layout < LAYOUT_10_COUNT; layout++) {
+                for (int padding : PADDINGS) {
+                    for (int pattern = 0; pattern < PATTERN_COUNT; pattern++) {
+                        TestFrame10 test;
+                        make_frame10(pattern, layout, width, height, padding, test);
+                        for (int matrix = YUV_MATRIX_BT601_FULL; matrix <= YUV_MATRIX_BT2020_LIMITED; matrix++) {
+                            char name[96];
+                            snprintf(name, sizeof(name), "yuv10 %dx%d %s+%d %s %s", width, height,
+                                     LAYOUT_10_NAMES[layout], padding, PATTERN_NAMES[pattern], MATRIX_NAMES[matrix]);
+                            if (!matchFilter(name, suite.filter)) {
+                                continue;
+                            }
+                            for (int orientation = 0; orientation < 8; orientation++) {
+                                int rotation = orientation / 2, facing = orientation % 2;
+                                if (p == 0) {
+                                    yuv10_reference(test.frame, matrix, rotation, facing, reference.data());
+                                }
+                                for (int f = 0; f < 3; f++) {
+                                    int format = FORMATS[f];
+                                    yuv10_to_rgba(test.frame, out.data(), format, matrix, rotation, facing);
+                                    uint64_t hash = hash_bytes(out.data(), pixels * yuv10_bytes_per_pixel(format));
+                                    suite.checks++;
+                                    if (p > 0) {
+                                        if (hash != hashes[index++]) {
+                                            fail(suite, "%s rotation %d facing %d %s@%s %d threads: "
+                                                        "differs from scalar", name, rotation, facing,
+                                                 FORMAT_NAMES[f], pass.features, pass.threads);
+                                        }
+                                        continue;
+                                    }
+                                    hashes.push_back(hash);
+                                    double error = 0;
+                                    bool opaque = true;
+                                    for (size_t i = 0; i < pixels; i++) {
+                                        for (int c = 0; c < 3; c++) {
+                                            double value = output_channel(out.data(), format, i, c);
+                                            error = max(error, fabs(value - reference[i * 3 + c]) * SCALES[f]);
+                                        }
+                                        opaque &= output_channel(out.data(), format, i, 3) == 1.0;
+                                    }
+                                    maxError[f] = max(maxError[f], error);
+                                    if (error > BOUNDS[f] || !opaque) {
+                                        fail(suite, "%s rotation %d facing %d %s: error %.3f, bound %.1f%s", name,
+                                             rotation, facing, FORMAT_NAMES[f], error, BOUNDS[f],
+                                             opaque ? "" : ", alpha is not opaque");
+                                    }
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+    if (!hashes.empty()) {
+        for (int f = 0; f < 3; f++) {
+            LOGD(TAG, "yuv10 %s: %zu cases x %zu passes, max error %.3f LSB, bound %.1f", FORMAT_NAMES[f],
+                 hashes.size() / 3, passes.size(), maxError[f], BOUNDS[f]);
+        }
+    }
+}
+
+int run_conformance(const char *filter) {
+    char previous[64];
+    cpu_features_to_string(dispatch_features(), previous, sizeof(previous));
+    Suite suite;
+    suite.filter = filter;
+    conformanceYuv420(suite);
+    conformanceYuv10(suite);
+    dispatch_set_override(previous);
+    parallel_set_thread_count(0);
+    yuv_set_kernel_policy(YUV_KERNEL_AUTO);
+    if (suite.failures > 0) {
+        LOGE(TAG, "%d of %d checks failed", suite.failures, suite.checks);
+    } else {
+        LOGD(TAG, "all %d checks passed", suite.checks);
+    }
+    return suite.failures;
+}
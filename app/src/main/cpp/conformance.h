@@ -0,0 +1,22 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#ifndef CAMERAUTIL_CONFORMANCE_H
+#define CAMERAUTIL_CONFORMANCE_H
+
+/**
+ * YUV转RGBA的一致性测试，结果通过logcat输出。
+ *
+ * 输入是确定性生成的合成帧：渐变、彩条、伪随机噪声和极值（0/255组合，检验饱和），
+ * 覆盖多种尺寸（包括奇数宽度对应的尾部处理和多个条带）、带填充的行跨度，以及I420 / NV12 / NV21
+ * （10位为P010 / I010）排列。每个输入在所有指令集变体、kernel策略、精度、旋转、镜像以及
+ * 单线程/多线程下转换，检查：
+ * 1. 与双精度参考实现的每通道最大误差不超过该精度记录的上限；
+ * 2. 同一精度下所有变体的输出与标量单线程的结果逐位相同。
+ *
+ * filter为空时运行全部测试，否则只运行名字中包含filter的测试。返回失败的检查数，0表示全部通过。
+ * */
+int run_conformance(const char *filter);
+
+#endif //CAMERAUTIL_CONFORMANCE_H
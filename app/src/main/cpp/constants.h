@@ -13,5 +13,17 @@
 #define ROTATION_180 2
 #define ROTATION_270 3
 
+// android.graphics.ImageFormat
+#define IMAGE_FORMAT_RAW_SENSOR 0x20
+#define IMAGE_FORMAT_YUV_420_888 0x23
+#define IMAGE_FORMAT_RAW10 0x25
+#define IMAGE_FORMAT_RAW12 0x26
+#define IMAGE_FORMAT_YCBCR_P010 0x36
+
+// android.hardware.DataSpace
+#define DATASPACE_TRANSFER_MASK (0x1F << 22)
+#define DATASPACE_TRANSFER_ST2084 (7 << 22)
+#define DATASPACE_TRANSFER_HLG (8 << 22)
+
 
 #endif //CAMERAUTIL_CONSTANTS_H
@@ -5,11 +5,20 @@
 #include "converter.h"
 #include <android/bitmap.h>
 #include "log.h"
+#include "yuv_kernels.h"
+#include "yuv10_kernels.h"
+#include "lut3d.h"
+#include "exposure_fusion.h"
+#include "lens_distortion.h"
+#include "simd.h"
+#include "trace.h"
+#include "frame_arena.h"
 #include "glm/mat3x3.hpp"
 #include "glm/vec3.hpp"
 #include <chrono>
 #include <algorithm>
 #include <stdlib.h>
+#include <mutex>
 
 using namespace std;
 
@@ -21,6 +30,11 @@ jmethodID bitmapCreateMethod = nullptr;
 jclass configClass = nullptr;
 jobject argb8888Obj = nullptr;
 
+static mutex gradeMutex;
+static shared_ptr<Lut3D> gradeLut;
+static mutex lensMutex;
+static unique_ptr<LensDistortion> lensDistortion;
+
 void initJNI(JNIEnv *env) {
     bitmapClass = (jclass)env->NewGlobalRef(env->FindClass("android/graphics/Bitmap"));
     bitmapCreateMethod = env->GetStaticMethodID(bitmapClass, "createBitmap", "(IILandroid/graphics/Bitmap$Config;)Landroid/graphics/Bitmap;");
@@ -193,10 +207,13 @@ jobject convert_YUV_420_888_i32(JNIEnv *env, ImageProxy &image, int rotation, in
         initJNI(env);
     }
 
-    jobject bitmap = env->CallStaticObjectMethod(bitmapClass, bitmapCreateMethod, bitmapWidth, bitmapHeight, argb8888Obj);
-
+    jobject bitmap;
     int32_t *bitmapBuffer = nullptr;
-    AndroidBitmap_lockPixels(env, bitmap, (void **)&bitmapBuffer);
+    {
+        TRACE_SCOPE("Bitmap acquire");
+        bitmap = env->CallStaticObjectMethod(bitmapClass, bitmapCreateMethod, bitmapWidth, bitmapHeight, argb8888Obj);
+        AndroidBitmap_lockPixels(env, bitmap, (void **)&bitmapBuffer);
+    }
 
     uint8_t *yBuffer, *uBuffer, *vBuffer;
     int yBufferLen, uBufferLen, vBufferLen;
@@ -253,10 +270,13 @@ jobject convert_YUV_420_888_i32_raw(JNIEnv *env, ImageProxy &image, int rotation
         initJNI(env);
     }
 
-    jobject bitmap = env->CallStaticObjectMethod(bitmapClass, bitmapCreateMethod, bitmapWidth, bitmapHeight, argb8888Obj);
-
+    jobject bitmap;
     int32_t *bitmapBuffer = nullptr;
-    AndroidBitmap_lockPixels(env, bitmap, (void **)&bitmapBuffer);
+    {
+        TRACE_SCOPE("Bitmap acquire");
+        bitmap = env->CallStaticObjectMethod(bitmapClass, bitmapCreateMethod, bitmapWidth, bitmapHeight, argb8888Obj);
+        AndroidBitmap_lockPixels(env, bitmap, (void **)&bitmapBuffer);
+    }
 
     uint8_t *yBuffer, *uBuffer, *vBuffer;
     int yBufferLen, uBufferLen, vBufferLen;
@@ -323,10 +343,13 @@ jobject convert_YUV_420_888_f32(JNIEnv *env, ImageProxy &image, int rotation, in
         initJNI(env);
     }
 
-    jobject bitmap = env->CallStaticObjectMethod(bitmapClass, bitmapCreateMethod, bitmapWidth, bitmapHeight, argb8888Obj);
-
+    jobject bitmap;
     int32_t *bitmapBuffer = nullptr;
-    AndroidBitmap_lockPixels(env, bitmap, (void **)&bitmapBuffer);
+    {
+        TRACE_SCOPE("Bitmap acquire");
+        bitmap = env->CallStaticObjectMethod(bitmapClass, bitmapCreateMethod, bitmapWidth, bitmapHeight, argb8888Obj);
+        AndroidBitmap_lockPixels(env, bitmap, (void **)&bitmapBuffer);
+    }
 
     uint8_t *yBuffer, *uBuffer, *vBuffer;
     int yBufferLen, uBufferLen, vBufferLen;
@@ -382,10 +405,13 @@ jobject convert_YUV_420_888_f32_raw(JNIEnv *env, ImageProxy &image, int rotation
         initJNI(env);
     }
 
-    jobject bitmap = env->CallStaticObjectMethod(bitmapClass, bitmapCreateMethod, bitmapWidth, bitmapHeight, argb8888Obj);
-
+    jobject bitmap;
     int32_t *bitmapBuffer = nullptr;
-    AndroidBitmap_lockPixels(env, bitmap, (void **)&bitmapBuffer);
+    {
+        TRACE_SCOPE("Bitmap acquire");
+        bitmap = env->CallStaticObjectMethod(bitmapClass, bitmapCreateMethod, bitmapWidth, bitmapHeight, argb8888Obj);
+        AndroidBitmap_lockPixels(env, bitmap, (void **)&bitmapBuffer);
+    }
 
     uint8_t *yBuffer, *uBuffer, *vBuffer;
     int yBufferLen, uBufferLen, vBufferLen;
@@ -435,13 +461,14 @@ jobject convert_YUV_420_888_f32_raw(JNIEnv *env, ImageProxy &image, int rotation
  * Y1 Y3 Y5 Y7
  * Y2 Y4 Y6 Y8
  * */
-static inline int16x8x2_t neon_load_y(uint8_t *buffer) {
-    uint8x8x2_t u8_2 = vld2_u8(buffer);
-    int16x8x2_t s16_2;
-    // Y[even]
-    s16_2.val[0] = vreinterpretq_s16_u16(vmovl_u8(u8_2.val[0]));
-    // Y[odd]
-    s16_2.val[1] = vreinterpretq_s16_u16(vmovl_u8(u8_2.val[1]));
+struct v_s16x8x2 {
+    v_s16x8 val[2];
+};
+
+static inline v_s16x8x2 load_y(uint8_t *buffer) {
+    v_s16x8x2 s16_2;
+    // Y[even], Y[odd]
+    v_load_deinterleave_expand_s16(buffer, s16_2.val[0], s16_2.val[1]);
     return s16_2;
 }
 
@@ -455,15 +482,14 @@ static inline int16x8x2_t neon_load_y(uint8_t *buffer) {
  * where X means unused byte, which is described by stride. In this case,
  * assuming the stride of U and Y is 2.
  * */
-static inline int16x8_t neon_load_uv(uint8_t *buffer) {
-    uint8x8x2_t u8_2 = vld2_u8(buffer);
-    uint8x8_t u8 = u8_2.val[0];
-    int16x8_t s16 = vreinterpretq_s16_u16(vmovl_u8(u8));
+static inline v_s16x8 load_uv(uint8_t *buffer) {
+    v_s16x8 s16, unused;
+    v_load_deinterleave_expand_s16(buffer, s16, unused);
     return s16;
 }
 
 jobject convert_YUV_420_888_neon(JNIEnv *env, ImageProxy &image, int rotation, int facing) {
-    static int16x8_t _128 = vdupq_n_s16(128);
+    static v_s16x8 _128 = v_dup_s16(128);
     glm::mat3x3 posMat;
     glm::vec3 posInCamera, posInBitmap;
     int bitmapHeight, bitmapWidth;
@@ -485,10 +511,13 @@ jobject convert_YUV_420_888_neon(JNIEnv *env, ImageProxy &image, int rotation, i
         initJNI(env);
     }
 
-    jobject bitmap = env->CallStaticObjectMethod(bitmapClass, bitmapCreateMethod, bitmapWidth, bitmapHeight, argb8888Obj);
-
+    jobject bitmap;
     int32_t *bitmapBuffer = nullptr;
-    AndroidBitmap_lockPixels(env, bitmap, (void **)&bitmapBuffer);
+    {
+        TRACE_SCOPE("Bitmap acquire");
+        bitmap = env->CallStaticObjectMethod(bitmapClass, bitmapCreateMethod, bitmapWidth, bitmapHeight, argb8888Obj);
+        AndroidBitmap_lockPixels(env, bitmap, (void **)&bitmapBuffer);
+    }
 
     uint8_t *yBuffer, *uBuffer, *vBuffer;
     int yBufferLen, uBufferLen, vBufferLen;
@@ -513,47 +542,47 @@ jobject convert_YUV_420_888_neon(JNIEnv *env, ImageProxy &image, int rotation, i
     while (row < image.getHeight()) {
         int col = 0;
         while (col < image.getWidth()) {
-            int16x8_t u = neon_load_uv(uBuffer + row / 2 * uRowStride + col);
+            v_s16x8 u = load_uv(uBuffer + row / 2 * uRowStride + col);
             // u - 128
-            u = vsubq_s16(u, _128);
-            int16x8_t v = neon_load_uv(vBuffer + row / 2 * vRowStride + col);
+            u = v_sub(u, _128);
+            v_s16x8 v = load_uv(vBuffer + row / 2 * vRowStride + col);
             // v - 128
-            v = vsubq_s16(v, _128);
+            v = v_sub(v, _128);
 
             // Won't overflow
             // 44 * (u - 128)
-            int16x8_t u1 = vmulq_n_s16(u, 44);
+            v_s16x8 u1 = v_mul_n(u, 44);
             // 227 * (u - 128)
-            int16x8_t u2 = vmulq_n_s16(u, 227);
+            v_s16x8 u2 = v_mul_n(u, 227);
             // 179 * (v - 128)
-            int16x8_t v1 = vmulq_n_s16(v, 179);
+            v_s16x8 v1 = v_mul_n(v, 179);
             // 91 * (v - 128)
-            int16x8_t v2 = vmulq_n_s16(v, 91);
+            v_s16x8 v2 = v_mul_n(v, 91);
             // 44 * (u - 128) + 91 * (v - 128)
-            int16x8_t c1 = vaddq_s16(u1, v2);
+            v_s16x8 c1 = v_add(u1, v2);
 
             for (int lineOddEven = 0; lineOddEven < 2; lineOddEven++) {
-                int16x8x2_t y_2 = neon_load_y(yBuffer + (row + lineOddEven) * yRowStride + col);
+                v_s16x8x2 y_2 = load_y(yBuffer + (row + lineOddEven) * yRowStride + col);
                 for (int colOddEven = 0; colOddEven < 2; colOddEven++) {
-                    int16x8_t y = y_2.val[colOddEven];
+                    v_s16x8 y = y_2.val[colOddEven];
                     // y * 128
-                    y = vmulq_n_s16(y, 128);
+                    y = v_mul_n(y, 128);
 
-                    int16x8_t r1 = vqaddq_s16(y, v1);
-                    int16x8_t g1 = vqsubq_s16(y, c1);
-                    int16x8_t b1 = vqaddq_s16(y, u2);
+                    v_s16x8 r1 = v_adds(y, v1);
+                    v_s16x8 g1 = v_subs(y, c1);
+                    v_s16x8 b1 = v_adds(y, u2);
 
-                    r1 = vshrq_n_s16(r1, 7);
-                    g1 = vshrq_n_s16(g1, 7);
-                    b1 = vshrq_n_s16(b1, 7);
+                    r1 = v_shr<7>(r1);
+                    g1 = v_shr<7>(g1);
+                    b1 = v_shr<7>(b1);
 
-                    uint8x8_t r2 = vqmovun_s16(r1);
-                    uint8x8_t g2 = vqmovun_s16(g1);
-                    uint8x8_t b2 = vqmovun_s16(b1);
+                    v_u8x8 r2 = v_narrow_sat_u8(r1);
+                    v_u8x8 g2 = v_narrow_sat_u8(g1);
+                    v_u8x8 b2 = v_narrow_sat_u8(b1);
 
-                    vst1_u8(rBuffer, r2);
-                    vst1_u8(gBuffer, g2);
-                    vst1_u8(bBuffer, b2);
+                    v_store(rBuffer, r2);
+                    v_store(gBuffer, g2);
+                    v_store(bBuffer, b2);
 
                     for (int i = 0; i < 8; i++) {
                         uint8_t r = rBuffer[i];
@@ -592,7 +621,7 @@ jobject convert_YUV_420_888_neon(JNIEnv *env, ImageProxy &image, int rotation, i
 
 
 jobject convert_YUV_420_888_neon_raw(JNIEnv *env, ImageProxy &image, int rotation, int facing) {
-    static int16x8_t _128 = vdupq_n_s16(128);
+    static v_s16x8 _128 = v_dup_s16(128);
     int bitmapWidth = image.getWidth();
     int bitmapHeight = image.getHeight();
 
@@ -601,10 +630,13 @@ jobject convert_YUV_420_888_neon_raw(JNIEnv *env, ImageProxy &image, int rotatio
         initJNI(env);
     }
 
-    jobject bitmap = env->CallStaticObjectMethod(bitmapClass, bitmapCreateMethod, bitmapWidth, bitmapHeight, argb8888Obj);
-
+    jobject bitmap;
     int32_t *bitmapBuffer = nullptr;
-    AndroidBitmap_lockPixels(env, bitmap, (void **)&bitmapBuffer);
+    {
+        TRACE_SCOPE("Bitmap acquire");
+        bitmap = env->CallStaticObjectMethod(bitmapClass, bitmapCreateMethod, bitmapWidth, bitmapHeight, argb8888Obj);
+        AndroidBitmap_lockPixels(env, bitmap, (void **)&bitmapBuffer);
+    }
 
     uint8_t *yBuffer, *uBuffer, *vBuffer;
     int yBufferLen, uBufferLen, vBufferLen;
@@ -629,48 +661,48 @@ jobject convert_YUV_420_888_neon_raw(JNIEnv *env, ImageProxy &image, int rotatio
     while (row < image.getHeight()) {
         int col = 0;
         while (col < image.getWidth()) {
-            int16x8_t u = neon_load_uv(uBuffer + row / 2 * uRowStride + col);
+            v_s16x8 u = load_uv(uBuffer + row / 2 * uRowStride + col);
             // u - 128
-            u = vsubq_s16(u, _128);
-            int16x8_t v = neon_load_uv(vBuffer + row / 2 * vRowStride + col);
+            u = v_sub(u, _128);
+            v_s16x8 v = load_uv(vBuffer + row / 2 * vRowStride + col);
             // v - 128
-            v = vsubq_s16(v, _128);
+            v = v_sub(v, _128);
 
             // will not overflow
             // 44 * (u - 128)
-            int16x8_t u1 = vmulq_n_s16(u, 44);
+            v_s16x8 u1 = v_mul_n(u, 44);
             // 227 * (u - 128)
-            int16x8_t u2 = vmulq_n_s16(u, 227);
+            v_s16x8 u2 = v_mul_n(u, 227);
             // 179 * (v - 128)
-            int16x8_t v1 = vmulq_n_s16(v, 179);
+            v_s16x8 v1 = v_mul_n(v, 179);
             // 91 * (v - 128)
-            int16x8_t v2 = vmulq_n_s16(v, 91);
+            v_s16x8 v2 = v_mul_n(v, 91);
             // 44 * (u - 128) + 91 * (v - 128)
-            int16x8_t c1 = vaddq_s16(u1, v2);
+            v_s16x8 c1 = v_add(u1, v2);
 
             // 1 line UV is used by 2 lines Y
             for (int lineOddEven = 0; lineOddEven < 2; lineOddEven++) {
-                int16x8x2_t y_2 = neon_load_y(yBuffer + (row + lineOddEven) * yRowStride + col);
+                v_s16x8x2 y_2 = load_y(yBuffer + (row + lineOddEven) * yRowStride + col);
                 for (int colOddEven = 0; colOddEven < 2; colOddEven++) {
-                    int16x8_t y = y_2.val[colOddEven];
+                    v_s16x8 y = y_2.val[colOddEven];
                     // y * 128
-                    y = vmulq_n_s16(y, 128);
+                    y = v_mul_n(y, 128);
 
-                    int16x8_t r1 = vqaddq_s16(y, v1);
-                    int16x8_t g1 = vqsubq_s16(y, c1);
-                    int16x8_t b1 = vqaddq_s16(y, u2);
+                    v_s16x8 r1 = v_adds(y, v1);
+                    v_s16x8 g1 = v_subs(y, c1);
+                    v_s16x8 b1 = v_adds(y, u2);
 
-                    r1 = vshrq_n_s16(r1, 7);
-                    g1 = vshrq_n_s16(g1, 7);
-                    b1 = vshrq_n_s16(b1, 7);
+                    r1 = v_shr<7>(r1);
+                    g1 = v_shr<7>(g1);
+                    b1 = v_shr<7>(b1);
 
-                    uint8x8_t r2 = vqmovun_s16(r1);
-                    uint8x8_t g2 = vqmovun_s16(g1);
-                    uint8x8_t b2 = vqmovun_s16(b1);
+                    v_u8x8 r2 = v_narrow_sat_u8(r1);
+                    v_u8x8 g2 = v_narrow_sat_u8(g1);
+                    v_u8x8 b2 = v_narrow_sat_u8(b1);
 
-                    vst1_u8(rBuffer, r2);
-                    vst1_u8(gBuffer, g2);
-                    vst1_u8(bBuffer, b2);
+                    v_store(rBuffer, r2);
+                    v_store(gBuffer, g2);
+                    v_store(bBuffer, b2);
 
                     for (int i = 0; i < 8; i++) {
                         uint8_t r = rBuffer[i];
@@ -702,6 +734,317 @@ jobject convert_YUV_420_888_neon_raw(JNIEnv *env, ImageProxy &image, int rotatio
     return bitmap;
 }
 
+/**
+ * Planes of a YUV_420_888 image, the image must outlive the frame.
+ * */
+static YuvFrame yuv_frame(ImageProxy &image) {
+    uint8_t *yBuffer, *uBuffer, *vBuffer;
+    int yBufferLen, uBufferLen, vBufferLen;
+    int yRowStride, uRowStride, vRowStride;
+    int yPixelStride, uPixelStride, vPixelStride;
+
+    image.getPlane(0, &yBuffer, yBufferLen, yRowStride, yPixelStride);
+    image.getPlane(1, &uBuffer, uBufferLen, uRowStride, uPixelStride);
+    image.getPlane(2, &vBuffer, vBufferLen, vRowStride, vPixelStride);
+
+    assert(yPixelStride == 1);
+    assert(uPixelStride == vPixelStride && uRowStride == vRowStride);
+
+    YuvFrame frame;
+    frame.y = yBuffer;
+    frame.u = uBuffer;
+    frame.v = vBuffer;
+    frame.yRowStride = yRowStride;
+    frame.uvRowStride = uRowStride;
+    frame.uvPixelStride = uPixelStride;
+    frame.width = image.getWidth();
+    frame.height = image.getHeight();
+    return frame;
+}
+
+/**
+ * 通用版本，支持I420和NV12/NV21，宽高没有对齐要求。
+ * 每行的转换通过kernel_table()选择当前CPU上最快的实现，整帧按行切分后多线程处理。
+ * 输出与convert_YUV_420_888_i32一致。
+ * */
+jobject convert_YUV_420_888(JNIEnv *env, ImageProxy &image, int rotation, int facing) {
+    TRACE_SCOPE("convert YUV_420_888");
+    int bitmapWidth, bitmapHeight;
+    yuv_output_size(image.getWidth(), image.getHeight(), rotation, bitmapWidth, bitmapHeight);
+
+    if (bitmapClass == nullptr) {
+        LOGE(TAG, "JNI object not init, init");
+        initJNI(env);
+    }
+
+    jobject bitmap;
+    uint32_t *bitmapBuffer = nullptr;
+    {
+        TRACE_SCOPE("Bitmap acquire");
+        bitmap = env->CallStaticObjectMethod(bitmapClass, bitmapCreateMethod, bitmapWidth, bitmapHeight, argb8888Obj);
+        AndroidBitmap_lockPixels(env, bitmap, (void **)&bitmapBuffer);
+    }
+
+    YuvFrame frame = yuv_frame(image);
+
+    shared_ptr<Lut3D> grade;
+    {
+        lock_guard<mutex> lock(gradeMutex);
+        grade = gradeLut;
+    }
+
+    shared_ptr<const LensRemap> remap;
+    {
+        lock_guard<mutex> lock(lensMutex);
+        if (lensDistortion) {
+            remap = lens_remap(*lensDistortion, frame.width, frame.height);
+        }
+    }
+
+    chrono::time_point startTime = chrono::system_clock::now();
+    if (remap) {
+        lens_undistort_to_rgba(*remap, frame, bitmapBuffer, rotation, facing, YUV_PRECISION_FAST, grade.get());
+    } else {
+        yuv420_to_rgba(frame, bitmapBuffer, rotation, facing, YUV_PRECISION_FAST, grade.get());
+    }
+    chrono::time_point endTime = chrono::system_clock::now();
+    chrono::duration oneImageTime = endTime - startTime;
+    long ms = chrono::duration_cast<chrono::milliseconds>(oneImageTime).count();
+    debugIndex++;
+    timeMS += ms;
+    if (debugIndex >= DEBUG_LOOP) {
+        long avg = timeMS / debugIndex;
+        LOGD(TAG, "convert dispatch, %d images avg cost %d ms, image size = [%d, %d]", debugIndex, (int)avg, bitmapWidth, bitmapHeight);
+        debugIndex = 0;
+        timeMS = 0;
+    }
+    AndroidBitmap_unlockPixels(env, bitmap);
+    return bitmap;
+}
+
+/**
+ * Convert an I420 frame built in native memory to a Bitmap, graded like convert_YUV_420_888.
+ * */
+static jobject i420_to_bitmap(JNIEnv *env, const YuvFrame &frame, int rotation, int facing) {
+    TRACE_SCOPE("convert I420");
+    int bitmapWidth, bitmapHeight;
+    yuv_output_size(frame.width, frame.height, rotation, bitmapWidth, bitmapHeight);
+
+    if (bitmapClass == nullptr) {
+        LOGE(TAG, "JNI object not init, init");
+        initJNI(env);
+    }
+
+    jobject bitmap;
+    uint32_t *bitmapBuffer = nullptr;
+    {
+        TRACE_SCOPE("Bitmap acquire");
+        bitmap = env->CallStaticObjectMethod(bitmapClass, bitmapCreateMethod, bitmapWidth, bitmapHeight, argb8888Obj);
+        AndroidBitmap_lockPixels(env, bitmap, (void **)&bitmapBuffer);
+    }
+
+    shared_ptr<Lut3D> grade;
+    {
+        lock_guard<mutex> lock(gradeMutex);
+        grade = gradeLut;
+    }
+    yuv420_to_rgba(frame, bitmapBuffer, rotation, facing, YUV_PRECISION_FAST, grade.get());
+    AndroidBitmap_unlockPixels(env, bitmap);
+    return bitmap;
+}
+
+bool burst_add_YUV_420_888(ImageProxy &image, BurstMerger &merger) {
+    TRACE_SCOPE("burst align");
+    YuvFrame frame = yuv_frame(image);
+
+    chrono::time_point startTime = chrono::system_clock::now();
+    bool ret = merger.addYuv(frame);
+    chrono::time_point endTime = chrono::system_clock::now();
+    long ms = chrono::duration_cast<chrono::milliseconds>(endTime - startTime).count();
+    LOGD(TAG, "burst add frame %d cost %d ms, image size = [%d, %d]", merger.getFrameCount(), (int)ms,
+         frame.width, frame.height);
+    return ret;
+}
+
+jobject burst_merge_YUV_420_888(JNIEnv *env, BurstMerger &merger, int rotation, int facing) {
+    TRACE_SCOPE("burst merge");
+    int width = merger.getWidth(), height = merger.getHeight();
+    int chromaWidth = (width + 1) / 2, chromaHeight = (height + 1) / 2;
+    FrameArena arena;
+    uint8_t *merged = arena.alloc<uint8_t>((size_t)width * height + (size_t)chromaWidth * chromaHeight * 2);
+    YuvFrame frame;
+    frame.y = merged;
+    frame.u = frame.y + (size_t)width * height;
+    frame.v = frame.u + (size_t)chromaWidth * chromaHeight;
+    frame.yRowStride = width;
+    frame.uvRowStride = chromaWidth;
+    frame.uvPixelStride = 1;
+    frame.width = width;
+    frame.height = height;
+    if (!merger.finishYuv(merged, width, (uint8_t *)frame.u, (uint8_t *)frame.v, chromaWidth, 1)) {
+        return nullptr;
+    }
+    return i420_to_bitmap(env, frame, rotation, facing);
+}
+
+jobject fuse_YUV_420_888(JNIEnv *env, ImageProxy *const *images, int count, int rotation, int facing) {
+    TRACE_SCOPE("exposure fusion");
+    vector<YuvFrame> frames;
+    for (int i = 0; i < count; i++) {
+        frames.push_back(yuv_frame(*images[i]));
+    }
+    int width = frames[0].width, height = frames[0].height;
+    int chromaWidth = (width + 1) / 2, chromaHeight = (height + 1) / 2;
+    FrameArena arena;
+    uint8_t *fused = arena.alloc<uint8_t>((size_t)width * height + (size_t)chromaWidth * chromaHeight * 2);
+    YuvFrame frame;
+    frame.y = fused;
+    frame.u = frame.y + (size_t)width * height;
+    frame.v = frame.u + (size_t)chromaWidth * chromaHeight;
+    frame.yRowStride = width;
+    frame.uvRowStride = chromaWidth;
+    frame.uvPixelStride = 1;
+    frame.width = width;
+    frame.height = height;
+
+    chrono::time_point startTime = chrono::system_clock::now();
+    bool ret = exposure_fusion_yuv(frames.data(), count, ExposureFusionParams(), fused, width,
+                                   (uint8_t *)frame.u, (uint8_t *)frame.v, chromaWidth, 1);
+    chrono::time_point endTime = chrono::system_clock::now();
+    long ms = chrono::duration_cast<chrono::milliseconds>(endTime - startTime).count();
+    LOGD(TAG, "exposure fusion of %d frames cost %d ms, image size = [%d, %d]", count, (int)ms, width, height);
+    if (!ret) {
+        return nullptr;
+    }
+    return i420_to_bitmap(env, frame, rotation, facing);
+}
+
+bool converter_set_cube_lut(const char *path) {
+    shared_ptr<Lut3D> lut;
+    if (path != nullptr && path[0] != '\0') {
+        lut = Lut3D::loadCube(path);
+        if (!lut) {
+            return false;
+        }
+    }
+    lock_guard<mutex> lock(gradeMutex);
+    gradeLut = lut;
+    return true;
+}
+
+void converter_set_lens_distortion(const LensDistortion *lens) {
+    lock_guard<mutex> lock(lensMutex);
+    if (lens == nullptr) {
+        lensDistortion.reset();
+    } else {
+        lensDistortion.reset(new LensDistortion(*lens));
+    }
+}
+
+/**
+ * HDR 10位输出，转成ARGB_8888，用抖动代替直接截断。
+ * DataSpace是PQ或HLG时同时做色调映射，否则按SDR的BT.2020信号直接显示。
+ * */
+jobject convert_YCBCR_P010(JNIEnv *env, ImageProxy &image, int rotation, int facing) {
+    TRACE_SCOPE("convert YCBCR_P010");
+    int bitmapWidth, bitmapHeight;
+    yuv_output_size(image.getWidth(), image.getHeight(), rotation, bitmapWidth, bitmapHeight);
 
+    if (bitmapClass == nullptr) {
+        LOGE(TAG, "JNI object not init, init");
+        initJNI(env);
+    }
 
+    jobject bitmap;
+    uint32_t *bitmapBuffer = nullptr;
+    {
+        TRACE_SCOPE("Bitmap acquire");
+        bitmap = env->CallStaticObjectMethod(bitmapClass, bitmapCreateMethod, bitmapWidth, bitmapHeight, argb8888Obj);
+        AndroidBitmap_lockPixels(env, bitmap, (void **)&bitmapBuffer);
+    }
 
+    uint8_t *yBuffer, *uBuffer, *vBuffer;
+    int yBufferLen, uBufferLen, vBufferLen;
+    int yRowStride, uRowStride, vRowStride;
+    int yPixelStride, uPixelStride, vPixelStride;
+
+    image.getPlane(0, &yBuffer, yBufferLen, yRowStride, yPixelStride);
+    image.getPlane(1, &uBuffer, uBufferLen, uRowStride, uPixelStride);
+    image.getPlane(2, &vBuffer, vBufferLen, vRowStride, vPixelStride);
+
+    assert(yPixelStride == 2);
+    assert(uPixelStride == vPixelStride && uRowStride == vRowStride);
+
+    Yuv10Frame frame;
+    frame.y = (const uint16_t *)yBuffer;
+    frame.u = (const uint16_t *)uBuffer;
+    frame.v = (const uint16_t *)vBuffer;
+    frame.yRowStride = yRowStride;
+    frame.uvRowStride = uRowStride;
+    frame.uvPixelStride = uPixelStride;
+    frame.width = image.getWidth();
+    frame.height = image.getHeight();
+    frame.layout = YUV10_LAYOUT_MSB;
+
+    ToneMapParams toneMap;
+    int transfer = image.getDataSpace() & DATASPACE_TRANSFER_MASK;
+    bool hdr = transfer == DATASPACE_TRANSFER_ST2084 || transfer == DATASPACE_TRANSFER_HLG;
+    toneMap.transfer = transfer == DATASPACE_TRANSFER_HLG ? HDR_TRANSFER_HLG : HDR_TRANSFER_PQ;
+
+    chrono::time_point startTime = chrono::system_clock::now();
+    yuv10_to_rgba(frame, bitmapBuffer, OUTPUT_RGBA_8888, YUV_MATRIX_BT2020_LIMITED, rotation, facing,
+                  hdr ? &toneMap : nullptr);
+    chrono::time_point endTime = chrono::system_clock::now();
+    chrono::duration oneImageTime = endTime - startTime;
+    long ms = chrono::duration_cast<chrono::milliseconds>(oneImageTime).count();
+    LOGD(TAG, "convert P010 cost %d ms, image size = [%d, %d]", (int)ms, bitmapWidth, bitmapHeight);
+    AndroidBitmap_unlockPixels(env, bitmap);
+    return bitmap;
+}
+
+jobject convert_RAW_SENSOR(JNIEnv *env, ImageProxy &image, int rotation, int facing, const RawParams &params) {
+    TRACE_SCOPE("convert RAW_SENSOR");
+    int bitmapWidth, bitmapHeight;
+    yuv_output_size(image.getWidth(), image.getHeight(), rotation, bitmapWidth, bitmapHeight);
+
+    if (bitmapClass == nullptr) {
+        LOGE(TAG, "JNI object not init, init");
+        initJNI(env);
+    }
+
+    jobject bitmap;
+    uint32_t *bitmapBuffer = nullptr;
+    {
+        TRACE_SCOPE("Bitmap acquire");
+        bitmap = env->CallStaticObjectMethod(bitmapClass, bitmapCreateMethod, bitmapWidth, bitmapHeight, argb8888Obj);
+        AndroidBitmap_lockPixels(env, bitmap, (void **)&bitmapBuffer);
+    }
+
+    uint8_t *buffer;
+    int bufferLen, rowStride, pixelStride;
+    image.getPlane(0, &buffer, bufferLen, rowStride, pixelStride);
+
+    RawFrame frame;
+    frame.data = buffer;
+    frame.rowStride = rowStride;
+    if (image.getFormat() == IMAGE_FORMAT_RAW10) {
+        frame.packing = RAW_PACKING_10;
+    } else if (image.getFormat() == IMAGE_FORMAT_RAW12) {
+        frame.packing = RAW_PACKING_12;
+    } else {
+        assert(pixelStride == 2);
+    }
+    frame.width = image.getWidth();
+    frame.height = image.getHeight();
+
+    chrono::time_point startTime = chrono::system_clock::now();
+    if (!raw_to_rgba(frame, params, bitmapBuffer, rotation, facing)) {
+        LOGE(TAG, "convert raw format 0x%x failed", image.getFormat());
+    }
+    chrono::time_point endTime = chrono::system_clock::now();
+    chrono::duration oneImageTime = endTime - startTime;
+    long ms = chrono::duration_cast<chrono::milliseconds>(oneImageTime).count();
+    LOGD(TAG, "convert RAW_SENSOR cost %d ms, image size = [%d, %d]", (int)ms, bitmapWidth, bitmapHeight);
+    AndroidBitmap_unlockPixels(env, bitmap);
+    return bitmap;
+}
@@ -8,7 +8,9 @@
 #include "ImageProxy.h"
 #include <jni.h>
 #include "constants.h"
-#include <arm_neon.h>
+#include "raw_pipeline.h"
+#include "burst_merge.h"
+#include "lens_distortion.h"
 
 //extern "C" void neonYUV420ToRGBAFullSwing(const uint8_t *yInput, const uint8_t *uInput, const uint8_t *vInput, uint8_t *rgbaOutput, int width, int height, int rgbaStride, int lumaStride, int chromaStride);
 
@@ -18,6 +20,33 @@ jobject convert_YUV_420_888_i32(JNIEnv *env, ImageProxy &image, int rotation, in
 jobject convert_YUV_420_888_i32_raw(JNIEnv *env, ImageProxy &image, int rotation, int facing);
 jobject convert_YUV_420_888_neon(JNIEnv *env, ImageProxy &image, int rotation, int facing);
 jobject convert_YUV_420_888_neon_raw(JNIEnv *env, ImageProxy &image, int rotation, int facing);
+jobject convert_YUV_420_888(JNIEnv *env, ImageProxy &image, int rotation, int facing);
+jobject convert_YCBCR_P010(JNIEnv *env, ImageProxy &image, int rotation, int facing);
+jobject convert_RAW_SENSOR(JNIEnv *env, ImageProxy &image, int rotation, int facing, const RawParams &params);
+
+/**
+ * Add a YUV_420_888 image to the burst, and convert the merged frame to a Bitmap like convert_YUV_420_888.
+ * */
+bool burst_add_YUV_420_888(ImageProxy &image, BurstMerger &merger);
+jobject burst_merge_YUV_420_888(JNIEnv *env, BurstMerger &merger, int rotation, int facing);
+
+/**
+ * Fuse 2 .. EXPOSURE_FUSION_MAX_FRAMES bracketed YUV_420_888 images of the same size into one Bitmap,
+ * nullptr if they can not be fused.
+ * */
+jobject fuse_YUV_420_888(JNIEnv *env, ImageProxy *const *images, int count, int rotation, int facing);
+
+/**
+ * Colour grade the output of convert_YUV_420_888 with a .cube file, nullptr or "" to stop grading.
+ * Return false if the file can not be loaded, the previous LUT is kept then.
+ * */
+bool converter_set_cube_lut(const char *path);
+
+/**
+ * Undistort the output of convert_YUV_420_888 for this lens, nullptr to stop. The remap table is
+ * built on the next frame and reused until the lens or the frame size changes.
+ * */
+void converter_set_lens_distortion(const LensDistortion *lens);
 //jobject convert_YUV_420_888_assembly(JNIEnv *env, ImageProxy &image, int rotation, int facing);
 
 
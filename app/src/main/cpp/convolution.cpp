@@ -0,0 +1,462 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#include "convolution.h"
+#include "parallel.h"
+#include "dispatch.h"
+#include "cpu_features.h"
+#include "frame_arena.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+#include "simd.h"
+
+using namespace std;
+
+// Stripes smaller than this spend more time on the halo rows than on real work.
+#define MIN_STRIPE_ROWS 16
+
+static const float SHARPEN_KERNEL[9] = {
+        -1.0f, -1.0f, -1.0f,
+        -1.0f,  9.0f, -1.0f,
+        -1.0f, -1.0f, -1.0f
+};
+
+static const float BLUR_KERNEL[9] = {
+        1.0f / 16.0f, 2.0f / 16.0f, 1.0f / 16.0f,
+        2.0f / 16.0f, 4.0f / 16.0f, 2.0f / 16.0f,
+        1.0f / 16.0f, 2.0f / 16.0f, 1.0f / 16.0f
+};
+
+static const float EDGE_KERNEL[9] = {
+        1.0f,  1.0f, 1.0f,
+        1.0f, -8.0f, 1.0f,
+        1.0f,  1.0f, 1.0f
+};
+
+static inline uint8_t clamp_u8(int32_t n) {
+    return (uint8_t)(n < 0 ? 0 : (n > 255 ? 255 : n));
+}
+
+/**
+ * Same as NEON vrshl with a negative shift: add half and shift right, without overflowing.
+ * */
+static inline int32_t round_shift(int32_t acc, int shift) {
+    if (shift == 0) {
+        return acc;
+    }
+    return (int32_t)(((int64_t)acc + ((int64_t)1 << (shift - 1))) >> shift);
+}
+
+/**
+ * Map a row or column index outside [0, n) back into the image. Return -1 if the pixel
+ * is a constant (zero) border pixel.
+ * */
+static inline int border_index(int i, int n, int border) {
+    if (i >= 0 && i < n) {
+        return i;
+    }
+    if (border == BORDER_CONSTANT) {
+        return -1;
+    }
+    if (border == BORDER_REFLECT_101 && n > 1) {
+        while (i < 0 || i >= n) {
+            i = i < 0 ? -i : 2 * n - 2 - i;
+        }
+        return i;
+    }
+    return i < 0 ? 0 : n - 1;
+}
+
+/**
+ * Quantize weights to q = round(w * 2^shift). The largest shift is picked so that
+ * every |q| fits int16 and sum(|q|) <= sumLimit.
+ * */
+static bool quantize(const float *weights, int count, int64_t sumLimit, int maxShift, int16_t *out, int &shift) {
+    for (shift = maxShift; shift >= 0; shift--) {
+        int64_t sum = 0;
+        bool fit = true;
+        for (int i = 0; i < count; i++) {
+            float q = roundf(weights[i] * (float)(1 << shift));
+            if (fabsf(q) > 32767.0f) {
+                fit = false;
+                break;
+            }
+            out[i] = (int16_t)q;
+            sum += abs((int)out[i]);
+        }
+        if (fit && sum <= sumLimit) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Try to write the kernel as col * row. The pivot is the element with the largest magnitude.
+ * */
+static bool decompose(const float *weights, int width, int height, float *row, float *col) {
+    int pivot = 0;
+    for (int i = 1; i < width * height; i++) {
+        if (fabsf(weights[i]) > fabsf(weights[pivot])) {
+            pivot = i;
+        }
+    }
+    float pivotValue = weights[pivot];
+    if (pivotValue == 0.0f) {
+        return false;
+    }
+    int pivotRow = pivot / width;
+    int pivotCol = pivot % width;
+    for (int i = 0; i < width; i++) {
+        row[i] = weights[pivotRow * width + i] / pivotValue;
+    }
+    for (int j = 0; j < height; j++) {
+        col[j] = weights[j * width + pivotCol];
+    }
+    float tolerance = fabsf(pivotValue) * 1e-6f;
+    for (int j = 0; j < height; j++) {
+        for (int i = 0; i < width; i++) {
+            if (fabsf(col[j] * row[i] - weights[j * width + i]) > tolerance) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Worst case error of a quantized kernel on 8-bit input, in output LSB.
+ * */
+static float quantization_error(const float *weights, const int32_t *quantized, int count, int shift) {
+    float error = 0;
+    for (int i = 0; i < count; i++) {
+        error += fabsf((float)quantized[i] / (float)(1 << shift) - weights[i]);
+    }
+    return error * 255.0f;
+}
+
+bool conv_kernel_init(ConvKernel &kernel, const float *weights, int width, int height) {
+    if (width <= 0 || height <= 0 || width % 2 == 0 || height % 2 == 0
+        || width > CONV_MAX_KERNEL_SIZE || height > CONV_MAX_KERNEL_SIZE) {
+        return false;
+    }
+    int count = width * height;
+    kernel.width = width;
+    kernel.height = height;
+    kernel.separable = false;
+
+    int16_t q[CONV_MAX_KERNEL_SIZE * CONV_MAX_KERNEL_SIZE];
+    bool directOk = quantize(weights, count, (1 << 30) / 255, 14, q, kernel.shift);
+    float directError = 0;
+    if (directOk) {
+        for (int i = 0; i < count; i++) {
+            kernel.weights[i] = q[i];
+        }
+        directError = quantization_error(weights, kernel.weights, count, kernel.shift);
+    }
+
+    float row[CONV_MAX_KERNEL_SIZE], col[CONV_MAX_KERNEL_SIZE];
+    if (!decompose(weights, width, height, row, col)) {
+        return directOk;
+    }
+    // The horizontal pass keeps 8-bit pixels * rowWeights in int16, the vertical pass
+    // accumulates int16 * colWeights in int32.
+    ConvKernel sep = kernel;
+    if (!quantize(row, width, 32767 / 255, 14, sep.rowWeights, sep.rowShift)
+        || !quantize(col, height, 32768, 14, sep.colWeights, sep.colShift)) {
+        return directOk;
+    }
+    sep.shift = sep.rowShift + sep.colShift;
+    for (int j = 0; j < height; j++) {
+        for (int i = 0; i < width; i++) {
+            sep.weights[j * width + i] = (int32_t)sep.colWeights[j] * sep.rowWeights[i];
+        }
+    }
+    // Kernels with a large gain leave few bits for the int16 horizontal sums. Only take
+    // the separable path when it is about as precise as the direct one.
+    float sepError = quantization_error(weights, sep.weights, count, sep.shift);
+    if (!directOk || sepError <= std::max(0.5f, directError)) {
+        sep.separable = true;
+        kernel = sep;
+    }
+    return true;
+}
+
+void conv_kernel_sharpen(ConvKernel &kernel) {
+    conv_kernel_init(kernel, SHARPEN_KERNEL, 3, 3);
+}
+
+void conv_kernel_blur(ConvKernel &kernel) {
+    conv_kernel_init(kernel, BLUR_KERNEL, 3, 3);
+}
+
+void conv_kernel_edge(ConvKernel &kernel) {
+    conv_kernel_init(kernel, EDGE_KERNEL, 3, 3);
+}
+
+/**
+ * Copy one row into a buffer with radius pixels of border on both sides.
+ * */
+static void pad_row(const uint8_t *src, uint8_t *padded, int width, int channels, int radius, int border) {
+    memcpy(padded + radius * channels, src, width * channels);
+    for (int k = 1; k <= radius; k++) {
+        int left = border_index(-k, width, border);
+        int right = border_index(width - 1 + k, width, border);
+        for (int c = 0; c < channels; c++) {
+            padded[(radius - k) * channels + c] = left < 0 ? 0 : src[left * channels + c];
+            padded[(radius + width - 1 + k) * channels + c] = right < 0 ? 0 : src[right * channels + c];
+        }
+    }
+}
+
+/**
+ * out[x] = sum(weights[i] * padded[x + i * channels]). The sum is known to fit int16.
+ * Scalar code from x on, also used for the tails of the SIMD versions.
+ * */
+static inline void horizontal_tail(int x, const uint8_t *padded, int16_t *out, int count, int channels,
+                                   const int16_t *weights, int taps) {
+    for (; x < count; x++) {
+        int32_t acc = 0;
+        for (int i = 0; i < taps; i++) {
+            acc += weights[i] * padded[x + i * channels];
+        }
+        out[x] = (int16_t)acc;
+    }
+}
+
+/**
+ * dst[x] = clamp(round_shift(sum(weights[j] * rows[j][x]))).
+ * */
+static inline void vertical_tail(int x, const int16_t *const *rows, uint8_t *dst, int count,
+                                 const int16_t *weights, int taps, int shift) {
+    for (; x < count; x++) {
+        int32_t acc = 0;
+        for (int j = 0; j < taps; j++) {
+            acc += weights[j] * rows[j][x];
+        }
+        dst[x] = clamp_u8(round_shift(acc, shift));
+    }
+}
+
+/**
+ * Direct 2D convolution of one output row from height padded source rows.
+ * Weights of a non-separable kernel always fit int16.
+ * */
+static inline void direct_tail(int x, const uint8_t *const *lines, uint8_t *dst, int count, int channels,
+                               const int32_t *weights, int width, int height, int shift) {
+    for (; x < count; x++) {
+        int32_t acc = 0;
+        for (int j = 0; j < height; j++) {
+            for (int i = 0; i < width; i++) {
+                acc += weights[j * width + i] * lines[j][x + i * channels];
+            }
+        }
+        dst[x] = clamp_u8(round_shift(acc, shift));
+    }
+}
+
+static void horizontal_pass_c(const uint8_t *padded, int16_t *out, int count, int channels,
+                              const int16_t *weights, int taps) {
+    horizontal_tail(0, padded, out, count, channels, weights, taps);
+}
+
+static void vertical_pass_c(const int16_t *const *rows, uint8_t *dst, int count,
+                            const int16_t *weights, int taps, int shift) {
+    vertical_tail(0, rows, dst, count, weights, taps, shift);
+}
+
+static void direct_pass_c(const uint8_t *const *lines, uint8_t *dst, int count, int channels,
+                          const int32_t *weights, int width, int height, int shift) {
+    direct_tail(0, lines, dst, count, channels, weights, width, height, shift);
+}
+
+#if SIMD_128
+static void horizontal_pass_simd(const uint8_t *padded, int16_t *out, int count, int channels,
+                                 const int16_t *weights, int taps) {
+    int x = 0;
+    for (; x + 8 <= count; x += 8) {
+        v_s16x8 acc = v_dup_s16(0);
+        for (int i = 0; i < taps; i++) {
+            v_s16x8 p = v_load_expand_s16(padded + x + i * channels);
+            acc = v_mla_n(acc, p, weights[i]);
+        }
+        v_store(out + x, acc);
+    }
+    horizontal_tail(x, padded, out, count, channels, weights, taps);
+}
+
+static void vertical_pass_simd(const int16_t *const *rows, uint8_t *dst, int count,
+                               const int16_t *weights, int taps, int shift) {
+    int x = 0;
+    for (; x + 8 <= count; x += 8) {
+        v_s32x4 lo = v_dup_s32(0);
+        v_s32x4 hi = v_dup_s32(0);
+        for (int j = 0; j < taps; j++) {
+            v_s16x8 r = v_load_s16x8(rows[j] + x);
+            lo = v_mlal_lo_n(lo, r, weights[j]);
+            hi = v_mlal_hi_n(hi, r, weights[j]);
+        }
+        v_s16x8 narrow = v_narrow_sat_s16(v_rshr_var(lo, shift), v_rshr_var(hi, shift));
+        v_store(dst + x, v_narrow_sat_u8(narrow));
+    }
+    vertical_tail(x, rows, dst, count, weights, taps, shift);
+}
+
+static void direct_pass_simd(const uint8_t *const *lines, uint8_t *dst, int count, int channels,
+                             const int32_t *weights, int width, int height, int shift) {
+    int x = 0;
+    for (; x + 8 <= count; x += 8) {
+        v_s32x4 lo = v_dup_s32(0);
+        v_s32x4 hi = v_dup_s32(0);
+        for (int j = 0; j < height; j++) {
+            for (int i = 0; i < width; i++) {
+                int16_t w = (int16_t)weights[j * width + i];
+                if (w == 0) {
+                    continue;
+                }
+                v_s16x8 p = v_load_expand_s16(lines[j] + x + i * channels);
+                lo = v_mlal_lo_n(lo, p, w);
+                hi = v_mlal_hi_n(hi, p, w);
+            }
+        }
+        v_s16x8 narrow = v_narrow_sat_s16(v_rshr_var(lo, shift), v_rshr_var(hi, shift));
+        v_store(dst + x, v_narrow_sat_u8(narrow));
+    }
+    direct_tail(x, lines, dst, count, channels, weights, width, height, shift);
+}
+#endif
+
+void convolution_fill_kernels(KernelTable &table, uint32_t features) {
+    table.convHorizontal = horizontal_pass_c;
+    table.convVertical = vertical_pass_c;
+    table.convDirect = direct_pass_c;
+#if SIMD_128
+    if (features & SIMD_128_FEATURE) {
+        table.convHorizontal = horizontal_pass_simd;
+        table.convVertical = vertical_pass_simd;
+        table.convDirect = direct_pass_simd;
+    }
+#endif
+}
+
+static inline void copy_alpha(const uint8_t *src, uint8_t *dst, int width) {
+    for (int x = 0; x < width; x++) {
+        dst[x * 4 + 3] = src[x * 4 + 3];
+    }
+}
+
+/**
+ * Process output rows [rowStart, rowEnd). Every source row the stripe needs is padded
+ * (and for separable kernels filtered horizontally) exactly once into a ring of height rows.
+ * */
+static void convolve_stripe(const KernelTable &kt, const uint8_t *src, int srcStride, uint8_t *dst, int dstStride,
+                            int width, int height, int channels, const ConvKernel &kernel, int border,
+                            int rowStart, int rowEnd) {
+    int rx = kernel.width / 2;
+    int ry = kernel.height / 2;
+    int count = width * channels;
+    int paddedCount = (width + 2 * rx) * channels;
+    int taps = kernel.height;
+
+    FrameArena scratch;
+    uint8_t *padded = scratch.alloc<uint8_t>(kernel.separable ? paddedCount : paddedCount * taps);
+    int16_t *ring = kernel.separable ? scratch.alloc<int16_t>(count * taps) : nullptr;
+    const int16_t *rows[CONV_MAX_KERNEL_SIZE];
+    const uint8_t *lines[CONV_MAX_KERNEL_SIZE];
+
+    int firstSrc = rowStart - ry;
+    int nextSrc = firstSrc;
+    for (int y = rowStart; y < rowEnd; y++) {
+        for (; nextSrc <= y + ry; nextSrc++) {
+            int slot = (nextSrc - firstSrc) % taps;
+            int srcRow = border_index(nextSrc, height, border);
+            if (kernel.separable) {
+                int16_t *out = ring + slot * count;
+                if (srcRow < 0) {
+                    memset(out, 0, count * sizeof(int16_t));
+                } else {
+                    pad_row(src + srcRow * srcStride, padded, width, channels, rx, border);
+                    kt.convHorizontal(padded, out, count, channels, kernel.rowWeights, kernel.width);
+                }
+            } else {
+                uint8_t *line = padded + slot * paddedCount;
+                if (srcRow < 0) {
+                    memset(line, 0, paddedCount);
+                } else {
+                    pad_row(src + srcRow * srcStride, line, width, channels, rx, border);
+                }
+            }
+        }
+
+        uint8_t *dstRow = dst + y * dstStride;
+        if (kernel.separable) {
+            for (int j = 0; j < taps; j++) {
+                rows[j] = ring + ((y - rowStart + j) % taps) * count;
+            }
+            kt.convVertical(rows, dstRow, count, kernel.colWeights, taps, kernel.shift);
+        } else {
+            for (int j = 0; j < taps; j++) {
+                lines[j] = padded + ((y - rowStart + j) % taps) * paddedCount;
+            }
+            kt.convDirect(lines, dstRow, count, channels, kernel.weights, kernel.width, kernel.height,
+                          kernel.shift);
+        }
+        if (channels == 4) {
+            copy_alpha(src + y * srcStride, dstRow, width);
+        }
+    }
+}
+
+static void convolve(const uint8_t *src, int srcStride, uint8_t *dst, int dstStride,
+                     int width, int height, int channels, const ConvKernel &kernel, int border) {
+    if (width <= 0 || height <= 0 || kernel.width <= 0) {
+        return;
+    }
+    const KernelTable &kt = kernel_table();
+    parallel_for_stripes(height, MIN_STRIPE_ROWS, [&](int rowStart, int rowEnd) {
+        convolve_stripe(kt, src, srcStride, dst, dstStride, width, height, channels, kernel, border,
+                        rowStart, rowEnd);
+    });
+}
+
+void convolve_y(const uint8_t *src, int srcStride, uint8_t *dst, int dstStride,
+                int width, int height, const ConvKernel &kernel, int border) {
+    convolve(src, srcStride, dst, dstStride, width, height, 1, kernel, border);
+}
+
+void convolve_rgba(const uint8_t *src, int srcStride, uint8_t *dst, int dstStride,
+                   int width, int height, const ConvKernel &kernel, int border) {
+    convolve(src, srcStride, dst, dstStride, width, height, 4, kernel, border);
+}
+
+void convolve_reference(const uint8_t *src, int srcStride, uint8_t *dst, int dstStride,
+                        int width, int height, int channels, const ConvKernel &kernel, int border) {
+    int rx = kernel.width / 2;
+    int ry = kernel.height / 2;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            for (int c = 0; c < channels; c++) {
+                if (c == 3) {
+                    dst[y * dstStride + x * 4 + 3] = src[y * srcStride + x * 4 + 3];
+                    continue;
+                }
+                int64_t acc = 0;
+                for (int j = 0; j < kernel.height; j++) {
+                    int sy = border_index(y - ry + j, height, border);
+                    for (int i = 0; i < kernel.width; i++) {
+                        int sx = border_index(x - rx + i, width, border);
+                        if (sy < 0 || sx < 0) {
+                            continue;
+                        }
+                        acc += (int64_t)kernel.weights[j * kernel.width + i] * src[sy * srcStride + sx * channels + c];
+                    }
+                }
+                dst[y * dstStride + x * channels + c] = clamp_u8(round_shift((int32_t)acc, kernel.shift));
+            }
+        }
+    }
+}
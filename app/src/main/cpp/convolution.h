@@ -0,0 +1,79 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#ifndef CAMERAUTIL_CONVOLUTION_H
+#define CAMERAUTIL_CONVOLUTION_H
+
+#include <stdint.h>
+
+/**
+ * CPU版本的小尺寸卷积，与gl/ShaderScripts.kt中fragShaderCode的sharpen/blur/edge卷积核对应，
+ * 用于不走GLRender的场景。
+ *
+ * 浮点卷积核在conv_kernel_init时被量化为定点数，之后所有计算都是整数运算。
+ * 秩为1的卷积核会被自动分解为一个行向量和一个列向量，分两次一维卷积完成。
+ * 无论走哪条路径，结果都与convolve_reference逐位一致。
+ * */
+
+#define CONV_MAX_KERNEL_SIZE 7
+
+#define BORDER_REPLICATE 0
+#define BORDER_REFLECT_101 1
+#define BORDER_CONSTANT 2
+
+struct ConvKernel {
+    int width = 0;
+    int height = 0;
+    /**
+     * Effective integer kernel, row major. The result of a pixel is
+     * clamp((sum(weights * pixels) + (1 << (shift - 1))) >> shift).
+     * */
+    int32_t weights[CONV_MAX_KERNEL_SIZE * CONV_MAX_KERNEL_SIZE];
+    int shift = 0;
+
+    /**
+     * Rank 1 kernels are stored as weights[j][i] = colWeights[j] * rowWeights[i] as well,
+     * shift = rowShift + colShift. The horizontal pass keeps its sums in int16.
+     * */
+    bool separable = false;
+    int16_t rowWeights[CONV_MAX_KERNEL_SIZE];
+    int16_t colWeights[CONV_MAX_KERNEL_SIZE];
+    int rowShift = 0;
+    int colShift = 0;
+};
+
+/**
+ * Quantize a float kernel. width and height must be odd and not larger than CONV_MAX_KERNEL_SIZE.
+ * Return false if the kernel can not be used.
+ * */
+bool conv_kernel_init(ConvKernel &kernel, const float *weights, int width, int height);
+
+/**
+ * The 3x3 kernels hard-coded in fragShaderCode.
+ * */
+void conv_kernel_sharpen(ConvKernel &kernel);
+void conv_kernel_blur(ConvKernel &kernel);
+void conv_kernel_edge(ConvKernel &kernel);
+
+/**
+ * Convolve a single 8-bit plane, e.g. the Y plane of YUV_420_888.
+ * src and dst must not overlap. The frame is split into stripes across cores.
+ * */
+void convolve_y(const uint8_t *src, int srcStride, uint8_t *dst, int dstStride,
+                int width, int height, const ConvKernel &kernel, int border);
+
+/**
+ * Convolve a RGBA_8888 buffer. R, G and B are filtered, alpha is copied from src.
+ * */
+void convolve_rgba(const uint8_t *src, int srcStride, uint8_t *dst, int dstStride,
+                   int width, int height, const ConvKernel &kernel, int border);
+
+/**
+ * Straightforward scalar implementation, one pixel at a time. Used to verify the fast paths.
+ * channels is 1 or 4.
+ * */
+void convolve_reference(const uint8_t *src, int srcStride, uint8_t *dst, int dstStride,
+                        int width, int height, int channels, const ConvKernel &kernel, int border);
+
+#endif //CAMERAUTIL_CONVOLUTION_H
@@ -0,0 +1,129 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#include "cpu_features.h"
+#include <string.h>
+#include <stdio.h>
+
+#if defined(__aarch64__) || defined(__arm__)
+#include <sys/auxv.h>
+#endif
+
+// Older NDK headers miss some of the bits.
+#if defined(__aarch64__)
+#ifndef HWCAP_ASIMD
+#define HWCAP_ASIMD (1 << 1)
+#endif
+#ifndef HWCAP_ASIMDDP
+#define HWCAP_ASIMDDP (1 << 20)
+#endif
+#ifndef HWCAP2_I8MM
+#define HWCAP2_I8MM (1 << 13)
+#endif
+#ifndef AT_HWCAP2
+#define AT_HWCAP2 26
+#endif
+#elif defined(__arm__)
+#ifndef HWCAP_NEON
+#define HWCAP_NEON (1 << 12)
+#endif
+#endif
+
+struct FeatureName {
+    uint32_t feature;
+    const char *name;
+};
+
+static const FeatureName FEATURE_NAMES[] = {
+        {CPU_FEATURE_NEON, "neon"},
+        {CPU_FEATURE_DOTPROD, "dotprod"},
+        {CPU_FEATURE_I8MM, "i8mm"},
+        {CPU_FEATURE_SSE41, "sse4.1"},
+        {CPU_FEATURE_AVX2, "avx2"},
+        {CPU_FEATURE_AVX512, "avx512"},
+};
+
+static uint32_t probe_features() {
+    uint32_t features = 0;
+#if defined(__aarch64__)
+    unsigned long hwcap = getauxval(AT_HWCAP);
+    unsigned long hwcap2 = getauxval(AT_HWCAP2);
+    if (hwcap & HWCAP_ASIMD) {
+        features |= CPU_FEATURE_NEON;
+    }
+    if (hwcap & HWCAP_ASIMDDP) {
+        features |= CPU_FEATURE_DOTPROD;
+    }
+    if (hwcap2 & HWCAP2_I8MM) {
+        features |= CPU_FEATURE_I8MM;
+    }
+#elif defined(__arm__)
+    if (getauxval(AT_HWCAP) & HWCAP_NEON) {
+        features |= CPU_FEATURE_NEON;
+    }
+#elif defined(__i386__) || defined(__x86_64__)
+    // __builtin_cpu_supports also checks that the OS saves the AVX registers.
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.1")) {
+        features |= CPU_FEATURE_SSE41;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        features |= CPU_FEATURE_AVX2;
+    }
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+        features |= CPU_FEATURE_AVX512;
+    }
+#endif
+    return features;
+}
+
+uint32_t cpu_features() {
+    static uint32_t features = probe_features();
+    return features;
+}
+
+void cpu_features_to_string(uint32_t features, char *buffer, int bufferSize) {
+    if (bufferSize <= 0) {
+        return;
+    }
+    buffer[0] = '\0';
+    if (features == 0) {
+        snprintf(buffer, bufferSize, "scalar");
+        return;
+    }
+    int length = 0;
+    for (auto &f : FEATURE_NAMES) {
+        if ((features & f.feature) == 0 || length >= bufferSize) {
+            continue;
+        }
+        length += snprintf(buffer + length, bufferSize - length, "%s%s", length == 0 ? "" : ",", f.name);
+    }
+}
+
+bool cpu_features_from_string(const char *names, uint32_t &features) {
+    features = 0;
+    if (names == nullptr) {
+        return true;
+    }
+    const char *p = names;
+    while (*p != '\0') {
+        const char *end = strchr(p, ',');
+        size_t length = end == nullptr ? strlen(p) : (size_t)(end - p);
+        bool known = length == 0 || (length == 6 && strncmp(p, "scalar", 6) == 0);
+        for (auto &f : FEATURE_NAMES) {
+            if (strlen(f.name) == length && strncmp(p, f.name, length) == 0) {
+                features |= f.feature;
+                known = true;
+            }
+        }
+        if (!known) {
+            return false;
+        }
+        p += length;
+        if (*p == ',') {
+            p++;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,41 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#ifndef CAMERAUTIL_CPU_FEATURES_H
+#define CAMERAUTIL_CPU_FEATURES_H
+
+#include <stdint.h>
+
+/**
+ * 运行时检测CPU支持的SIMD指令集。
+ * ARM上通过getauxval(AT_HWCAP/AT_HWCAP2)读取，x86上通过cpuid读取。结果只检测一次。
+ * DOTPROD、I8MM、AVX2、AVX512目前只是检测出来，为以后的kernel档位预留，还没有kernel使用；
+ * dispatch_features()和日志只报告当前kernel表实际用到的位。
+ * */
+
+#define CPU_FEATURE_NEON (1u << 0)
+#define CPU_FEATURE_DOTPROD (1u << 1)
+#define CPU_FEATURE_I8MM (1u << 2)
+
+#define CPU_FEATURE_SSE41 (1u << 8)
+#define CPU_FEATURE_AVX2 (1u << 9)
+#define CPU_FEATURE_AVX512 (1u << 10)
+
+/**
+ * Features of the current CPU, CPU_FEATURE_* bits.
+ * */
+uint32_t cpu_features();
+
+/**
+ * Write names of the feature bits, e.g. "neon,dotprod". An empty mask is "scalar".
+ * */
+void cpu_features_to_string(uint32_t features, char *buffer, int bufferSize);
+
+/**
+ * Parse a comma separated list of feature names. Return false on an unknown name.
+ * "scalar" or an empty string is 0.
+ * */
+bool cpu_features_from_string(const char *names, uint32_t &features);
+
+#endif //CAMERAUTIL_CPU_FEATURES_H
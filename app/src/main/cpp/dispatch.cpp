@@ -0,0 +1,177 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#include "dispatch.h"
+#include "cpu_features.h"
+#include "log.h"
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <mutex>
+
+using namespace std;
+
+#define TAG "dispatch.cpp"
+
+#define OVERRIDE_ENV "CAMERAUTIL_KERNELS"
+// Distinct feature sets a process can switch between, there are at most a few per CPU.
+#define MAX_TABLES 16
+
+// Feature sets in the order kernels are added for them, each a superset of the one before on its architecture.
+static const uint32_t LEVELS[] = {
+        0,
+        CPU_FEATURE_NEON,
+        CPU_FEATURE_NEON | CPU_FEATURE_DOTPROD,
+        CPU_FEATURE_NEON | CPU_FEATURE_DOTPROD | CPU_FEATURE_I8MM,
+        CPU_FEATURE_SSE41,
+        CPU_FEATURE_SSE41 | CPU_FEATURE_AVX2,
+        CPU_FEATURE_SSE41 | CPU_FEATURE_AVX2 | CPU_FEATURE_AVX512,
+};
+
+static atomic<const KernelTable *> currentTable{nullptr};
+static atomic<uint32_t> currentFeatures{0};
+
+/**
+ * Tables are never freed: a frame in flight may still hold the previous one. One table is built
+ * per feature set and reused, so tests switching between variants for every case do not pile them up.
+ * */
+static const KernelTable *build_table(uint32_t features) {
+    auto table = new KernelTable();
+    convolution_fill_kernels(*table, features);
+    resize_fill_kernels(*table, features);
+    yuv_fill_kernels(*table, features);
+    yuv10_fill_kernels(*table, features);
+    tone_map_fill_kernels(*table, features);
+    lut3d_fill_kernels(*table, features);
+    raw_fill_kernels(*table, features);
+    raw_unpack_fill_kernels(*table, features);
+    lens_shading_fill_kernels(*table, features);
+    burst_merge_fill_kernels(*table, features);
+    pyramid_fill_kernels(*table, features);
+    warp_fill_kernels(*table, features);
+    audio_dsp_fill_kernels(*table, features);
+    yuv_repack_fill_kernels(*table, features);
+    return table;
+}
+
+static mutex tablesMutex;
+
+/**
+ * The table of a feature set, built on first use. The caller holds tablesMutex.
+ * */
+static const KernelTable *table_for(uint32_t features) {
+    static uint32_t builtFeatures[MAX_TABLES];
+    static const KernelTable *builtTables[MAX_TABLES];
+    static int builtCount = 0;
+
+    for (int i = 0; i < builtCount; i++) {
+        if (builtFeatures[i] == features) {
+            return builtTables[i];
+        }
+    }
+    const KernelTable *table = build_table(features);
+    if (builtCount < MAX_TABLES) {
+        builtFeatures[builtCount] = features;
+        builtTables[builtCount++] = table;
+    }
+    return table;
+}
+
+/**
+ * The first level within features that gives the same table, the features the kernels of table
+ * really use. A bit no kernel reads yet, e.g. avx512, is left out. The caller holds tablesMutex.
+ * */
+static uint32_t used_features(uint32_t features, const KernelTable *table) {
+    for (uint32_t level : LEVELS) {
+        if ((level & features) == level && memcmp(table_for(level), table, sizeof(KernelTable)) == 0) {
+            return level;
+        }
+    }
+    return features;
+}
+
+static void install(uint32_t features) {
+    features &= cpu_features();
+    lock_guard<mutex> lock(tablesMutex);
+    const KernelTable *table = table_for(features);
+    if (currentTable.load() == table) {
+        return;
+    }
+    features = used_features(features, table);
+    currentTable.store(table);
+    currentFeatures.store(features);
+    char names[64];
+    cpu_features_to_string(features, names, sizeof(names));
+    LOGD(TAG, "image kernels use %s", names);
+}
+
+static const KernelTable *init_from_environment() {
+    uint32_t features = cpu_features();
+    const char *env = getenv(OVERRIDE_ENV);
+    if (env != nullptr && env[0] != '\0' && strcmp(env, "auto") != 0) {
+        uint32_t forced;
+        if (cpu_features_from_string(env, forced)) {
+            features = forced;
+        } else {
+            LOGE(TAG, "ignore %s = %s", OVERRIDE_ENV, env);
+        }
+    }
+    install(features);
+    return currentTable.load();
+}
+
+// Probe once when the library is loaded.
+static const KernelTable *initialTable = init_from_environment();
+
+const KernelTable &kernel_table() {
+    const KernelTable *table = currentTable.load();
+    if (table == nullptr) {
+        // Called from another static initializer before ours ran.
+        table = init_from_environment();
+    }
+    return *table;
+}
+
+uint32_t dispatch_features() {
+    kernel_table();
+    return currentFeatures.load();
+}
+
+bool dispatch_set_override(const char *features) {
+    if (features == nullptr || strcmp(features, "auto") == 0) {
+        install(cpu_features());
+        return true;
+    }
+    uint32_t forced;
+    if (!cpu_features_from_string(features, forced)) {
+        LOGE(TAG, "unknown kernel override %s", features);
+        return false;
+    }
+    install(forced);
+    return true;
+}
+
+int dispatch_variants(uint32_t *masks, int maxCount) {
+    uint32_t detected = cpu_features();
+    lock_guard<mutex> lock(tablesMutex);
+    const KernelTable *listed[sizeof(LEVELS) / sizeof(LEVELS[0])];
+    int count = 0;
+    for (uint32_t level : LEVELS) {
+        if ((level & detected) != level || count >= maxCount) {
+            continue;
+        }
+        // A level no kernel reads gives the same table as one already listed, running it again
+        // would only time the same code under another name.
+        const KernelTable *table = table_for(level);
+        bool same = false;
+        for (int i = 0; i < count && !same; i++) {
+            same = memcmp(listed[i], table, sizeof(KernelTable)) == 0;
+        }
+        if (!same) {
+            listed[count] = table;
+            masks[count++] = level;
+        }
+    }
+    return count;
+}
@@ -0,0 +1,161 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#ifndef CAMERAUTIL_DISPATCH_H
+#define CAMERAUTIL_DISPATCH_H
+
+#include <stdint.h>
+
+struct Lut3dTables;
+struct ShadingRow;
+
+/**
+ * 图像kernel的函数指针表。
+ * 加载时根据cpu_features()为每个kernel选择最好的实现，同一个二进制可以在不同CPU上运行
+ * 最合适的版本，也可以强制使用较低的指令集，方便在同一台设备上对比不同实现。
+ *
+ * 强制指定指令集：
+ * 1. 环境变量CAMERAUTIL_KERNELS，例如"scalar"、"neon"、"neon,dotprod"；
+ * 2. 调用dispatch_set_override。
+ * 指定的指令集会与CPU实际支持的取交集。
+ *
+ * 每个模块在自己的cpp中实现各个版本，并通过xxx_fill_kernels填写表中属于自己的部分。
+ * */
+
+struct KernelTable {
+    // convolution.cpp
+    void (*convHorizontal)(const uint8_t *padded, int16_t *out, int count, int channels,
+                           const int16_t *weights, int taps);
+    void (*convVertical)(const int16_t *const *rows, uint8_t *dst, int count,
+                         const int16_t *weights, int taps, int shift);
+    void (*convDirect)(const uint8_t *const *lines, uint8_t *dst, int count, int channels,
+                       const int32_t *weights, int width, int height, int shift);
+
+    // resize.cpp
+    void (*resizeHorizontalC1)(const uint8_t *src, int16_t *out, const int32_t *starts,
+                               const int16_t *weights, int taps, int count);
+    void (*resizeHorizontalC4)(const uint8_t *src, int16_t *out, const int32_t *starts,
+                               const int16_t *weights, int taps, int count);
+    void (*resizeVertical)(const int16_t *const *rows, const int16_t *weights, int taps,
+                           uint8_t *dst, int count);
+
+    // yuv_kernels.cpp
+    void (*yuv420ToRgba)(const uint8_t *y, const uint8_t *u, const uint8_t *v, int uvPixelStride,
+                         uint32_t *dst, int dstStep, int width);
+    void (*yuv420ToRgbaPrecise)(const uint8_t *y, const uint8_t *u, const uint8_t *v, int uvPixelStride,
+                                uint32_t *dst, int dstStep, int width);
+    // Table driven, same signature and results as the two above.
+    void (*yuv420ToRgbaLut)(const uint8_t *y, const uint8_t *u, const uint8_t *v, int uvPixelStride,
+                            uint32_t *dst, int dstStep, int width);
+    void (*yuv420ToRgbaPreciseLut)(const uint8_t *y, const uint8_t *u, const uint8_t *v, int uvPixelStride,
+                                   uint32_t *dst, int dstStep, int width);
+
+    // yuv10_kernels.cpp, rgb is three int16 rows R, G, B of width
+    void (*yuv10ToRgb)(const uint16_t *y, const uint16_t *u, const uint16_t *v, int uvPixelStride,
+                       int layout, const int16_t *coefficients, int16_t *rgb, int width);
+    void (*rgbToRgba8Dither)(const int16_t *rgb, int width, int row, uint32_t *dst, int dstStep);
+    void (*rgbToRgba1010102)(const int16_t *rgb, int width, uint32_t *dst, int dstStep);
+
+    // tone_map.cpp, 3x3 Q12 matrix on planar R, G, B rows, in place. Also the CCM of raw_pipeline.cpp.
+    void (*rgbMatrix)(int16_t *rgb, int width, const int16_t *matrix);
+
+    // lut3d.cpp
+    void (*lut3dApply)(const uint32_t *src, uint32_t *dst, int dstStep, int width, const Lut3dTables &tables);
+
+    // raw_pipeline.cpp, one Bayer row into Q14 even and odd column planes, then 5 rows of planes
+    // into planar R, G, B of 2 * halfWidth
+    void (*rawNormalize)(const uint16_t *raw, int halfWidth, const int16_t *black, const int16_t *scale,
+                         int shift, const ShadingRow *shading, int16_t *even, int16_t *odd);
+    void (*rawDemosaic)(const int16_t *const *even, const int16_t *const *odd, const int16_t *coefficients,
+                        int16_t *rgb, int halfWidth);
+
+    // raw_unpack.cpp, one row of MIPI RAW10 / RAW12
+    void (*rawUnpack10)(const uint8_t *src, uint16_t *dst, int width);
+    void (*rawUnpack12)(const uint8_t *src, uint16_t *dst, int width);
+
+    // lens_shading.cpp, one 8 bit row times its interpolated gains
+    void (*shadingLuma)(const uint8_t *src, uint8_t *dst, int width, const ShadingRow &row);
+
+    // burst_merge.cpp, 2x2 mean of two rows, SAD of a tile, and robust accumulation of a tile
+    void (*burstDown2)(const uint8_t *row0, const uint8_t *row1, uint8_t *dst, int dstWidth);
+    uint32_t (*burstSad)(const uint8_t *a, int aStride, const uint8_t *b, int bStride, int width, int height);
+    void (*burstMerge)(const uint16_t *ref, const uint16_t *alt, uint16_t *sum, uint16_t *weight, int stride,
+                       int width, int height, const int16_t *params);
+
+    // pyramid.cpp, 5 tap [1 4 6 4 1] / 16 reduce and expand, and weighted accumulation of a level row
+    void (*pyrDownV)(const int16_t *const *rows, int16_t *dst, int width);
+    void (*pyrDownH)(const int16_t *padded, int16_t *dst, int dstWidth);
+    void (*pyrUpV)(const int16_t *const *rows, int16_t *dst, int width, int odd);
+    void (*pyrUpH)(const int16_t *padded, int16_t *fine, int fineWidth, int subtract);
+    void (*pyrAccumulate)(const int16_t *src, const int16_t *weight, int16_t *acc, int width);
+
+    // warp.cpp, bilinear samples stepped by (du, dv) from (u, v), Q16, all inside the source
+    void (*warpBilinearC1)(const uint8_t *src, int srcStride, int srcPixelStride, int32_t u, int32_t v,
+                           int32_t du, int32_t dv, uint8_t *dst, int count);
+    void (*warpBilinearC4)(const uint8_t *src, int srcStride, int32_t u, int32_t v, int32_t du, int32_t dv,
+                           uint8_t *dst, int count);
+
+    // audio_dsp.cpp, sample format conversion, stereo <-> mono, and polyphase filtering of one planar channel
+    void (*pcmS16ToF32)(const int16_t *src, float *dst, int count);
+    void (*pcmF32ToS16)(const float *src, int16_t *dst, int count);
+    void (*pcmS32ToF32)(const int32_t *src, float *dst, int count);
+    void (*pcmF32ToS32)(const float *src, int32_t *dst, int count);
+    void (*pcmS32ToS16)(const int32_t *src, int16_t *dst, int count);
+    void (*pcmS16ToS32)(const int16_t *src, int32_t *dst, int count);
+    void (*pcmStereoToMono)(const int16_t *src, int16_t *dst, int frames);
+    void (*pcmMonoToStereo)(const int16_t *src, int16_t *dst, int frames);
+    void (*pcmPolyphase)(const int16_t *src, const int16_t *bank, int taps, int phases, int step, int index,
+                         int phase, int16_t *dst, int dstStride, int count);
+
+    // yuv_repack.cpp, interleaved chroma rows of count pairs, rounded average of two rows,
+    // and packed 4:2:2 rows of width pixels (uyvy 0 for YUYV, 1 for UYVY)
+    void (*repackSplitUv)(const uint8_t *uv, uint8_t *u, uint8_t *v, int count);
+    void (*repackMergeUv)(const uint8_t *u, const uint8_t *v, uint8_t *uv, int count);
+    void (*repackSwapUv)(const uint8_t *src, uint8_t *dst, int count);
+    void (*repackAverage)(const uint8_t *a, const uint8_t *b, uint8_t *dst, int count);
+    void (*repackPack422)(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *dst, int width, int uyvy);
+    void (*repackUnpack422)(const uint8_t *src, uint8_t *y, uint8_t *u, uint8_t *v, int width, int uyvy);
+};
+
+/**
+ * The table of the current feature set. Fetch it once per frame, not per pixel.
+ * */
+const KernelTable &kernel_table();
+
+/**
+ * Features the kernels of the current table use: the smallest listed feature set that gives
+ * the same table, so detected bits without kernels of their own are not reported.
+ * */
+uint32_t dispatch_features();
+
+/**
+ * Only use kernels that need no more than the given features, e.g. "scalar" or "neon".
+ * nullptr or "auto" goes back to everything the CPU supports. Return false if the
+ * string can not be parsed, the table is not changed then.
+ * */
+bool dispatch_set_override(const char *features);
+
+/**
+ * Distinct feature sets worth comparing on this CPU, from scalar up to all detected
+ * features. A set is left out when its table is the same as that of a smaller one listed
+ * before it. Return the number written to masks.
+ * */
+int dispatch_variants(uint32_t *masks, int maxCount);
+
+void convolution_fill_kernels(KernelTable &table, uint32_t features);
+void resize_fill_kernels(KernelTable &table, uint32_t features);
+void yuv_fill_kernels(KernelTable &table, uint32_t features);
+void yuv10_fill_kernels(KernelTable &table, uint32_t features);
+void tone_map_fill_kernels(KernelTable &table, uint32_t features);
+void lut3d_fill_kernels(KernelTable &table, uint32_t features);
+void raw_fill_kernels(KernelTable &table, uint32_t features);
+void raw_unpack_fill_kernels(KernelTable &table, uint32_t features);
+void lens_shading_fill_kernels(KernelTable &table, uint32_t features);
+void burst_merge_fill_kernels(KernelTable &table, uint32_t features);
+void pyramid_fill_kernels(KernelTable &table, uint32_t features);
+void warp_fill_kernels(KernelTable &table, uint32_t features);
+void audio_dsp_fill_kernels(KernelTable &table, uint32_t features);
+void yuv_repack_fill_kernels(KernelTable &table, uint32_t features);
+
+#endif //CAMERAUTIL_DISPATCH_H
@@ -0,0 +1,184 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#include "exposure_fusion.h"
+#include "pyramid.h"
+#include "parallel.h"
+#include "frame_arena.h"
+#include "log.h"
+#include <math.h>
+#include <algorithm>
+
+using namespace std;
+
+#define TAG "exposure_fusion.cpp"
+
+#define MIN_STRIPE_ROWS 16
+#define WEIGHT_BITS 10
+// Normalized weights are kept as 8 bit shares between the two passes.
+#define SHARE_MAX 255
+// |4 * center - 4 neighbours| of 8 bit Y
+#define MAX_CONTRAST 1020
+// |U - 128| + |V - 128|
+#define MAX_SATURATION 256
+#define EXPOSURE_SIGMA 0.2
+
+struct WeightTables {
+    float contrast[MAX_CONTRAST + 1];
+    float saturation[MAX_SATURATION + 1];
+    float exposure[256];
+};
+
+/**
+ * Contrast and saturation are offset by one step, so that flat grey areas (both 0 in every
+ * frame) are still weighted by exposure instead of averaged.
+ * */
+static void build_tables(const ExposureFusionParams &params, WeightTables &tables) {
+    for (int i = 0; i <= MAX_CONTRAST; i++) {
+        tables.contrast[i] = powf((i + 1) / 255.0f, params.contrast);
+    }
+    for (int i = 0; i <= MAX_SATURATION; i++) {
+        tables.saturation[i] = powf((i + 1) / 255.0f, params.saturation);
+    }
+    for (int i = 0; i < 256; i++) {
+        double d = i / 255.0 - 0.5;
+        tables.exposure[i] = (float)exp(-params.exposure * d * d / (2 * EXPOSURE_SIGMA * EXPOSURE_SIGMA));
+    }
+}
+
+/**
+ * Weights of one row of a frame, before normalization.
+ * */
+static void row_weights(const YuvFrame &frame, int row, const WeightTables &tables, float *weights) {
+    int width = frame.width;
+    const uint8_t *above = frame.y + (size_t)std::max(row - 1, 0) * frame.yRowStride;
+    const uint8_t *center = frame.y + (size_t)row * frame.yRowStride;
+    const uint8_t *below = frame.y + (size_t)std::min(row + 1, frame.height - 1) * frame.yRowStride;
+    const uint8_t *u = frame.u + (size_t)(row / 2) * frame.uvRowStride;
+    const uint8_t *v = frame.v + (size_t)(row / 2) * frame.uvRowStride;
+    auto weight = [&](int x, int left, int right) {
+        int contrast = abs(4 * center[x] - left - right - above[x] - below[x]);
+        size_t c = (size_t)(x / 2) * frame.uvPixelStride;
+        int saturation = abs(u[c] - 128) + abs(v[c] - 128);
+        weights[x] = tables.contrast[contrast] * tables.saturation[saturation] * tables.exposure[center[x]];
+    };
+    weight(0, center[0], center[1]);
+    for (int x = 1; x < width - 1; x++) {
+        weight(x, center[x - 1], center[x + 1]);
+    }
+    weight(width - 1, center[width - 2], center[width - 1]);
+}
+
+/**
+ * Every frame's share of the summed weights, Q8, one plane per frame.
+ * */
+static void normalize_weights(const YuvFrame *frames, int count, const WeightTables &tables,
+                              FrameArena &arena, uint8_t **shares) {
+    int width = frames[0].width, height = frames[0].height;
+    for (int i = 0; i < count; i++) {
+        shares[i] = arena.alloc<uint8_t>((size_t)width * height);
+    }
+    parallel_for_stripes(height, MIN_STRIPE_ROWS, [&](int rowStart, int rowEnd) {
+        FrameArena scratch;
+        float *weights = scratch.alloc<float>((size_t)width * count), *sum = scratch.alloc<float>(width);
+        for (int row = rowStart; row < rowEnd; row++) {
+            std::fill(sum, sum + width, 0.0f);
+            for (int i = 0; i < count; i++) {
+                float *w = weights + (size_t)i * width;
+                row_weights(frames[i], row, tables, w);
+                for (int x = 0; x < width; x++) {
+                    sum[x] += w[x];
+                }
+            }
+            for (int x = 0; x < width; x++) {
+                sum[x] = SHARE_MAX / sum[x];
+            }
+            for (int i = 0; i < count; i++) {
+                const float *w = weights + (size_t)i * width;
+                uint8_t *out = shares[i] + (size_t)row * width;
+                for (int x = 0; x < width; x++) {
+                    out[x] = (uint8_t)lroundf(w[x] * sum[x]);
+                }
+            }
+        }
+    });
+}
+
+/**
+ * Level 0 of weight from a Q8 share, Q10.
+ * */
+static void load_weights(const uint8_t *share, Pyramid &weight) {
+    const PyramidLevel &level = weight.level(0);
+    parallel_for_stripes(level.height, MIN_STRIPE_ROWS, [&](int rowStart, int rowEnd) {
+        for (int row = rowStart; row < rowEnd; row++) {
+            const uint8_t *in = share + (size_t)row * level.width;
+            int16_t *out = level.data + (size_t)row * level.stride;
+            for (int x = 0; x < level.width; x++) {
+                out[x] = (int16_t)((in[x] * (1 << WEIGHT_BITS) + SHARE_MAX / 2) / SHARE_MAX);
+            }
+        }
+    });
+}
+
+/**
+ * acc += weight * Laplacian pyramid of an 8 bit plane.
+ * */
+static void accumulate_plane(Pyramid &acc, const uint8_t *src, int rowStride, int pixelStride,
+                             const Pyramid &weight, int weightLevelOffset) {
+    const PyramidLevel &base = acc.level(0);
+    Pyramid laplacian(base.width, base.height, acc.getLevels());
+    pyramid_load_u8(laplacian, src, rowStride, pixelStride);
+    pyramid_gaussian(laplacian);
+    pyramid_laplacian(laplacian);
+    pyramid_accumulate(acc, laplacian, weight, weightLevelOffset);
+}
+
+bool exposure_fusion_yuv(const YuvFrame *frames, int count, const ExposureFusionParams &params,
+                         uint8_t *y, int yRowStride, uint8_t *u, uint8_t *v, int uvRowStride, int uvPixelStride) {
+    if (count < 2 || count > EXPOSURE_FUSION_MAX_FRAMES) {
+        LOGE(TAG, "can not fuse %d frames", count);
+        return false;
+    }
+    int width = frames[0].width, height = frames[0].height;
+    for (int i = 0; i < count; i++) {
+        if (frames[i].width != width || frames[i].height != height || width < 4 || height < 4) {
+            LOGE(TAG, "frame %d is %dx%d, frame 0 is %dx%d", i, frames[i].width, frames[i].height, width, height);
+            return false;
+        }
+    }
+    WeightTables tables;
+    build_tables(params, tables);
+    FrameArena arena;
+    uint8_t *shares[EXPOSURE_FUSION_MAX_FRAMES];
+    normalize_weights(frames, count, tables, arena, shares);
+
+    int chromaWidth = (width + 1) / 2, chromaHeight = (height + 1) / 2;
+    // Chroma levels use the weights one level up, so luma needs at least 2 levels.
+    Pyramid fusedY(width, height, params.levels == 1 ? 2 : params.levels);
+    int levels = fusedY.getLevels();
+    Pyramid fusedU(chromaWidth, chromaHeight, levels - 1);
+    Pyramid fusedV(chromaWidth, chromaHeight, levels - 1);
+    pyramid_clear(fusedY);
+    pyramid_clear(fusedU);
+    pyramid_clear(fusedV);
+
+    for (int i = 0; i < count; i++) {
+        const YuvFrame &frame = frames[i];
+        Pyramid weight(width, height, levels);
+        load_weights(shares[i], weight);
+        pyramid_gaussian(weight);
+        accumulate_plane(fusedY, frame.y, frame.yRowStride, 1, weight, 0);
+        accumulate_plane(fusedU, frame.u, frame.uvRowStride, frame.uvPixelStride, weight, 1);
+        accumulate_plane(fusedV, frame.v, frame.uvRowStride, frame.uvPixelStride, weight, 1);
+    }
+
+    pyramid_collapse(fusedY);
+    pyramid_collapse(fusedU);
+    pyramid_collapse(fusedV);
+    pyramid_store_u8(fusedY, y, yRowStride);
+    pyramid_store_u8(fusedU, u, uvRowStride, uvPixelStride);
+    pyramid_store_u8(fusedV, v, uvRowStride, uvPixelStride);
+    LOGD(TAG, "fused %d frames of %dx%d, %d levels", count, width, height, levels);
+    return true;
+}
@@ -0,0 +1,43 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#ifndef CAMERAUTIL_EXPOSURE_FUSION_H
+#define CAMERAUTIL_EXPOSURE_FUSION_H
+
+#include "yuv_kernels.h"
+#include <stdint.h>
+
+/**
+ * 包围曝光合成（Mertens exposure fusion），不需要曝光时间和响应曲线，直接在YUV上合成。
+ *
+ * 每帧每个像素的权重是三项的乘积：
+ * 1. 对比度：Y的3x3拉普拉斯响应的绝对值；
+ * 2. 饱和度：色度到中性灰的距离|U - 128| + |V - 128|，代替RGB的标准差；
+ * 3. 曝光良好程度：以Y = 0.5为中心、sigma = 0.2的高斯。
+ * 各帧的权重归一化后，用权重的高斯金字塔混合各帧Y、U、V的拉普拉斯金字塔，再合成回图像。
+ * 色度是半分辨率，使用权重金字塔的上一层。
+ *
+ * 一次只处理一帧的金字塔；归一化需要所有帧的权重，所以先一次算出所有帧归一化后的权重，
+ * 每帧保存为一个8位平面（比输入帧本身还小），再逐帧建金字塔。
+ * */
+
+#define EXPOSURE_FUSION_MAX_FRAMES 8
+
+struct ExposureFusionParams {
+    // Exponents of the three weight terms, 0 turns a term off.
+    float contrast = 1.0f;
+    float saturation = 1.0f;
+    float exposure = 1.0f;
+    // Pyramid levels, 0 for as many as the frame size allows.
+    int levels = 0;
+};
+
+/**
+ * Fuse count (2 .. EXPOSURE_FUSION_MAX_FRAMES) frames of the same size into y / u / v,
+ * uvPixelStride 1 for I420 and 2 for NV12 / NV21 (v = u + 1 or u - 1).
+ * */
+bool exposure_fusion_yuv(const YuvFrame *frames, int count, const ExposureFusionParams &params,
+                         uint8_t *y, int yRowStride, uint8_t *u, uint8_t *v, int uvRowStride, int uvPixelStride);
+
+#endif //CAMERAUTIL_EXPOSURE_FUSION_H
@@ -0,0 +1,262 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#include "frame_arena.h"
+#include "log.h"
+#include "trace.h"
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <atomic>
+#include <mutex>
+
+using namespace std;
+
+#define TAG "frame_arena.cpp"
+
+// 64 bytes, the smallest block
+#define MIN_CLASS 6
+// Up to half the address space
+#define CLASS_COUNT ((int)sizeof(size_t) * 8 - 1)
+// The block header takes a whole cache line so the memory after it stays aligned.
+#define HEADER_BYTES FRAME_ARENA_ALIGNMENT
+#define BLOCK_MAGIC 0x4652414Du
+
+struct FrameArenaBlock {
+    FrameArenaBlock *next;
+    uint32_t sizeClass;
+    uint32_t magic;
+};
+
+static_assert(sizeof(FrameArenaBlock) <= HEADER_BYTES, "block header does not fit");
+
+namespace {
+
+struct SharedLists {
+    mutex lock;
+    FrameArenaBlock *blocks[CLASS_COUNT] = {};
+};
+
+// Never destroyed, arenas in other threads may release blocks while the process exits.
+SharedLists &shared_lists() {
+    static SharedLists *instance = new SharedLists();
+    return *instance;
+}
+
+atomic<size_t> inUseBytes{0};
+atomic<size_t> peakBytes{0};
+atomic<size_t> reservedBytes{0};
+atomic<uint64_t> systemAllocations{0};
+atomic<uint64_t> reusedAllocations{0};
+atomic<uint64_t> allocations{0};
+atomic<bool> hugePages{false};
+
+inline size_t class_bytes(int sizeClass) {
+    return (size_t)1 << sizeClass;
+}
+
+inline bool is_large(int sizeClass) {
+    return class_bytes(sizeClass) >= FRAME_ARENA_LARGE_BYTES;
+}
+
+FrameArenaBlock *system_alloc(int sizeClass) {
+    size_t total = HEADER_BYTES + class_bytes(sizeClass);
+    void *memory = nullptr;
+    if (is_large(sizeClass)) {
+        memory = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) {
+            memory = nullptr;
+        }
+#ifdef MADV_HUGEPAGE
+        if (memory != nullptr && hugePages.load(memory_order_relaxed)) {
+            madvise(memory, total, MADV_HUGEPAGE);
+        }
+#endif
+    } else if (posix_memalign(&memory, FRAME_ARENA_ALIGNMENT, total) != 0) {
+        memory = nullptr;
+    }
+    if (memory == nullptr) {
+        LOGE(TAG, "out of memory, can not allocate %zu bytes, %zu reserved", total,
+             reservedBytes.load(memory_order_relaxed));
+        abort();
+    }
+    auto *block = (FrameArenaBlock *)memory;
+    block->next = nullptr;
+    block->sizeClass = (uint32_t)sizeClass;
+    block->magic = BLOCK_MAGIC;
+    systemAllocations.fetch_add(1, memory_order_relaxed);
+    size_t reserved = reservedBytes.fetch_add(class_bytes(sizeClass), memory_order_relaxed) + class_bytes(sizeClass);
+    TRACE_COUNTER("frame arena reserved", reserved);
+    return block;
+}
+
+void system_free(FrameArenaBlock *block) {
+    int sizeClass = (int)block->sizeClass;
+    reservedBytes.fetch_sub(class_bytes(sizeClass), memory_order_relaxed);
+    if (is_large(sizeClass)) {
+        munmap(block, HEADER_BYTES + class_bytes(sizeClass));
+    } else {
+        free(block);
+    }
+}
+
+void free_list(FrameArenaBlock *block) {
+    while (block != nullptr) {
+        FrameArenaBlock *next = block->next;
+        system_free(block);
+        block = next;
+    }
+}
+
+/**
+ * Free small blocks of one thread, so stripe scratch is reused without locking.
+ * Large blocks are one per plane and few, they always go through the shared lists
+ * so that any thread can pick them up and trim can release them.
+ * */
+struct ThreadCache {
+    FrameArenaBlock *blocks[CLASS_COUNT] = {};
+    int counts[CLASS_COUNT] = {};
+
+    ~ThreadCache();
+};
+
+thread_local ThreadCache threadCache;
+// Set when threadCache is destroyed at thread exit, blocks released later go to the shared lists.
+// A plain bool is never destroyed, so it can still be read then, unlike a member of threadCache.
+thread_local bool threadCacheClosed = false;
+
+ThreadCache::~ThreadCache() {
+    SharedLists &lists = shared_lists();
+    lock_guard<mutex> lock(lists.lock);
+    for (int c = 0; c < CLASS_COUNT; c++) {
+        while (blocks[c] != nullptr) {
+            FrameArenaBlock *block = blocks[c];
+            blocks[c] = block->next;
+            block->next = lists.blocks[c];
+            lists.blocks[c] = block;
+        }
+        counts[c] = 0;
+    }
+    threadCacheClosed = true;
+}
+
+int size_class(size_t bytes) {
+    int sizeClass = MIN_CLASS;
+    while (sizeClass < CLASS_COUNT && class_bytes(sizeClass) < bytes) {
+        sizeClass++;
+    }
+    return sizeClass;
+}
+
+FrameArenaBlock *take(int sizeClass) {
+    FrameArenaBlock *block = nullptr;
+    ThreadCache *cache = threadCacheClosed ? nullptr : &threadCache;
+    if (!is_large(sizeClass) && cache != nullptr && cache->blocks[sizeClass] != nullptr) {
+        block = cache->blocks[sizeClass];
+        cache->blocks[sizeClass] = block->next;
+        cache->counts[sizeClass]--;
+    } else {
+        SharedLists &lists = shared_lists();
+        lock_guard<mutex> lock(lists.lock);
+        block = lists.blocks[sizeClass];
+        if (block != nullptr) {
+            lists.blocks[sizeClass] = block->next;
+        }
+    }
+    if (block != nullptr) {
+        reusedAllocations.fetch_add(1, memory_order_relaxed);
+    } else {
+        block = system_alloc(sizeClass);
+    }
+    allocations.fetch_add(1, memory_order_relaxed);
+    size_t inUse = inUseBytes.fetch_add(class_bytes(sizeClass), memory_order_relaxed) + class_bytes(sizeClass);
+    size_t peak = peakBytes.load(memory_order_relaxed);
+    while (inUse > peak && !peakBytes.compare_exchange_weak(peak, inUse, memory_order_relaxed)) {
+    }
+    return block;
+}
+
+void give(FrameArenaBlock *block) {
+    int sizeClass = (int)block->sizeClass;
+    inUseBytes.fetch_sub(class_bytes(sizeClass), memory_order_relaxed);
+    ThreadCache *cache = threadCacheClosed ? nullptr : &threadCache;
+    if (!is_large(sizeClass) && cache != nullptr && cache->counts[sizeClass] < FRAME_ARENA_THREAD_BLOCKS) {
+        block->next = cache->blocks[sizeClass];
+        cache->blocks[sizeClass] = block;
+        cache->counts[sizeClass]++;
+        return;
+    }
+    SharedLists &lists = shared_lists();
+    lock_guard<mutex> lock(lists.lock);
+    block->next = lists.blocks[sizeClass];
+    lists.blocks[sizeClass] = block;
+}
+
+}
+
+void *FrameArena::alloc(size_t size) {
+    int sizeClass = size_class(size);
+    if (sizeClass >= CLASS_COUNT) {
+        LOGE(TAG, "can not allocate %zu bytes", size);
+        abort();
+    }
+    FrameArenaBlock *block = take(sizeClass);
+    block->next = blocks;
+    blocks = block;
+    bytes += class_bytes(sizeClass);
+    return (uint8_t *)block + HEADER_BYTES;
+}
+
+void FrameArena::reset() {
+    while (blocks != nullptr) {
+        FrameArenaBlock *block = blocks;
+        blocks = block->next;
+        if (block->magic != BLOCK_MAGIC) {
+            LOGE(TAG, "block %p is corrupted, something wrote before its start", block);
+            abort();
+        }
+        give(block);
+    }
+    bytes = 0;
+}
+
+void frame_arena_set_huge_pages(bool enable) {
+    hugePages.store(enable, memory_order_relaxed);
+}
+
+void frame_arena_trim() {
+    if (!threadCacheClosed) {
+        ThreadCache &cache = threadCache;
+        for (int c = 0; c < CLASS_COUNT; c++) {
+            free_list(cache.blocks[c]);
+            cache.blocks[c] = nullptr;
+            cache.counts[c] = 0;
+        }
+    }
+    FrameArenaBlock *blocks[CLASS_COUNT];
+    {
+        SharedLists &lists = shared_lists();
+        lock_guard<mutex> lock(lists.lock);
+        for (int c = 0; c < CLASS_COUNT; c++) {
+            blocks[c] = lists.blocks[c];
+            lists.blocks[c] = nullptr;
+        }
+    }
+    for (auto block : blocks) {
+        free_list(block);
+    }
+    TRACE_COUNTER("frame arena reserved", reservedBytes.load(memory_order_relaxed));
+}
+
+void frame_arena_get_stats(FrameArenaStats &stats) {
+    stats.inUseBytes = inUseBytes.load(memory_order_relaxed);
+    stats.peakBytes = peakBytes.load(memory_order_relaxed);
+    stats.reservedBytes = reservedBytes.load(memory_order_relaxed);
+    stats.systemAllocations = systemAllocations.load(memory_order_relaxed);
+    stats.reusedAllocations = reusedAllocations.load(memory_order_relaxed);
+    stats.allocations = allocations.load(memory_order_relaxed);
+}
+
+void frame_arena_reset_peak() {
+    peakBytes.store(inUseBytes.load(memory_order_relaxed), memory_order_relaxed);
+}
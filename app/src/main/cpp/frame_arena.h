@@ -0,0 +1,103 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#ifndef CAMERAUTIL_FRAME_ARENA_H
+#define CAMERAUTIL_FRAME_ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * 帧处理中间平面和行缓冲的内存池，避免每一帧、每个stripe都向系统申请、释放内存。
+ *
+ * 每块内存按2的幂分级（最小64字节），起始地址64字节对齐，长度是64的倍数，
+ * 所以两块内存不会共享cache line，SIMD kernel可以放心按向量宽度读写到行尾的填充里。
+ * 释放的内存按级别挂在空闲链表上：小块放进当前线程自己的链表，不加锁，stripe的行缓冲由同一个
+ * worker线程反复使用；大块（FRAME_ARENA_LARGE_BYTES以上，整帧平面）放进共享链表，
+ * 直接用mmap申请，可以通过frame_arena_set_huge_pages让内核用透明大页，减少TLB miss。
+ *
+ * 使用方式是在一帧（或一个stripe）的作用域里放一个FrameArena，从它申请，离开作用域或reset时
+ * 这期间申请的所有内存一起回到空闲链表。处理过几帧之后同样大小的帧不再向系统申请内存，
+ * 可以用frame_arena_get_stats中的systemAllocations确认。空闲内存不会自动还给系统，
+ * 相机关闭或者内存紧张时调用frame_arena_trim。
+ * */
+
+#define FRAME_ARENA_ALIGNMENT 64
+// Blocks from this size up are mapped on their own and may use huge pages.
+#define FRAME_ARENA_LARGE_BYTES (1 << 20)
+// Free blocks of one size a thread keeps for itself, more go to the shared lists.
+#define FRAME_ARENA_THREAD_BLOCKS 8
+
+struct FrameArenaBlock;
+
+struct FrameArenaStats {
+    // Bytes handed out and not yet released, rounded up to the size classes
+    size_t inUseBytes;
+    // Highest inUseBytes since the last frame_arena_reset_peak
+    size_t peakBytes;
+    // Bytes held from the system, in use or free
+    size_t reservedBytes;
+    // Blocks taken from the system since the library was loaded, constant once the pipeline is warm
+    uint64_t systemAllocations;
+    // Allocations served from a free list
+    uint64_t reusedAllocations;
+    uint64_t allocations;
+};
+
+class FrameArena {
+public:
+    FrameArena() = default;
+    FrameArena(FrameArena &) = delete;
+    // A copy would release the same blocks twice.
+    FrameArena &operator=(FrameArena &) = delete;
+
+    ~FrameArena() {
+        reset();
+    }
+
+    /**
+     * At least bytes of uninitialized memory, 64 byte aligned. Like new, it never returns nullptr:
+     * running out of memory aborts the process.
+     * */
+    void *alloc(size_t bytes);
+
+    template<typename T>
+    T *alloc(size_t count) {
+        return (T *)alloc(count * sizeof(T));
+    }
+
+    /**
+     * Release every allocation made since the last reset.
+     * */
+    void reset();
+
+    /**
+     * Bytes currently allocated from this arena, rounded up to the size classes.
+     * */
+    size_t getBytes() const {
+        return bytes;
+    }
+
+private:
+    FrameArenaBlock *blocks = nullptr;
+    size_t bytes = 0;
+};
+
+/**
+ * Ask the kernel to back large blocks mapped from now on with transparent huge pages
+ * (madvise MADV_HUGEPAGE), off by default. Only takes effect where THP is set to madvise or always.
+ * */
+void frame_arena_set_huge_pages(bool enable);
+
+/**
+ * Return the free blocks of the shared lists and of the calling thread to the system.
+ * Blocks cached by other threads stay until those threads exit.
+ * */
+void frame_arena_trim();
+
+void frame_arena_get_stats(FrameArenaStats &stats);
+
+void frame_arena_reset_peak();
+
+#endif //CAMERAUTIL_FRAME_ARENA_H
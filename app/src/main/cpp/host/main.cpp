@@ -0,0 +1,47 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#include "conformance.h"
+#include "audio_check.h"
+#include "mp4_check.h"
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * 在Linux主机上运行native自测，不需要设备：camerautil_host <suite> [filter]。
+ * 输出和logcat中的相同（写到stderr），最后一行是失败的检查数；有失败时退出码为1，
+ * 所以ctest和CI可以直接用它阻止输出变差的kernel合入。
+ * */
+
+struct Suite {
+    const char *name;
+    int (*run)(const char *filter);
+};
+
+static const Suite SUITES[] = {
+        {"conformance", run_conformance},
+        {"audio", run_audio_check},
+        {"mp4", run_mp4_check},
+};
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <suite> [filter], suites:", argv[0]);
+        for (auto &suite : SUITES) {
+            fprintf(stderr, " %s", suite.name);
+        }
+        fputc('\n', stderr);
+        return 2;
+    }
+    for (auto &suite : SUITES) {
+        if (strcmp(suite.name, argv[1]) == 0) {
+            int failures = suite.run(argc > 2 ? argv[2] : "");
+            fprintf(stderr, "%s: %d failures\n", suite.name, failures);
+            // Exit codes are 8 bits, a multiple of 256 must not read as success.
+            return failures > 0 ? 1 : 0;
+        }
+    }
+    fprintf(stderr, "unknown suite %s\n", argv[1]);
+    return 2;
+}
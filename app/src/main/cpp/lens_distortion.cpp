@@ -0,0 +1,257 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#include "lens_distortion.h"
+#include "warp.h"
+#include "lut3d.h"
+#include "dispatch.h"
+#include "parallel.h"
+#include "frame_arena.h"
+#include "log.h"
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <list>
+#include <mutex>
+
+using namespace std;
+
+#define TAG "lens_distortion.cpp"
+
+#define MAX_CACHED_REMAPS 2
+#define MIN_STRIPE_ROWS 16
+#define FRACTION_BITS WARP_FRACTION_BITS
+#define CHROMA_NEUTRAL 0x80
+
+static mutex cacheMutex;
+static list<shared_ptr<const LensRemap>> remapCache;
+
+/**
+ * Frame pixel <-> intrinsics array pixel, the frame is the array scaled by scale and cropped
+ * around the centre. Pixel centres are mapped onto each other.
+ * */
+struct FrameToArray {
+    double scale;
+    double cropX, cropY;
+
+    FrameToArray(const LensDistortion &lens, int width, int height) {
+        scale = std::max((double)width / lens.arrayWidth, (double)height / lens.arrayHeight);
+        cropX = (lens.arrayWidth - width / scale) * 0.5;
+        cropY = (lens.arrayHeight - height / scale) * 0.5;
+    }
+
+    double toArray(double p, double crop) const {
+        return (p + 0.5) / scale - 0.5 + crop;
+    }
+
+    double toFrame(double a, double crop) const {
+        return (a - crop + 0.5) * scale - 0.5;
+    }
+};
+
+/**
+ * Where the corrected image samples the input at array pixel (x, y), by the LENS_DISTORTION equations.
+ * */
+static void distort(const LensDistortion &lens, double x, double y, double &outX, double &outY) {
+    double fx = lens.intrinsics[0], fy = lens.intrinsics[1];
+    double cx = lens.intrinsics[2], cy = lens.intrinsics[3], s = lens.intrinsics[4];
+    const float *k = lens.distortion;
+    double yi = (y - cy) / fy;
+    double xi = (x - cx - s * yi) / fx;
+    double r2 = xi * xi + yi * yi;
+    double radial = 1 + r2 * (k[0] + r2 * (k[1] + r2 * k[2]));
+    double xc = xi * radial + k[3] * 2 * xi * yi + k[4] * (r2 + 2 * xi * xi);
+    double yc = yi * radial + k[4] * 2 * xi * yi + k[3] * (r2 + 2 * yi * yi);
+    outX = fx * xc + s * yc + cx;
+    outY = fy * yc + cy;
+}
+
+LensRemap::LensRemap(const LensDistortion &lens, int width, int height)
+        : lens(lens), width(width), height(height), valid(true) {
+    // One node past the last pixel, so that every pixel is between two nodes.
+    gridColumns = ((width - 1) >> LENS_REMAP_GRID_SHIFT) + 2;
+    gridRows = ((height - 1) >> LENS_REMAP_GRID_SHIFT) + 2;
+    offsets.resize((size_t)gridColumns * gridRows * 2);
+    FrameToArray frame(lens, width, height);
+    const double limit = 32767.0 / (1 << LENS_REMAP_OFFSET_BITS);
+    for (int j = 0; j < gridRows; j++) {
+        int16_t *out = offsets.data() + (size_t)j * gridColumns * 2;
+        double y = j * LENS_REMAP_GRID_STEP;
+        for (int i = 0; i < gridColumns; i++) {
+            double x = i * LENS_REMAP_GRID_STEP;
+            double sampleX, sampleY;
+            distort(lens, frame.toArray(x, frame.cropX), frame.toArray(y, frame.cropY), sampleX, sampleY);
+            double dx = frame.toFrame(sampleX, frame.cropX) - x, dy = frame.toFrame(sampleY, frame.cropY) - y;
+            if (!(fabs(dx) < limit && fabs(dy) < limit)) {
+                valid = false;
+                dx = dy = 0;
+            }
+            out[i * 2] = (int16_t)lround(dx * (1 << LENS_REMAP_OFFSET_BITS));
+            out[i * 2 + 1] = (int16_t)lround(dy * (1 << LENS_REMAP_OFFSET_BITS));
+        }
+    }
+}
+
+bool LensRemap::matches(const LensDistortion &lens, int width, int height) const {
+    return width == this->width && height == this->height && lens.arrayWidth == this->lens.arrayWidth &&
+           lens.arrayHeight == this->lens.arrayHeight &&
+           memcmp(lens.intrinsics, this->lens.intrinsics, sizeof(lens.intrinsics)) == 0 &&
+           memcmp(lens.distortion, this->lens.distortion, sizeof(lens.distortion)) == 0;
+}
+
+void LensRemap::rowNodes(int shift, int y, int64_t *u, int64_t *v) const {
+    // Plane row y is at luma row (y << shift) + 0.5 * shift, in grid rows Q16.
+    int64_t g = (int64_t)((y << (shift + 1)) + shift) << (FRACTION_BITS - 1 - LENS_REMAP_GRID_SHIFT);
+    int j = (int)(g >> FRACTION_BITS);
+    int64_t weight = g & ((1 << FRACTION_BITS) - 1);
+    const int16_t *top = offsets.data() + (size_t)j * gridColumns * 2;
+    const int16_t *bottom = top + gridColumns * 2;
+    const int offsetShift = FRACTION_BITS - LENS_REMAP_OFFSET_BITS;
+    const int64_t nodeY = (int64_t)j << (LENS_REMAP_GRID_SHIFT + FRACTION_BITS);
+    for (int i = 0; i < gridColumns; i++) {
+        int64_t x0 = ((int64_t)i << (LENS_REMAP_GRID_SHIFT + FRACTION_BITS)) + ((int64_t)top[i * 2] << offsetShift);
+        int64_t x1 = ((int64_t)i << (LENS_REMAP_GRID_SHIFT + FRACTION_BITS)) + ((int64_t)bottom[i * 2] << offsetShift);
+        int64_t y0 = nodeY + ((int64_t)top[i * 2 + 1] << offsetShift);
+        int64_t y1 = nodeY + ((int64_t)LENS_REMAP_GRID_STEP << FRACTION_BITS) +
+                     ((int64_t)bottom[i * 2 + 1] << offsetShift);
+        int64_t x = x0 + (((x1 - x0) * weight) >> FRACTION_BITS);
+        int64_t yy = y0 + (((y1 - y0) * weight) >> FRACTION_BITS);
+        // Luma position -> plane position, chroma sample c sits at luma 2c + 0.5.
+        u[i] = (x - ((int64_t)shift << (FRACTION_BITS - 1))) >> shift;
+        v[i] = (yy - ((int64_t)shift << (FRACTION_BITS - 1))) >> shift;
+    }
+}
+
+shared_ptr<const LensRemap> lens_remap(const LensDistortion &lens, int width, int height) {
+    if (lens.intrinsics[0] <= 0 || lens.intrinsics[1] <= 0 || lens.arrayWidth <= 0 || lens.arrayHeight <= 0 ||
+        width <= 0 || height <= 0) {
+        LOGE(TAG, "invalid lens, f = %f, %f, array = %dx%d, frame = %dx%d", lens.intrinsics[0], lens.intrinsics[1],
+             lens.arrayWidth, lens.arrayHeight, width, height);
+        return nullptr;
+    }
+    lock_guard<mutex> lock(cacheMutex);
+    for (auto it = remapCache.begin(); it != remapCache.end(); it++) {
+        if ((*it)->matches(lens, width, height)) {
+            auto remap = *it;
+            remapCache.erase(it);
+            remapCache.push_front(remap);
+            return remap->isValid() ? remap : nullptr;
+        }
+    }
+    LOGD(TAG, "build lens remap, frame = %dx%d, array = %dx%d", width, height, lens.arrayWidth, lens.arrayHeight);
+    auto remap = make_shared<const LensRemap>(lens, width, height);
+    // Cached even when invalid, so the same parameters are not tried on every frame.
+    remapCache.push_front(remap);
+    if (remapCache.size() > MAX_CACHED_REMAPS) {
+        remapCache.pop_back();
+    }
+    if (!remap->isValid()) {
+        LOGE(TAG, "lens distortion moves pixels too far for the remap table");
+        return nullptr;
+    }
+    return remap;
+}
+
+/**
+ * One undistorted row of a plane, every grid interval is a warp span. nodes has room for 2 rows of nodes.
+ * */
+static void remap_row(const LensRemap &remap, const WarpSource &src, int shift, int row, int width,
+                      uint8_t borderValue, int64_t *nodes, uint8_t *out) {
+    int columns = remap.getGridColumns();
+    int64_t *u = nodes, *v = nodes + columns;
+    remap.rowNodes(shift, row, u, v);
+    const int cellPixels = LENS_REMAP_GRID_STEP >> shift;
+    // Pixel j of a cell is (j << shift) + 0.5 * shift luma pixels from the left node.
+    const int stepShift = LENS_REMAP_GRID_SHIFT - shift;
+    for (int k = 0, x = 0; x < width; k++, x += cellPixels) {
+        int64_t du = (u[k + 1] - u[k]) >> stepShift, dv = (v[k + 1] - v[k]) >> stepShift;
+        int64_t startU = u[k] + (shift ? ((u[k + 1] - u[k]) >> (LENS_REMAP_GRID_SHIFT + 1)) : 0);
+        int64_t startV = v[k] + (shift ? ((v[k + 1] - v[k]) >> (LENS_REMAP_GRID_SHIFT + 1)) : 0);
+        warp_span(src, startU, startV, du, dv, std::min(cellPixels, width - x), WARP_BORDER_CONSTANT,
+                  &borderValue, out + x);
+    }
+}
+
+bool lens_undistort_yuv420(const LensRemap &remap, const YuvFrame &src, uint8_t *y, int yRowStride,
+                           uint8_t *u, uint8_t *v, int uvRowStride, int uvPixelStride) {
+    if (src.width != remap.getWidth() || src.height != remap.getHeight()) {
+        LOGE(TAG, "frame is %dx%d, remap is for %dx%d", src.width, src.height, remap.getWidth(), remap.getHeight());
+        return false;
+    }
+    int width = src.width, height = src.height;
+    int chromaWidth = (width + 1) / 2, chromaHeight = (height + 1) / 2;
+    WarpSource planeY = {src.y, src.yRowStride, 1, width, height, 1};
+    WarpSource planeU = {src.u, src.uvRowStride, src.uvPixelStride, chromaWidth, chromaHeight, 1};
+    WarpSource planeV = {src.v, src.uvRowStride, src.uvPixelStride, chromaWidth, chromaHeight, 1};
+    parallel_for_stripes(height, MIN_STRIPE_ROWS, [&](int rowStart, int rowEnd) {
+        FrameArena scratch;
+        int64_t *nodes = scratch.alloc<int64_t>((size_t)remap.getGridColumns() * 2);
+        for (int row = rowStart; row < rowEnd; row++) {
+            remap_row(remap, planeY, 0, row, width, 0, nodes, y + (size_t)row * yRowStride);
+        }
+    });
+    parallel_for_stripes(chromaHeight, MIN_STRIPE_ROWS, [&](int rowStart, int rowEnd) {
+        FrameArena scratch;
+        int64_t *nodes = scratch.alloc<int64_t>((size_t)remap.getGridColumns() * 2);
+        // Interleaved chroma is remapped into rows of its own first.
+        uint8_t *rowU = nullptr, *rowV = nullptr;
+        if (uvPixelStride != 1) {
+            rowU = scratch.alloc<uint8_t>(chromaWidth);
+            rowV = scratch.alloc<uint8_t>(chromaWidth);
+        }
+        for (int row = rowStart; row < rowEnd; row++) {
+            uint8_t *outU = u + (size_t)row * uvRowStride, *outV = v + (size_t)row * uvRowStride;
+            remap_row(remap, planeU, 1, row, chromaWidth, CHROMA_NEUTRAL, nodes, rowU == nullptr ? outU : rowU);
+            remap_row(remap, planeV, 1, row, chromaWidth, CHROMA_NEUTRAL, nodes, rowV == nullptr ? outV : rowV);
+            if (rowU != nullptr) {
+                for (int x = 0; x < chromaWidth; x++) {
+                    outU[x * uvPixelStride] = rowU[x];
+                    outV[x * uvPixelStride] = rowV[x];
+                }
+            }
+        }
+    });
+    return true;
+}
+
+bool lens_undistort_to_rgba(const LensRemap &remap, const YuvFrame &frame, uint32_t *dst, int rotation, int facing,
+                            int precision, const Lut3D *grade) {
+    if (frame.width != remap.getWidth() || frame.height != remap.getHeight()) {
+        LOGE(TAG, "frame is %dx%d, remap is for %dx%d", frame.width, frame.height,
+             remap.getWidth(), remap.getHeight());
+        return false;
+    }
+    int width = frame.width, height = frame.height;
+    int chromaWidth = (width + 1) / 2, chromaHeight = (height + 1) / 2;
+    int origin, rowStep, colStep;
+    yuv_output_layout(width, height, rotation, facing, origin, rowStep, colStep);
+    const KernelTable &kt = kernel_table();
+    auto kernel = precision == YUV_PRECISION_HIGH ? kt.yuv420ToRgbaPrecise : kt.yuv420ToRgba;
+    WarpSource planeY = {frame.y, frame.yRowStride, 1, width, height, 1};
+    WarpSource planeU = {frame.u, frame.uvRowStride, frame.uvPixelStride, chromaWidth, chromaHeight, 1};
+    WarpSource planeV = {frame.v, frame.uvRowStride, frame.uvPixelStride, chromaWidth, chromaHeight, 1};
+    parallel_for_stripes(height, MIN_STRIPE_ROWS, [&](int rowStart, int rowEnd) {
+        FrameArena scratch;
+        int64_t *nodes = scratch.alloc<int64_t>((size_t)remap.getGridColumns() * 2);
+        uint8_t *rowY = scratch.alloc<uint8_t>(width);
+        uint8_t *rowU = scratch.alloc<uint8_t>(chromaWidth), *rowV = scratch.alloc<uint8_t>(chromaWidth);
+        uint32_t *rgba = grade != nullptr ? scratch.alloc<uint32_t>(width) : nullptr;
+        int chromaRow = -1;
+        for (int row = rowStart; row < rowEnd; row++) {
+            remap_row(remap, planeY, 0, row, width, 0, nodes, rowY);
+            if (row / 2 != chromaRow) {
+                chromaRow = row / 2;
+                remap_row(remap, planeU, 1, chromaRow, chromaWidth, CHROMA_NEUTRAL, nodes, rowU);
+                remap_row(remap, planeV, 1, chromaRow, chromaWidth, CHROMA_NEUTRAL, nodes, rowV);
+            }
+            uint32_t *out = dst + origin + row * rowStep;
+            kernel(rowY, rowU, rowV, 1, grade != nullptr ? rgba : out,
+                   grade != nullptr ? 1 : colStep, width);
+            if (grade != nullptr) {
+                kt.lut3dApply(rgba, out, colStep, width, grade->getTables());
+            }
+        }
+    });
+    return true;
+}
@@ -0,0 +1,105 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#ifndef CAMERAUTIL_LENS_DISTORTION_H
+#define CAMERAUTIL_LENS_DISTORTION_H
+
+#include "yuv_kernels.h"
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+/**
+ * 镜头畸变校正（广角、超广角镜头的桶形畸变），参数来自CameraCharacteristics的
+ * LENS_INTRINSIC_CALIBRATION和LENS_DISTORTION。按照LENS_DISTORTION的定义，畸变公式本身就是
+ * 从校正后像素到原图采样位置的映射，不需要求逆。
+ *
+ * 逐像素计算公式太慢，改为查表：每隔LENS_REMAP_GRID_STEP个像素取一个网格点，
+ * 保存该点采样位置相对自身的偏移（int16，Q5定点数），整张表对12MP只有约190KB。
+ * 使用时每行先在上下两行网格点之间垂直插值，再在相邻网格点之间用Q16定点数逐像素累加步长，
+ * 每个网格间隔就是warp.cpp的一段（warp_span），双线性插值走warp的SIMD kernel。
+ * 表按参数和画面尺寸缓存，切换摄像头或分辨率时才重建。
+ *
+ * lens_undistort_to_rgba把校正和YUV转RGBA、旋转、调色合在一起：每行先校正到缓存里的一行，
+ * 直接转换写入Bitmap，不产生整帧的中间图像。
+ * */
+
+// Grid nodes every 1 << LENS_REMAP_GRID_SHIFT pixels in both directions.
+#define LENS_REMAP_GRID_SHIFT 4
+#define LENS_REMAP_GRID_STEP (1 << LENS_REMAP_GRID_SHIFT)
+// Offsets are Q5 int16, so at most 1024 pixels.
+#define LENS_REMAP_OFFSET_BITS 5
+
+struct LensDistortion {
+    // LENS_INTRINSIC_CALIBRATION: f_x, f_y, c_x, c_y, s, in pixels of the array below
+    float intrinsics[5] = {0, 0, 0, 0, 0};
+    // LENS_DISTORTION: kappa_1, kappa_2, kappa_3 radial, kappa_4, kappa_5 tangential
+    float distortion[5] = {0, 0, 0, 0, 0};
+    // Size of the array the intrinsics refer to (SENSOR_INFO_PRE_CORRECTION_ACTIVE_ARRAY_SIZE).
+    // Frames are taken to be that array scaled down and cropped to their aspect ratio around the centre.
+    int arrayWidth = 0;
+    int arrayHeight = 0;
+};
+
+class LensRemap {
+public:
+    LensRemap(const LensDistortion &lens, int width, int height);
+    LensRemap(LensRemap &) = delete;
+
+    bool matches(const LensDistortion &lens, int width, int height) const;
+
+    /**
+     * False if a sample position is too far from its pixel for the offsets.
+     * */
+    bool isValid() const {
+        return valid;
+    }
+
+    /**
+     * Source positions of the grid nodes for image row y of a plane subsampled by shift
+     * (0 for Y, 1 for 420 chroma), Q16 in pixels of that plane. u and v have getGridColumns() elements.
+     * */
+    void rowNodes(int shift, int y, int64_t *u, int64_t *v) const;
+
+    int getGridColumns() const {
+        return gridColumns;
+    }
+
+    int getWidth() const {
+        return width;
+    }
+
+    int getHeight() const {
+        return height;
+    }
+
+private:
+    LensDistortion lens;
+    int width, height;
+    int gridColumns, gridRows;
+    bool valid;
+    // [grid row][grid column][x, y]
+    std::vector<int16_t> offsets;
+};
+
+/**
+ * Cached remap for the lens and frame size, rebuilt only when one of them changes.
+ * Return nullptr if the parameters are not usable.
+ * */
+std::shared_ptr<const LensRemap> lens_remap(const LensDistortion &lens, int width, int height);
+
+/**
+ * Undistort all planes of src (the size of remap) into y / u / v, uvPixelStride 1 for I420
+ * and 2 for NV12 / NV21. Pixels sampled from outside the frame are black.
+ * */
+bool lens_undistort_yuv420(const LensRemap &remap, const YuvFrame &src, uint8_t *y, int yRowStride,
+                           uint8_t *u, uint8_t *v, int uvRowStride, int uvPixelStride);
+
+/**
+ * yuv420_to_rgba of the undistorted frame, without building it.
+ * */
+bool lens_undistort_to_rgba(const LensRemap &remap, const YuvFrame &frame, uint32_t *dst, int rotation, int facing,
+                            int precision = YUV_PRECISION_FAST, const Lut3D *grade = nullptr);
+
+#endif //CAMERAUTIL_LENS_DISTORTION_H
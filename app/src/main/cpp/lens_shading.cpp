@@ -0,0 +1,169 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#include "lens_shading.h"
+#include "dispatch.h"
+#include "cpu_features.h"
+#include "parallel.h"
+#include "simd.h"
+#include "log.h"
+#include <math.h>
+#include <string.h>
+#include <list>
+#include <mutex>
+
+using namespace std;
+
+#define TAG "lens_shading.cpp"
+
+#define MAX_CACHED_SHADING 2
+#define MIN_STRIPE_ROWS 16
+#define GRID_FRACTION_BITS 16
+#define WEIGHT_BITS 15
+
+static mutex cacheMutex;
+static list<shared_ptr<const LensShading>> shadingCache;
+
+static inline uint8_t sat_u8(int32_t n) {
+    return (uint8_t)(n < 0 ? 0 : (n > 255 ? 255 : n));
+}
+
+static inline void lens_shading_luma_tail(int x, const uint8_t *src, uint8_t *dst, int width, const ShadingRow &row) {
+    for (; x < width; x++) {
+        int32_t gain = row.top[x] + (((row.bottom[x] - row.top[x]) * row.weight + (1 << 14)) >> WEIGHT_BITS);
+        dst[x] = sat_u8((src[x] * gain + (1 << (LENS_SHADING_GAIN_BITS - 1))) >> LENS_SHADING_GAIN_BITS);
+    }
+}
+
+static void lens_shading_luma_c(const uint8_t *src, uint8_t *dst, int width, const ShadingRow &row) {
+    lens_shading_luma_tail(0, src, dst, width, row);
+}
+
+#if SIMD_128
+static void lens_shading_luma_simd(const uint8_t *src, uint8_t *dst, int width, const ShadingRow &row) {
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        v_s16x8 top = v_load_s16x8(row.top + x);
+        v_s16x8 gain = v_add(top, v_mulhrs_n(v_sub(v_load_s16x8(row.bottom + x), top), row.weight));
+        v_s16x8 pixel = v_load_expand_s16(src + x);
+        v_s32x4 lo = v_mlal_lo(v_dup_s32(0), pixel, gain);
+        v_s32x4 hi = v_mlal_hi(v_dup_s32(0), pixel, gain);
+        v_store(dst + x, v_narrow_sat_u8(v_narrow_sat_s16(v_rshr<LENS_SHADING_GAIN_BITS>(lo),
+                                                          v_rshr<LENS_SHADING_GAIN_BITS>(hi))));
+    }
+    lens_shading_luma_tail(x, src, dst, width, row);
+}
+#endif
+
+void lens_shading_fill_kernels(KernelTable &table, uint32_t features) {
+    table.shadingLuma = lens_shading_luma_c;
+#if SIMD_128
+    if (features & SIMD_128_FEATURE) {
+        table.shadingLuma = lens_shading_luma_simd;
+    }
+#endif
+}
+
+LensShading::LensShading(const LensShadingMap &map, int width, int height, int layout)
+        : grid(map.gains, map.gains + (size_t)map.rows * map.columns * 4), columns(map.columns), rows(map.rows),
+          width(width), height(height), layout(layout) {
+    bool bayer = layout == LENS_SHADING_LAYOUT_BAYER;
+    rowLength = bayer ? width / 2 : width;
+    int planes = bayer ? 8 : 1;
+    stepY = height > 1 ? (int32_t)(((int64_t)(rows - 1) << WEIGHT_BITS) / (height - 1)) : 0;
+    gains.resize((size_t)planes * rows * rowLength);
+
+    // Grid column position of pixel x is x * stepX, Q16, stepped by pixelStep along a row.
+    int64_t stepX = width > 1 ? ((int64_t)(columns - 1) << GRID_FRACTION_BITS) / (width - 1) : 0;
+    int pixelStep = bayer ? 2 : 1;
+    const double maxGain = 32767.0 / (1 << LENS_SHADING_GAIN_BITS);
+    for (int plane = 0; plane < planes; plane++) {
+        int channel = plane / 2;
+        int parity = bayer ? plane % 2 : 0;
+        for (int j = 0; j < rows; j++) {
+            const float *points = grid.data() + (size_t)j * columns * 4;
+            int16_t *out = gains.data() + ((size_t)plane * rows + j) * rowLength;
+            int64_t u = parity * stepX;
+            for (int i = 0; i < rowLength; i++, u += pixelStep * stepX) {
+                int k = (int)(u >> GRID_FRACTION_BITS);
+                double f = (double)(u & ((1 << GRID_FRACTION_BITS) - 1)) / (1 << GRID_FRACTION_BITS);
+                if (k >= columns - 1) {
+                    k = columns - 2;
+                    f = 1.0;
+                }
+                double left, right;
+                if (bayer) {
+                    left = points[k * 4 + channel];
+                    right = points[(k + 1) * 4 + channel];
+                } else {
+                    left = (points[k * 4 + 1] + points[k * 4 + 2]) * 0.5;
+                    right = (points[(k + 1) * 4 + 1] + points[(k + 1) * 4 + 2]) * 0.5;
+                }
+                double gain = fmin(fmax(left + (right - left) * f, 0.0), maxGain);
+                out[i] = (int16_t)lround(gain * (1 << LENS_SHADING_GAIN_BITS));
+            }
+        }
+    }
+}
+
+bool LensShading::matches(const LensShadingMap &map, int width, int height, int layout) const {
+    return map.columns == columns && map.rows == rows && width == this->width && height == this->height &&
+           layout == this->layout && memcmp(map.gains, grid.data(), sizeof(float) * grid.size()) == 0;
+}
+
+ShadingRow LensShading::row(int channel, int parity, int y) const {
+    int32_t v = y * stepY;
+    int j = v >> WEIGHT_BITS;
+    int32_t weight = v & ((1 << WEIGHT_BITS) - 1);
+    if (j >= rows - 1) {
+        j = rows - 2;
+        weight = (1 << WEIGHT_BITS) - 1;
+    }
+    int plane = layout == LENS_SHADING_LAYOUT_BAYER ? channel * 2 + parity : 0;
+    ShadingRow r;
+    r.top = gains.data() + ((size_t)plane * rows + j) * rowLength;
+    r.bottom = r.top + rowLength;
+    r.weight = (int16_t)weight;
+    return r;
+}
+
+shared_ptr<const LensShading> lens_shading(const LensShadingMap &map, int width, int height, int layout) {
+    if (map.gains == nullptr || map.columns < 2 || map.rows < 2) {
+        LOGE(TAG, "invalid lens shading map %dx%d", map.columns, map.rows);
+        return nullptr;
+    }
+    lock_guard<mutex> lock(cacheMutex);
+    for (auto it = shadingCache.begin(); it != shadingCache.end(); it++) {
+        if ((*it)->matches(map, width, height, layout)) {
+            auto shading = *it;
+            shadingCache.erase(it);
+            shadingCache.push_front(shading);
+            return shading;
+        }
+    }
+    LOGD(TAG, "build lens shading gains, map = %dx%d, frame = %dx%d, layout = %d",
+         map.columns, map.rows, width, height, layout);
+    auto shading = make_shared<const LensShading>(map, width, height, layout);
+    shadingCache.push_front(shading);
+    if (shadingCache.size() > MAX_CACHED_SHADING) {
+        shadingCache.pop_back();
+    }
+    return shading;
+}
+
+bool lens_shading_apply_luma(const LensShadingMap &map, const uint8_t *src, int srcRowStride,
+                             uint8_t *dst, int dstRowStride, int width, int height) {
+    auto shading = lens_shading(map, width, height, LENS_SHADING_LAYOUT_LUMA);
+    if (!shading) {
+        return false;
+    }
+    const KernelTable &kt = kernel_table();
+    parallel_for_stripes(height, MIN_STRIPE_ROWS, [&](int rowStart, int rowEnd) {
+        for (int row = rowStart; row < rowEnd; row++) {
+            kt.shadingLuma(src + (size_t)row * srcRowStride, dst + (size_t)row * dstRowStride, width,
+                           shading->row(0, 0, row));
+        }
+    });
+    return true;
+}
@@ -0,0 +1,90 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#ifndef CAMERAUTIL_LENS_SHADING_H
+#define CAMERAUTIL_LENS_SHADING_H
+
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+/**
+ * 镜头暗角（lens shading）校正，增益来自CaptureResult.STATISTICS_LENS_SHADING_CORRECTION_MAP：
+ * rows x columns个网格点，每个点R、G_even、G_odd、B四个增益（>= 1），网格覆盖整个画面，
+ * 第一个和最后一个点分别落在第一个和最后一个像素上。
+ *
+ * 网格到像素的双线性插值拆成两步：
+ * 1. 水平方向：每个网格行插值到整行宽度，用定点数累加定位，没有除法，结果是Q12增益，
+ *    按地图内容和画面尺寸缓存，地图不变时后续帧不再计算；
+ * 2. 垂直方向：每个像素行取上下两个网格行，按一个Q15权重混合，混合和乘增益在同一个SIMD循环里完成。
+ * */
+
+// One plane of gains per channel and column parity, for the even and odd column planes of raw_pipeline.
+#define LENS_SHADING_LAYOUT_BAYER 0
+// One full width plane with the mean of the two green channels, for Y.
+#define LENS_SHADING_LAYOUT_LUMA 1
+
+// Gains are Q12, so at most 7.99.
+#define LENS_SHADING_GAIN_BITS 12
+
+struct LensShadingMap {
+    // rows * columns * 4: R, G_even, G_odd, B, row major
+    const float *gains = nullptr;
+    int columns = 0;
+    int rows = 0;
+};
+
+/**
+ * Gains of one image row: top + (bottom - top) * weight, weight is Q15 in [0, 32767].
+ * */
+struct ShadingRow {
+    const int16_t *top = nullptr;
+    const int16_t *bottom = nullptr;
+    int16_t weight = 0;
+};
+
+class LensShading {
+public:
+    LensShading(const LensShadingMap &map, int width, int height, int layout);
+    LensShading(LensShading &) = delete;
+
+    bool matches(const LensShadingMap &map, int width, int height, int layout) const;
+
+    /**
+     * Gains for image row y. channel is 0..3 (R, G_even, G_odd, B) and parity the column parity
+     * for LENS_SHADING_LAYOUT_BAYER, both 0 for LENS_SHADING_LAYOUT_LUMA.
+     * */
+    ShadingRow row(int channel, int parity, int y) const;
+
+    /**
+     * Elements in a row of gains: width / 2 for LENS_SHADING_LAYOUT_BAYER, width otherwise.
+     * */
+    int getRowLength() const {
+        return rowLength;
+    }
+
+private:
+    std::vector<float> grid;
+    int columns, rows;
+    int width, height, layout;
+    int rowLength;
+    // Image row y is between grid rows (y * stepY) >> 15 and the next one, Q15.
+    int32_t stepY;
+    // [plane][grid row][rowLength]
+    std::vector<int16_t> gains;
+};
+
+/**
+ * Cached gains for the map and frame size, rebuilt only when one of them changes.
+ * Return nullptr if the map is not valid (less than 2 x 2 points).
+ * */
+std::shared_ptr<const LensShading> lens_shading(const LensShadingMap &map, int width, int height, int layout);
+
+/**
+ * Correct an 8 bit plane (e.g. Y) into dst, src and dst may be the same. Strides in bytes.
+ * */
+bool lens_shading_apply_luma(const LensShadingMap &map, const uint8_t *src, int srcRowStride,
+                             uint8_t *dst, int dstRowStride, int width, int height);
+
+#endif //CAMERAUTIL_LENS_SHADING_H
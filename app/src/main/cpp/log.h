@@ -5,9 +5,17 @@
 #ifndef CAMERAUTIL_LOG_H
 #define CAMERAUTIL_LOG_H
 
+#if defined(__ANDROID__)
 #include <android/log.h>
 
 #define LOGD(TAG, ...) __android_log_print(ANDROID_LOG_DEBUG, TAG, __VA_ARGS__)
 #define LOGE(TAG, ...) __android_log_print(ANDROID_LOG_ERROR, TAG, __VA_ARGS__)
+#else
+// Host builds of the kernels (x86 Linux) log to stderr.
+#include <stdio.h>
+
+#define LOGD(TAG, ...) (fprintf(stderr, "D/%s: ", TAG), fprintf(stderr, __VA_ARGS__), fputc('\n', stderr))
+#define LOGE(TAG, ...) (fprintf(stderr, "E/%s: ", TAG), fprintf(stderr, __VA_ARGS__), fputc('\n', stderr))
+#endif
 
 #endif //CAMERAUTIL_LOG_H
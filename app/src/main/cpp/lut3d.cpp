@@ -0,0 +1,298 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#include "lut3d.h"
+#include "dispatch.h"
+#include "cpu_features.h"
+#include "simd.h"
+#include "log.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <string>
+
+using namespace std;
+
+#define TAG "lut3d.cpp"
+
+// 1.0 of a node value, Q4 of 8 bit
+#define NODE_ONE (255 * 16)
+// Weight (Q8) times node (Q4) gives Q12 of 8 bit.
+#define BLEND_SHIFT (LUT3D_FRACTION_BITS + 4)
+
+/**
+ * Largest and smallest axis for (f0 >= f1) | (f1 >= f2) << 1 | (f0 >= f2) << 2.
+ * 3 and 4 contradict themselves and never happen.
+ * */
+static const int8_t AXIS_ORDER[8][2] = {
+        {2, 0}, // f2 > f1 > f0
+        {2, 1}, // f2 > f0 >= f1
+        {1, 0}, // f1 >= f2 > f0
+        {0, 2},
+        {1, 2},
+        {0, 1}, // f0 >= f2 > f1
+        {1, 2}, // f1 > f0 >= f2
+        {0, 2}, // f0 >= f1 >= f2
+};
+
+static inline uint8_t clamp_u8(int32_t n) {
+    return (uint8_t)(n < 0 ? 0 : (n > 255 ? 255 : n));
+}
+
+/**
+ * The tetrahedron of the cube around pixel, as node indices and Q8 weights that sum up to 256.
+ * Each weight is repeated 4 times, so the SIMD code loads it for all channels at once.
+ * */
+static inline void tetrahedron(const Lut3dTables &t, uint32_t pixel, int32_t vertex[4], int16_t weight[4][4]) {
+    int r = pixel & 0xFF, g = (pixel >> 8) & 0xFF, b = (pixel >> 16) & 0xFF;
+    int32_t base = t.offset[0][r] + t.offset[1][g] + t.offset[2][b];
+    int f[3] = {t.fraction[0][r], t.fraction[1][g], t.fraction[2][b]};
+    // The axis with the largest fraction is stepped first and the one with the smallest last.
+    // Branch free, the order changes from pixel to pixel and would be mispredicted a lot.
+    int order = (f[0] >= f[1]) | (f[1] >= f[2]) << 1 | (f[0] >= f[2]) << 2;
+    int maxAxis = AXIS_ORDER[order][0], minAxis = AXIS_ORDER[order][1];
+    int fMax = f[maxAxis], fMin = f[minAxis];
+    int fMid = f[0] + f[1] + f[2] - fMax - fMin;
+    int32_t all = t.stride[0] + t.stride[1] + t.stride[2];
+
+    vertex[0] = base;
+    vertex[1] = base + t.stride[maxAxis];
+    vertex[2] = base + all - t.stride[minAxis];
+    vertex[3] = base + all;
+    int16_t w[4] = {(int16_t)((1 << LUT3D_FRACTION_BITS) - fMax), (int16_t)(fMax - fMid),
+                    (int16_t)(fMid - fMin), (int16_t)fMin};
+    for (int k = 0; k < 4; k++) {
+        weight[k][0] = weight[k][1] = weight[k][2] = weight[k][3] = w[k];
+    }
+}
+
+static inline uint32_t blend_pixel(const int16_t *nodes, const int32_t vertex[4], int16_t weight[4][4]) {
+    uint32_t color = 0;
+    for (int c = 0; c < 4; c++) {
+        int32_t sum = 0;
+        for (int k = 0; k < 4; k++) {
+            sum += weight[k][0] * nodes[vertex[k] * 4 + c];
+        }
+        color |= (uint32_t)clamp_u8((sum + (1 << (BLEND_SHIFT - 1))) >> BLEND_SHIFT) << (c * 8);
+    }
+    return color;
+}
+
+static void lut3d_apply_c(const uint32_t *src, uint32_t *dst, int dstStep, int width, const Lut3dTables &tables) {
+    int32_t vertex[4];
+    int16_t weight[4][4];
+    for (int col = 0; col < width; col++) {
+        tetrahedron(tables, src[col], vertex, weight);
+        dst[col * dstStep] = blend_pixel(tables.nodes, vertex, weight);
+    }
+}
+
+#if SIMD_128
+/**
+ * Two pixels per iteration, each one a half of the vector with its 4 channels.
+ * Vertex selection stays scalar, it is a different tetrahedron for every pixel.
+ * */
+static void lut3d_apply_simd(const uint32_t *src, uint32_t *dst, int dstStep, int width, const Lut3dTables &tables) {
+    const int16_t *nodes = tables.nodes;
+    int32_t vertexA[4], vertexB[4];
+    int16_t weightA[4][4], weightB[4][4];
+    uint32_t pair[2];
+    int col = 0;
+    for (; col + 2 <= width; col += 2) {
+        tetrahedron(tables, src[col], vertexA, weightA);
+        tetrahedron(tables, src[col + 1], vertexB, weightB);
+        v_s32x4 lo = v_dup_s32(0), hi = v_dup_s32(0);
+        for (int k = 0; k < 4; k++) {
+            v_s16x8 n = v_load_halves(nodes + vertexA[k] * 4, nodes + vertexB[k] * 4);
+            v_s16x8 w = v_load_halves(weightA[k], weightB[k]);
+            lo = v_mlal_lo(lo, n, w);
+            hi = v_mlal_hi(hi, n, w);
+        }
+        v_u8x8 color = v_narrow_sat_u8(v_narrow_sat_s16(v_rshr<BLEND_SHIFT>(lo), v_rshr<BLEND_SHIFT>(hi)));
+        if (dstStep == 1) {
+            v_store((uint8_t *)(dst + col), color);
+        } else {
+            v_store((uint8_t *)pair, color);
+            dst[col * dstStep] = pair[0];
+            dst[(col + 1) * dstStep] = pair[1];
+        }
+    }
+    for (; col < width; col++) {
+        tetrahedron(tables, src[col], vertexA, weightA);
+        dst[col * dstStep] = blend_pixel(nodes, vertexA, weightA);
+    }
+}
+#endif
+
+void lut3d_fill_kernels(KernelTable &table, uint32_t features) {
+    table.lut3dApply = lut3d_apply_c;
+#if SIMD_128
+    if (features & SIMD_128_FEATURE) {
+        table.lut3dApply = lut3d_apply_simd;
+    }
+#endif
+}
+
+void lut3d_apply(const Lut3D &lut, const uint32_t *src, uint32_t *dst, int dstStep, int width) {
+    kernel_table().lut3dApply(src, dst, dstStep, width, lut.getTables());
+}
+
+Lut3D::Lut3D(int size, const float *rgb, const float domainMin[3], const float domainMax[3]) : size(size) {
+    int count = size * size * size;
+    nodes.resize((size_t)count * 4);
+    for (int i = 0; i < count; i++) {
+        for (int c = 0; c < 3; c++) {
+            float value = fminf(fmaxf(rgb[i * 3 + c], 0.0f), 1.0f);
+            nodes[i * 4 + c] = (int16_t)lroundf(value * NODE_ONE);
+        }
+        nodes[i * 4 + 3] = NODE_ONE;
+    }
+    tables.nodes = nodes.data();
+    tables.stride[0] = 1;
+    tables.stride[1] = size;
+    tables.stride[2] = size * size;
+    for (int axis = 0; axis < 3; axis++) {
+        double range = domainMax[axis] - domainMin[axis];
+        for (int v = 0; v < 256; v++) {
+            double p = (v / 255.0 - domainMin[axis]) / range * (size - 1);
+            p = fmin(fmax(p, 0.0), size - 1.0);
+            int i = (int)floor(p);
+            // The last grid point is reached with a full weight from the one before.
+            i = i > size - 2 ? size - 2 : i;
+            tables.offset[axis][v] = i * tables.stride[axis];
+            tables.fraction[axis][v] = (int16_t)lround((p - i) * (1 << LUT3D_FRACTION_BITS));
+        }
+    }
+}
+
+shared_ptr<Lut3D> Lut3D::identity(int size) {
+    vector<float> rgb((size_t)size * size * size * 3);
+    float *p = rgb.data();
+    for (int b = 0; b < size; b++) {
+        for (int g = 0; g < size; g++) {
+            for (int r = 0; r < size; r++) {
+                *p++ = (float)r / (size - 1);
+                *p++ = (float)g / (size - 1);
+                *p++ = (float)b / (size - 1);
+            }
+        }
+    }
+    const float domainMin[3] = {0, 0, 0}, domainMax[3] = {1, 1, 1};
+    return make_shared<Lut3D>(size, rgb.data(), domainMin, domainMax);
+}
+
+static bool starts_with(const char *line, const char *keyword) {
+    size_t n = strlen(keyword);
+    return strncmp(line, keyword, n) == 0 && (line[n] == '\0' || isspace((unsigned char)line[n]));
+}
+
+shared_ptr<Lut3D> Lut3D::fromCube(const char *text, size_t length) {
+    string content(text, length);
+    int size = 0;
+    float domainMin[3] = {0, 0, 0}, domainMax[3] = {1, 1, 1};
+    vector<float> rgb;
+
+    int lineNumber = 0;
+    const char *p = content.c_str();
+    while (*p != '\0') {
+        const char *end = strchr(p, '\n');
+        if (end == nullptr) {
+            end = p + strlen(p);
+        }
+        string lineString(p, end);
+        p = *end == '\0' ? end : end + 1;
+        lineNumber++;
+
+        const char *line = lineString.c_str();
+        while (isspace((unsigned char)*line)) {
+            line++;
+        }
+        if (*line == '\0' || *line == '#') {
+            continue;
+        }
+        if (starts_with(line, "LUT_3D_SIZE")) {
+            if (sscanf(line + 11, "%d", &size) != 1) {
+                LOGE(TAG, "line %d: bad LUT_3D_SIZE", lineNumber);
+                return nullptr;
+            }
+            if (size < LUT3D_MIN_SIZE || size > LUT3D_MAX_SIZE) {
+                LOGE(TAG, "LUT_3D_SIZE %d not supported", size);
+                return nullptr;
+            }
+            rgb.reserve((size_t)size * size * size * 3);
+        } else if (starts_with(line, "LUT_1D_SIZE")) {
+            LOGE(TAG, "1D LUT not supported");
+            return nullptr;
+        } else if (starts_with(line, "DOMAIN_MIN")) {
+            if (sscanf(line + 10, "%f %f %f", &domainMin[0], &domainMin[1], &domainMin[2]) != 3) {
+                LOGE(TAG, "line %d: bad DOMAIN_MIN", lineNumber);
+                return nullptr;
+            }
+        } else if (starts_with(line, "DOMAIN_MAX")) {
+            if (sscanf(line + 10, "%f %f %f", &domainMax[0], &domainMax[1], &domainMax[2]) != 3) {
+                LOGE(TAG, "line %d: bad DOMAIN_MAX", lineNumber);
+                return nullptr;
+            }
+        } else if (starts_with(line, "LUT_3D_INPUT_RANGE")) {
+            // Resolve's variant of the domain, the same for all channels.
+            float min, max;
+            if (sscanf(line + 18, "%f %f", &min, &max) != 2) {
+                LOGE(TAG, "line %d: bad LUT_3D_INPUT_RANGE", lineNumber);
+                return nullptr;
+            }
+            domainMin[0] = domainMin[1] = domainMin[2] = min;
+            domainMax[0] = domainMax[1] = domainMax[2] = max;
+        } else if (isalpha((unsigned char)*line)) {
+            // TITLE and vendor keywords
+            continue;
+        } else {
+            float r, g, b;
+            if (sscanf(line, "%f %f %f", &r, &g, &b) != 3) {
+                LOGE(TAG, "line %d: expect 3 numbers", lineNumber);
+                return nullptr;
+            }
+            rgb.push_back(r);
+            rgb.push_back(g);
+            rgb.push_back(b);
+        }
+    }
+
+    if (size == 0) {
+        LOGE(TAG, "no LUT_3D_SIZE");
+        return nullptr;
+    }
+    size_t expected = (size_t)size * size * size * 3;
+    if (rgb.size() != expected) {
+        LOGE(TAG, "expect %d entries, got %d", (int)(expected / 3), (int)(rgb.size() / 3));
+        return nullptr;
+    }
+    for (int i = 0; i < 3; i++) {
+        if (!(domainMax[i] > domainMin[i])) {
+            LOGE(TAG, "empty domain on channel %d", i);
+            return nullptr;
+        }
+    }
+    return make_shared<Lut3D>(size, rgb.data(), domainMin, domainMax);
+}
+
+shared_ptr<Lut3D> Lut3D::loadCube(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (file == nullptr) {
+        LOGE(TAG, "can not open %s", path);
+        return nullptr;
+    }
+    string text;
+    char buffer[64 * 1024];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        text.append(buffer, n);
+    }
+    fclose(file);
+    auto lut = fromCube(text.data(), text.size());
+    if (lut) {
+        LOGD(TAG, "load %s, size = %d", path, lut->getSize());
+    }
+    return lut;
+}
@@ -0,0 +1,70 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#ifndef CAMERAUTIL_LUT3D_H
+#define CAMERAUTIL_LUT3D_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <memory>
+#include <vector>
+
+/**
+ * 3D LUT调色，支持Adobe/Resolve的.cube格式（LUT_3D_SIZE、DOMAIN_MIN、DOMAIN_MAX），常见的是17、33、65。
+ *
+ * 节点按(b * size + g) * size + r排列，也就是.cube文件里的顺序，每个节点是4个int16：
+ * r、g、b、a，值是8位的Q4（1.0 = 255 * 16），a固定为1.0，插值之后正好是不透明的alpha。
+ * 一个节点8字节对齐，四面体插值的每个顶点只需要一次64位加载。
+ *
+ * 输入是8位RGBA，每个轴上的格子下标和Q8小数部分预先算成256项的表，DOMAIN也算在里面。
+ * */
+
+#define LUT3D_MIN_SIZE 2
+#define LUT3D_MAX_SIZE 129
+// Interpolation weights are Q8, a full weight is 256.
+#define LUT3D_FRACTION_BITS 8
+
+struct Lut3dTables {
+    const int16_t *nodes = nullptr;
+    // Node index of the lower grid point of each 8 bit input value, axis 0 r, 1 g, 2 b
+    int32_t offset[3][256];
+    int16_t fraction[3][256];
+    // Node index distance between neighbours on each axis
+    int32_t stride[3];
+};
+
+class Lut3D {
+public:
+    /**
+     * Parse the text of a .cube file. Return nullptr and log the reason if it is not a valid 3D LUT.
+     * */
+    static std::shared_ptr<Lut3D> fromCube(const char *text, size_t length);
+
+    static std::shared_ptr<Lut3D> loadCube(const char *path);
+
+    static std::shared_ptr<Lut3D> identity(int size);
+
+    Lut3D(int size, const float *rgb, const float domainMin[3], const float domainMax[3]);
+    Lut3D(Lut3D &) = delete;
+
+    int getSize() const {
+        return size;
+    }
+
+    const Lut3dTables &getTables() const {
+        return tables;
+    }
+
+private:
+    int size;
+    std::vector<int16_t> nodes;
+    Lut3dTables tables;
+};
+
+/**
+ * Grade width RGBA pixels of src into dst, dst pixels are dstStep apart. src and dst can be the same.
+ * */
+void lut3d_apply(const Lut3D &lut, const uint32_t *src, uint32_t *dst, int dstStep, int width);
+
+#endif //CAMERAUTIL_LUT3D_H
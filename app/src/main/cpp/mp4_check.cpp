@@ -0,0 +1,705 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#include "mp4_check.h"
+#include "mp4_muxer.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+#define TAG "mp4_check.cpp"
+
+// Stop logging failures after this many, the count is still returned.
+#define MAX_LOGGED_FAILURES 32
+
+#define VIDEO_WIDTH 1920
+#define VIDEO_HEIGHT 1080
+#define VIDEO_FPS 30
+// 5 s with a key frame every second, so one fragment per second with MP4_FRAGMENT_US.
+#define VIDEO_FRAMES 150
+#define KEY_FRAME_INTERVAL 30
+#define VIDEO_ROTATION 90
+#define AUDIO_RATE 48000
+#define AUDIO_CHANNELS 2
+// 48000 Hz in the ADTS / AudioSpecificConfig table
+#define AUDIO_RATE_INDEX 3
+#define AAC_FRAME_SAMPLES 1024
+// Every few ADTS frames carries a CRC, its header is 9 bytes instead of 7.
+#define ADTS_CRC_INTERVAL 5
+// The file is read while recording after this frame, once the fragments before it are on disk.
+#define SNAPSHOT_FRAME 75
+#define SNAPSHOT_FRAGMENTS 2
+#define SNAPSHOT_TIMEOUT_MS 2000
+
+// From ISO/IEC 14496-12, written out here instead of shared with the muxer so that both can not be wrong together.
+#define SAMPLE_FLAGS_SYNC 0x02000000
+#define SAMPLE_FLAGS_NON_SYNC 0x01010000
+#define TFHD_DEFAULT_BASE_IS_MOOF 0x020000
+// data offset, sample duration, size and flags
+#define TRUN_FLAGS 0x000701
+// Bytes of a VisualSampleEntry / AudioSampleEntry before its child boxes
+#define VISUAL_ENTRY_BYTES 78
+#define AUDIO_ENTRY_BYTES 28
+
+struct Suite {
+    const char *filter;
+    int checks = 0;
+    int failures = 0;
+};
+
+static bool matchFilter(const char *name, const char *filter) {
+    return filter == nullptr || filter[0] == '\0' || strstr(name, filter) != nullptr;
+}
+
+static void check(Suite &suite, bool ok, const char *format, ...) {
+    suite.checks++;
+    if (ok) {
+        return;
+    }
+    suite.failures++;
+    if (suite.failures > MAX_LOGGED_FAILURES) {
+        return;
+    }
+    char message[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+    LOGE(TAG, "%s", message);
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static uint64_t get_u64(const uint8_t *p) {
+    return (uint64_t)get_u32(p) << 32 | get_u32(p + 4);
+}
+
+static void put_u16(vector<uint8_t> &out, size_t value) {
+    out.push_back((uint8_t)(value >> 8));
+    out.push_back((uint8_t)value);
+}
+
+static void put_u32(vector<uint8_t> &out, size_t value) {
+    put_u16(out, value >> 16);
+    put_u16(out, value & 0xFFFF);
+}
+
+class BitWriter {
+public:
+    void bits(uint32_t value, int count) {
+        for (int i = count - 1; i >= 0; i--) {
+            if (position % 8 == 0) {
+                bytes.push_back(0);
+            }
+            bytes.back() |= (uint8_t)(((value >> i) & 1) << (7 - position % 8));
+            position++;
+        }
+    }
+
+    void ue(uint32_t value) {
+        value++;
+        int length = 0;
+        while ((value >> length) > 1) {
+            length++;
+        }
+        bits(0, length);
+        bits(value, length + 1);
+    }
+
+    std::vector<uint8_t> bytes;
+
+private:
+    int position = 0;
+};
+
+/**
+ * Insert the emulation prevention bytes, so that the NAL unit never contains 00 00 00..03.
+ * */
+static vector<uint8_t> rbsp_to_nal(const vector<uint8_t> &rbsp) {
+    vector<uint8_t> nal;
+    int zeros = 0;
+    for (uint8_t b : rbsp) {
+        if (zeros >= 2 && b <= 3) {
+            nal.push_back(3);
+            zeros = 0;
+        }
+        nal.push_back(b);
+        zeros = b == 0 ? zeros + 1 : 0;
+    }
+    return nal;
+}
+
+struct VideoStream {
+    const char *name;
+    bool hevc;
+    // In the order they go in front of key frames
+    vector<vector<uint8_t>> parameterSets;
+    // avcC / hvcC written from the parameter sets by the rules of ISO/IEC 14496-15
+    vector<uint8_t> expectedConfig;
+};
+
+static VideoStream h264_stream() {
+    VideoStream stream;
+    stream.name = "h264";
+    stream.hevc = false;
+    // High profile, level 4.0
+    vector<uint8_t> sps = {0x67, 0x64, 0x00, 0x28, 0xAC, 0xD9, 0x40, 0x50, 0x05, 0xBB, 0x01, 0x10};
+    vector<uint8_t> pps = {0x68, 0xEB, 0xE3, 0xCB, 0x22, 0xC0};
+    stream.parameterSets = {sps, pps};
+    // version, profile, compatibility, level, 4 byte lengths, one SPS, one PPS
+    vector<uint8_t> &config = stream.expectedConfig;
+    config = {1, sps[1], sps[2], sps[3], 0xFF, 0xE1};
+    put_u16(config, sps.size());
+    config.insert(config.end(), sps.begin(), sps.end());
+    config.push_back(1);
+    put_u16(config, pps.size());
+    config.insert(config.end(), pps.begin(), pps.end());
+    return stream;
+}
+
+static VideoStream hevc_stream() {
+    VideoStream stream;
+    stream.name = "hevc";
+    stream.hevc = true;
+    // Main 10, level 3.1, 4:2:0 10 bit. The zero constraint flags need emulation prevention bytes.
+    BitWriter w;
+    w.bits(0, 4);
+    w.bits(0, 3);
+    w.bits(1, 1);
+    w.bits(0x02, 8);
+    w.bits(0x20000000, 32);
+    w.bits(0x9000, 16);
+    w.bits(0, 32);
+    w.bits(93, 8);
+    w.ue(0);
+    w.ue(1);
+    w.ue(VIDEO_WIDTH);
+    w.ue(VIDEO_HEIGHT);
+    w.bits(0, 1);
+    w.ue(2);
+    w.ue(2);
+    // The muxer reads no further, rbsp_stop_one_bit
+    w.bits(1, 1);
+    vector<uint8_t> vps = {0x40, 0x01, 0x0C, 0x01, 0xFF, 0xFF, 0x02, 0x20};
+    vector<uint8_t> sps = {0x42, 0x01};
+    vector<uint8_t> spsPayload = rbsp_to_nal(w.bytes);
+    sps.insert(sps.end(), spsPayload.begin(), spsPayload.end());
+    vector<uint8_t> pps = {0x44, 0x01, 0xC1, 0x72, 0xB4};
+    stream.parameterSets = {vps, sps, pps};
+
+    vector<uint8_t> &config = stream.expectedConfig;
+    // version, profile, compatibility, constraint flags, level
+    config = {1, 0x02, 0x20, 0, 0, 0, 0x90, 0, 0, 0, 0, 0, 93};
+    // min_spatial_segmentation 0, parallelism unknown, 4:2:0, 10 bit luma and chroma, no frame rate
+    const uint8_t fields[] = {0xF0, 0x00, 0xFC, 0xFD, 0xFA, 0xFA, 0x00, 0x00};
+    config.insert(config.end(), fields, fields + sizeof(fields));
+    // 1 temporal layer, nested, 4 byte lengths, then arrays of VPS, SPS and PPS
+    config.push_back(1 << 3 | 1 << 2 | 3);
+    config.push_back(3);
+    for (auto &nal : stream.parameterSets) {
+        config.push_back((uint8_t)(0x80 | nal[0] >> 1));
+        put_u16(config, 1);
+        put_u16(config, nal.size());
+        config.insert(config.end(), nal.begin(), nal.end());
+    }
+    return stream;
+}
+
+/**
+ * A slice of frame: no zero bytes except one kept 00 00 03, so that only the start codes split it.
+ * */
+static vector<uint8_t> make_slice(bool hevc, bool key, int frame) {
+    vector<uint8_t> slice(1000 + frame * 37 % 3000);
+    size_t start;
+    if (hevc) {
+        // IDR_W_RADL or TRAIL_R
+        slice[0] = key ? 19 << 1 : 1 << 1;
+        slice[1] = 1;
+        start = 2;
+    } else {
+        // IDR or non-IDR slice
+        slice[0] = key ? 0x65 : 0x41;
+        start = 1;
+    }
+    for (size_t k = start; k < slice.size(); k++) {
+        slice[k] = (uint8_t)(1 + (k * 13 + frame) % 255);
+    }
+    size_t middle = slice.size() / 2;
+    slice[middle] = 0;
+    slice[middle + 1] = 0;
+    slice[middle + 2] = 3;
+    return slice;
+}
+
+/**
+ * Append nal to an Annex B access unit and to what the muxer must store for it.
+ * */
+static void append_nal(const vector<uint8_t> &nal, bool longStartCode, vector<uint8_t> &annexB,
+                       vector<uint8_t> &lengthPrefixed) {
+    if (longStartCode) {
+        annexB.push_back(0);
+    }
+    annexB.insert(annexB.end(), {0, 0, 1});
+    annexB.insert(annexB.end(), nal.begin(), nal.end());
+    put_u32(lengthPrefixed, nal.size());
+    lengthPrefixed.insert(lengthPrefixed.end(), nal.begin(), nal.end());
+}
+
+/**
+ * An ADTS AAC LC frame around a payload of index.
+ * */
+static vector<uint8_t> make_adts(int index, vector<uint8_t> &payload) {
+    payload.resize(200 + index % 50);
+    for (size_t k = 0; k < payload.size(); k++) {
+        payload[k] = (uint8_t)(k * 7 + index);
+    }
+    bool crc = index % ADTS_CRC_INTERVAL == 0;
+    size_t length = (crc ? 9 : 7) + payload.size();
+    vector<uint8_t> frame = {0xFF, (uint8_t)(crc ? 0xF0 : 0xF1),
+                             (uint8_t)(1 << 6 | AUDIO_RATE_INDEX << 2 | AUDIO_CHANNELS >> 2),
+                             (uint8_t)((AUDIO_CHANNELS & 3) << 6 | (length >> 11 & 3)),
+                             (uint8_t)(length >> 3), (uint8_t)((length & 7) << 5 | 0x1F), 0xFC};
+    if (crc) {
+        frame.insert(frame.end(), {0x12, 0x34});
+    }
+    frame.insert(frame.end(), payload.begin(), payload.end());
+    return frame;
+}
+
+static bool read_file(const string &path, vector<uint8_t> &data) {
+    FILE *file = fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    data.resize(size > 0 ? (size_t)size : 0);
+    bool ok = fread(data.data(), 1, data.size(), file) == data.size();
+    fclose(file);
+    return ok;
+}
+
+struct Box {
+    char type[5];
+    // Offsets of the size field, of the payload after the header, and of the end
+    size_t start;
+    size_t payload;
+    size_t end;
+};
+
+/**
+ * The box at pos, which must end by end. Return false if it is cut off or malformed.
+ * */
+static bool read_box(const vector<uint8_t> &file, size_t pos, size_t end, Box &box) {
+    if (pos + 8 > end) {
+        return false;
+    }
+    uint64_t size = get_u32(&file[pos]);
+    size_t header = 8;
+    if (size == 1) {
+        if (pos + 16 > end) {
+            return false;
+        }
+        size = get_u64(&file[pos + 8]);
+        header = 16;
+    }
+    if (size < header || size > end - pos) {
+        return false;
+    }
+    memcpy(box.type, &file[pos + 4], 4);
+    box.type[4] = '\0';
+    box.start = pos;
+    box.payload = pos + header;
+    box.end = pos + size;
+    return true;
+}
+
+/**
+ * The first child of parent of type, children start skip bytes into the payload.
+ * */
+static bool find_child(const vector<uint8_t> &file, const Box &parent, size_t skip, const char *type, Box &child) {
+    size_t pos = parent.payload + skip;
+    while (pos < parent.end && read_box(file, pos, parent.end, child)) {
+        if (strcmp(child.type, type) == 0) {
+            return true;
+        }
+        pos = child.end;
+    }
+    return false;
+}
+
+/**
+ * moof + mdat pairs that are complete, for polling a file being written.
+ * */
+static int count_fragments(const vector<uint8_t> &file) {
+    int fragments = 0;
+    size_t pos = 0;
+    Box box, mdat;
+    while (read_box(file, pos, file.size(), box)) {
+        pos = box.end;
+        if (strcmp(box.type, "moof") == 0) {
+            if (!read_box(file, box.end, file.size(), mdat)) {
+                break;
+            }
+            fragments++;
+            pos = mdat.end;
+        }
+    }
+    return fragments;
+}
+
+/**
+ * What the file must hold per track (0 video, 1 audio): the stored bytes of each sample,
+ * its time in the track timescale and its flags.
+ * */
+struct Recording {
+    vector<vector<uint8_t>> samples[2];
+    vector<int64_t> times[2];
+    vector<uint32_t> flags[2];
+};
+
+static void verify_moov(Suite &suite, const char *name, const vector<uint8_t> &file, const Box &moov,
+                        const VideoStream &stream) {
+    Box mvex, child;
+    int trex = 0;
+    if (find_child(file, moov, 0, "mvex", mvex)) {
+        for (size_t pos = mvex.payload; read_box(file, pos, mvex.end, child); pos = child.end) {
+            trex += strcmp(child.type, "trex") == 0;
+        }
+    }
+    check(suite, trex == 2, "%s: moov has %d trex, expected 2", name, trex);
+
+    int tracks = 0;
+    Box trak;
+    for (size_t pos = moov.payload; read_box(file, pos, moov.end, trak); pos = trak.end) {
+        if (strcmp(trak.type, "trak") != 0) {
+            continue;
+        }
+        tracks++;
+        Box tkhd, mdia, mdhd, hdlr, minf, stbl, stsd, entry, config;
+        if (!find_child(file, trak, 0, "tkhd", tkhd) || !find_child(file, trak, 0, "mdia", mdia) ||
+            !find_child(file, mdia, 0, "mdhd", mdhd) || !find_child(file, mdia, 0, "hdlr", hdlr) ||
+            !find_child(file, mdia, 0, "minf", minf) || !find_child(file, minf, 0, "stbl", stbl) ||
+            !find_child(file, stbl, 0, "stsd", stsd)) {
+            check(suite, false, "%s: trak %d misses a box", name, tracks);
+            continue;
+        }
+        const uint8_t *header = &file[tkhd.payload];
+        bool video = memcmp(&file[hdlr.payload + 8], "vide", 4) == 0;
+        uint32_t id = get_u32(header + 12);
+        uint32_t timescale = get_u32(&file[mdhd.payload + 12]);
+        check(suite, id == (video ? 1u : 2u), "%s: %s track has id %u", name, video ? "video" : "audio", id);
+        check(suite, timescale == (video ? MP4_VIDEO_TIMESCALE : AUDIO_RATE), "%s: %s timescale %u", name,
+              video ? "video" : "audio", timescale);
+        if (video) {
+            // a b u / c d v / x y w of a 90 degree clockwise rotation
+            bool rotated = get_u32(header + 40) == 0 && get_u32(header + 44) == 0x00010000 &&
+                           get_u32(header + 52) == 0xFFFF0000 && get_u32(header + 56) == 0;
+            check(suite, rotated, "%s: tkhd matrix is not a %d degree rotation", name, VIDEO_ROTATION);
+            check(suite, get_u32(header + 76) == VIDEO_WIDTH << 16 && get_u32(header + 80) == VIDEO_HEIGHT << 16,
+                  "%s: tkhd size is not %dx%d", name, VIDEO_WIDTH, VIDEO_HEIGHT);
+            const char *entryType = stream.hevc ? "hvc1" : "avc1";
+            const char *configType = stream.hevc ? "hvcC" : "avcC";
+            bool found = find_child(file, stsd, 8, entryType, entry) &&
+                         find_child(file, entry, VISUAL_ENTRY_BYTES, configType, config);
+            check(suite, found && vector<uint8_t>(file.begin() + config.payload, file.begin() + config.end) ==
+                                  stream.expectedConfig,
+                  "%s: %s differs from the one built from the parameter sets", name, configType);
+        } else {
+            // DecoderSpecificInfo: tag, length and the AudioSpecificConfig of AAC LC, 48 kHz, stereo
+            const uint8_t specificInfo[] = {0x05, 0x02, 0x11, 0x90};
+            bool found = find_child(file, stsd, 8, "mp4a", entry) &&
+                         find_child(file, entry, AUDIO_ENTRY_BYTES, "esds", config) &&
+                         search(file.begin() + config.payload, file.begin() + config.end, specificInfo,
+                                specificInfo + sizeof(specificInfo)) != file.begin() + config.end;
+            check(suite, found, "%s: esds does not carry the AudioSpecificConfig of the ADTS stream", name);
+        }
+    }
+    check(suite, tracks == 2, "%s: moov has %d trak, expected 2", name, tracks);
+}
+
+/**
+ * Compare the samples of one fragment with the recording. next and endTime carry the position
+ * of each track from fragment to fragment.
+ * */
+static void verify_fragment(Suite &suite, const char *name, const vector<uint8_t> &file, const Box &moof,
+                            const Box &mdat, int sequence, const Recording &recording, size_t next[2],
+                            int64_t endTime[2]) {
+    Box mfhd;
+    check(suite, find_child(file, moof, 0, "mfhd", mfhd) && get_u32(&file[mfhd.payload + 4]) == (uint32_t)sequence,
+          "%s: mfhd of fragment %d does not have sequence number %d", name, sequence, sequence);
+    Box traf;
+    for (size_t pos = moof.payload; read_box(file, pos, moof.end, traf); pos = traf.end) {
+        if (strcmp(traf.type, "traf") != 0) {
+            continue;
+        }
+        Box tfhd, tfdt, trun;
+        if (!find_child(file, traf, 0, "tfhd", tfhd) || !find_child(file, traf, 0, "tfdt", tfdt) ||
+            !find_child(file, traf, 0, "trun", trun)) {
+            check(suite, false, "%s: a traf of fragment %d misses tfhd, tfdt or trun", name, sequence);
+            continue;
+        }
+        uint32_t trackId = get_u32(&file[tfhd.payload + 4]);
+        check(suite, (get_u32(&file[tfhd.payload]) & 0xFFFFFF) == TFHD_DEFAULT_BASE_IS_MOOF,
+              "%s: tfhd of fragment %d does not use default-base-is-moof", name, sequence);
+        if (trackId < 1 || trackId > 2) {
+            check(suite, false, "%s: fragment %d has track id %u", name, sequence, trackId);
+            continue;
+        }
+        int t = (int)trackId - 1;
+        check(suite, file[tfdt.payload] == 1, "%s: tfdt of fragment %d is not version 1", name, sequence);
+        auto baseTime = (int64_t)get_u64(&file[tfdt.payload + 4]);
+        // The fragment starts where the previous one of the track ended, and at its first sample.
+        if (endTime[t] >= 0) {
+            check(suite, baseTime == endTime[t], "%s: fragment %d track %u: tfdt %lld, previous fragment ended at %lld",
+                  name, sequence, trackId, (long long)baseTime, (long long)endTime[t]);
+        }
+        if (next[t] < recording.times[t].size()) {
+            check(suite, baseTime == recording.times[t][next[t]],
+                  "%s: fragment %d track %u: tfdt %lld, first sample written at %lld", name, sequence, trackId,
+                  (long long)baseTime, (long long)recording.times[t][next[t]]);
+        }
+        uint32_t trunFlags = get_u32(&file[trun.payload]) & 0xFFFFFF;
+        uint32_t count = get_u32(&file[trun.payload + 4]);
+        size_t entries = trun.payload + 12;
+        if (trunFlags != TRUN_FLAGS || entries + (size_t)count * 12 > trun.end) {
+            check(suite, false, "%s: fragment %d track %u: trun flags %06x with %u samples do not fit", name,
+                  sequence, trackId, trunFlags, count);
+            continue;
+        }
+        // Signed in version 0 as well, relative to the moof start
+        size_t data = moof.start + (int32_t)get_u32(&file[trun.payload + 8]);
+        int64_t time = baseTime;
+        int wrongData = 0, wrongDuration = 0, wrongFlags = 0;
+        for (uint32_t k = 0; k < count; k++) {
+            const uint8_t *entry = &file[entries + (size_t)k * 12];
+            uint32_t duration = get_u32(entry), size = get_u32(entry + 4), flags = get_u32(entry + 8);
+            size_t i = next[t]++;
+            if (i >= recording.samples[t].size()) {
+                check(suite, false, "%s: track %u has more samples than were written", name, trackId);
+                break;
+            }
+            const vector<uint8_t> &expected = recording.samples[t][i];
+            bool inMdat = data >= mdat.payload && data + size <= mdat.end;
+            wrongData += !inMdat || size != expected.size() || memcmp(&file[data], expected.data(), size) != 0;
+            // The last sample of the recording has nothing after it, its duration is an estimate.
+            wrongDuration += i + 1 < recording.times[t].size() &&
+                             duration != recording.times[t][i + 1] - recording.times[t][i];
+            wrongFlags += flags != recording.flags[t][i];
+            data += size;
+            time += duration;
+        }
+        check(suite, wrongData == 0 && wrongDuration == 0 && wrongFlags == 0,
+              "%s: fragment %d track %u: %d samples differ in data, %d in duration, %d in flags", name, sequence,
+              trackId, wrongData, wrongDuration, wrongFlags);
+        endTime[t] = time;
+    }
+}
+
+/**
+ * Parse the file back and compare it with the recording. complete is false for a file read while
+ * recording, where the fragment being written may be cut off. Return the number of complete fragments.
+ * */
+static int verify_file(Suite &suite, const char *name, const vector<uint8_t> &file, const VideoStream &stream,
+                       const Recording &recording, bool complete) {
+    int fragments = 0;
+    bool ftyp = false, moov = false;
+    size_t next[2] = {0, 0};
+    int64_t endTime[2] = {-1, -1};
+    size_t pos = 0;
+    Box box;
+    while (pos < file.size()) {
+        if (!read_box(file, pos, file.size(), box)) {
+            check(suite, !complete, "%s: box at %zu is cut off", name, pos);
+            break;
+        }
+        if (strcmp(box.type, "ftyp") == 0) {
+            ftyp = pos == 0 && memcmp(&file[box.payload], "isom", 4) == 0;
+        } else if (strcmp(box.type, "moov") == 0) {
+            check(suite, ftyp && fragments == 0, "%s: moov is not right after ftyp", name);
+            moov = true;
+            verify_moov(suite, name, file, box, stream);
+        } else if (strcmp(box.type, "moof") == 0) {
+            Box mdat;
+            if (!read_box(file, box.end, file.size(), mdat)) {
+                check(suite, !complete, "%s: mdat of fragment %d is cut off", name, fragments + 1);
+                break;
+            }
+            if (strcmp(mdat.type, "mdat") != 0) {
+                check(suite, false, "%s: fragment %d is followed by %s, not mdat", name, fragments + 1, mdat.type);
+                break;
+            }
+            fragments++;
+            verify_fragment(suite, name, file, box, mdat, fragments, recording, next, endTime);
+            box.end = mdat.end;
+        } else {
+            check(suite, false, "%s: unexpected top level box %s", name, box.type);
+        }
+        pos = box.end;
+    }
+    check(suite, ftyp && moov, "%s: the file does not start with an isom ftyp and a moov", name);
+    if (complete) {
+        for (int t = 0; t < 2; t++) {
+            check(suite, next[t] == recording.samples[t].size(), "%s: %zu of %zu %s samples in the file", name,
+                  next[t], recording.samples[t].size(), t == 0 ? "video" : "audio");
+        }
+    }
+    return fragments;
+}
+
+static string temp_path(int &fd) {
+    const char *dir = getenv("TMPDIR");
+    string path = string(dir != nullptr && dir[0] != '\0' ? dir : "/tmp") + "/camerautil_mp4_XXXXXX";
+    fd = mkstemp(&path[0]);
+    if (fd < 0) {
+        LOGE(TAG, "can not create %s", path.c_str());
+    }
+    return path;
+}
+
+/**
+ * Record VIDEO_FRAMES of stream with interleaved audio, read the file once while recording,
+ * then verify the snapshot and the finished file.
+ * */
+static void checkRecording(Suite &suite, const VideoStream &stream) {
+    string name = string("mp4_") + stream.name;
+    if (!matchFilter(name.c_str(), suite.filter)) {
+        return;
+    }
+    int fd;
+    string path = temp_path(fd);
+    check(suite, fd >= 0, "%s: can not create the output file", name.c_str());
+    if (fd < 0) {
+        return;
+    }
+    Mp4Muxer muxer(fd);
+    vector<uint8_t> config, unused;
+    for (auto &nal : stream.parameterSets) {
+        append_nal(nal, config.empty(), config, unused);
+    }
+    int video = muxer.addVideoTrack(stream.hevc ? MP4_CODEC_HEVC : MP4_CODEC_H264, VIDEO_WIDTH, VIDEO_HEIGHT,
+                                    config.data(), config.size());
+    // The audio config comes from the first ADTS header, as the recorder does with MediaCodec output.
+    vector<uint8_t> payload;
+    vector<uint8_t> first = make_adts(1, payload);
+    AdtsHeader adts;
+    uint8_t specificConfig[2] = {};
+    check(suite, adts_parse(first.data(), first.size(), adts), "%s: the first ADTS header does not parse",
+          name.c_str());
+    adts_audio_specific_config(adts, specificConfig);
+    int audio = muxer.addAudioTrack(AUDIO_RATE, AUDIO_CHANNELS, specificConfig, sizeof(specificConfig));
+    muxer.setRotation(VIDEO_ROTATION);
+    check(suite, video == 0 && audio == 1, "%s: track indices %d and %d", name.c_str(), video, audio);
+    check(suite, muxer.start(), "%s: start failed", name.c_str());
+
+    Recording recording;
+    vector<uint8_t> snapshot;
+    int audioFrames = 0, writeErrors = 0;
+    int64_t audioPtsUs = 0;
+    for (int frame = 0; frame < VIDEO_FRAMES; frame++) {
+        int64_t ptsUs = (int64_t)frame * 1000000 / VIDEO_FPS;
+        while (audioPtsUs <= ptsUs) {
+            vector<uint8_t> adtsFrame = make_adts(audioFrames, payload);
+            writeErrors += !muxer.writeSample(audio, adtsFrame.data(), adtsFrame.size(), audioPtsUs, true);
+            recording.samples[1].push_back(payload);
+            recording.times[1].push_back((int64_t)audioFrames * AAC_FRAME_SAMPLES);
+            recording.flags[1].push_back(SAMPLE_FLAGS_SYNC);
+            audioFrames++;
+            audioPtsUs = (int64_t)audioFrames * AAC_FRAME_SAMPLES * 1000000 / AUDIO_RATE;
+        }
+
+        bool key = frame % KEY_FRAME_INTERVAL == 0;
+        vector<uint8_t> accessUnit, stored;
+        if (key) {
+            for (auto &nal : stream.parameterSets) {
+                append_nal(nal, accessUnit.empty(), accessUnit, stored);
+            }
+        }
+        append_nal(make_slice(stream.hevc, key, frame), accessUnit.empty(), accessUnit, stored);
+        writeErrors += !muxer.writeSample(video, accessUnit.data(), accessUnit.size(), ptsUs, key);
+        recording.samples[0].push_back(stored);
+        recording.times[0].push_back((ptsUs * MP4_VIDEO_TIMESCALE + 500000) / 1000000);
+        recording.flags[0].push_back(key ? SAMPLE_FLAGS_SYNC : SAMPLE_FLAGS_NON_SYNC);
+
+        if (frame == SNAPSHOT_FRAME) {
+            // Fragments go to disk on the writer's I/O thread, wait until those finished so far are there.
+            auto deadline = chrono::steady_clock::now() + chrono::milliseconds(SNAPSHOT_TIMEOUT_MS);
+            while (read_file(path, snapshot) && count_fragments(snapshot) < SNAPSHOT_FRAGMENTS &&
+                   chrono::steady_clock::now() < deadline) {
+                this_thread::sleep_for(chrono::milliseconds(10));
+            }
+        }
+    }
+    check(suite, writeErrors == 0, "%s: %d writeSample calls failed", name.c_str(), writeErrors);
+    check(suite, muxer.stop(), "%s: stop failed", name.c_str());
+
+    // As if the process died after SNAPSHOT_FRAME: every complete fragment must still be intact.
+    int snapshotFragments = verify_file(suite, (name + " snapshot").c_str(), snapshot, stream, recording, false);
+    check(suite, snapshotFragments == SNAPSHOT_FRAGMENTS, "%s: %d fragments while recording, expected %d",
+          name.c_str(), snapshotFragments, SNAPSHOT_FRAGMENTS);
+
+    vector<uint8_t> file;
+    check(suite, read_file(path, file), "%s: can not read the output file", name.c_str());
+    unlink(path.c_str());
+    int fragments = verify_file(suite, name.c_str(), file, stream, recording, true);
+    check(suite, fragments == VIDEO_FRAMES / KEY_FRAME_INTERVAL, "%s: %d fragments, expected %d", name.c_str(),
+          fragments, VIDEO_FRAMES / KEY_FRAME_INTERVAL);
+    LOGD(TAG, "%s: %zu bytes, %d fragments, %zu video and %zu audio samples", name.c_str(), file.size(), fragments,
+         recording.samples[0].size(), recording.samples[1].size());
+}
+
+/**
+ * ADTS headers with and without CRC, and what is not one.
+ * */
+static void checkAdts(Suite &suite) {
+    const char *name = "mp4_adts";
+    if (!matchFilter(name, suite.filter)) {
+        return;
+    }
+    vector<uint8_t> payload;
+    for (int index = 0; index < 2; index++) {
+        vector<uint8_t> frame = make_adts(index, payload);
+        AdtsHeader header;
+        bool parsed = adts_parse(frame.data(), frame.size(), header);
+        int headerBytes = index % ADTS_CRC_INTERVAL == 0 ? 9 : 7;
+        check(suite, parsed && header.profile == 2 && header.sampleRate == AUDIO_RATE &&
+                     header.channels == AUDIO_CHANNELS && header.headerBytes == headerBytes &&
+                     header.frameBytes == (int)frame.size(),
+              "%s: header of %d bytes parsed wrong", name, headerBytes);
+        uint8_t config[2];
+        adts_audio_specific_config(header, config);
+        check(suite, config[0] == 0x11 && config[1] == 0x90, "%s: AudioSpecificConfig %02x %02x, expected 11 90",
+              name, config[0], config[1]);
+        frame[0] = 0xFE;
+        check(suite, !adts_parse(frame.data(), frame.size(), header), "%s: a frame without sync word parsed", name);
+        check(suite, !adts_parse(frame.data() + 1, 6, header), "%s: a 6 byte header parsed", name);
+    }
+}
+
+int run_mp4_check(const char *filter) {
+    Suite suite;
+    suite.filter = filter;
+    checkAdts(suite);
+    checkRecording(suite, h264_stream());
+    checkRecording(suite, hevc_stream());
+    if (suite.failures > 0) {
+        LOGE(TAG, "%d of %d checks failed", suite.failures, suite.checks);
+    } else {
+        LOGD(TAG, "all %d checks passed", suite.checks);
+    }
+    return suite.failures;
+}
@@ -0,0 +1,25 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#ifndef CAMERAUTIL_MP4_CHECK_H
+#define CAMERAUTIL_MP4_CHECK_H
+
+/**
+ * 分片MP4封装的自测，不需要编码器，在Linux主机上运行（camerautil_host mp4）。
+ *
+ * 输入是合成的Annex B H.264 / HEVC码流（参数集、3字节和4字节起始码混用、带防竞争字节的slice）
+ * 和ADTS AAC帧（有无CRC都有），写完后把文件按box解析回来检查：
+ * 1. ftyp、moov中的轨道、旋转矩阵、时间刻度，avcC / hvcC与按规范独立拼出的字节相同，esds中是ADTS得到的AudioSpecificConfig；
+ * 2. 每个moof + mdat：mfhd序号从1连续递增，每条轨道的tfdt等于上一个分片的tfdt加上样本时长之和，
+ *    也等于第一个样本的时间；
+ * 3. 按trun的data offset、样本大小逐个取出样本，与写入的样本（视频换成4字节长度，音频去掉ADTS头）
+ *    逐字节比较，时长和关键帧标志正确；
+ * 4. 录制中途读取文件（模拟崩溃），已完成的分片都能完整解析。
+ *
+ * 临时文件写在$TMPDIR（默认/tmp）下，结束后删除。
+ * filter为空时运行全部测试，否则只运行名字中包含filter的测试。返回失败的检查数，0表示全部通过。
+ * */
+int run_mp4_check(const char *filter);
+
+#endif //CAMERAUTIL_MP4_CHECK_H
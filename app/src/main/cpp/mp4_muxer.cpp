@@ -0,0 +1,733 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#include "mp4_muxer.h"
+#include "log.h"
+#include "trace.h"
+#include <string.h>
+#include <algorithm>
+
+using namespace std;
+
+#define TAG "mp4_muxer.cpp"
+
+#define H264_NAL_SPS 7
+#define H264_NAL_PPS 8
+#define HEVC_NAL_VPS 32
+#define HEVC_NAL_SPS 33
+#define HEVC_NAL_PPS 34
+
+// trun sample flags: sync sample, and non sync sample that depends on others
+#define SAMPLE_FLAGS_SYNC 0x02000000
+#define SAMPLE_FLAGS_NON_SYNC 0x01010000
+
+#define TFHD_DEFAULT_BASE_IS_MOOF 0x020000
+#define TRUN_DATA_OFFSET 0x000001
+#define TRUN_SAMPLE_DURATION 0x000100
+#define TRUN_SAMPLE_SIZE 0x000200
+#define TRUN_SAMPLE_FLAGS 0x000400
+
+static const int ADTS_SAMPLE_RATES[16] = {96000, 88200, 64000, 48000, 44100, 32000, 24000, 22050,
+                                          16000, 12000, 11025, 8000, 7350, 0, 0, 0};
+
+static inline void put_u8(vector<uint8_t> &out, uint32_t n) {
+    out.push_back((uint8_t)n);
+}
+
+static inline void put_u16(vector<uint8_t> &out, uint32_t n) {
+    out.push_back((uint8_t)(n >> 8));
+    out.push_back((uint8_t)n);
+}
+
+static inline void put_u24(vector<uint8_t> &out, uint32_t n) {
+    out.push_back((uint8_t)(n >> 16));
+    put_u16(out, n);
+}
+
+static inline void put_u32(vector<uint8_t> &out, uint32_t n) {
+    put_u16(out, n >> 16);
+    put_u16(out, n);
+}
+
+static inline void put_u64(vector<uint8_t> &out, uint64_t n) {
+    put_u32(out, (uint32_t)(n >> 32));
+    put_u32(out, (uint32_t)n);
+}
+
+static inline void put_bytes(vector<uint8_t> &out, const void *data, size_t size) {
+    out.insert(out.end(), (const uint8_t *)data, (const uint8_t *)data + size);
+}
+
+static inline void put_zeros(vector<uint8_t> &out, size_t size) {
+    out.insert(out.end(), size, 0);
+}
+
+static inline void set_u32(vector<uint8_t> &out, size_t at, uint32_t n) {
+    out[at] = (uint8_t)(n >> 24);
+    out[at + 1] = (uint8_t)(n >> 16);
+    out[at + 2] = (uint8_t)(n >> 8);
+    out[at + 3] = (uint8_t)n;
+}
+
+/**
+ * Start a box, return its offset for end_box to fill in the size.
+ * */
+static size_t begin_box(vector<uint8_t> &out, const char *type) {
+    size_t at = out.size();
+    put_u32(out, 0);
+    put_bytes(out, type, 4);
+    return at;
+}
+
+static size_t begin_full_box(vector<uint8_t> &out, const char *type, int version, uint32_t flags) {
+    size_t at = begin_box(out, type);
+    put_u32(out, (uint32_t)version << 24 | flags);
+    return at;
+}
+
+static void end_box(vector<uint8_t> &out, size_t at) {
+    set_u32(out, at, (uint32_t)(out.size() - at));
+}
+
+/**
+ * Length of the Annex B start code at data, 0 if there is none.
+ * */
+static int start_code_length(const uint8_t *data, size_t size) {
+    if (size >= 3 && data[0] == 0 && data[1] == 0 && data[2] == 1) {
+        return 3;
+    }
+    if (size >= 4 && data[0] == 0 && data[1] == 0 && data[2] == 0 && data[3] == 1) {
+        return 4;
+    }
+    return 0;
+}
+
+/**
+ * Offset of the next 00 00 01 from from, size if there is none. memchr does the scanning,
+ * video frames are hundreds of KB.
+ * */
+static size_t find_start_code(const uint8_t *data, size_t size, size_t from) {
+    size_t i = from + 2;
+    while (i < size) {
+        const uint8_t *one = (const uint8_t *)memchr(data + i, 1, size - i);
+        if (one == nullptr) {
+            return size;
+        }
+        i = (size_t)(one - data);
+        if (data[i - 1] == 0 && data[i - 2] == 0) {
+            return i - 2;
+        }
+        i++;
+    }
+    return size;
+}
+
+/**
+ * Find the next NAL unit of an Annex B stream from pos. Return false at the end.
+ * */
+static bool next_nal(const uint8_t *data, size_t size, size_t &pos, const uint8_t *&nal, size_t &nalSize) {
+    while (true) {
+        size_t start = find_start_code(data, size, pos);
+        if (start >= size) {
+            return false;
+        }
+        start += 3;
+        pos = find_start_code(data, size, start);
+        nal = data + start;
+        nalSize = pos - start;
+        // Trailing zero bytes belong to the next 4 byte start code.
+        while (nalSize > 0 && nal[nalSize - 1] == 0) {
+            nalSize--;
+        }
+        if (nalSize > 0) {
+            return true;
+        }
+    }
+}
+
+class BitReader {
+public:
+    BitReader(const uint8_t *data, size_t size) : data(data), size(size) {}
+
+    uint32_t bits(int n) {
+        uint32_t value = 0;
+        for (int i = 0; i < n; i++) {
+            uint32_t bit = 0;
+            if (position < size * 8) {
+                bit = (data[position >> 3] >> (7 - (position & 7))) & 1;
+            }
+            position++;
+            value = value << 1 | bit;
+        }
+        return value;
+    }
+
+    uint32_t ue() {
+        int zeros = 0;
+        while (bits(1) == 0 && zeros < 32) {
+            zeros++;
+        }
+        return (1u << zeros) - 1 + bits(zeros);
+    }
+
+    void skip(size_t n) {
+        position += n;
+    }
+
+private:
+    const uint8_t *data;
+    size_t size;
+    size_t position = 0;
+};
+
+/**
+ * Drop the emulation prevention bytes (00 00 03) of a NAL unit.
+ * */
+static vector<uint8_t> nal_to_rbsp(const uint8_t *nal, size_t size) {
+    vector<uint8_t> rbsp;
+    rbsp.reserve(size);
+    int zeros = 0;
+    for (size_t i = 0; i < size; i++) {
+        if (zeros >= 2 && nal[i] == 3) {
+            zeros = 0;
+            continue;
+        }
+        zeros = nal[i] == 0 ? zeros + 1 : 0;
+        rbsp.push_back(nal[i]);
+    }
+    return rbsp;
+}
+
+static bool build_avcc(const uint8_t *config, size_t size, vector<uint8_t> &avcc) {
+    vector<pair<const uint8_t *, size_t>> sps, pps;
+    size_t pos = 0;
+    const uint8_t *nal;
+    size_t nalSize;
+    while (next_nal(config, size, pos, nal, nalSize)) {
+        int type = nal[0] & 0x1F;
+        if (type == H264_NAL_SPS && nalSize >= 4) {
+            sps.emplace_back(nal, nalSize);
+        } else if (type == H264_NAL_PPS) {
+            pps.emplace_back(nal, nalSize);
+        }
+    }
+    if (sps.empty() || pps.empty()) {
+        LOGE(TAG, "H.264 config has %zu SPS and %zu PPS", sps.size(), pps.size());
+        return false;
+    }
+    avcc.clear();
+    put_u8(avcc, 1);
+    put_bytes(avcc, sps[0].first + 1, 3);
+    // 4 byte NAL lengths
+    put_u8(avcc, 0xFF);
+    put_u8(avcc, 0xE0 | (uint32_t)sps.size());
+    for (auto &s : sps) {
+        put_u16(avcc, (uint32_t)s.second);
+        put_bytes(avcc, s.first, s.second);
+    }
+    put_u8(avcc, (uint32_t)pps.size());
+    for (auto &p : pps) {
+        put_u16(avcc, (uint32_t)p.second);
+        put_bytes(avcc, p.first, p.second);
+    }
+    return true;
+}
+
+static bool build_hvcc(const uint8_t *config, size_t size, vector<uint8_t> &hvcc) {
+    vector<pair<const uint8_t *, size_t>> arrays[3];
+    size_t pos = 0;
+    const uint8_t *nal;
+    size_t nalSize;
+    while (next_nal(config, size, pos, nal, nalSize)) {
+        int type = (nal[0] >> 1) & 0x3F;
+        if (type >= HEVC_NAL_VPS && type <= HEVC_NAL_PPS && nalSize > 2) {
+            arrays[type - HEVC_NAL_VPS].emplace_back(nal, nalSize);
+        }
+    }
+    if (arrays[0].empty() || arrays[1].empty() || arrays[2].empty()) {
+        LOGE(TAG, "HEVC config has %zu VPS, %zu SPS and %zu PPS", arrays[0].size(), arrays[1].size(),
+             arrays[2].size());
+        return false;
+    }
+
+    // profile_tier_level and the format fields of the SPS, after the 2 byte NAL header.
+    vector<uint8_t> rbsp = nal_to_rbsp(arrays[1][0].first + 2, arrays[1][0].second - 2);
+    BitReader reader(rbsp.data(), rbsp.size());
+    reader.bits(4);
+    int maxSubLayersMinus1 = (int)reader.bits(3);
+    int temporalIdNesting = (int)reader.bits(1);
+    uint32_t profile = reader.bits(8);
+    uint32_t compatibility = reader.bits(32);
+    uint64_t constraints = (uint64_t)reader.bits(16) << 32 | reader.bits(32);
+    uint32_t level = reader.bits(8);
+    int subLayerProfile[8] = {0}, subLayerLevel[8] = {0};
+    for (int i = 0; i < maxSubLayersMinus1; i++) {
+        subLayerProfile[i] = (int)reader.bits(1);
+        subLayerLevel[i] = (int)reader.bits(1);
+    }
+    if (maxSubLayersMinus1 > 0) {
+        reader.skip((size_t)(8 - maxSubLayersMinus1) * 2);
+    }
+    for (int i = 0; i < maxSubLayersMinus1; i++) {
+        reader.skip(subLayerProfile[i] ? 88 : 0);
+        reader.skip(subLayerLevel[i] ? 8 : 0);
+    }
+    reader.ue();
+    uint32_t chromaFormat = reader.ue();
+    if (chromaFormat == 3) {
+        reader.bits(1);
+    }
+    reader.ue();
+    reader.ue();
+    if (reader.bits(1)) {
+        reader.ue();
+        reader.ue();
+        reader.ue();
+        reader.ue();
+    }
+    uint32_t lumaBitDepthMinus8 = reader.ue();
+    uint32_t chromaBitDepthMinus8 = reader.ue();
+
+    hvcc.clear();
+    put_u8(hvcc, 1);
+    put_u8(hvcc, profile);
+    put_u32(hvcc, compatibility);
+    put_u16(hvcc, (uint32_t)(constraints >> 32));
+    put_u32(hvcc, (uint32_t)constraints);
+    put_u8(hvcc, level);
+    // min_spatial_segmentation_idc 0, parallelismType 0
+    put_u16(hvcc, 0xF000);
+    put_u8(hvcc, 0xFC);
+    put_u8(hvcc, 0xFC | (chromaFormat & 3));
+    put_u8(hvcc, 0xF8 | (lumaBitDepthMinus8 & 7));
+    put_u8(hvcc, 0xF8 | (chromaBitDepthMinus8 & 7));
+    // avgFrameRate unknown, constantFrameRate 0, 4 byte NAL lengths
+    put_u16(hvcc, 0);
+    put_u8(hvcc, (uint32_t)(maxSubLayersMinus1 + 1) << 3 | (uint32_t)temporalIdNesting << 2 | 3);
+    put_u8(hvcc, 3);
+    for (int i = 0; i < 3; i++) {
+        put_u8(hvcc, 0x80 | (HEVC_NAL_VPS + i));
+        put_u16(hvcc, (uint32_t)arrays[i].size());
+        for (auto &n : arrays[i]) {
+            put_u16(hvcc, (uint32_t)n.second);
+            put_bytes(hvcc, n.first, n.second);
+        }
+    }
+    return true;
+}
+
+bool adts_parse(const uint8_t *data, size_t size, AdtsHeader &header) {
+    if (size < 7 || data[0] != 0xFF || (data[1] & 0xF6) != 0xF0) {
+        return false;
+    }
+    header.profile = (data[2] >> 6) + 1;
+    header.sampleRateIndex = (data[2] >> 2) & 0xF;
+    header.sampleRate = ADTS_SAMPLE_RATES[header.sampleRateIndex];
+    header.channels = (data[2] & 1) << 2 | data[3] >> 6;
+    // No CRC when protection_absent is set.
+    header.headerBytes = (data[1] & 1) ? 7 : 9;
+    header.frameBytes = (data[3] & 3) << 11 | data[4] << 3 | data[5] >> 5;
+    return header.sampleRate > 0 && header.frameBytes >= header.headerBytes;
+}
+
+void adts_audio_specific_config(const AdtsHeader &header, uint8_t config[2]) {
+    config[0] = (uint8_t)(header.profile << 3 | header.sampleRateIndex >> 1);
+    config[1] = (uint8_t)((header.sampleRateIndex & 1) << 7 | header.channels << 3);
+}
+
+/**
+ * Display matrix of tkhd, the same values MediaMuxer.setOrientationHint writes.
+ * */
+static void put_matrix(vector<uint8_t> &out, int rotation) {
+    const uint32_t one = 0x00010000, minusOne = 0xFFFF0000;
+    uint32_t a = one, b = 0, c = 0, d = one;
+    if (rotation == 90) {
+        a = 0, b = one, c = minusOne, d = 0;
+    } else if (rotation == 180) {
+        a = minusOne, d = minusOne;
+    } else if (rotation == 270) {
+        a = 0, b = minusOne, c = one, d = 0;
+    }
+    const uint32_t matrix[9] = {a, b, 0, c, d, 0, 0, 0, 0x40000000};
+    for (uint32_t m : matrix) {
+        put_u32(out, m);
+    }
+}
+
+Mp4Muxer::Mp4Muxer(int fd, int64_t fragmentDurationUs)
+        : writer(new AsyncFileWriter(fd)), fragmentDurationUs(fragmentDurationUs) {
+}
+
+Mp4Muxer::~Mp4Muxer() {
+    stop();
+}
+
+int Mp4Muxer::addVideoTrack(Mp4Codec codec, int width, int height, const uint8_t *config, size_t configSize) {
+    lock_guard<std::mutex> lock(mutex);
+    if (started || videoTrack >= 0) {
+        LOGE(TAG, "can not add a video track now");
+        return -1;
+    }
+    Track track;
+    track.codec = codec;
+    track.width = width;
+    track.height = height;
+    track.timescale = MP4_VIDEO_TIMESCALE;
+    track.lastDuration = MP4_VIDEO_TIMESCALE / 30;
+    bool built = codec == MP4_CODEC_HEVC ? build_hvcc(config, configSize, track.config)
+                                         : build_avcc(config, configSize, track.config);
+    if (codec == MP4_CODEC_AAC || !built) {
+        return -1;
+    }
+    tracks.push_back(std::move(track));
+    videoTrack = (int)tracks.size() - 1;
+    return videoTrack;
+}
+
+int Mp4Muxer::addAudioTrack(int sampleRate, int channels, const uint8_t *config, size_t configSize) {
+    lock_guard<std::mutex> lock(mutex);
+    if (started || configSize < 2) {
+        LOGE(TAG, "can not add an audio track, started = %d, config size = %zu", started, configSize);
+        return -1;
+    }
+    Track track;
+    track.codec = MP4_CODEC_AAC;
+    track.sampleRate = sampleRate;
+    track.channels = channels;
+    track.timescale = (uint32_t)sampleRate;
+    // AAC frames are 1024 samples
+    track.lastDuration = 1024;
+    track.config.assign(config, config + configSize);
+    tracks.push_back(std::move(track));
+    return (int)tracks.size() - 1;
+}
+
+void Mp4Muxer::setRotation(int degrees) {
+    rotation = ((degrees % 360) + 360) % 360;
+}
+
+bool Mp4Muxer::start() {
+    lock_guard<std::mutex> lock(mutex);
+    if (started || tracks.empty() || writer == nullptr) {
+        return false;
+    }
+    header.clear();
+    size_t ftyp = begin_box(header, "ftyp");
+    put_bytes(header, "isom", 4);
+    put_u32(header, 0x200);
+    put_bytes(header, "isomiso6mp41", 12);
+    end_box(header, ftyp);
+    writeMoov(header);
+    started = true;
+    return writer->write(header.data(), header.size()) && writer->flush(false);
+}
+
+void Mp4Muxer::writeMoov(vector<uint8_t> &out) {
+    size_t moov = begin_box(out, "moov");
+    size_t mvhd = begin_full_box(out, "mvhd", 0, 0);
+    // creation and modification time, timescale 1 ms, duration unknown
+    put_u32(out, 0);
+    put_u32(out, 0);
+    put_u32(out, 1000);
+    put_u32(out, 0);
+    put_u32(out, 0x00010000);
+    put_u16(out, 0x0100);
+    put_zeros(out, 10);
+    put_matrix(out, 0);
+    put_zeros(out, 24);
+    put_u32(out, (uint32_t)tracks.size() + 1);
+    end_box(out, mvhd);
+    for (int i = 0; i < (int)tracks.size(); i++) {
+        writeTrak(out, i);
+    }
+    size_t mvex = begin_box(out, "mvex");
+    for (int i = 0; i < (int)tracks.size(); i++) {
+        size_t trex = begin_full_box(out, "trex", 0, 0);
+        put_u32(out, (uint32_t)i + 1);
+        put_u32(out, 1);
+        put_u32(out, 0);
+        put_u32(out, 0);
+        put_u32(out, 0);
+        end_box(out, trex);
+    }
+    end_box(out, mvex);
+    end_box(out, moov);
+}
+
+void Mp4Muxer::writeTrak(vector<uint8_t> &out, int index) {
+    const Track &track = tracks[index];
+    bool video = track.codec != MP4_CODEC_AAC;
+    size_t trak = begin_box(out, "trak");
+
+    // enabled, in movie
+    size_t tkhd = begin_full_box(out, "tkhd", 0, 3);
+    put_u32(out, 0);
+    put_u32(out, 0);
+    put_u32(out, (uint32_t)index + 1);
+    put_u32(out, 0);
+    put_u32(out, 0);
+    put_zeros(out, 8);
+    put_u16(out, 0);
+    put_u16(out, 0);
+    put_u16(out, video ? 0 : 0x0100);
+    put_u16(out, 0);
+    put_matrix(out, video ? rotation : 0);
+    put_u32(out, (uint32_t)track.width << 16);
+    put_u32(out, (uint32_t)track.height << 16);
+    end_box(out, tkhd);
+
+    size_t mdia = begin_box(out, "mdia");
+    size_t mdhd = begin_full_box(out, "mdhd", 0, 0);
+    put_u32(out, 0);
+    put_u32(out, 0);
+    put_u32(out, track.timescale);
+    put_u32(out, 0);
+    // "und"
+    put_u16(out, 0x55C4);
+    put_u16(out, 0);
+    end_box(out, mdhd);
+
+    size_t hdlr = begin_full_box(out, "hdlr", 0, 0);
+    put_u32(out, 0);
+    put_bytes(out, video ? "vide" : "soun", 4);
+    put_zeros(out, 12);
+    const char *name = video ? "VideoHandle" : "SoundHandle";
+    put_bytes(out, name, strlen(name) + 1);
+    end_box(out, hdlr);
+
+    size_t minf = begin_box(out, "minf");
+    if (video) {
+        size_t vmhd = begin_full_box(out, "vmhd", 0, 1);
+        put_zeros(out, 8);
+        end_box(out, vmhd);
+    } else {
+        size_t smhd = begin_full_box(out, "smhd", 0, 0);
+        put_zeros(out, 4);
+        end_box(out, smhd);
+    }
+    size_t dinf = begin_box(out, "dinf");
+    size_t dref = begin_full_box(out, "dref", 0, 0);
+    put_u32(out, 1);
+    // Media data is in this file.
+    size_t url = begin_full_box(out, "url ", 0, 1);
+    end_box(out, url);
+    end_box(out, dref);
+    end_box(out, dinf);
+
+    size_t stbl = begin_box(out, "stbl");
+    size_t stsd = begin_full_box(out, "stsd", 0, 0);
+    put_u32(out, 1);
+    if (video) {
+        bool hevc = track.codec == MP4_CODEC_HEVC;
+        size_t entry = begin_box(out, hevc ? "hvc1" : "avc1");
+        put_zeros(out, 6);
+        put_u16(out, 1);
+        put_zeros(out, 16);
+        put_u16(out, (uint32_t)track.width);
+        put_u16(out, (uint32_t)track.height);
+        // 72 dpi
+        put_u32(out, 0x00480000);
+        put_u32(out, 0x00480000);
+        put_u32(out, 0);
+        put_u16(out, 1);
+        put_zeros(out, 32);
+        put_u16(out, 0x0018);
+        put_u16(out, 0xFFFF);
+        size_t config = begin_box(out, hevc ? "hvcC" : "avcC");
+        put_bytes(out, track.config.data(), track.config.size());
+        end_box(out, config);
+        end_box(out, entry);
+    } else {
+        size_t entry = begin_box(out, "mp4a");
+        put_zeros(out, 6);
+        put_u16(out, 1);
+        put_zeros(out, 8);
+        put_u16(out, (uint32_t)track.channels);
+        put_u16(out, 16);
+        put_u32(out, 0);
+        put_u32(out, (uint32_t)track.sampleRate << 16);
+
+        size_t esds = begin_full_box(out, "esds", 0, 0);
+        uint32_t configSize = (uint32_t)track.config.size();
+        // ES_Descriptor > DecoderConfigDescriptor > DecoderSpecificInfo, then SLConfigDescriptor
+        put_u8(out, 0x03);
+        put_u8(out, 3 + 2 + 13 + 2 + configSize + 3);
+        put_u16(out, 0);
+        put_u8(out, 0);
+        put_u8(out, 0x04);
+        put_u8(out, 13 + 2 + configSize);
+        // MPEG-4 audio, audio stream
+        put_u8(out, 0x40);
+        put_u8(out, 0x15);
+        put_u24(out, 0);
+        put_u32(out, 0);
+        put_u32(out, 0);
+        put_u8(out, 0x05);
+        put_u8(out, configSize);
+        put_bytes(out, track.config.data(), configSize);
+        put_u8(out, 0x06);
+        put_u8(out, 1);
+        put_u8(out, 0x02);
+        end_box(out, esds);
+        end_box(out, entry);
+    }
+    end_box(out, stsd);
+    // The sample tables are empty, samples are in the fragments.
+    size_t stts = begin_full_box(out, "stts", 0, 0);
+    put_u32(out, 0);
+    end_box(out, stts);
+    size_t stsc = begin_full_box(out, "stsc", 0, 0);
+    put_u32(out, 0);
+    end_box(out, stsc);
+    size_t stsz = begin_full_box(out, "stsz", 0, 0);
+    put_u32(out, 0);
+    put_u32(out, 0);
+    end_box(out, stsz);
+    size_t stco = begin_full_box(out, "stco", 0, 0);
+    put_u32(out, 0);
+    end_box(out, stco);
+    end_box(out, stbl);
+    end_box(out, minf);
+    end_box(out, mdia);
+    end_box(out, trak);
+}
+
+bool Mp4Muxer::writeSample(int track, const uint8_t *data, size_t size, int64_t ptsUs, bool keyFrame) {
+    TRACE_SCOPE("mux sample");
+    lock_guard<std::mutex> lock(mutex);
+    if (!started || writer == nullptr || track < 0 || track >= (int)tracks.size() || size == 0) {
+        return false;
+    }
+    Track &t = tracks[track];
+    bool video = track == videoTrack;
+    if (video && t.startPtsUs < 0 && !keyFrame) {
+        // Decoding starts at a key frame.
+        return true;
+    }
+    if (t.startPtsUs < 0) {
+        t.startPtsUs = ptsUs;
+    }
+    // Rounded, so that AAC frame times at 1 us precision come back as whole multiples of 1024.
+    int64_t time = ((ptsUs - t.startPtsUs) * t.timescale + 500000) / 1000000;
+
+    // Fragments start at video key frames, or anywhere without video.
+    bool canCut = videoTrack < 0 || (video && keyFrame);
+    if (canCut && fragmentStartUs >= 0 && ptsUs - fragmentStartUs >= fragmentDurationUs) {
+        t.nextTime = time;
+        if (!writeFragment(true)) {
+            return false;
+        }
+    }
+    if (fragmentStartUs < 0) {
+        fragmentStartUs = ptsUs;
+    }
+
+    size_t start = t.data.size();
+    if (video && start_code_length(data, size) > 0) {
+        // Annex B to 4 byte lengths
+        size_t pos = 0;
+        const uint8_t *nal;
+        size_t nalSize;
+        while (next_nal(data, size, pos, nal, nalSize)) {
+            put_u32(t.data, (uint32_t)nalSize);
+            put_bytes(t.data, nal, nalSize);
+        }
+    } else {
+        AdtsHeader adts;
+        size_t skip = !video && adts_parse(data, size, adts) ? adts.headerBytes : 0;
+        put_bytes(t.data, data + skip, size - skip);
+    }
+    Sample sample;
+    sample.size = (uint32_t)(t.data.size() - start);
+    sample.flags = !video || keyFrame ? SAMPLE_FLAGS_SYNC : SAMPLE_FLAGS_NON_SYNC;
+    sample.time = time;
+    t.samples.push_back(sample);
+    return true;
+}
+
+bool Mp4Muxer::writeFragment(bool sync) {
+    TRACE_SCOPE("mux fragment");
+    uint64_t payload = 0;
+    for (auto &t : tracks) {
+        payload += t.data.size();
+    }
+    if (payload == 0) {
+        return true;
+    }
+    header.clear();
+    size_t moof = begin_box(header, "moof");
+    size_t mfhd = begin_full_box(header, "mfhd", 0, 0);
+    put_u32(header, ++sequence);
+    end_box(header, mfhd);
+    for (int i = 0; i < (int)tracks.size(); i++) {
+        Track &t = tracks[i];
+        if (t.samples.empty()) {
+            continue;
+        }
+        size_t traf = begin_box(header, "traf");
+        size_t tfhd = begin_full_box(header, "tfhd", 0, TFHD_DEFAULT_BASE_IS_MOOF);
+        put_u32(header, (uint32_t)i + 1);
+        end_box(header, tfhd);
+        size_t tfdt = begin_full_box(header, "tfdt", 1, 0);
+        put_u64(header, (uint64_t)max<int64_t>(t.samples[0].time, 0));
+        end_box(header, tfdt);
+        size_t trun = begin_full_box(header, "trun", 0, TRUN_DATA_OFFSET | TRUN_SAMPLE_DURATION |
+                                                        TRUN_SAMPLE_SIZE | TRUN_SAMPLE_FLAGS);
+        put_u32(header, (uint32_t)t.samples.size());
+        // Patched once the moof size is known.
+        t.dataOffsetAt = header.size();
+        put_u32(header, 0);
+        for (size_t k = 0; k < t.samples.size(); k++) {
+            int64_t next = k + 1 < t.samples.size() ? t.samples[k + 1].time : t.nextTime;
+            if (next >= 0) {
+                t.lastDuration = (uint32_t)max<int64_t>(next - t.samples[k].time, 1);
+            }
+            put_u32(header, t.lastDuration);
+            put_u32(header, t.samples[k].size);
+            put_u32(header, t.samples[k].flags);
+        }
+        end_box(header, trun);
+        end_box(header, traf);
+    }
+    end_box(header, moof);
+
+    bool large = payload + 8 > UINT32_MAX;
+    uint64_t dataOffset = header.size() + (large ? 16 : 8);
+    for (auto &t : tracks) {
+        if (!t.samples.empty()) {
+            set_u32(header, t.dataOffsetAt, (uint32_t)dataOffset);
+            dataOffset += t.data.size();
+        }
+    }
+    if (large) {
+        put_u32(header, 1);
+        put_bytes(header, "mdat", 4);
+        put_u64(header, payload + 16);
+    } else {
+        put_u32(header, (uint32_t)(payload + 8));
+        put_bytes(header, "mdat", 4);
+    }
+
+    bool ok = writer->write(header.data(), header.size());
+    for (auto &t : tracks) {
+        ok = ok && writer->write(t.data.data(), t.data.size());
+        t.samples.clear();
+        t.data.clear();
+        t.nextTime = -1;
+    }
+    fragmentStartUs = -1;
+    return ok && writer->flush(sync);
+}
+
+bool Mp4Muxer::stop() {
+    lock_guard<std::mutex> lock(mutex);
+    if (writer == nullptr) {
+        return false;
+    }
+    bool ok = !started || writeFragment(true);
+    ok = writer->close() && ok;
+    writer.reset();
+    LOGD(TAG, "stopped after %u fragments, ok = %d", sequence, ok);
+    return ok;
+}
@@ -0,0 +1,152 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#ifndef CAMERAUTIL_MP4_MUXER_H
+#define CAMERAUTIL_MP4_MUXER_H
+
+#include "async_file_writer.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * 分片MP4（ISO BMFF fragmented MP4）封装，替代MediaMuxer：H.264 / HEVC视频和AAC音频。
+ *
+ * 文件结构：开头是ftyp和没有样本的moov（带mvex），之后每隔fragmentDurationUs（从视频关键帧开始）
+ * 写一个moof + mdat分片。文件只追加不回写，每个分片写完后都是一个可以播放的文件，
+ * 录制中途崩溃只丢失最后一个没写完的分片。
+ *
+ * 编码器线程调用writeSample只把样本拷贝进当前分片的内存缓冲区（视频的Annex B起始码在这里
+ * 换成4字节长度），分片结束时拼成moof + mdat交给AsyncFileWriter，磁盘I/O在它的I/O线程上。
+ * 视频和音频编码器各自的线程可以同时调用，内部有锁。
+ * */
+
+// Cut a fragment at the first video key frame after this much media.
+#define MP4_FRAGMENT_US 1000000
+#define MP4_VIDEO_TIMESCALE 90000
+
+enum Mp4Codec {
+    MP4_CODEC_H264,
+    MP4_CODEC_HEVC,
+    MP4_CODEC_AAC,
+};
+
+/**
+ * Fields of an ADTS header, the framing of AAC elementary streams.
+ * */
+struct AdtsHeader {
+    int profile;
+    int sampleRateIndex;
+    int sampleRate;
+    int channels;
+    int headerBytes;
+    // Header and payload
+    int frameBytes;
+};
+
+/**
+ * Parse the ADTS header at data. Return false if it is not a valid header.
+ * */
+bool adts_parse(const uint8_t *data, size_t size, AdtsHeader &header);
+
+/**
+ * The 2 byte AudioSpecificConfig (esds payload, MediaCodec csd-0) of an ADTS stream.
+ * */
+void adts_audio_specific_config(const AdtsHeader &header, uint8_t config[2]);
+
+class Mp4Muxer {
+public:
+    /**
+     * Write to fd, which the muxer owns from now on.
+     * */
+    explicit Mp4Muxer(int fd, int64_t fragmentDurationUs = MP4_FRAGMENT_US);
+    Mp4Muxer(Mp4Muxer &) = delete;
+    ~Mp4Muxer();
+
+    /**
+     * config is the Annex B parameter sets, SPS and PPS for H.264 (csd-0 + csd-1),
+     * VPS, SPS and PPS for HEVC (csd-0). Return the track index, -1 on error.
+     * */
+    int addVideoTrack(Mp4Codec codec, int width, int height, const uint8_t *config, size_t configSize);
+
+    /**
+     * config is the AudioSpecificConfig (csd-0). Return the track index, -1 on error.
+     * */
+    int addAudioTrack(int sampleRate, int channels, const uint8_t *config, size_t configSize);
+
+    /**
+     * Clockwise rotation of the video for display, 0, 90, 180 or 270. Before start.
+     * */
+    void setRotation(int degrees);
+
+    /**
+     * Write ftyp and moov, no tracks can be added afterwards.
+     * */
+    bool start();
+
+    /**
+     * One access unit: Annex B (or already length prefixed) NAL units of one frame, or one raw AAC frame.
+     * Samples of a track must come in decoding order. Return false after an I/O error.
+     * */
+    bool writeSample(int track, const uint8_t *data, size_t size, int64_t ptsUs, bool keyFrame);
+
+    /**
+     * Write the last fragment and close the file.
+     * */
+    bool stop();
+
+    bool isStarted() const {
+        return started;
+    }
+
+private:
+    struct Sample {
+        uint32_t size;
+        uint32_t flags;
+        int64_t time;
+    };
+
+    struct Track {
+        Mp4Codec codec;
+        int width = 0, height = 0;
+        int sampleRate = 0, channels = 0;
+        uint32_t timescale;
+        // avcC / hvcC, or the AudioSpecificConfig
+        std::vector<uint8_t> config;
+        // Samples of the current fragment, the data is contiguous in the order of samples.
+        std::vector<Sample> samples;
+        std::vector<uint8_t> data;
+        int64_t startPtsUs = -1;
+        // Time of the sample after the fragment when it is known, -1 otherwise.
+        int64_t nextTime = -1;
+        // Duration given to the last sample of a fragment otherwise, the previous sample duration.
+        uint32_t lastDuration;
+        // Offset of the trun data_offset field in header
+        size_t dataOffsetAt = 0;
+    };
+
+    void writeMoov(std::vector<uint8_t> &out);
+    void writeTrak(std::vector<uint8_t> &out, int index);
+
+    /**
+     * Build moof + mdat of the buffered samples and hand them to the writer.
+     * */
+    bool writeFragment(bool sync);
+
+    std::unique_ptr<AsyncFileWriter> writer;
+    int64_t fragmentDurationUs;
+    std::vector<Track> tracks;
+    int videoTrack = -1;
+    int rotation = 0;
+    bool started = false;
+    uint32_t sequence = 0;
+    int64_t fragmentStartUs = -1;
+    // moof is built here, kept to avoid allocating every fragment
+    std::vector<uint8_t> header;
+    std::mutex mutex;
+};
+
+#endif //CAMERAUTIL_MP4_MUXER_H
@@ -5,7 +5,17 @@
 #include <jni.h>
 #include "ImageProxy.h"
 #include "converter.h"
+#include "exposure_fusion.h"
 #include "neon_test.h"
+#include "benchmark.h"
+#include "conformance.h"
+#include "dispatch.h"
+#include "audio_capture.h"
+#include "mp4_muxer.h"
+#include "frame_arena.h"
+#include <algorithm>
+#include <memory>
+#include <vector>
 
 
 extern "C"
@@ -15,14 +25,274 @@ Java_com_zu_camerautil_util_ImageConverter_nYUV_1420_1888_1to_1bitmap(JNIEnv *en
     ImageProxy imageProxy(env, image);
     //jobject bitmap = convert_YUV_420_888_f32_raw(env, imageProxy, rotation, facing);
     //jobject bitmap = convert_YUV_420_888_i32_raw(env, imageProxy, rotation, facing);
-    jobject bitmap = convert_YUV_420_888_neon(env, imageProxy, rotation, facing);
+    //jobject bitmap = convert_YUV_420_888_neon(env, imageProxy, rotation, facing);
+    jobject bitmap;
+    if (imageProxy.getFormat() == IMAGE_FORMAT_YCBCR_P010) {
+        bitmap = convert_YCBCR_P010(env, imageProxy, rotation, facing);
+    } else {
+        bitmap = convert_YUV_420_888(env, imageProxy, rotation, facing);
+    }
     return bitmap;
 }
 
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_com_zu_camerautil_util_ImageConverter_nSetCubeLut(JNIEnv *env, jobject thiz, jstring path) {
+    if (path == nullptr) {
+        return converter_set_cube_lut(nullptr);
+    }
+    const char *pathChars = env->GetStringUTFChars(path, nullptr);
+    bool ret = converter_set_cube_lut(pathChars);
+    env->ReleaseStringUTFChars(path, pathChars);
+    return ret;
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_zu_camerautil_util_ImageConverter_nSetLensDistortion(JNIEnv *env, jobject thiz, jfloatArray intrinsics,
+                                                               jfloatArray distortion, jint arrayWidth,
+                                                               jint arrayHeight) {
+    if (intrinsics == nullptr || distortion == nullptr) {
+        converter_set_lens_distortion(nullptr);
+        return;
+    }
+    LensDistortion lens;
+    env->GetFloatArrayRegion(intrinsics, 0, 5, lens.intrinsics);
+    env->GetFloatArrayRegion(distortion, 0, 5, lens.distortion);
+    lens.arrayWidth = arrayWidth;
+    lens.arrayHeight = arrayHeight;
+    converter_set_lens_distortion(&lens);
+}
+
+extern "C"
+JNIEXPORT jobject JNICALL
+Java_com_zu_camerautil_util_ImageConverter_nRawToBitmap(JNIEnv *env, jobject thiz, jobject image, jint rotation,
+                                                        jint facing, jint cfa, jfloatArray blackLevel,
+                                                        jfloat whiteLevel, jfloatArray wbGains, jfloatArray ccm,
+                                                        jfloatArray shadingGains, jint shadingColumns,
+                                                        jint shadingRows) {
+    RawParams params;
+    params.cfa = cfa;
+    params.whiteLevel = whiteLevel;
+    env->GetFloatArrayRegion(blackLevel, 0, 4, params.blackLevel);
+    env->GetFloatArrayRegion(wbGains, 0, 4, params.wbGains);
+    env->GetFloatArrayRegion(ccm, 0, 9, params.ccm);
+    std::vector<float> shading;
+    if (shadingGains != nullptr && env->GetArrayLength(shadingGains) == shadingColumns * shadingRows * 4) {
+        shading.resize(shadingColumns * shadingRows * 4);
+        env->GetFloatArrayRegion(shadingGains, 0, (jint)shading.size(), shading.data());
+        params.shading.gains = shading.data();
+        params.shading.columns = shadingColumns;
+        params.shading.rows = shadingRows;
+    }
+    ImageProxy imageProxy(env, image);
+    return convert_RAW_SENSOR(env, imageProxy, rotation, facing, params);
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_zu_camerautil_util_ImageConverter_nSetHugePages(JNIEnv *env, jobject thiz, jboolean enable) {
+    frame_arena_set_huge_pages(enable);
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_zu_camerautil_util_ImageConverter_nTrimScratchMemory(JNIEnv *env, jobject thiz) {
+    frame_arena_trim();
+}
+
+extern "C"
+JNIEXPORT jobject JNICALL
+Java_com_zu_camerautil_util_ImageConverter_nExposureFusion(JNIEnv *env, jobject thiz, jobjectArray images,
+                                                           jint rotation, jint facing) {
+    int count = env->GetArrayLength(images);
+    if (count < 2 || count > EXPOSURE_FUSION_MAX_FRAMES) {
+        return nullptr;
+    }
+    std::vector<std::unique_ptr<ImageProxy>> proxies;
+    std::vector<ImageProxy *> pointers;
+    for (int i = 0; i < count; i++) {
+        proxies.emplace_back(new ImageProxy(env, env->GetObjectArrayElement(images, i)));
+        pointers.push_back(proxies.back().get());
+    }
+    return fuse_YUV_420_888(env, pointers.data(), count, rotation, facing);
+}
+
+extern "C"
+JNIEXPORT jlong JNICALL
+Java_com_zu_camerautil_util_BurstMerger_nCreate(JNIEnv *env, jobject thiz, jint width, jint height) {
+    return (jlong)new BurstMerger(BURST_FORMAT_YUV420, width, height);
+}
+
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_com_zu_camerautil_util_BurstMerger_nAdd(JNIEnv *env, jobject thiz, jlong handle, jobject image) {
+    ImageProxy imageProxy(env, image);
+    return burst_add_YUV_420_888(imageProxy, *(BurstMerger *)handle);
+}
+
+extern "C"
+JNIEXPORT jobject JNICALL
+Java_com_zu_camerautil_util_BurstMerger_nMerge(JNIEnv *env, jobject thiz, jlong handle, jint rotation, jint facing) {
+    return burst_merge_YUV_420_888(env, *(BurstMerger *)handle, rotation, facing);
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_zu_camerautil_util_BurstMerger_nRelease(JNIEnv *env, jobject thiz, jlong handle) {
+    delete (BurstMerger *)handle;
+}
+
+extern "C"
+JNIEXPORT jlong JNICALL
+Java_com_zu_camerautil_recorder_NativeAudioInput_nCreate(JNIEnv *env, jobject thiz, jint captureRate,
+                                                         jint captureChannels, jint outputRate, jint outputChannels) {
+    std::unique_ptr<PcmSource> source = pcm_source_opensl(captureRate, captureChannels);
+    if (!source) {
+        return 0;
+    }
+    return (jlong)new AudioCapture(std::move(source), AUDIO_RING_MS, outputRate, outputChannels);
+}
+
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_com_zu_camerautil_recorder_NativeAudioInput_nStart(JNIEnv *env, jobject thiz, jlong handle) {
+    return ((AudioCapture *)handle)->start();
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_zu_camerautil_recorder_NativeAudioInput_nStop(JNIEnv *env, jobject thiz, jlong handle) {
+    ((AudioCapture *)handle)->stop();
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_zu_camerautil_recorder_NativeAudioInput_nRelease(JNIEnv *env, jobject thiz, jlong handle) {
+    delete (AudioCapture *)handle;
+}
+
+extern "C"
+JNIEXPORT jint JNICALL
+Java_com_zu_camerautil_recorder_NativeAudioInput_nRead(JNIEnv *env, jobject thiz, jlong handle, jobject buffer,
+                                                       jint offset, jint size, jint timeoutMs) {
+    auto *address = (uint8_t *)env->GetDirectBufferAddress(buffer);
+    if (address == nullptr || offset < 0 || size < 0 ||
+        (jlong)offset + size > env->GetDirectBufferCapacity(buffer)) {
+        return 0;
+    }
+    return std::max(((AudioCapture *)handle)->read(address + offset, size, timeoutMs), 0);
+}
+
+extern "C"
+JNIEXPORT jlong JNICALL
+Java_com_zu_camerautil_recorder_NativeAudioInput_nGetFramesRead(JNIEnv *env, jobject thiz, jlong handle) {
+    return ((AudioCapture *)handle)->getFramesRead();
+}
+
+extern "C"
+JNIEXPORT jlong JNICALL
+Java_com_zu_camerautil_recorder_NativeMp4Muxer_nCreate(JNIEnv *env, jobject thiz, jint fd, jint fragmentMs) {
+    return (jlong)new Mp4Muxer(fd, (int64_t)fragmentMs * 1000);
+}
+
+extern "C"
+JNIEXPORT jint JNICALL
+Java_com_zu_camerautil_recorder_NativeMp4Muxer_nAddVideoTrack(JNIEnv *env, jobject thiz, jlong handle,
+                                                              jboolean hevc, jint width, jint height,
+                                                              jbyteArray config) {
+    jsize size = env->GetArrayLength(config);
+    std::vector<uint8_t> bytes(size);
+    env->GetByteArrayRegion(config, 0, size, (jbyte *)bytes.data());
+    return ((Mp4Muxer *)handle)->addVideoTrack(hevc ? MP4_CODEC_HEVC : MP4_CODEC_H264, width, height,
+                                               bytes.data(), bytes.size());
+}
+
+extern "C"
+JNIEXPORT jint JNICALL
+Java_com_zu_camerautil_recorder_NativeMp4Muxer_nAddAudioTrack(JNIEnv *env, jobject thiz, jlong handle,
+                                                              jint sampleRate, jint channels, jbyteArray config) {
+    jsize size = env->GetArrayLength(config);
+    std::vector<uint8_t> bytes(size);
+    env->GetByteArrayRegion(config, 0, size, (jbyte *)bytes.data());
+    return ((Mp4Muxer *)handle)->addAudioTrack(sampleRate, channels, bytes.data(), bytes.size());
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_zu_camerautil_recorder_NativeMp4Muxer_nSetRotation(JNIEnv *env, jobject thiz, jlong handle,
+                                                            jint degrees) {
+    ((Mp4Muxer *)handle)->setRotation(degrees);
+}
+
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_com_zu_camerautil_recorder_NativeMp4Muxer_nStart(JNIEnv *env, jobject thiz, jlong handle) {
+    return ((Mp4Muxer *)handle)->start();
+}
+
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_com_zu_camerautil_recorder_NativeMp4Muxer_nWriteSample(JNIEnv *env, jobject thiz, jlong handle, jint track,
+                                                            jobject buffer, jint offset, jint size, jlong ptsUs,
+                                                            jboolean keyFrame) {
+    auto *address = (uint8_t *)env->GetDirectBufferAddress(buffer);
+    if (address == nullptr || offset < 0 || size < 0 ||
+        (jlong)offset + size > env->GetDirectBufferCapacity(buffer)) {
+        return false;
+    }
+    return ((Mp4Muxer *)handle)->writeSample(track, address + offset, size, ptsUs, keyFrame);
+}
+
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_com_zu_camerautil_recorder_NativeMp4Muxer_nStop(JNIEnv *env, jobject thiz, jlong handle) {
+    return ((Mp4Muxer *)handle)->stop();
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_zu_camerautil_recorder_NativeMp4Muxer_nRelease(JNIEnv *env, jobject thiz, jlong handle) {
+    delete (Mp4Muxer *)handle;
+}
+
 extern "C"
 JNIEXPORT void JNICALL
 Java_com_zu_camerautil_util_NeonTest_doNeonTest(JNIEnv *env, jobject thiz) {
     //do_neon_test();
     //assembly_test();
     instruction_test();
-}
\ No newline at end of file
+}
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_zu_camerautil_util_NativeBenchmark_runBenchmark(JNIEnv *env, jobject thiz, jstring filter) {
+    const char *filterChars = env->GetStringUTFChars(filter, nullptr);
+    run_native_benchmark(filterChars);
+    env->ReleaseStringUTFChars(filter, filterChars);
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_zu_camerautil_util_NativeBenchmark_runRoofline(JNIEnv *env, jobject thiz, jstring filter) {
+    const char *filterChars = env->GetStringUTFChars(filter, nullptr);
+    run_native_benchmark(filterChars, true);
+    env->ReleaseStringUTFChars(filter, filterChars);
+}
+
+extern "C"
+JNIEXPORT jint JNICALL
+Java_com_zu_camerautil_util_NativeBenchmark_runConformance(JNIEnv *env, jobject thiz, jstring filter) {
+    const char *filterChars = env->GetStringUTFChars(filter, nullptr);
+    int failures = run_conformance(filterChars);
+    env->ReleaseStringUTFChars(filter, filterChars);
+    return failures;
+}
+
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_com_zu_camerautil_util_NativeBenchmark_setKernelOverride(JNIEnv *env, jobject thiz, jstring features) {
+    const char *featureChars = env->GetStringUTFChars(features, nullptr);
+    bool ret = dispatch_set_override(featureChars);
+    env->ReleaseStringUTFChars(features, featureChars);
+    return ret;
+}
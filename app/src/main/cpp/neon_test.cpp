@@ -11,6 +11,7 @@
 using namespace std;
 
 void instruction_test() {
+#if defined(__ARM_NEON)
     // 饱和式加法
 //    int8x8_t a = vdup_n_s8(100);
 //    int8x8_t b = vdup_n_s8(1);
@@ -28,7 +29,7 @@ void instruction_test() {
     int8x8_t c = vzip1_s8(a, b);
     int8x8_t d = vzip2_s8(a, b);
     int8x8x2_t e = vzip_s8(a, b);
-
+#endif
 }
 
 void do_neon_test() {
@@ -38,7 +39,9 @@ void do_neon_test() {
 void assembly_test() {
     int a = 4;
     int b = 7;
+#if defined(__aarch64__)
     //int c = assembly_add(a, b);
     int c = my_function(a, b);
     LOGD(TAG, "%d", c);
+#endif
 }
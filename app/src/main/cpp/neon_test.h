@@ -6,7 +6,9 @@
 #define CAMERAUTIL_NEON_TEST_H
 
 #include <stdlib.h>
+#if defined(__ARM_NEON)
 #include <arm_neon.h>
+#endif
 
 /**
  * neon相关测试
@@ -0,0 +1,195 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#include "parallel.h"
+#include "trace.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#include <unistd.h>
+
+using namespace std;
+
+#define MAX_THREADS 8
+
+namespace {
+
+class StripePool {
+public:
+    StripePool() {
+        int cores = (int)thread::hardware_concurrency();
+        defaultCount = std::max(1, std::min(cores, MAX_THREADS));
+        threadCount = defaultCount;
+        // The caller always works on stripes too, so the pool needs one thread less.
+        for (int i = 0; i < defaultCount - 1; i++) {
+            workers.emplace_back(&StripePool::workerLoop, this);
+        }
+    }
+
+    ~StripePool() {
+        {
+            lock_guard<mutex> lock(stateMutex);
+            exiting = true;
+        }
+        wakeCondition.notify_all();
+        for (auto &t : workers) {
+            t.join();
+        }
+    }
+
+    void run(int rows, int minStripeRows, const function<void(int, int)> &task) {
+        if (rows <= 0) {
+            return;
+        }
+        minStripeRows = std::max(1, minStripeRows);
+        int threads = threadCount.load();
+        int stripes = std::min(threads, (rows + minStripeRows - 1) / minStripeRows);
+        // Calls from inside a stripe or from a second thread while a frame is in flight
+        // are done serially instead of waiting for the pool.
+        if (stripes <= 1 || insideStripe || !jobMutex.try_lock()) {
+            TRACE_SCOPE("stripe");
+            task(0, rows);
+            return;
+        }
+
+        {
+            // Workers that woke up late for the previous frame must leave before the job is replaced.
+            unique_lock<mutex> lock(stateMutex);
+            doneCondition.wait(lock, [this] { return activeWorkers == 0; });
+            jobTask = &task;
+            jobRows = rows;
+            jobStripes = stripes;
+            nextStripe.store(0);
+            pendingStripes.store(stripes);
+            generation++;
+        }
+        wakeCondition.notify_all();
+
+        insideStripe = true;
+        drainStripes();
+        insideStripe = false;
+
+        {
+            unique_lock<mutex> lock(stateMutex);
+            doneCondition.wait(lock, [this] { return pendingStripes.load() == 0 && activeWorkers == 0; });
+            jobTask = nullptr;
+        }
+        jobMutex.unlock();
+    }
+
+    int getThreadCount() {
+        return threadCount.load();
+    }
+
+    int getWorkerTids(int *tids, int maxCount) {
+        unique_lock<mutex> lock(stateMutex);
+        doneCondition.wait(lock, [this] { return workerTids.size() == workers.size(); });
+        int count = std::min(maxCount, (int)workerTids.size());
+        std::copy(workerTids.begin(), workerTids.begin() + count, tids);
+        return (int)workerTids.size();
+    }
+
+    void setThreadCount(int count) {
+        if (count <= 0 || count > defaultCount) {
+            count = defaultCount;
+        }
+        threadCount.store(count);
+    }
+
+private:
+    void workerLoop() {
+        insideStripe = true;
+        {
+            lock_guard<mutex> lock(stateMutex);
+            workerTids.push_back((int)gettid());
+        }
+        doneCondition.notify_all();
+        uint64_t seenGeneration = 0;
+        while (true) {
+            {
+                unique_lock<mutex> lock(stateMutex);
+                wakeCondition.wait(lock, [&] { return exiting || generation != seenGeneration; });
+                if (exiting) {
+                    return;
+                }
+                seenGeneration = generation;
+                activeWorkers++;
+            }
+            drainStripes();
+            {
+                lock_guard<mutex> lock(stateMutex);
+                activeWorkers--;
+            }
+            doneCondition.notify_all();
+        }
+    }
+
+    void drainStripes() {
+        while (true) {
+            int stripe = nextStripe.fetch_add(1);
+            if (stripe >= jobStripes) {
+                return;
+            }
+            // Evenly sized stripes, the first (rows % stripes) ones get one more row.
+            int base = jobRows / jobStripes;
+            int extra = jobRows % jobStripes;
+            int rowStart = stripe * base + std::min(stripe, extra);
+            int rowEnd = rowStart + base + (stripe < extra ? 1 : 0);
+            {
+                TRACE_SCOPE("stripe");
+                (*jobTask)(rowStart, rowEnd);
+            }
+            pendingStripes.fetch_sub(1);
+        }
+    }
+
+    vector<thread> workers;
+    vector<int> workerTids;
+    int defaultCount = 1;
+    atomic<int> threadCount{1};
+
+    mutex jobMutex;
+    mutex stateMutex;
+    condition_variable wakeCondition;
+    condition_variable doneCondition;
+    bool exiting = false;
+    uint64_t generation = 0;
+    int activeWorkers = 0;
+
+    const function<void(int, int)> *jobTask = nullptr;
+    int jobRows = 0;
+    int jobStripes = 0;
+    atomic<int> nextStripe{0};
+    atomic<int> pendingStripes{0};
+
+    static thread_local bool insideStripe;
+};
+
+thread_local bool StripePool::insideStripe = false;
+
+StripePool &getPool() {
+    static StripePool pool;
+    return pool;
+}
+
+}
+
+int parallel_thread_count() {
+    return getPool().getThreadCount();
+}
+
+int parallel_worker_tids(int *tids, int maxCount) {
+    return getPool().getWorkerTids(tids, maxCount);
+}
+
+void parallel_set_thread_count(int count) {
+    getPool().setThreadCount(count);
+}
+
+void parallel_for_stripes(int rows, int minStripeRows, const function<void(int, int)> &task) {
+    getPool().run(rows, minStripeRows, task);
+}
@@ -0,0 +1,40 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#ifndef CAMERAUTIL_PARALLEL_H
+#define CAMERAUTIL_PARALLEL_H
+
+#include <functional>
+
+/**
+ * 图像处理用的简单线程池。
+ * 一帧图像按行切成若干stripe，每个stripe交给一个线程处理。调用线程本身也参与计算，
+ * 所有stripe处理完之后函数才返回。
+ * */
+
+/**
+ * Number of threads (including the caller) used by parallel_for_stripes.
+ * */
+int parallel_thread_count();
+
+/**
+ * Limit the threads used by parallel_for_stripes. count <= 0 restores the default,
+ * which is the number of online cores.
+ * */
+void parallel_set_thread_count(int count);
+
+/**
+ * Kernel thread ids of the pool workers, which run stripes besides the caller, for attaching
+ * per thread profilers. Fill at most maxCount and return the number of workers.
+ * */
+int parallel_worker_tids(int *tids, int maxCount);
+
+/**
+ * Split [0, rows) into stripes of at least minStripeRows rows and run task(rowStart, rowEnd)
+ * on every stripe. Stripes are processed concurrently, so task must only write rows inside
+ * its own range.
+ * */
+void parallel_for_stripes(int rows, int minStripeRows, const std::function<void(int rowStart, int rowEnd)> &task);
+
+#endif //CAMERAUTIL_PARALLEL_H
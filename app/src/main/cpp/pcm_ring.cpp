@@ -0,0 +1,58 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#include "pcm_ring.h"
+#include <string.h>
+
+using namespace std;
+
+PcmRing::PcmRing(size_t capacity) {
+    size_t size = PCM_RING_CACHE_LINE;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    buffer.resize(size);
+    mask = size - 1;
+}
+
+bool PcmRing::write(const void *data, size_t bytes) {
+    uint64_t w = writePos.load(memory_order_relaxed);
+    uint64_t r = readPos.load(memory_order_acquire);
+    if (bytes > buffer.size() - (size_t)(w - r)) {
+        dropped.fetch_add(bytes, memory_order_relaxed);
+        return false;
+    }
+    size_t start = (size_t)w & mask;
+    size_t first = min(bytes, buffer.size() - start);
+    memcpy(buffer.data() + start, data, first);
+    memcpy(buffer.data(), (const uint8_t *)data + first, bytes - first);
+    writePos.store(w + bytes, memory_order_release);
+    return true;
+}
+
+size_t PcmRing::read(void *data, size_t bytes) {
+    uint64_t r = readPos.load(memory_order_relaxed);
+    uint64_t w = writePos.load(memory_order_acquire);
+    bytes = min(bytes, (size_t)(w - r));
+    size_t start = (size_t)r & mask;
+    size_t first = min(bytes, buffer.size() - start);
+    memcpy(data, buffer.data() + start, first);
+    memcpy((uint8_t *)data + first, buffer.data(), bytes - first);
+    readPos.store(r + bytes, memory_order_release);
+    return bytes;
+}
+
+size_t PcmRing::readable() const {
+    return (size_t)(writePos.load(memory_order_acquire) - readPos.load(memory_order_relaxed));
+}
+
+size_t PcmRing::writable() const {
+    return buffer.size() - (size_t)(writePos.load(memory_order_relaxed) - readPos.load(memory_order_acquire));
+}
+
+void PcmRing::reset() {
+    writePos.store(0, memory_order_relaxed);
+    readPos.store(0, memory_order_relaxed);
+    dropped.store(0, memory_order_relaxed);
+}
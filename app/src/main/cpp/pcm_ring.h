@@ -0,0 +1,77 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#ifndef CAMERAUTIL_PCM_RING_H
+#define CAMERAUTIL_PCM_RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <vector>
+
+/**
+ * 单生产者单消费者的无锁PCM环形缓冲区。
+ *
+ * 生产者是采集回调（OpenSL ES的buffer queue回调线程），消费者是编码线程，两边都不加锁、不分配内存。
+ * 读写位置是一直递增的64位字节计数，容量是2的幂，下标用位与取得；
+ * 生产者先写数据再release写位置，消费者acquire写位置后读数据，读位置反之。
+ * 两个位置放在不同的cache line上，避免两个线程互相失效对方的cache line。
+ * 满了的时候生产者丢弃新数据并计数，不能由生产者移动读位置。
+ * */
+
+#define PCM_RING_CACHE_LINE 64
+
+class PcmRing {
+public:
+    /**
+     * capacity is rounded up to a power of two bytes.
+     * */
+    explicit PcmRing(size_t capacity);
+    PcmRing(PcmRing &) = delete;
+
+    /**
+     * Producer only. Write all of data or, if it does not fit, nothing. Return false when the data was dropped.
+     * */
+    bool write(const void *data, size_t bytes);
+
+    /**
+     * Consumer only. Copy up to bytes into data, return the number of bytes copied.
+     * */
+    size_t read(void *data, size_t bytes);
+
+    /**
+     * Bytes the consumer can read now, at least this many until it reads.
+     * */
+    size_t readable() const;
+
+    /**
+     * Bytes the producer can write now, at least this many until it writes.
+     * */
+    size_t writable() const;
+
+    size_t getCapacity() const {
+        return buffer.size();
+    }
+
+    /**
+     * Bytes dropped because the ring was full.
+     * */
+    uint64_t getDropped() const {
+        return dropped.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Empty the ring, only while neither side is running.
+     * */
+    void reset();
+
+private:
+    std::vector<uint8_t> buffer;
+    size_t mask;
+    alignas(PCM_RING_CACHE_LINE) std::atomic<uint64_t> writePos{0};
+    alignas(PCM_RING_CACHE_LINE) std::atomic<uint64_t> readPos{0};
+    alignas(PCM_RING_CACHE_LINE) std::atomic<uint64_t> dropped{0};
+};
+
+#endif //CAMERAUTIL_PCM_RING_H
@@ -0,0 +1,145 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#include "perf_counters.h"
+#include "parallel.h"
+#include "log.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+using namespace std;
+
+#define TAG "perf_counters.cpp"
+
+// More than the pool ever has, see parallel.cpp.
+#define MAX_WORKERS 16
+
+struct EventConfig {
+    uint32_t type;
+    uint64_t config;
+};
+
+static constexpr uint64_t cache_event(uint64_t cache, uint64_t op, uint64_t result) {
+    return cache | (op << 8) | (result << 16);
+}
+
+/**
+ * Generic events tried in order for each counter, the first one the CPU supports is used.
+ * Many ARM cores have no generic last level cache event but do count cache misses.
+ * */
+static const EventConfig EVENTS[PERF_COUNTER_COUNT][2] = {
+        {{PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES}, {PERF_TYPE_MAX, 0}},
+        {{PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS}, {PERF_TYPE_MAX, 0}},
+        {{PERF_TYPE_HW_CACHE, cache_event(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ,
+                                          PERF_COUNT_HW_CACHE_RESULT_MISS)}, {PERF_TYPE_MAX, 0}},
+        {{PERF_TYPE_HW_CACHE, cache_event(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_OP_READ,
+                                          PERF_COUNT_HW_CACHE_RESULT_MISS)},
+         {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES}},
+        {{PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES}, {PERF_TYPE_MAX, 0}},
+        {{PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_BACKEND}, {PERF_TYPE_MAX, 0}},
+};
+
+static const char *NAMES[PERF_COUNTER_COUNT] = {
+        "cycles", "instructions", "L1D misses", "LLC misses", "branch misses", "stalled cycles",
+};
+
+static int open_event(const EventConfig &event, int tid) {
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = event.type;
+    attr.config = event.config;
+    attr.disabled = 1;
+    // User space only, which is all an unprivileged process may count.
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(__NR_perf_event_open, &attr, tid, -1, -1, 0);
+}
+
+PerfCounters::PerfCounters() {
+    int tids[MAX_WORKERS + 1];
+    tids[0] = (int)gettid();
+    int threads = 1 + min(parallel_worker_tids(tids + 1, MAX_WORKERS), MAX_WORKERS);
+
+    for (int id = 0; id < PERF_COUNTER_COUNT; id++) {
+        for (const EventConfig &event : EVENTS[id]) {
+            if (event.type == PERF_TYPE_MAX || !fds[id].empty()) {
+                break;
+            }
+            for (int i = 0; i < threads; i++) {
+                int fd = open_event(event, tids[i]);
+                if (fd < 0) {
+                    if (error[0] == '\0') {
+                        snprintf(error, sizeof(error), "%s: %s", NAMES[id], strerror(errno));
+                    }
+                    for (int opened : fds[id]) {
+                        close(opened);
+                    }
+                    fds[id].clear();
+                    break;
+                }
+                fds[id].push_back(fd);
+            }
+        }
+    }
+    if (!isAvailable()) {
+        LOGE(TAG, "hardware counters are not available, %s", error);
+    }
+}
+
+PerfCounters::~PerfCounters() {
+    for (auto &counter : fds) {
+        for (int fd : counter) {
+            close(fd);
+        }
+    }
+}
+
+bool PerfCounters::isAvailable() const {
+    return !fds[PERF_CYCLES].empty() && !fds[PERF_INSTRUCTIONS].empty();
+}
+
+void PerfCounters::start() {
+    for (auto &counter : fds) {
+        for (int fd : counter) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+void PerfCounters::stop(PerfCounterValues &values) {
+    for (auto &counter : fds) {
+        for (int fd : counter) {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+    for (int id = 0; id < PERF_COUNTER_COUNT; id++) {
+        if (fds[id].empty()) {
+            values.values[id] = -1;
+            continue;
+        }
+        double total = 0;
+        for (int fd : fds[id]) {
+            // value, time enabled, time running
+            uint64_t data[3];
+            if (read(fd, data, sizeof(data)) != (ssize_t)sizeof(data) || data[2] == 0) {
+                continue;
+            }
+            // Scale up for the time the counter was multiplexed out.
+            total += (double)data[0] * ((double)data[1] / (double)data[2]);
+        }
+        values.values[id] = (int64_t)total;
+    }
+}
+
+const char *PerfCounters::name(int id) {
+    return NAMES[id];
+}
@@ -0,0 +1,82 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#ifndef CAMERAUTIL_PERF_COUNTERS_H
+#define CAMERAUTIL_PERF_COUNTERS_H
+
+#include <stdint.h>
+#include <vector>
+
+/**
+ * 通过perf_event_open读取硬件性能计数器，用于基准测试判断kernel受限于内存、指令发射还是分支。
+ *
+ * 计数器开在调用线程和parallel_for_stripes线程池的每个worker线程上（只统计用户态），
+ * 读数是这些线程的总和。每个计数器单独打开，硬件计数器不够时由内核分时复用，
+ * 读数按实际计数时间比例放大。
+ *
+ * 很多环境不允许使用：容器和seccomp过滤了这个系统调用，Android的user版本默认
+ * perf_event_paranoid为3（adb shell setprop security.perf_harden 0可以打开），
+ * 有的CPU不支持某些事件。打不开的计数器标记为不可用，其余的照常工作。
+ * */
+
+enum PerfCounterId {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_BRANCH_MISSES,
+    // Cycles the back end could not accept instructions, waiting for memory or execution units.
+    PERF_STALLED_CYCLES,
+    PERF_COUNTER_COUNT
+};
+
+struct PerfCounterValues {
+    // -1 for a counter that is not available
+    int64_t values[PERF_COUNTER_COUNT];
+
+    bool has(int id) const {
+        return values[id] >= 0;
+    }
+};
+
+class PerfCounters {
+public:
+    /**
+     * Open the counters on the calling thread and the stripe pool workers.
+     * */
+    PerfCounters();
+    PerfCounters(PerfCounters &) = delete;
+    ~PerfCounters();
+
+    /**
+     * Whether at least cycles and instructions could be opened.
+     * */
+    bool isAvailable() const;
+
+    /**
+     * Why a counter could not be opened, empty if all are available.
+     * */
+    const char *getError() const {
+        return error;
+    }
+
+    /**
+     * Reset and start counting. Only the thread that created the counters may call start and stop.
+     * */
+    void start();
+
+    /**
+     * Stop counting and read the totals since start.
+     * */
+    void stop(PerfCounterValues &values);
+
+    static const char *name(int id);
+
+private:
+    // One descriptor per thread for each counter, empty if the counter is not available.
+    std::vector<int> fds[PERF_COUNTER_COUNT];
+    char error[128] = {};
+};
+
+#endif //CAMERAUTIL_PERF_COUNTERS_H
@@ -0,0 +1,347 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#include "pyramid.h"
+#include "dispatch.h"
+#include "cpu_features.h"
+#include "parallel.h"
+#include "simd.h"
+#include "frame_arena.h"
+#include "log.h"
+#include <string.h>
+#include <algorithm>
+
+using namespace std;
+
+#define TAG "pyramid.cpp"
+
+#define MIN_STRIPE_ROWS 16
+// Levels start and rows are padded to this many elements, 16 bytes.
+#define ROW_ALIGN 8
+// Extra elements after a padded row, for the last vector loads of pyrDownH.
+#define ROW_SLACK 8
+#define WEIGHT_BITS 10
+
+static inline int16_t sat_s16(int32_t n) {
+    return (int16_t)(n < -32768 ? -32768 : (n > 32767 ? 32767 : n));
+}
+
+static inline uint8_t sat_u8(int32_t n) {
+    return (uint8_t)(n < 0 ? 0 : (n > 255 ? 255 : n));
+}
+
+static inline void pyr_down_v_tail(int x, const int16_t *const *rows, int16_t *dst, int width) {
+    for (; x < width; x++) {
+        dst[x] = (int16_t)((rows[0][x] + rows[4][x] + 4 * (rows[1][x] + rows[3][x]) + 6 * rows[2][x] + 8) >> 4);
+    }
+}
+
+static inline void pyr_down_h_tail(int x, const int16_t *padded, int16_t *dst, int dstWidth) {
+    for (; x < dstWidth; x++) {
+        const int16_t *p = padded + 2 * x;
+        dst[x] = (int16_t)((p[-2] + p[2] + 4 * (p[-1] + p[1]) + 6 * p[0] + 8) >> 4);
+    }
+}
+
+static inline void pyr_up_v_tail(int x, const int16_t *const *rows, int16_t *dst, int width, int odd) {
+    if (odd) {
+        for (; x < width; x++) {
+            dst[x] = (int16_t)((rows[1][x] + rows[2][x] + 1) >> 1);
+        }
+    } else {
+        for (; x < width; x++) {
+            dst[x] = (int16_t)((rows[0][x] + rows[2][x] + 6 * rows[1][x] + 4) >> 3);
+        }
+    }
+}
+
+static inline void pyr_up_h_tail(int k, const int16_t *padded, int16_t *fine, int fineWidth, int subtract) {
+    int sign = subtract ? -1 : 1;
+    for (; 2 * k < fineWidth; k++) {
+        const int16_t *p = padded + k;
+        int even = (p[-1] + p[1] + 6 * p[0] + 4) >> 3;
+        fine[2 * k] = sat_s16(fine[2 * k] + sign * even);
+        if (2 * k + 1 < fineWidth) {
+            int odd = (p[0] + p[1] + 1) >> 1;
+            fine[2 * k + 1] = sat_s16(fine[2 * k + 1] + sign * odd);
+        }
+    }
+}
+
+static inline void pyr_accumulate_tail(int x, const int16_t *src, const int16_t *weight, int16_t *acc, int width) {
+    for (; x < width; x++) {
+        int32_t weighted = (src[x] * weight[x] + (1 << (WEIGHT_BITS - 1))) >> WEIGHT_BITS;
+        acc[x] = sat_s16(acc[x] + sat_s16(weighted));
+    }
+}
+
+static void pyr_down_v_c(const int16_t *const *rows, int16_t *dst, int width) {
+    pyr_down_v_tail(0, rows, dst, width);
+}
+
+static void pyr_down_h_c(const int16_t *padded, int16_t *dst, int dstWidth) {
+    pyr_down_h_tail(0, padded, dst, dstWidth);
+}
+
+static void pyr_up_v_c(const int16_t *const *rows, int16_t *dst, int width, int odd) {
+    pyr_up_v_tail(0, rows, dst, width, odd);
+}
+
+static void pyr_up_h_c(const int16_t *padded, int16_t *fine, int fineWidth, int subtract) {
+    pyr_up_h_tail(0, padded, fine, fineWidth, subtract);
+}
+
+static void pyr_accumulate_c(const int16_t *src, const int16_t *weight, int16_t *acc, int width) {
+    pyr_accumulate_tail(0, src, weight, acc, width);
+}
+
+#if SIMD_128
+static void pyr_down_v_simd(const int16_t *const *rows, int16_t *dst, int width) {
+    const v_s16x8 bias = v_dup_s16(8);
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        v_s16x8 outer = v_add(v_load_s16x8(rows[0] + x), v_load_s16x8(rows[4] + x));
+        v_s16x8 inner = v_add(v_load_s16x8(rows[1] + x), v_load_s16x8(rows[3] + x));
+        v_s16x8 sum = v_add(v_add(outer, bias), v_shl<2>(inner));
+        v_store(dst + x, v_shr<4>(v_mla_n(sum, v_load_s16x8(rows[2] + x), 6)));
+    }
+    pyr_down_v_tail(x, rows, dst, width);
+}
+
+static void pyr_down_h_simd(const int16_t *padded, int16_t *dst, int dstWidth) {
+    const v_s16x8 bias = v_dup_s16(8);
+    int x = 0;
+    for (; x + 8 <= dstWidth; x += 8) {
+        // Even and odd samples around 2x: p[2x - 2], p[2x - 1], p[2x], p[2x + 1], p[2x + 2]
+        v_s16x8 evenLeft, oddLeft, even, odd, evenRight, oddRight;
+        v_load_deinterleave(padded + 2 * x - 2, evenLeft, oddLeft);
+        v_load_deinterleave(padded + 2 * x, even, odd);
+        v_load_deinterleave(padded + 2 * x + 2, evenRight, oddRight);
+        v_s16x8 sum = v_add(v_add(evenLeft, evenRight), bias);
+        sum = v_add(sum, v_shl<2>(v_add(oddLeft, odd)));
+        v_store(dst + x, v_shr<4>(v_mla_n(sum, even, 6)));
+    }
+    pyr_down_h_tail(x, padded, dst, dstWidth);
+}
+
+static void pyr_up_v_simd(const int16_t *const *rows, int16_t *dst, int width, int odd) {
+    int x = 0;
+    if (odd) {
+        const v_s16x8 one = v_dup_s16(1);
+        for (; x + 8 <= width; x += 8) {
+            v_s16x8 sum = v_add(v_load_s16x8(rows[1] + x), v_load_s16x8(rows[2] + x));
+            v_store(dst + x, v_shr<1>(v_add(sum, one)));
+        }
+    } else {
+        const v_s16x8 bias = v_dup_s16(4);
+        for (; x + 8 <= width; x += 8) {
+            v_s16x8 sum = v_add(v_add(v_load_s16x8(rows[0] + x), v_load_s16x8(rows[2] + x)), bias);
+            v_store(dst + x, v_shr<3>(v_mla_n(sum, v_load_s16x8(rows[1] + x), 6)));
+        }
+    }
+    pyr_up_v_tail(x, rows, dst, width, odd);
+}
+
+static void pyr_up_h_simd(const int16_t *padded, int16_t *fine, int fineWidth, int subtract) {
+    const v_s16x8 four = v_dup_s16(4);
+    const v_s16x8 one = v_dup_s16(1);
+    int k = 0;
+    for (; 2 * k + 16 <= fineWidth; k += 8) {
+        v_s16x8 left = v_load_s16x8(padded + k - 1);
+        v_s16x8 center = v_load_s16x8(padded + k);
+        v_s16x8 right = v_load_s16x8(padded + k + 1);
+        v_s16x8 even = v_shr<3>(v_mla_n(v_add(v_add(left, right), four), center, 6));
+        v_s16x8 odd = v_shr<1>(v_add(v_add(center, right), one));
+        v_s16x8 lo, hi;
+        v_zip(even, odd, lo, hi);
+        int16_t *out = fine + 2 * k;
+        if (subtract) {
+            v_store(out, v_subs(v_load_s16x8(out), lo));
+            v_store(out + 8, v_subs(v_load_s16x8(out + 8), hi));
+        } else {
+            v_store(out, v_adds(v_load_s16x8(out), lo));
+            v_store(out + 8, v_adds(v_load_s16x8(out + 8), hi));
+        }
+    }
+    pyr_up_h_tail(k, padded, fine, fineWidth, subtract);
+}
+
+static void pyr_accumulate_simd(const int16_t *src, const int16_t *weight, int16_t *acc, int width) {
+    const v_s32x4 zero = v_dup_s32(0);
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        v_s16x8 s = v_load_s16x8(src + x), w = v_load_s16x8(weight + x);
+        v_s32x4 lo = v_rshr<WEIGHT_BITS>(v_mlal_lo(zero, s, w));
+        v_s32x4 hi = v_rshr<WEIGHT_BITS>(v_mlal_hi(zero, s, w));
+        v_store(acc + x, v_adds(v_load_s16x8(acc + x), v_narrow_sat_s16(lo, hi)));
+    }
+    pyr_accumulate_tail(x, src, weight, acc, width);
+}
+#endif
+
+void pyramid_fill_kernels(KernelTable &table, uint32_t features) {
+    table.pyrDownV = pyr_down_v_c;
+    table.pyrDownH = pyr_down_h_c;
+    table.pyrUpV = pyr_up_v_c;
+    table.pyrUpH = pyr_up_h_c;
+    table.pyrAccumulate = pyr_accumulate_c;
+#if SIMD_128
+    if (features & SIMD_128_FEATURE) {
+        table.pyrDownV = pyr_down_v_simd;
+        table.pyrDownH = pyr_down_h_simd;
+        table.pyrUpV = pyr_up_v_simd;
+        table.pyrUpH = pyr_up_h_simd;
+        table.pyrAccumulate = pyr_accumulate_simd;
+    }
+#endif
+}
+
+static inline int align_up(int n) {
+    return (n + ROW_ALIGN - 1) / ROW_ALIGN * ROW_ALIGN;
+}
+
+Pyramid::Pyramid(int width, int height, int levelCount) {
+    if (levelCount <= 0 || levelCount > PYRAMID_MAX_LEVELS) {
+        levelCount = PYRAMID_MAX_LEVELS;
+    }
+    size_t total = 0;
+    for (int i = 0; i < levelCount; i++) {
+        PyramidLevel level;
+        level.width = ((width - 1) >> i) + 1;
+        level.height = ((height - 1) >> i) + 1;
+        if (i > 0 && (level.width < 2 || level.height < 2)) {
+            break;
+        }
+        level.stride = align_up(level.width);
+        levels.push_back(level);
+        total += (size_t)level.stride * level.height;
+    }
+
+    int16_t *p = arena.alloc<int16_t>(total);
+    for (auto &level : levels) {
+        level.data = p;
+        p += (size_t)level.stride * level.height;
+    }
+}
+
+void pyramid_load_u8(Pyramid &pyramid, const uint8_t *src, int srcRowStride, int srcPixelStride) {
+    const PyramidLevel &level = pyramid.level(0);
+    parallel_for_stripes(level.height, MIN_STRIPE_ROWS, [&](int rowStart, int rowEnd) {
+        for (int row = rowStart; row < rowEnd; row++) {
+            const uint8_t *s = src + (size_t)row * srcRowStride;
+            int16_t *d = level.data + (size_t)row * level.stride;
+            for (int x = 0; x < level.width; x++) {
+                d[x] = (int16_t)(s[x * srcPixelStride] << PYRAMID_U8_SHIFT);
+            }
+        }
+    });
+}
+
+void pyramid_load_s16(Pyramid &pyramid, const int16_t *src, int srcRowStride) {
+    const PyramidLevel &level = pyramid.level(0);
+    for (int row = 0; row < level.height; row++) {
+        memcpy(level.data + (size_t)row * level.stride, (const uint8_t *)src + (size_t)row * srcRowStride,
+               level.width * sizeof(int16_t));
+    }
+}
+
+void pyramid_store_u8(const Pyramid &pyramid, uint8_t *dst, int dstRowStride, int dstPixelStride) {
+    const PyramidLevel &level = pyramid.level(0);
+    parallel_for_stripes(level.height, MIN_STRIPE_ROWS, [&](int rowStart, int rowEnd) {
+        for (int row = rowStart; row < rowEnd; row++) {
+            const int16_t *s = level.data + (size_t)row * level.stride;
+            uint8_t *d = dst + (size_t)row * dstRowStride;
+            for (int x = 0; x < level.width; x++) {
+                d[x * dstPixelStride] = sat_u8((s[x] + (1 << (PYRAMID_U8_SHIFT - 1))) >> PYRAMID_U8_SHIFT);
+            }
+        }
+    });
+}
+
+static inline const int16_t *level_row(const PyramidLevel &level, int row) {
+    row = std::min(std::max(row, 0), level.height - 1);
+    return level.data + (size_t)row * level.stride;
+}
+
+void pyramid_gaussian(Pyramid &pyramid) {
+    const KernelTable &kt = kernel_table();
+    for (int i = 1; i < pyramid.getLevels(); i++) {
+        const PyramidLevel &src = pyramid.level(i - 1);
+        const PyramidLevel &dst = pyramid.level(i);
+        parallel_for_stripes(dst.height, MIN_STRIPE_ROWS, [&](int rowStart, int rowEnd) {
+            // Vertically filtered source row, with 2 edge pixels repeated on both sides
+            FrameArena scratch;
+            int16_t *row = scratch.alloc<int16_t>(src.width + 4 + ROW_SLACK) + 2;
+            for (int y = rowStart; y < rowEnd; y++) {
+                const int16_t *rows[5];
+                for (int j = 0; j < 5; j++) {
+                    rows[j] = level_row(src, 2 * y - 2 + j);
+                }
+                kt.pyrDownV(rows, row, src.width);
+                row[-2] = row[-1] = row[0];
+                row[src.width] = row[src.width + 1] = row[src.width - 1];
+                kt.pyrDownH(row, dst.data + (size_t)y * dst.stride, dst.width);
+            }
+        });
+    }
+}
+
+/**
+ * fine +/-= expand(coarse)
+ * */
+static void expand_into(const PyramidLevel &coarse, const PyramidLevel &fine, bool subtract) {
+    const KernelTable &kt = kernel_table();
+    parallel_for_stripes(fine.height, MIN_STRIPE_ROWS, [&](int rowStart, int rowEnd) {
+        FrameArena scratch;
+        int16_t *row = scratch.alloc<int16_t>(coarse.width + 2 + ROW_SLACK) + 1;
+        for (int y = rowStart; y < rowEnd; y++) {
+            int k = y >> 1;
+            const int16_t *rows[3] = {level_row(coarse, k - 1), level_row(coarse, k), level_row(coarse, k + 1)};
+            kt.pyrUpV(rows, row, coarse.width, y & 1);
+            row[-1] = row[0];
+            row[coarse.width] = row[coarse.width - 1];
+            kt.pyrUpH(row, fine.data + (size_t)y * fine.stride, fine.width, subtract);
+        }
+    });
+}
+
+void pyramid_laplacian(Pyramid &pyramid) {
+    for (int i = 0; i + 1 < pyramid.getLevels(); i++) {
+        expand_into(pyramid.level(i + 1), pyramid.level(i), true);
+    }
+}
+
+void pyramid_collapse(Pyramid &pyramid) {
+    for (int i = pyramid.getLevels() - 2; i >= 0; i--) {
+        expand_into(pyramid.level(i + 1), pyramid.level(i), false);
+    }
+}
+
+void pyramid_clear(Pyramid &pyramid) {
+    for (int i = 0; i < pyramid.getLevels(); i++) {
+        const PyramidLevel &level = pyramid.level(i);
+        memset(level.data, 0, (size_t)level.stride * level.height * sizeof(int16_t));
+    }
+}
+
+void pyramid_accumulate(Pyramid &acc, const Pyramid &src, const Pyramid &weight, int weightLevelOffset) {
+    const KernelTable &kt = kernel_table();
+    int levels = std::min(acc.getLevels(), weight.getLevels() - weightLevelOffset);
+    for (int i = 0; i < levels; i++) {
+        const PyramidLevel &a = acc.level(i);
+        const PyramidLevel &s = src.level(i);
+        const PyramidLevel &w = weight.level(i + weightLevelOffset);
+        if (w.width != a.width || w.height != a.height) {
+            LOGE(TAG, "weight level %d is %dx%d, not %dx%d", i + weightLevelOffset, w.width, w.height,
+                 a.width, a.height);
+            return;
+        }
+        parallel_for_stripes(a.height, MIN_STRIPE_ROWS, [&](int rowStart, int rowEnd) {
+            for (int y = rowStart; y < rowEnd; y++) {
+                kt.pyrAccumulate(s.data + (size_t)y * s.stride, w.data + (size_t)y * w.stride,
+                                 a.data + (size_t)y * a.stride, a.width);
+            }
+        });
+    }
+}
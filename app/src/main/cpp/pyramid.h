@@ -0,0 +1,99 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#ifndef CAMERAUTIL_PYRAMID_H
+#define CAMERAUTIL_PYRAMID_H
+
+#include "frame_arena.h"
+#include <stdint.h>
+#include <vector>
+
+/**
+ * 高斯/拉普拉斯金字塔，每层都是int16平面。
+ *
+ * 滤波是可分离的5抽头[1 4 6 4 1] / 16，缩小时先垂直再水平，放大时先垂直再水平，
+ * 每一步都在16位内完成并单独舍入，所以SIMD与标量版本逐位一致。
+ * 拉普拉斯金字塔由高斯金字塔原地生成（L_i = G_i - expand(G_i+1)），合成（collapse）也是原地的，
+ * 两者使用同一个expand，所以整数意义上完全可逆。
+ *
+ * 数值范围：缩小要求|v| < 2048，放大要求|v| < 4096，所以8位平面按Q3（<< PYRAMID_U8_SHIFT）存放，
+ * 16位平面最多11位加符号位。
+ *
+ * 所有层放在同一块内存里，从FrameArena申请，Pyramid析构后回到空闲链表，下一个同样大小级别的
+ * 金字塔直接复用，连续处理多帧时不会反复申请大块内存。
+ * */
+
+#define PYRAMID_U8_SHIFT 3
+#define PYRAMID_MAX_LEVELS 16
+
+struct PyramidLevel {
+    int16_t *data = nullptr;
+    int width = 0;
+    int height = 0;
+    // In elements
+    int stride = 0;
+};
+
+class Pyramid {
+public:
+    /**
+     * Level i is ((width - 1) >> i) + 1 wide. Levels stop before a side gets shorter than 2, so
+     * getLevels() may be less than levels; levels <= 0 means as many as fit.
+     * */
+    Pyramid(int width, int height, int levels);
+    Pyramid(Pyramid &) = delete;
+
+    int getLevels() const {
+        return (int)levels.size();
+    }
+
+    const PyramidLevel &level(int i) const {
+        return levels[i];
+    }
+
+private:
+    FrameArena arena;
+    std::vector<PyramidLevel> levels;
+};
+
+/**
+ * Load level 0 from an 8 bit plane as Q3, or from a 16 bit plane as is. Strides in bytes,
+ * pixelStride 2 reads one plane of interleaved NV12 / NV21 chroma.
+ * */
+void pyramid_load_u8(Pyramid &pyramid, const uint8_t *src, int srcRowStride, int srcPixelStride = 1);
+void pyramid_load_s16(Pyramid &pyramid, const int16_t *src, int srcRowStride);
+
+/**
+ * Round level 0 from Q3 back to an 8 bit plane, saturated.
+ * */
+void pyramid_store_u8(const Pyramid &pyramid, uint8_t *dst, int dstRowStride, int dstPixelStride = 1);
+
+/**
+ * Fill levels 1.. from level 0.
+ * */
+void pyramid_gaussian(Pyramid &pyramid);
+
+/**
+ * Turn a Gaussian pyramid into a Laplacian one, in place. The last level stays Gaussian.
+ * */
+void pyramid_laplacian(Pyramid &pyramid);
+
+/**
+ * Turn a Laplacian pyramid back into level 0, in place. Levels above 0 are Gaussian afterwards.
+ * */
+void pyramid_collapse(Pyramid &pyramid);
+
+/**
+ * Fill every level with 0.
+ * */
+void pyramid_clear(Pyramid &pyramid);
+
+/**
+ * acc += (src * weight + 512) >> 10 on every level, weight is Q10 in [0, 1024].
+ * weight may have more levels than acc, and its level (i + weightLevelOffset) must be the size of
+ * acc's level i: chroma pyramids use 1 with weights at luma resolution.
+ * */
+void pyramid_accumulate(Pyramid &acc, const Pyramid &src, const Pyramid &weight, int weightLevelOffset);
+
+#endif //CAMERAUTIL_PYRAMID_H
@@ -0,0 +1,473 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#include "raw_pipeline.h"
+#include "lens_shading.h"
+#include "yuv_kernels.h"
+#include "dispatch.h"
+#include "cpu_features.h"
+#include "parallel.h"
+#include "simd.h"
+#include "frame_arena.h"
+#include "log.h"
+#include <math.h>
+#include <limits.h>
+#include <string.h>
+#include <memory>
+#include <mutex>
+
+using namespace std;
+
+#define TAG "raw_pipeline.cpp"
+
+// 1.0 of normalized linear light, Q14
+#define LINEAR_BITS 14
+#define LINEAR_ONE (1 << LINEAR_BITS)
+#define MATRIX_BITS 12
+// Demosaic filters are in 1/16.
+#define FILTER_BITS 4
+#define RING_ROWS 5
+#define ROW_PAD 8
+#define MIN_STRIPE_ROWS 16
+
+#define COLOR_R 0
+#define COLOR_G 1
+#define COLOR_B 2
+
+/**
+ * Neighbours of a site in the 5x5 window. Pixels two columns apart are in the same
+ * half-width plane as the site, horizontal and diagonal neighbours in the other one.
+ * */
+#define TAP_CENTER 0
+#define TAP_LEFT2 1
+#define TAP_RIGHT2 2
+#define TAP_UP2 3
+#define TAP_DOWN2 4
+#define TAP_UP1 5
+#define TAP_DOWN1 6
+#define TAP_LEFT1 7
+#define TAP_RIGHT1 8
+#define TAP_UP_LEFT 9
+#define TAP_UP_RIGHT 10
+#define TAP_DOWN_LEFT 11
+#define TAP_DOWN_RIGHT 12
+#define RAW_TAPS 13
+
+static const int16_t FILTER_CENTER[RAW_TAPS] = {16, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+
+static const int16_t FILTER_CROSS_BILINEAR[RAW_TAPS] = {0, 0, 0, 0, 0, 4, 4, 4, 4, 0, 0, 0, 0};
+static const int16_t FILTER_H_BILINEAR[RAW_TAPS] = {0, 0, 0, 0, 0, 0, 0, 8, 8, 0, 0, 0, 0};
+static const int16_t FILTER_V_BILINEAR[RAW_TAPS] = {0, 0, 0, 0, 0, 8, 8, 0, 0, 0, 0, 0, 0};
+static const int16_t FILTER_DIAG_BILINEAR[RAW_TAPS] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 4, 4, 4, 4};
+
+/**
+ * Malvar, He, Cutler, "High-quality linear interpolation for demosaicing of Bayer-patterned
+ * color images", 2004. The bilinear estimate plus the Laplacian of the site's own colour.
+ * */
+static const int16_t FILTER_CROSS_GRADIENT[RAW_TAPS] = {8, -2, -2, -2, -2, 4, 4, 4, 4, 0, 0, 0, 0};
+static const int16_t FILTER_H_GRADIENT[RAW_TAPS] = {10, -2, -2, 1, 1, 0, 0, 8, 8, -2, -2, -2, -2};
+static const int16_t FILTER_V_GRADIENT[RAW_TAPS] = {10, 1, 1, -2, -2, 8, 8, 0, 0, -2, -2, -2, -2};
+static const int16_t FILTER_DIAG_GRADIENT[RAW_TAPS] = {12, -3, -3, -3, -3, 0, 0, 0, 0, 4, 4, 4, 4};
+
+static const int8_t CFA_COLORS[4][2][2] = {
+        {{COLOR_R, COLOR_G}, {COLOR_G, COLOR_B}},
+        {{COLOR_G, COLOR_R}, {COLOR_B, COLOR_G}},
+        {{COLOR_G, COLOR_B}, {COLOR_R, COLOR_G}},
+        {{COLOR_B, COLOR_G}, {COLOR_G, COLOR_R}},
+};
+
+struct GammaTable {
+    float gamma;
+    uint8_t value[LINEAR_ONE + 1];
+};
+
+static mutex gammaMutex;
+static shared_ptr<const GammaTable> lastGamma;
+
+static inline int16_t sat_s16(int32_t n) {
+    return (int16_t)(n < -32768 ? -32768 : (n > 32767 ? 32767 : n));
+}
+
+static inline int32_t clamp_i32(int32_t n, int32_t max) {
+    return n < 0 ? 0 : (n > max ? max : n);
+}
+
+static inline int32_t round_shift(int32_t n, int shift) {
+    return shift == 0 ? n : (n + (1 << (shift - 1))) >> shift;
+}
+
+/**
+ * Black level, white level, white balance and lens shading gain of one pixel, Q14.
+ * The subtraction of the black level wraps like int16 lanes do.
+ * */
+static inline int16_t normalize_pixel(uint16_t raw, int16_t black, int16_t scale, int shift,
+                                      const ShadingRow *shading, int x) {
+    int32_t n = round_shift((int16_t)(raw - black) * scale, shift);
+    if (shading != nullptr) {
+        int32_t gain = shading->top[x] +
+                       (((shading->bottom[x] - shading->top[x]) * shading->weight + (1 << 14)) >> 15);
+        n = round_shift(sat_s16(n) * gain, LENS_SHADING_GAIN_BITS);
+    }
+    return (int16_t)clamp_i32(n, LINEAR_ONE);
+}
+
+/**
+ * One row into its even and odd column planes. black and scale are for even and odd columns,
+ * shading is nullptr or the gains of even and odd columns.
+ * */
+static inline void raw_normalize_tail(int x, const uint16_t *raw, int halfWidth, const int16_t *black,
+                                      const int16_t *scale, int shift, const ShadingRow *shading,
+                                      int16_t *even, int16_t *odd) {
+    for (; x < halfWidth; x++) {
+        even[x] = normalize_pixel(raw[2 * x], black[0], scale[0], shift, shading, x);
+        odd[x] = normalize_pixel(raw[2 * x + 1], black[1], scale[1], shift, shading ? shading + 1 : nullptr, x);
+    }
+}
+
+static void raw_normalize_c(const uint16_t *raw, int halfWidth, const int16_t *black, const int16_t *scale,
+                            int shift, const ShadingRow *shading, int16_t *even, int16_t *odd) {
+    raw_normalize_tail(0, raw, halfWidth, black, scale, shift, shading, even, odd);
+}
+
+static inline void site_taps(const int16_t *const *same, const int16_t *const *other, int leftOffset, int x,
+                             int32_t *t) {
+    t[TAP_CENTER] = same[2][x];
+    t[TAP_LEFT2] = same[2][x - 1];
+    t[TAP_RIGHT2] = same[2][x + 1];
+    t[TAP_UP2] = same[0][x];
+    t[TAP_DOWN2] = same[4][x];
+    t[TAP_UP1] = same[1][x];
+    t[TAP_DOWN1] = same[3][x];
+    int l = x + leftOffset;
+    t[TAP_LEFT1] = other[2][l];
+    t[TAP_RIGHT1] = other[2][l + 1];
+    t[TAP_UP_LEFT] = other[1][l];
+    t[TAP_UP_RIGHT] = other[1][l + 1];
+    t[TAP_DOWN_LEFT] = other[3][l];
+    t[TAP_DOWN_RIGHT] = other[3][l + 1];
+}
+
+/**
+ * even and odd are 5 rows of planes centred on the output row, coefficients are
+ * [column parity][R, G, B][RAW_TAPS]. rgb gets planar R, G, B rows of 2 * halfWidth.
+ * */
+static inline void raw_demosaic_tail(int x, const int16_t *const *even, const int16_t *const *odd,
+                                     const int16_t *coefficients, int16_t *rgb, int halfWidth) {
+    int width = halfWidth * 2;
+    int32_t t[RAW_TAPS];
+    for (; x < halfWidth; x++) {
+        for (int site = 0; site < 2; site++) {
+            // The left neighbour of an even column is odd column x - 1, of an odd column even column x.
+            site_taps(site == 0 ? even : odd, site == 0 ? odd : even, site == 0 ? -1 : 0, x, t);
+            for (int c = 0; c < 3; c++) {
+                const int16_t *filter = coefficients + (site * 3 + c) * RAW_TAPS;
+                int32_t sum = 0;
+                for (int i = 0; i < RAW_TAPS; i++) {
+                    sum += filter[i] * t[i];
+                }
+                rgb[c * width + 2 * x + site] = sat_s16(round_shift(sum, FILTER_BITS));
+            }
+        }
+    }
+}
+
+static void raw_demosaic_c(const int16_t *const *even, const int16_t *const *odd, const int16_t *coefficients,
+                           int16_t *rgb, int halfWidth) {
+    raw_demosaic_tail(0, even, odd, coefficients, rgb, halfWidth);
+}
+
+#if SIMD_128
+static inline v_s16x8 normalize(v_s16x8 v, int16_t scale, int shift, const ShadingRow *shading, int x) {
+    v_s32x4 lo = v_mlal_lo_n(v_dup_s32(0), v, scale);
+    v_s32x4 hi = v_mlal_hi_n(v_dup_s32(0), v, scale);
+    v_s16x8 n = v_narrow_sat_s16(v_rshr_var(lo, shift), v_rshr_var(hi, shift));
+    if (shading != nullptr) {
+        v_s16x8 top = v_load_s16x8(shading->top + x);
+        v_s16x8 gain = v_add(top, v_mulhrs_n(v_sub(v_load_s16x8(shading->bottom + x), top), shading->weight));
+        lo = v_mlal_lo(v_dup_s32(0), n, gain);
+        hi = v_mlal_hi(v_dup_s32(0), n, gain);
+        n = v_narrow_sat_s16(v_rshr<LENS_SHADING_GAIN_BITS>(lo), v_rshr<LENS_SHADING_GAIN_BITS>(hi));
+    }
+    return v_min(v_max(n, v_dup_s16(0)), v_dup_s16(LINEAR_ONE));
+}
+
+static void raw_normalize_simd(const uint16_t *raw, int halfWidth, const int16_t *black, const int16_t *scale,
+                               int shift, const ShadingRow *shading, int16_t *even, int16_t *odd) {
+    const v_s16x8 blackEven = v_dup_s16(black[0]);
+    const v_s16x8 blackOdd = v_dup_s16(black[1]);
+    const ShadingRow *shadingOdd = shading ? shading + 1 : nullptr;
+    int x = 0;
+    for (; x + 8 <= halfWidth; x += 8) {
+        v_s16x8 e, o;
+        v_load_deinterleave((const int16_t *)raw + 2 * x, e, o);
+        v_store(even + x, normalize(v_sub(e, blackEven), scale[0], shift, shading, x));
+        v_store(odd + x, normalize(v_sub(o, blackOdd), scale[1], shift, shadingOdd, x));
+    }
+    raw_normalize_tail(x, raw, halfWidth, black, scale, shift, shading, even, odd);
+}
+
+static inline void load_site_taps(const int16_t *const *same, const int16_t *const *other, int leftOffset, int x,
+                                  v_s16x8 *t) {
+    t[TAP_CENTER] = v_load_s16x8(same[2] + x);
+    t[TAP_LEFT2] = v_load_s16x8(same[2] + x - 1);
+    t[TAP_RIGHT2] = v_load_s16x8(same[2] + x + 1);
+    t[TAP_UP2] = v_load_s16x8(same[0] + x);
+    t[TAP_DOWN2] = v_load_s16x8(same[4] + x);
+    t[TAP_UP1] = v_load_s16x8(same[1] + x);
+    t[TAP_DOWN1] = v_load_s16x8(same[3] + x);
+    int l = x + leftOffset;
+    t[TAP_LEFT1] = v_load_s16x8(other[2] + l);
+    t[TAP_RIGHT1] = v_load_s16x8(other[2] + l + 1);
+    t[TAP_UP_LEFT] = v_load_s16x8(other[1] + l);
+    t[TAP_UP_RIGHT] = v_load_s16x8(other[1] + l + 1);
+    t[TAP_DOWN_LEFT] = v_load_s16x8(other[3] + l);
+    t[TAP_DOWN_RIGHT] = v_load_s16x8(other[3] + l + 1);
+}
+
+static inline v_s16x8 apply_filter(const v_s16x8 *t, const int16_t *filter) {
+    v_s32x4 lo = v_dup_s32(0), hi = v_dup_s32(0);
+    for (int i = 0; i < RAW_TAPS; i++) {
+        // Most taps are 0, the branch goes the same way for the whole row.
+        if (filter[i] != 0) {
+            lo = v_mlal_lo_n(lo, t[i], filter[i]);
+            hi = v_mlal_hi_n(hi, t[i], filter[i]);
+        }
+    }
+    return v_narrow_sat_s16(v_rshr<FILTER_BITS>(lo), v_rshr<FILTER_BITS>(hi));
+}
+
+/**
+ * 8 even and 8 odd sites per iteration, zipped back into 16 pixels of every colour.
+ * */
+static void raw_demosaic_simd(const int16_t *const *even, const int16_t *const *odd, const int16_t *coefficients,
+                              int16_t *rgb, int halfWidth) {
+    int width = halfWidth * 2;
+    v_s16x8 evenTaps[RAW_TAPS], oddTaps[RAW_TAPS];
+    int x = 0;
+    for (; x + 8 <= halfWidth; x += 8) {
+        load_site_taps(even, odd, -1, x, evenTaps);
+        load_site_taps(odd, even, 0, x, oddTaps);
+        for (int c = 0; c < 3; c++) {
+            v_s16x8 e = apply_filter(evenTaps, coefficients + c * RAW_TAPS);
+            v_s16x8 o = apply_filter(oddTaps, coefficients + (3 + c) * RAW_TAPS);
+            v_s16x8 lo, hi;
+            v_zip(e, o, lo, hi);
+            v_store(rgb + c * width + 2 * x, lo);
+            v_store(rgb + c * width + 2 * x + 8, hi);
+        }
+    }
+    raw_demosaic_tail(x, even, odd, coefficients, rgb, halfWidth);
+}
+#endif
+
+void raw_fill_kernels(KernelTable &table, uint32_t features) {
+    table.rawNormalize = raw_normalize_c;
+    table.rawDemosaic = raw_demosaic_c;
+#if SIMD_128
+    if (features & SIMD_128_FEATURE) {
+        table.rawNormalize = raw_normalize_simd;
+        table.rawDemosaic = raw_demosaic_simd;
+    }
+#endif
+}
+
+static shared_ptr<const GammaTable> gamma_table(float gamma) {
+    lock_guard<mutex> lock(gammaMutex);
+    if (lastGamma && lastGamma->gamma == gamma) {
+        return lastGamma;
+    }
+    auto table = make_shared<GammaTable>();
+    table->gamma = gamma;
+    for (int i = 0; i <= LINEAR_ONE; i++) {
+        double x = (double)i / LINEAR_ONE;
+        double y;
+        if (gamma > 0) {
+            y = pow(x, 1.0 / gamma);
+        } else {
+            y = x <= 0.0031308 ? 12.92 * x : 1.055 * pow(x, 1.0 / 2.4) - 0.055;
+        }
+        table->value[i] = (uint8_t)lround(y * 255.0);
+    }
+    lastGamma = table;
+    return table;
+}
+
+/**
+ * Filters for each site of the CFA, [row parity][column parity][R, G, B][RAW_TAPS].
+ * */
+static void build_filters(int cfa, int demosaic, int16_t *filters) {
+    bool gradient = demosaic == RAW_DEMOSAIC_GRADIENT;
+    const int8_t (*colors)[2] = CFA_COLORS[cfa];
+    for (int rp = 0; rp < 2; rp++) {
+        for (int cp = 0; cp < 2; cp++) {
+            int center = colors[rp][cp];
+            int horizontal = colors[rp][1 - cp];
+            for (int c = 0; c < 3; c++) {
+                const int16_t *filter;
+                if (c == center) {
+                    filter = FILTER_CENTER;
+                } else if (center == COLOR_G) {
+                    if (c == horizontal) {
+                        filter = gradient ? FILTER_H_GRADIENT : FILTER_H_BILINEAR;
+                    } else {
+                        filter = gradient ? FILTER_V_GRADIENT : FILTER_V_BILINEAR;
+                    }
+                } else if (c == COLOR_G) {
+                    filter = gradient ? FILTER_CROSS_GRADIENT : FILTER_CROSS_BILINEAR;
+                } else {
+                    filter = gradient ? FILTER_DIAG_GRADIENT : FILTER_DIAG_BILINEAR;
+                }
+                memcpy(filters + ((rp * 2 + cp) * 3 + c) * RAW_TAPS, filter, sizeof(int16_t) * RAW_TAPS);
+            }
+        }
+    }
+}
+
+/**
+ * Reflect around the first and last row or column without repeating it, the CFA phase is kept.
+ * */
+static inline int mirror(int i, int size) {
+    return i < 0 ? -i : (i >= size ? 2 * (size - 1) - i : i);
+}
+
+bool raw_to_rgba(const RawFrame &frame, const RawParams &params, uint32_t *dst, int rotation, int facing) {
+    int width = frame.width, height = frame.height;
+    if (width < 4 || height < 4 || (width & 1) || (height & 1)) {
+        LOGE(TAG, "unsupported raw size %dx%d", width, height);
+        return false;
+    }
+    int rowBytes = raw_row_bytes(frame.packing, width);
+    if (rowBytes < 0 || frame.rowStride < rowBytes) {
+        LOGE(TAG, "unsupported packing %d, width %d, rowStride %d", frame.packing, width, frame.rowStride);
+        return false;
+    }
+    if (params.cfa < RAW_CFA_RGGB || params.cfa > RAW_CFA_BGGR) {
+        LOGE(TAG, "unsupported cfa %d", params.cfa);
+        return false;
+    }
+    if (params.whiteLevel > 32767) {
+        LOGE(TAG, "white level %.0f too large", params.whiteLevel);
+        return false;
+    }
+
+    // Per CFA site: Q14 = (raw - black) * scale >> shift, with a shift shared by all sites.
+    int16_t black[2][2], scale[2][2];
+    int channels[2][2];
+    double k[2][2], maxK = 0;
+    const int8_t (*colors)[2] = CFA_COLORS[params.cfa];
+    for (int rp = 0; rp < 2; rp++) {
+        bool redRow = colors[rp][0] == COLOR_R || colors[rp][1] == COLOR_R;
+        for (int cp = 0; cp < 2; cp++) {
+            int color = colors[rp][cp];
+            int channel = color == COLOR_R ? 0 : (color == COLOR_B ? 3 : (redRow ? 1 : 2));
+            channels[rp][cp] = channel;
+            float blackLevel = params.blackLevel[rp * 2 + cp];
+            if (!(params.whiteLevel > blackLevel) || blackLevel < 0) {
+                LOGE(TAG, "bad black level %.1f, white level %.1f", blackLevel, params.whiteLevel);
+                return false;
+            }
+            black[rp][cp] = (int16_t)lroundf(blackLevel);
+            k[rp][cp] = params.wbGains[channel] * LINEAR_ONE / (params.whiteLevel - blackLevel);
+            maxK = fmax(maxK, k[rp][cp]);
+        }
+    }
+    int shift = 0;
+    while (shift < 24 && maxK * (1 << (shift + 1)) < 32767.0) {
+        shift++;
+    }
+    if (maxK * (1 << shift) >= 32767.5) {
+        LOGE(TAG, "gain %.1f too large", maxK);
+        return false;
+    }
+    for (int rp = 0; rp < 2; rp++) {
+        for (int cp = 0; cp < 2; cp++) {
+            scale[rp][cp] = (int16_t)lround(k[rp][cp] * (1 << shift));
+        }
+    }
+
+    int16_t filters[2 * 2 * 3 * RAW_TAPS];
+    build_filters(params.cfa, params.demosaic, filters);
+    int16_t ccm[9];
+    for (int i = 0; i < 9; i++) {
+        ccm[i] = sat_s16((int32_t)lroundf(params.ccm[i] * (1 << MATRIX_BITS)));
+    }
+    auto gamma = gamma_table(params.gamma);
+    shared_ptr<const LensShading> shading;
+    if (params.shading.gains != nullptr) {
+        shading = lens_shading(params.shading, width, height, LENS_SHADING_LAYOUT_BAYER);
+        if (!shading) {
+            return false;
+        }
+    }
+
+    int origin, rowStep, colStep;
+    yuv_output_layout(width, height, rotation, facing, origin, rowStep, colStep);
+    const KernelTable &kt = kernel_table();
+    int halfWidth = width / 2;
+    int planeSize = halfWidth + 2 * ROW_PAD;
+
+    parallel_for_stripes(height, MIN_STRIPE_ROWS, [&](int rowStart, int rowEnd) {
+        // Normalized rows rowStart - 2 .. rowEnd + 1, each as even and odd column planes.
+        FrameArena scratch;
+        int16_t *ring = scratch.alloc<int16_t>((size_t)RING_ROWS * 2 * planeSize);
+        int ringRow[RING_ROWS];
+        for (int &r : ringRow) {
+            r = INT_MIN;
+        }
+        int16_t *rgb = scratch.alloc<int16_t>((size_t)width * 3);
+        uint16_t *unpacked = frame.packing == RAW_PACKING_16 ? nullptr : scratch.alloc<uint16_t>(width);
+        const uint8_t *toGamma = gamma->value;
+
+        auto planes = [&](int row) {
+            int slot = (row % RING_ROWS + RING_ROWS) % RING_ROWS;
+            int16_t *even = ring + (size_t)slot * 2 * planeSize + ROW_PAD;
+            int16_t *odd = even + planeSize;
+            if (ringRow[slot] != row) {
+                int src = mirror(row, height);
+                auto raw = (const uint16_t *)((const uint8_t *)frame.data + (size_t)src * frame.rowStride);
+                if (frame.packing == RAW_PACKING_10) {
+                    kt.rawUnpack10((const uint8_t *)raw, unpacked, width);
+                    raw = unpacked;
+                } else if (frame.packing == RAW_PACKING_12) {
+                    kt.rawUnpack12((const uint8_t *)raw, unpacked, width);
+                    raw = unpacked;
+                }
+                ShadingRow gains[2];
+                if (shading) {
+                    gains[0] = shading->row(channels[src & 1][0], 0, src);
+                    gains[1] = shading->row(channels[src & 1][1], 1, src);
+                }
+                kt.rawNormalize(raw, halfWidth, black[src & 1], scale[src & 1], shift, shading ? gains : nullptr,
+                                even, odd);
+                // Column -1 is column 1, -2 is 2, width is width - 2 and width + 1 is width - 3.
+                even[-1] = even[1];
+                odd[-1] = odd[0];
+                even[halfWidth] = even[halfWidth - 1];
+                odd[halfWidth] = odd[halfWidth - 2];
+                ringRow[slot] = row;
+            }
+            return even;
+        };
+
+        const int16_t *even[RING_ROWS], *odd[RING_ROWS];
+        for (int row = rowStart; row < rowEnd; row++) {
+            for (int i = 0; i < RING_ROWS; i++) {
+                even[i] = planes(row - 2 + i);
+                odd[i] = even[i] + planeSize;
+            }
+            kt.rawDemosaic(even, odd, filters + (row & 1) * 2 * 3 * RAW_TAPS, rgb, halfWidth);
+            kt.rgbMatrix(rgb, width, ccm);
+
+            const int16_t *r = rgb, *g = r + width, *b = g + width;
+            uint32_t *out = dst + origin + row * rowStep;
+            for (int col = 0; col < width; col++) {
+                out[col * colStep] = (0xFFu << 24) |
+                                     ((uint32_t)toGamma[clamp_i32(b[col], LINEAR_ONE)] << 16) |
+                                     ((uint32_t)toGamma[clamp_i32(g[col], LINEAR_ONE)] << 8) |
+                                     toGamma[clamp_i32(r[col], LINEAR_ONE)];
+            }
+        }
+    });
+    return true;
+}
@@ -0,0 +1,67 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#ifndef CAMERAUTIL_RAW_PIPELINE_H
+#define CAMERAUTIL_RAW_PIPELINE_H
+
+#include "raw_unpack.h"
+#include "lens_shading.h"
+#include <stdint.h>
+
+/**
+ * RAW_SENSOR（16位Bayer）转RGBA，步骤和相机ISP的顺序一致：
+ * 1. 减黑电平（BlackLevelPattern），按白电平归一化，乘白平衡增益（RggbChannelVector）和可选的镜头暗角增益，
+ *    截断到[0, 1]；
+ * 2. 去马赛克，双线性或者Malvar-He-Cutler梯度修正插值（5x5）；
+ * 3. 3x3 CCM（ColorSpaceTransform），相机RGB转线性sRGB；
+ * 4. gamma查表，输出8位。
+ *
+ * 每个stripe用5行的环形缓冲，1在读入一行RAW时完成，2、3、4在输出一行时完成，
+ * 所以每个RAW像素只读一次，中间结果都在缓存里。RAW10、RAW12在读入时逐行解包，不需要整帧的16位副本。
+ * 旋转和镜像规则与yuv_kernels相同。
+ * */
+
+// CameraCharacteristics.SENSOR_INFO_COLOR_FILTER_ARRANGEMENT
+#define RAW_CFA_RGGB 0
+#define RAW_CFA_GRBG 1
+#define RAW_CFA_GBRG 2
+#define RAW_CFA_BGGR 3
+
+#define RAW_DEMOSAIC_BILINEAR 0
+#define RAW_DEMOSAIC_GRADIENT 1
+
+struct RawFrame {
+    const void *data = nullptr;
+    // In bytes
+    int rowStride = 0;
+    int packing = RAW_PACKING_16;
+    // Both even, width a multiple of 4 for RAW_PACKING_10
+    int width = 0;
+    int height = 0;
+};
+
+struct RawParams {
+    int cfa = RAW_CFA_RGGB;
+    // BlackLevelPattern, row major over the 2x2 CFA block.
+    float blackLevel[4] = {64, 64, 64, 64};
+    // Up to 32767
+    float whiteLevel = 1023;
+    // RggbChannelVector: R, G in R rows, G in B rows, B
+    float wbGains[4] = {1, 1, 1, 1};
+    // ColorSpaceTransform, row major, white balanced camera RGB to linear sRGB
+    float ccm[9] = {1, 0, 0, 0, 1, 0, 0, 0, 1};
+    int demosaic = RAW_DEMOSAIC_GRADIENT;
+    // Power law gamma, 0 for the sRGB curve
+    float gamma = 0;
+    // STATISTICS_LENS_SHADING_CORRECTION_MAP, not applied if gains is nullptr
+    LensShadingMap shading;
+};
+
+/**
+ * Convert into dst, yuv_output_size(width, height, rotation) RGBA pixels, packed.
+ * Return false if the frame or params are not supported.
+ * */
+bool raw_to_rgba(const RawFrame &frame, const RawParams &params, uint32_t *dst, int rotation, int facing);
+
+#endif //CAMERAUTIL_RAW_PIPELINE_H
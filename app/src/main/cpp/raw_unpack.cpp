@@ -0,0 +1,137 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#include "raw_unpack.h"
+#include "dispatch.h"
+#include "cpu_features.h"
+#include "parallel.h"
+#include "simd.h"
+#include "log.h"
+#include <string.h>
+
+#define TAG "raw_unpack.cpp"
+
+#define MIN_STRIPE_ROWS 16
+
+static void raw_unpack10_c(const uint8_t *src, uint16_t *dst, int width) {
+    for (int x = 0; x < width; x += 4, src += 5) {
+        uint8_t low = src[4];
+        dst[x] = (uint16_t)((src[0] << 2) | (low & 3));
+        dst[x + 1] = (uint16_t)((src[1] << 2) | ((low >> 2) & 3));
+        dst[x + 2] = (uint16_t)((src[2] << 2) | ((low >> 4) & 3));
+        dst[x + 3] = (uint16_t)((src[3] << 2) | (low >> 6));
+    }
+}
+
+static void raw_unpack12_c(const uint8_t *src, uint16_t *dst, int width) {
+    for (int x = 0; x < width; x += 2, src += 3) {
+        uint8_t low = src[2];
+        dst[x] = (uint16_t)((src[0] << 4) | (low & 15));
+        dst[x + 1] = (uint16_t)((src[1] << 4) | (low >> 4));
+    }
+}
+
+#if SIMD_128
+/**
+ * Every lane gets its high byte (or the byte with its low bits) into the upper half, then
+ * a logical shift drops it into place. The low bits are moved to the top of the lane first
+ * with a per-lane power of two multiply, the bits above them overflow and are lost.
+ * */
+static const uint8_t UNPACK10_HIGH[16] = {0xFF, 0, 0xFF, 1, 0xFF, 2, 0xFF, 3, 0xFF, 5, 0xFF, 6, 0xFF, 7, 0xFF, 8};
+static const uint8_t UNPACK10_LOW[16] = {0xFF, 4, 0xFF, 4, 0xFF, 4, 0xFF, 4, 0xFF, 9, 0xFF, 9, 0xFF, 9, 0xFF, 9};
+static const int16_t UNPACK10_SCALE[8] = {64, 16, 4, 1, 64, 16, 4, 1};
+
+static const uint8_t UNPACK12_HIGH[16] = {0xFF, 0, 0xFF, 1, 0xFF, 3, 0xFF, 4, 0xFF, 6, 0xFF, 7, 0xFF, 9, 0xFF, 10};
+static const uint8_t UNPACK12_LOW[16] = {0xFF, 2, 0xFF, 2, 0xFF, 5, 0xFF, 5, 0xFF, 8, 0xFF, 8, 0xFF, 11, 0xFF, 11};
+static const int16_t UNPACK12_SCALE[8] = {16, 1, 16, 1, 16, 1, 16, 1};
+
+// 8 pixels from 10 bytes
+static inline v_s16x8 unpack10(const uint8_t *src, v_u8x16 high, v_u8x16 low, v_s16x8 scale) {
+    v_u8x16 bytes = v_load_u8x16(src);
+    return v_add(v_shr_u16<6>(v_shuffle_s16(bytes, high)),
+                 v_shr_u16<14>(v_mul(v_shuffle_s16(bytes, low), scale)));
+}
+
+// 8 pixels from 12 bytes
+static inline v_s16x8 unpack12(const uint8_t *src, v_u8x16 high, v_u8x16 low, v_s16x8 scale) {
+    v_u8x16 bytes = v_load_u8x16(src);
+    return v_add(v_shr_u16<4>(v_shuffle_s16(bytes, high)),
+                 v_shr_u16<12>(v_mul(v_shuffle_s16(bytes, low), scale)));
+}
+
+static void raw_unpack10_simd(const uint8_t *src, uint16_t *dst, int width) {
+    const v_u8x16 high = v_load_u8x16(UNPACK10_HIGH);
+    const v_u8x16 low = v_load_u8x16(UNPACK10_LOW);
+    const v_s16x8 scale = v_load_s16x8(UNPACK10_SCALE);
+    int x = 0;
+    // Loads are 16 bytes for 10, stop before they run past the end of the row.
+    for (; x + 24 <= width; x += 16) {
+        const uint8_t *p = src + x / 4 * 5;
+        v_store((int16_t *)dst + x, unpack10(p, high, low, scale));
+        v_store((int16_t *)dst + x + 8, unpack10(p + 10, high, low, scale));
+    }
+    raw_unpack10_c(src + x / 4 * 5, dst + x, width - x);
+}
+
+static void raw_unpack12_simd(const uint8_t *src, uint16_t *dst, int width) {
+    const v_u8x16 high = v_load_u8x16(UNPACK12_HIGH);
+    const v_u8x16 low = v_load_u8x16(UNPACK12_LOW);
+    const v_s16x8 scale = v_load_s16x8(UNPACK12_SCALE);
+    int x = 0;
+    for (; x + 24 <= width; x += 16) {
+        const uint8_t *p = src + x / 2 * 3;
+        v_store((int16_t *)dst + x, unpack12(p, high, low, scale));
+        v_store((int16_t *)dst + x + 8, unpack12(p + 12, high, low, scale));
+    }
+    raw_unpack12_c(src + x / 2 * 3, dst + x, width - x);
+}
+#endif
+
+void raw_unpack_fill_kernels(KernelTable &table, uint32_t features) {
+    table.rawUnpack10 = raw_unpack10_c;
+    table.rawUnpack12 = raw_unpack12_c;
+#if SIMD_128
+    if (features & SIMD_128_FEATURE) {
+        table.rawUnpack10 = raw_unpack10_simd;
+        table.rawUnpack12 = raw_unpack12_simd;
+    }
+#endif
+}
+
+int raw_row_bytes(int packing, int width) {
+    switch (packing) {
+        case RAW_PACKING_16:
+            return width * 2;
+        case RAW_PACKING_10:
+            return width % 4 == 0 ? width / 4 * 5 : -1;
+        case RAW_PACKING_12:
+            return width % 2 == 0 ? width / 2 * 3 : -1;
+        default:
+            return -1;
+    }
+}
+
+bool raw_unpack(const uint8_t *src, int srcRowStride, int packing, int width, int height,
+                uint16_t *dst, int dstRowStride) {
+    int rowBytes = raw_row_bytes(packing, width);
+    if (rowBytes < 0 || srcRowStride < rowBytes || dstRowStride < width * 2) {
+        LOGE(TAG, "can not unpack packing %d, width %d, rowStride %d", packing, width, srcRowStride);
+        return false;
+    }
+    const KernelTable &kt = kernel_table();
+    parallel_for_stripes(height, MIN_STRIPE_ROWS, [&](int rowStart, int rowEnd) {
+        for (int row = rowStart; row < rowEnd; row++) {
+            const uint8_t *s = src + (size_t)row * srcRowStride;
+            auto d = (uint16_t *)((uint8_t *)dst + (size_t)row * dstRowStride);
+            if (packing == RAW_PACKING_10) {
+                kt.rawUnpack10(s, d, width);
+            } else if (packing == RAW_PACKING_12) {
+                kt.rawUnpack12(s, d, width);
+            } else {
+                memcpy(d, s, rowBytes);
+            }
+        }
+    });
+    return true;
+}
@@ -0,0 +1,36 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#ifndef CAMERAUTIL_RAW_UNPACK_H
+#define CAMERAUTIL_RAW_UNPACK_H
+
+#include <stdint.h>
+
+/**
+ * MIPI CSI-2打包的RAW（ImageFormat.RAW10、RAW12）解包成每像素一个uint16。
+ * RAW10每4个像素5字节：前4字节是各像素的高8位，第5字节依次是4个像素的低2位；
+ * RAW12每2个像素3字节：前2字节是高8位，第3字节低4位属于第一个像素，高4位属于第二个。
+ * 行尾的rowStride填充会被跳过。
+ * */
+
+// RAW_SENSOR, one uint16 per pixel
+#define RAW_PACKING_16 0
+// ImageFormat.RAW10, width a multiple of 4
+#define RAW_PACKING_10 1
+// ImageFormat.RAW12, width a multiple of 2
+#define RAW_PACKING_12 2
+
+/**
+ * Bytes of pixel data in one row, without padding. -1 if width does not fit the packing.
+ * */
+int raw_row_bytes(int packing, int width);
+
+/**
+ * Unpack height rows into dst, strides in bytes, split into stripes across cores.
+ * Return false if the packing, width or srcRowStride is not valid.
+ * */
+bool raw_unpack(const uint8_t *src, int srcRowStride, int packing, int width, int height,
+                uint16_t *dst, int dstRowStride);
+
+#endif //CAMERAUTIL_RAW_UNPACK_H
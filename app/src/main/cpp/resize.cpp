@@ -0,0 +1,427 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#include "resize.h"
+#include "parallel.h"
+#include "dispatch.h"
+#include "cpu_features.h"
+#include "frame_arena.h"
+#include <math.h>
+#include <string.h>
+#include <vector>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <algorithm>
+
+#include "simd.h"
+
+using namespace std;
+
+// Weights are Q14 and sum up to exactly 1 << WEIGHT_BITS.
+#define WEIGHT_BITS 14
+// The horizontal pass outputs Q6 pixels in int16, bicubic overshoot still fits.
+#define INTERMEDIATE_BITS 6
+#define HORIZONTAL_SHIFT (WEIGHT_BITS - INTERMEDIATE_BITS)
+#define VERTICAL_SHIFT (WEIGHT_BITS + INTERMEDIATE_BITS)
+
+#define MIN_STRIPE_ROWS 16
+#define MAX_CACHED_AXES 16
+
+/**
+ * Coefficient table of one axis. Output pixel i is
+ * sum(weights[i * taps + k] * src[starts[i] + k]), k in [0, taps).
+ * */
+struct ResizeAxis {
+    int srcSize = 0;
+    int scaledSize = 0;
+    int offset = 0;
+    int count = 0;
+    int filter = 0;
+
+    int taps = 0;
+    vector<int32_t> starts;
+    vector<int16_t> weights;
+};
+
+static mutex cacheMutex;
+static list<shared_ptr<ResizeAxis>> axisCache;
+
+static inline double filter_support(int filter) {
+    return filter == RESIZE_BICUBIC ? 2.0 : 1.0;
+}
+
+static inline double filter_weight(int filter, double x) {
+    double t = fabs(x);
+    if (filter == RESIZE_BICUBIC) {
+        // Keys cubic, a = -0.5
+        const double a = -0.5;
+        if (t < 1.0) {
+            return ((a + 2.0) * t - (a + 3.0)) * t * t + 1.0;
+        } else if (t < 2.0) {
+            return (((t - 5.0) * t + 8.0) * t - 4.0) * a;
+        }
+        return 0.0;
+    }
+    return t < 1.0 ? 1.0 - t : 0.0;
+}
+
+/**
+ * Build the table for count output pixels, starting at offset inside a source that is
+ * scaled to scaledSize. When shrinking, the filter is stretched so every source pixel counts.
+ * */
+static shared_ptr<ResizeAxis> build_axis(int srcSize, int scaledSize, int offset, int count, int filter) {
+    auto axis = make_shared<ResizeAxis>();
+    axis->srcSize = srcSize;
+    axis->scaledSize = scaledSize;
+    axis->offset = offset;
+    axis->count = count;
+    axis->filter = filter;
+
+    double scale = (double)srcSize / scaledSize;
+    double filterScale = std::max(scale, 1.0);
+    double support = filter_support(filter) * filterScale;
+    int taps = std::min((int)ceil(support) * 2 + 1, srcSize);
+    axis->taps = taps;
+    axis->starts.resize(count);
+    axis->weights.assign((size_t)count * taps, 0);
+
+    vector<double> w(taps);
+    for (int i = 0; i < count; i++) {
+        double center = (i + offset + 0.5) * scale;
+        int xMin = std::max((int)floor(center - support + 0.5), 0);
+        int xMax = std::min((int)floor(center + support + 0.5), srcSize);
+        xMax = std::min(xMax, xMin + taps);
+        if (xMin >= xMax) {
+            // Can only happen far outside of the source, use the nearest pixel.
+            xMin = std::min(std::max((int)center, 0), srcSize - 1);
+            xMax = xMin + 1;
+        }
+        int n = xMax - xMin;
+        double sum = 0;
+        for (int k = 0; k < n; k++) {
+            w[k] = filter_weight(filter, (xMin + k + 0.5 - center) / filterScale);
+            sum += w[k];
+        }
+        if (sum == 0) {
+            for (int k = 0; k < n; k++) {
+                w[k] = 1;
+            }
+            sum = n;
+        }
+
+        // Keep the window inside the source so that every output reads exactly taps pixels.
+        int start = std::min(xMin, srcSize - taps);
+        int16_t *out = axis->weights.data() + (size_t)i * taps;
+        int total = 0;
+        int maxIndex = xMin - start;
+        for (int k = 0; k < n; k++) {
+            int q = (int)lround(w[k] / sum * (1 << WEIGHT_BITS));
+            out[xMin - start + k] = (int16_t)q;
+            total += q;
+            if (q > out[maxIndex]) {
+                maxIndex = xMin - start + k;
+            }
+        }
+        // Rounding error goes to the largest weight, so flat areas stay exactly flat.
+        out[maxIndex] = (int16_t)(out[maxIndex] + (1 << WEIGHT_BITS) - total);
+        axis->starts[i] = start;
+    }
+    return axis;
+}
+
+static shared_ptr<ResizeAxis> get_axis(int srcSize, int scaledSize, int offset, int count, int filter) {
+    lock_guard<mutex> lock(cacheMutex);
+    for (auto it = axisCache.begin(); it != axisCache.end(); it++) {
+        ResizeAxis &a = **it;
+        if (a.srcSize == srcSize && a.scaledSize == scaledSize && a.offset == offset
+            && a.count == count && a.filter == filter) {
+            auto axis = *it;
+            axisCache.erase(it);
+            axisCache.push_front(axis);
+            return axis;
+        }
+    }
+    auto axis = build_axis(srcSize, scaledSize, offset, count, filter);
+    axisCache.push_front(axis);
+    if (axisCache.size() > MAX_CACHED_AXES) {
+        axisCache.pop_back();
+    }
+    return axis;
+}
+
+void resize_clear_cache() {
+    lock_guard<mutex> lock(cacheMutex);
+    axisCache.clear();
+}
+
+static inline int16_t saturate_s16(int32_t n) {
+    return (int16_t)(n < INT16_MIN ? INT16_MIN : (n > INT16_MAX ? INT16_MAX : n));
+}
+
+static inline uint8_t clamp_u8(int32_t n) {
+    return (uint8_t)(n < 0 ? 0 : (n > 255 ? 255 : n));
+}
+
+static inline int16_t horizontal_round(int32_t acc) {
+    return saturate_s16((acc + (1 << (HORIZONTAL_SHIFT - 1))) >> HORIZONTAL_SHIFT);
+}
+
+static void horizontal_pass_c1_c(const uint8_t *src, int16_t *out, const int32_t *starts,
+                                 const int16_t *weights, int taps, int count) {
+    for (int i = 0; i < count; i++) {
+        const uint8_t *p = src + starts[i];
+        const int16_t *w = weights + (size_t)i * taps;
+        int32_t acc = 0;
+        for (int k = 0; k < taps; k++) {
+            acc += w[k] * p[k];
+        }
+        out[i] = horizontal_round(acc);
+    }
+}
+
+static void horizontal_pass_c4_c(const uint8_t *src, int16_t *out, const int32_t *starts,
+                                 const int16_t *weights, int taps, int count) {
+    for (int i = 0; i < count; i++) {
+        const uint8_t *p = src + starts[i] * 4;
+        const int16_t *w = weights + (size_t)i * taps;
+        int32_t acc[4] = {0, 0, 0, 0};
+        for (int k = 0; k < taps; k++) {
+            for (int c = 0; c < 4; c++) {
+                acc[c] += w[k] * p[k * 4 + c];
+            }
+        }
+        for (int c = 0; c < 4; c++) {
+            out[i * 4 + c] = horizontal_round(acc[c]);
+        }
+    }
+}
+
+static inline void vertical_tail(int x, const int16_t *const *rows, const int16_t *weights, int taps,
+                                 uint8_t *dst, int count) {
+    for (; x < count; x++) {
+        int32_t acc = 0;
+        for (int j = 0; j < taps; j++) {
+            acc += weights[j] * rows[j][x];
+        }
+        dst[x] = clamp_u8((acc + (1 << (VERTICAL_SHIFT - 1))) >> VERTICAL_SHIFT);
+    }
+}
+
+static void vertical_pass_c(const int16_t *const *rows, const int16_t *weights, int taps,
+                            uint8_t *dst, int count) {
+    vertical_tail(0, rows, weights, taps, dst, count);
+}
+
+#if SIMD_128
+static void horizontal_pass_c1_simd(const uint8_t *src, int16_t *out, const int32_t *starts,
+                                    const int16_t *weights, int taps, int count) {
+    for (int i = 0; i < count; i++) {
+        const uint8_t *p = src + starts[i];
+        const int16_t *w = weights + (size_t)i * taps;
+        int32_t acc = 0;
+        int k = 0;
+        // Only pays off for wide filters, i.e. strong down scaling.
+        if (taps >= 8) {
+            v_s32x4 acc4 = v_dup_s32(0);
+            for (; k + 8 <= taps; k += 8) {
+                acc4 = v_dotprod(acc4, v_load_expand_s16(p + k), v_load_s16x8(w + k));
+            }
+            acc = v_reduce_sum(acc4);
+        }
+        for (; k < taps; k++) {
+            acc += w[k] * p[k];
+        }
+        out[i] = horizontal_round(acc);
+    }
+}
+
+static void horizontal_pass_c4_simd(const uint8_t *src, int16_t *out, const int32_t *starts,
+                                    const int16_t *weights, int taps, int count) {
+    for (int i = 0; i < count; i++) {
+        const uint8_t *p = src + starts[i] * 4;
+        const int16_t *w = weights + (size_t)i * taps;
+        // One lane per channel, two source pixels per load.
+        v_s32x4 acc = v_dup_s32(0);
+        int k = 0;
+        for (; k + 2 <= taps; k += 2) {
+            v_s16x8 px = v_load_expand_s16(p + k * 4);
+            acc = v_mlal_lo_n(acc, px, w[k]);
+            acc = v_mlal_hi_n(acc, px, w[k + 1]);
+        }
+        if (k < taps) {
+            acc = v_mlal_lo_n(acc, v_load_expand4_s16(p + k * 4), w[k]);
+        }
+        acc = v_rshr<HORIZONTAL_SHIFT>(acc);
+        v_store_low(out + i * 4, v_narrow_sat_s16(acc, acc));
+    }
+}
+
+static void vertical_pass_simd(const int16_t *const *rows, const int16_t *weights, int taps,
+                               uint8_t *dst, int count) {
+    int x = 0;
+    for (; x + 8 <= count; x += 8) {
+        v_s32x4 lo = v_dup_s32(0);
+        v_s32x4 hi = v_dup_s32(0);
+        for (int j = 0; j < taps; j++) {
+            if (weights[j] == 0) {
+                continue;
+            }
+            v_s16x8 r = v_load_s16x8(rows[j] + x);
+            lo = v_mlal_lo_n(lo, r, weights[j]);
+            hi = v_mlal_hi_n(hi, r, weights[j]);
+        }
+        v_s16x8 narrow = v_narrow_sat_s16(v_rshr<VERTICAL_SHIFT>(lo), v_rshr<VERTICAL_SHIFT>(hi));
+        v_store(dst + x, v_narrow_sat_u8(narrow));
+    }
+    vertical_tail(x, rows, weights, taps, dst, count);
+}
+#endif
+
+void resize_fill_kernels(KernelTable &table, uint32_t features) {
+    table.resizeHorizontalC1 = horizontal_pass_c1_c;
+    table.resizeHorizontalC4 = horizontal_pass_c4_c;
+    table.resizeVertical = vertical_pass_c;
+#if SIMD_128
+    if (features & SIMD_128_FEATURE) {
+        table.resizeHorizontalC1 = horizontal_pass_c1_simd;
+        table.resizeHorizontalC4 = horizontal_pass_c4_simd;
+        table.resizeVertical = vertical_pass_simd;
+    }
+#endif
+}
+
+/**
+ * Output rows [rowStart, rowEnd). Horizontally scaled source rows live in a ring of
+ * axisY.taps rows, each source row is scaled at most once per stripe.
+ * */
+static void resize_stripe(const KernelTable &kt, const uint8_t *src, int srcStride, uint8_t *dst, int dstStride, int channels,
+                          const ResizeAxis &axisX, const ResizeAxis &axisY, int rowStart, int rowEnd) {
+    int count = axisX.count * channels;
+    int taps = axisY.taps;
+    FrameArena scratch;
+    int16_t *ring = scratch.alloc<int16_t>((size_t)taps * count);
+    int *ringRow = scratch.alloc<int>(taps);
+    const int16_t **rows = scratch.alloc<const int16_t *>(taps);
+    std::fill(ringRow, ringRow + taps, -1);
+
+    for (int y = rowStart; y < rowEnd; y++) {
+        int start = axisY.starts[y];
+        const int16_t *weights = axisY.weights.data() + (size_t)y * taps;
+        for (int j = 0; j < taps; j++) {
+            int srcRow = start + j;
+            int slot = srcRow % taps;
+            int16_t *line = ring + (size_t)slot * count;
+            if (ringRow[slot] != srcRow) {
+                auto horizontal = channels == 4 ? kt.resizeHorizontalC4 : kt.resizeHorizontalC1;
+                horizontal(src + (size_t)srcRow * srcStride, line, axisX.starts.data(), axisX.weights.data(),
+                           axisX.taps, axisX.count);
+                ringRow[slot] = srcRow;
+            }
+            rows[j] = line;
+        }
+        kt.resizeVertical(rows, weights, taps, dst + (size_t)y * dstStride, count);
+    }
+}
+
+/**
+ * Scale src to scaledWidth x scaledHeight and write the count pixels starting at
+ * (offsetX, offsetY) of the scaled image to dst.
+ * */
+static void resize_region(const uint8_t *src, int srcStride, int srcWidth, int srcHeight,
+                          uint8_t *dst, int dstStride, int channels, int filter,
+                          int scaledWidth, int scaledHeight, int offsetX, int offsetY,
+                          int countX, int countY) {
+    if (countX <= 0 || countY <= 0 || srcWidth <= 0 || srcHeight <= 0) {
+        return;
+    }
+    auto axisX = get_axis(srcWidth, scaledWidth, offsetX, countX, filter);
+    auto axisY = get_axis(srcHeight, scaledHeight, offsetY, countY, filter);
+    const KernelTable &kt = kernel_table();
+    parallel_for_stripes(countY, MIN_STRIPE_ROWS, [&](int rowStart, int rowEnd) {
+        resize_stripe(kt, src, srcStride, dst, dstStride, channels, *axisX, *axisY, rowStart, rowEnd);
+    });
+}
+
+ResizeRect resize_compute_viewport(int srcWidth, int srcHeight, int dstWidth, int dstHeight, int scaleType) {
+    ResizeRect rect;
+    if (srcWidth <= 0 || srcHeight <= 0 || dstWidth <= 0 || dstHeight <= 0) {
+        return rect;
+    }
+    float texW2H = (float)srcWidth / srcHeight;
+    float screenW2H = (float)dstWidth / dstHeight;
+    rect.width = dstWidth;
+    rect.height = dstHeight;
+
+    // Same branches and rounding (roundToInt) as GLRender.updateViewport.
+    bool fitWidth = false;
+    if (scaleType == SCALE_TYPE_FULL) {
+        fitWidth = texW2H < screenW2H;
+    } else if (scaleType == SCALE_TYPE_INSIDE) {
+        fitWidth = texW2H >= screenW2H;
+    } else {
+        return rect;
+    }
+    if (fitWidth) {
+        rect.width = dstWidth;
+        rect.height = (int)floorf(rect.width / texW2H + 0.5f);
+        rect.left = 0;
+        rect.top = -(rect.height - dstHeight) / 2;
+    } else {
+        rect.height = dstHeight;
+        rect.width = (int)floorf(dstHeight * texW2H + 0.5f);
+        rect.top = 0;
+        rect.left = -(rect.width - dstWidth) / 2;
+    }
+    return rect;
+}
+
+void resize_plane(const uint8_t *src, int srcStride, int srcWidth, int srcHeight,
+                  uint8_t *dst, int dstStride, int dstWidth, int dstHeight,
+                  int channels, int filter) {
+    resize_region(src, srcStride, srcWidth, srcHeight, dst, dstStride, channels, filter,
+                  dstWidth, dstHeight, 0, 0, dstWidth, dstHeight);
+}
+
+static void fill_black(uint8_t *dst, int count, int channels) {
+    if (channels == 4) {
+        for (int i = 0; i < count; i++) {
+            dst[i * 4] = 0;
+            dst[i * 4 + 1] = 0;
+            dst[i * 4 + 2] = 0;
+            dst[i * 4 + 3] = 0xFF;
+        }
+    } else {
+        memset(dst, 0, count * channels);
+    }
+}
+
+void resize_fit(const uint8_t *src, int srcStride, int srcWidth, int srcHeight,
+                uint8_t *dst, int dstStride, int dstWidth, int dstHeight,
+                int channels, int scaleType, int filter) {
+    ResizeRect viewport = resize_compute_viewport(srcWidth, srcHeight, dstWidth, dstHeight, scaleType);
+    if (viewport.width <= 0 || viewport.height <= 0) {
+        return;
+    }
+    // The part of the viewport that is inside dst.
+    int x0 = std::max(viewport.left, 0);
+    int y0 = std::max(viewport.top, 0);
+    int x1 = std::min(viewport.left + viewport.width, dstWidth);
+    int y1 = std::min(viewport.top + viewport.height, dstHeight);
+
+    for (int row = 0; row < dstHeight; row++) {
+        uint8_t *line = dst + (size_t)row * dstStride;
+        if (row < y0 || row >= y1) {
+            fill_black(line, dstWidth, channels);
+        } else {
+            fill_black(line, x0, channels);
+            fill_black(line + x1 * channels, dstWidth - x1, channels);
+        }
+    }
+
+    resize_region(src, srcStride, srcWidth, srcHeight,
+                  dst + (size_t)y0 * dstStride + x0 * channels, dstStride, channels, filter,
+                  viewport.width, viewport.height, x0 - viewport.left, y0 - viewport.top,
+                  x1 - x0, y1 - y0);
+}
@@ -0,0 +1,63 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#ifndef CAMERAUTIL_RESIZE_H
+#define CAMERAUTIL_RESIZE_H
+
+#include <stdint.h>
+
+/**
+ * CPU版本的图像缩放，支持任意尺寸（不要求2的幂次），用于缩略图、ML输入等不经过GLRender的场景。
+ *
+ * 每个(原尺寸, 目标尺寸)对应的定点数插值系数表只计算一次并缓存。缩放分为水平和垂直两步，
+ * 水平结果保存在只有几行大小的环形缓冲中，垂直结果直接写入dst，按行切成stripe多线程处理。
+ * */
+
+#define RESIZE_BILINEAR 0
+#define RESIZE_BICUBIC 1
+
+/**
+ * 与GLRender.ScaleType一致
+ * */
+// 图像完整显示，保持宽高比，可能有黑边
+#define SCALE_TYPE_INSIDE 0
+// 图像占满dst，保持宽高比，超出dst的部分被裁掉
+#define SCALE_TYPE_FULL 1
+// 图像拉伸至dst大小，不保持宽高比
+#define SCALE_TYPE_SCALE_FULL 2
+
+struct ResizeRect {
+    int left = 0;
+    int top = 0;
+    int width = 0;
+    int height = 0;
+};
+
+/**
+ * Where the whole source image lands in dst, computed exactly like GLRender.updateViewport.
+ * For SCALE_TYPE_FULL the rect is larger than dst and left/top are negative.
+ * */
+ResizeRect resize_compute_viewport(int srcWidth, int srcHeight, int dstWidth, int dstHeight, int scaleType);
+
+/**
+ * Scale src to exactly dstWidth x dstHeight. channels is 1 (Y or any 8-bit plane) or 4 (RGBA).
+ * */
+void resize_plane(const uint8_t *src, int srcStride, int srcWidth, int srcHeight,
+                  uint8_t *dst, int dstStride, int dstWidth, int dstHeight,
+                  int channels, int filter);
+
+/**
+ * Scale src into dst with the fitting rule of scaleType. Bars left by SCALE_TYPE_INSIDE are
+ * filled with black (opaque black for RGBA).
+ * */
+void resize_fit(const uint8_t *src, int srcStride, int srcWidth, int srcHeight,
+                uint8_t *dst, int dstStride, int dstWidth, int dstHeight,
+                int channels, int scaleType, int filter);
+
+/**
+ * Drop all cached coefficient tables.
+ * */
+void resize_clear_cache();
+
+#endif //CAMERAUTIL_RESIZE_H
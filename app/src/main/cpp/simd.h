@@ -0,0 +1,1488 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#ifndef CAMERAUTIL_SIMD_H
+#define CAMERAUTIL_SIMD_H
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * 128位定长向量的薄封装，同一份kernel代码在ARM上编译为NEON，在x86上编译为SSE，
+ * 其他平台上编译为普通的C++数组运算（只用于编译和对比测试，不快）。
+ *
+ * 每个操作在NEON下都对应一条（或一组）固定的intrinsic，用封装写的kernel与直接写NEON生成的代码相同。
+ * 所有整数操作在三个后端上结果逐位一致；浮点只提供不融合的乘加，保证各后端舍入一致。
+ *
+ * 类型：
+ * v_u8x8   8 x uint8，只用于窄化后的结果和按8像素读写
+ * v_u8x16  16 x uint8
+ * v_s16x8  8 x int16
+ * v_s32x4  4 x int32
+ * v_f32x4  4 x float
+ *
+ * SIMD_128为1时表示有真正的向量指令，SIMD_128_FEATURE是对应的CPU_FEATURE_*，
+ * 用于在dispatch中登记向量版本的kernel。
+ * */
+
+#if defined(__ARM_NEON)
+#define SIMD_NEON 1
+#define SIMD_128 1
+#define SIMD_128_FEATURE CPU_FEATURE_NEON
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#define SIMD_SSE 1
+#define SIMD_128 1
+// Android x86_64 guarantees SSE4.2. Builds without -msse4.1 fall back to SSE2 sequences.
+#define SIMD_128_FEATURE CPU_FEATURE_SSE41
+#include <emmintrin.h>
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+#if defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+#else
+#define SIMD_SCALAR 1
+#define SIMD_128 0
+#define SIMD_128_FEATURE 0
+#endif
+
+#if defined(SIMD_NEON)
+
+struct v_u8x8 { uint8x8_t val; };
+struct v_u8x16 { uint8x16_t val; };
+struct v_s16x8 { int16x8_t val; };
+struct v_s32x4 { int32x4_t val; };
+struct v_f32x4 { float32x4_t val; };
+
+#elif defined(SIMD_SSE)
+
+// Only the low 8 bytes are used.
+struct v_u8x8 { __m128i val; };
+struct v_u8x16 { __m128i val; };
+struct v_s16x8 { __m128i val; };
+struct v_s32x4 { __m128i val; };
+struct v_f32x4 { __m128 val; };
+
+#else
+
+struct v_u8x8 { uint8_t val[8]; };
+struct v_u8x16 { uint8_t val[16]; };
+struct v_s16x8 { int16_t val[8]; };
+struct v_s32x4 { int32_t val[4]; };
+struct v_f32x4 { float val[4]; };
+
+#endif
+
+namespace simd_detail {
+inline uint8_t sat_u8(int32_t n) {
+    return (uint8_t)(n < 0 ? 0 : (n > 255 ? 255 : n));
+}
+
+inline int16_t sat_s16(int32_t n) {
+    return (int16_t)(n < INT16_MIN ? INT16_MIN : (n > INT16_MAX ? INT16_MAX : n));
+}
+
+inline int16_t sat_s16(int64_t n) {
+    return (int16_t)(n < INT16_MIN ? INT16_MIN : (n > INT16_MAX ? INT16_MAX : n));
+}
+}
+
+#if defined(SIMD_SSE)
+namespace simd_detail {
+/**
+ * Full 32-bit products of the int16 lanes of a and b, lanes 0..3 and 4..7.
+ * */
+inline void mul_widen(__m128i a, __m128i b, __m128i &lo, __m128i &hi) {
+    __m128i l = _mm_mullo_epi16(a, b);
+    __m128i h = _mm_mulhi_epi16(a, b);
+    lo = _mm_unpacklo_epi16(l, h);
+    hi = _mm_unpackhi_epi16(l, h);
+}
+}
+#endif
+
+/*
+ * ---------------------------------------------------------------------------------------------
+ * v_u8x8
+ * ---------------------------------------------------------------------------------------------
+ * */
+
+static inline v_u8x8 v_load_u8x8(const uint8_t *p) {
+#if defined(SIMD_NEON)
+    return {vld1_u8(p)};
+#elif defined(SIMD_SSE)
+    return {_mm_loadl_epi64((const __m128i *)p)};
+#else
+    v_u8x8 r;
+    memcpy(r.val, p, 8);
+    return r;
+#endif
+}
+
+static inline void v_store(uint8_t *p, v_u8x8 a) {
+#if defined(SIMD_NEON)
+    vst1_u8(p, a.val);
+#elif defined(SIMD_SSE)
+    _mm_storel_epi64((__m128i *)p, a.val);
+#else
+    memcpy(p, a.val, 8);
+#endif
+}
+
+static inline v_u8x8 v_dup_u8x8(uint8_t n) {
+#if defined(SIMD_NEON)
+    return {vdup_n_u8(n)};
+#elif defined(SIMD_SSE)
+    return {_mm_set1_epi8((char)n)};
+#else
+    v_u8x8 r;
+    memset(r.val, n, 8);
+    return r;
+#endif
+}
+
+/**
+ * lo = a0 b0 a1 b1 a2 b2 a3 b3, hi = a4 b4 ... a7 b7
+ * */
+static inline void v_zip(v_u8x8 a, v_u8x8 b, v_u8x8 &lo, v_u8x8 &hi) {
+#if defined(SIMD_NEON)
+    uint8x8x2_t z = vzip_u8(a.val, b.val);
+    lo.val = z.val[0];
+    hi.val = z.val[1];
+#elif defined(SIMD_SSE)
+    __m128i z = _mm_unpacklo_epi8(a.val, b.val);
+    lo.val = z;
+    hi.val = _mm_srli_si128(z, 8);
+#else
+    for (int i = 0; i < 4; i++) {
+        lo.val[i * 2] = a.val[i];
+        lo.val[i * 2 + 1] = b.val[i];
+        hi.val[i * 2] = a.val[i + 4];
+        hi.val[i * 2 + 1] = b.val[i + 4];
+    }
+#endif
+}
+
+/**
+ * Store 8 pixels of 4 channels: a0 b0 c0 d0 a1 b1 c1 d1 ... (32 bytes)
+ * */
+static inline void v_store_interleave4(uint8_t *p, v_u8x8 a, v_u8x8 b, v_u8x8 c, v_u8x8 d) {
+#if defined(SIMD_NEON)
+    uint8x8x4_t v;
+    v.val[0] = a.val;
+    v.val[1] = b.val;
+    v.val[2] = c.val;
+    v.val[3] = d.val;
+    vst4_u8(p, v);
+#elif defined(SIMD_SSE)
+    __m128i ab = _mm_unpacklo_epi8(a.val, b.val);
+    __m128i cd = _mm_unpacklo_epi8(c.val, d.val);
+    _mm_storeu_si128((__m128i *)p, _mm_unpacklo_epi16(ab, cd));
+    _mm_storeu_si128((__m128i *)(p + 16), _mm_unpackhi_epi16(ab, cd));
+#else
+    for (int i = 0; i < 8; i++) {
+        p[i * 4] = a.val[i];
+        p[i * 4 + 1] = b.val[i];
+        p[i * 4 + 2] = c.val[i];
+        p[i * 4 + 3] = d.val[i];
+    }
+#endif
+}
+
+/*
+ * ---------------------------------------------------------------------------------------------
+ * v_u8x16
+ * ---------------------------------------------------------------------------------------------
+ * */
+
+static inline v_u8x16 v_load_u8x16(const uint8_t *p) {
+#if defined(SIMD_NEON)
+    return {vld1q_u8(p)};
+#elif defined(SIMD_SSE)
+    return {_mm_loadu_si128((const __m128i *)p)};
+#else
+    v_u8x16 r;
+    memcpy(r.val, p, 16);
+    return r;
+#endif
+}
+
+static inline void v_store(uint8_t *p, v_u8x16 a) {
+#if defined(SIMD_NEON)
+    vst1q_u8(p, a.val);
+#elif defined(SIMD_SSE)
+    _mm_storeu_si128((__m128i *)p, a.val);
+#else
+    memcpy(p, a.val, 16);
+#endif
+}
+
+static inline v_u8x16 v_dup_u8x16(uint8_t n) {
+#if defined(SIMD_NEON)
+    return {vdupq_n_u8(n)};
+#elif defined(SIMD_SSE)
+    return {_mm_set1_epi8((char)n)};
+#else
+    v_u8x16 r;
+    memset(r.val, n, 16);
+    return r;
+#endif
+}
+
+static inline v_u8x8 v_low(v_u8x16 a) {
+#if defined(SIMD_NEON)
+    return {vget_low_u8(a.val)};
+#elif defined(SIMD_SSE)
+    return {a.val};
+#else
+    v_u8x8 r;
+    memcpy(r.val, a.val, 8);
+    return r;
+#endif
+}
+
+static inline v_u8x8 v_high(v_u8x16 a) {
+#if defined(SIMD_NEON)
+    return {vget_high_u8(a.val)};
+#elif defined(SIMD_SSE)
+    return {_mm_srli_si128(a.val, 8)};
+#else
+    v_u8x8 r;
+    memcpy(r.val, a.val + 8, 8);
+    return r;
+#endif
+}
+
+static inline v_u8x16 v_combine(v_u8x8 lo, v_u8x8 hi) {
+#if defined(SIMD_NEON)
+    return {vcombine_u8(lo.val, hi.val)};
+#elif defined(SIMD_SSE)
+    return {_mm_unpacklo_epi64(lo.val, hi.val)};
+#else
+    v_u8x16 r;
+    memcpy(r.val, lo.val, 8);
+    memcpy(r.val + 8, hi.val, 8);
+    return r;
+#endif
+}
+
+/**
+ * Saturating add / sub.
+ * */
+static inline v_u8x16 v_adds(v_u8x16 a, v_u8x16 b) {
+#if defined(SIMD_NEON)
+    return {vqaddq_u8(a.val, b.val)};
+#elif defined(SIMD_SSE)
+    return {_mm_adds_epu8(a.val, b.val)};
+#else
+    v_u8x16 r;
+    for (int i = 0; i < 16; i++) {
+        r.val[i] = simd_detail::sat_u8((int32_t)a.val[i] + b.val[i]);
+    }
+    return r;
+#endif
+}
+
+static inline v_u8x16 v_subs(v_u8x16 a, v_u8x16 b) {
+#if defined(SIMD_NEON)
+    return {vqsubq_u8(a.val, b.val)};
+#elif defined(SIMD_SSE)
+    return {_mm_subs_epu8(a.val, b.val)};
+#else
+    v_u8x16 r;
+    for (int i = 0; i < 16; i++) {
+        r.val[i] = simd_detail::sat_u8((int32_t)a.val[i] - b.val[i]);
+    }
+    return r;
+#endif
+}
+
+static inline v_u8x16 v_min(v_u8x16 a, v_u8x16 b) {
+#if defined(SIMD_NEON)
+    return {vminq_u8(a.val, b.val)};
+#elif defined(SIMD_SSE)
+    return {_mm_min_epu8(a.val, b.val)};
+#else
+    v_u8x16 r;
+    for (int i = 0; i < 16; i++) {
+        r.val[i] = a.val[i] < b.val[i] ? a.val[i] : b.val[i];
+    }
+    return r;
+#endif
+}
+
+static inline v_u8x16 v_max(v_u8x16 a, v_u8x16 b) {
+#if defined(SIMD_NEON)
+    return {vmaxq_u8(a.val, b.val)};
+#elif defined(SIMD_SSE)
+    return {_mm_max_epu8(a.val, b.val)};
+#else
+    v_u8x16 r;
+    for (int i = 0; i < 16; i++) {
+        r.val[i] = a.val[i] > b.val[i] ? a.val[i] : b.val[i];
+    }
+    return r;
+#endif
+}
+
+/**
+ * (a + b + 1) >> 1
+ * */
+static inline v_u8x16 v_avg(v_u8x16 a, v_u8x16 b) {
+#if defined(SIMD_NEON)
+    return {vrhaddq_u8(a.val, b.val)};
+#elif defined(SIMD_SSE)
+    return {_mm_avg_epu8(a.val, b.val)};
+#else
+    v_u8x16 r;
+    for (int i = 0; i < 16; i++) {
+        r.val[i] = (uint8_t)(((int)a.val[i] + b.val[i] + 1) >> 1);
+    }
+    return r;
+#endif
+}
+
+/**
+ * Load 32 bytes: a = even bytes, b = odd bytes.
+ * */
+static inline void v_load_deinterleave(const uint8_t *p, v_u8x16 &a, v_u8x16 &b) {
+#if defined(SIMD_NEON)
+    uint8x16x2_t v = vld2q_u8(p);
+    a.val = v.val[0];
+    b.val = v.val[1];
+#elif defined(SIMD_SSE)
+    __m128i v0 = _mm_loadu_si128((const __m128i *)p);
+    __m128i v1 = _mm_loadu_si128((const __m128i *)(p + 16));
+    __m128i mask = _mm_set1_epi16(0x00FF);
+    a.val = _mm_packus_epi16(_mm_and_si128(v0, mask), _mm_and_si128(v1, mask));
+    b.val = _mm_packus_epi16(_mm_srli_epi16(v0, 8), _mm_srli_epi16(v1, 8));
+#else
+    for (int i = 0; i < 16; i++) {
+        a.val[i] = p[i * 2];
+        b.val[i] = p[i * 2 + 1];
+    }
+#endif
+}
+
+/**
+ * Store 32 bytes: a0 b0 a1 b1 ...
+ * */
+static inline void v_store_interleave(uint8_t *p, v_u8x16 a, v_u8x16 b) {
+#if defined(SIMD_NEON)
+    uint8x16x2_t v;
+    v.val[0] = a.val;
+    v.val[1] = b.val;
+    vst2q_u8(p, v);
+#elif defined(SIMD_SSE)
+    _mm_storeu_si128((__m128i *)p, _mm_unpacklo_epi8(a.val, b.val));
+    _mm_storeu_si128((__m128i *)(p + 16), _mm_unpackhi_epi8(a.val, b.val));
+#else
+    for (int i = 0; i < 16; i++) {
+        p[i * 2] = a.val[i];
+        p[i * 2 + 1] = b.val[i];
+    }
+#endif
+}
+
+/**
+ * Store 16 pixels of 4 channels (64 bytes).
+ * */
+static inline void v_store_interleave4(uint8_t *p, v_u8x16 a, v_u8x16 b, v_u8x16 c, v_u8x16 d) {
+#if defined(SIMD_NEON)
+    uint8x16x4_t v;
+    v.val[0] = a.val;
+    v.val[1] = b.val;
+    v.val[2] = c.val;
+    v.val[3] = d.val;
+    vst4q_u8(p, v);
+#else
+    v_store_interleave4(p, v_low(a), v_low(b), v_low(c), v_low(d));
+    v_store_interleave4(p + 32, v_high(a), v_high(b), v_high(c), v_high(d));
+#endif
+}
+
+/**
+ * Load 64 bytes: a = bytes 0, 4, 8 ..., b = bytes 1, 5, 9 ..., c = bytes 2, 6 ..., d = bytes 3, 7 ...
+ * */
+static inline void v_load_deinterleave4(const uint8_t *p, v_u8x16 &a, v_u8x16 &b, v_u8x16 &c, v_u8x16 &d) {
+#if defined(SIMD_NEON)
+    uint8x16x4_t v = vld4q_u8(p);
+    a.val = v.val[0];
+    b.val = v.val[1];
+    c.val = v.val[2];
+    d.val = v.val[3];
+#elif defined(SIMD_SSE)
+    // Two rounds of even / odd bytes
+    __m128i mask = _mm_set1_epi16(0x00FF);
+    __m128i v0 = _mm_loadu_si128((const __m128i *)p);
+    __m128i v1 = _mm_loadu_si128((const __m128i *)(p + 16));
+    __m128i v2 = _mm_loadu_si128((const __m128i *)(p + 32));
+    __m128i v3 = _mm_loadu_si128((const __m128i *)(p + 48));
+    __m128i even0 = _mm_packus_epi16(_mm_and_si128(v0, mask), _mm_and_si128(v1, mask));
+    __m128i even1 = _mm_packus_epi16(_mm_and_si128(v2, mask), _mm_and_si128(v3, mask));
+    __m128i odd0 = _mm_packus_epi16(_mm_srli_epi16(v0, 8), _mm_srli_epi16(v1, 8));
+    __m128i odd1 = _mm_packus_epi16(_mm_srli_epi16(v2, 8), _mm_srli_epi16(v3, 8));
+    a.val = _mm_packus_epi16(_mm_and_si128(even0, mask), _mm_and_si128(even1, mask));
+    c.val = _mm_packus_epi16(_mm_srli_epi16(even0, 8), _mm_srli_epi16(even1, 8));
+    b.val = _mm_packus_epi16(_mm_and_si128(odd0, mask), _mm_and_si128(odd1, mask));
+    d.val = _mm_packus_epi16(_mm_srli_epi16(odd0, 8), _mm_srli_epi16(odd1, 8));
+#else
+    for (int i = 0; i < 16; i++) {
+        a.val[i] = p[i * 4];
+        b.val[i] = p[i * 4 + 1];
+        c.val[i] = p[i * 4 + 2];
+        d.val[i] = p[i * 4 + 3];
+    }
+#endif
+}
+
+/**
+ * Swap the two bytes of every 16 bit lane: a0 a1 a2 a3 ... -> a1 a0 a3 a2 ...
+ * */
+static inline v_u8x16 v_rev16(v_u8x16 a) {
+#if defined(SIMD_NEON)
+    return {vrev16q_u8(a.val)};
+#elif defined(SIMD_SSE)
+    return {_mm_or_si128(_mm_slli_epi16(a.val, 8), _mm_srli_epi16(a.val, 8))};
+#else
+    v_u8x16 r;
+    for (int i = 0; i < 16; i += 2) {
+        r.val[i] = a.val[i + 1];
+        r.val[i + 1] = a.val[i];
+    }
+    return r;
+#endif
+}
+
+/*
+ * ---------------------------------------------------------------------------------------------
+ * v_s16x8
+ * ---------------------------------------------------------------------------------------------
+ * */
+
+static inline v_s16x8 v_load_s16x8(const int16_t *p) {
+#if defined(SIMD_NEON)
+    return {vld1q_s16(p)};
+#elif defined(SIMD_SSE)
+    return {_mm_loadu_si128((const __m128i *)p)};
+#else
+    v_s16x8 r;
+    memcpy(r.val, p, 16);
+    return r;
+#endif
+}
+
+/**
+ * 4 int16 from lo into lanes 0..3 and 4 from hi into lanes 4..7.
+ * */
+static inline v_s16x8 v_load_halves(const int16_t *lo, const int16_t *hi) {
+#if defined(SIMD_NEON)
+    return {vcombine_s16(vld1_s16(lo), vld1_s16(hi))};
+#elif defined(SIMD_SSE)
+    return {_mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i *)lo), _mm_loadl_epi64((const __m128i *)hi))};
+#else
+    v_s16x8 r;
+    memcpy(r.val, lo, 8);
+    memcpy(r.val + 4, hi, 8);
+    return r;
+#endif
+}
+
+/**
+ * Byte i of the result is a[index[i]], 0 where index[i] is 0xFF. The 16 bytes are
+ * returned as 8 little endian int16, for gathering packed fields into lanes.
+ * */
+static inline v_s16x8 v_shuffle_s16(v_u8x16 a, v_u8x16 index) {
+#if defined(SIMD_NEON) && defined(__aarch64__)
+    return {vreinterpretq_s16_u8(vqtbl1q_u8(a.val, index.val))};
+#elif defined(SIMD_NEON)
+    uint8x8x2_t table = {{vget_low_u8(a.val), vget_high_u8(a.val)}};
+    return {vreinterpretq_s16_u8(vcombine_u8(vtbl2_u8(table, vget_low_u8(index.val)),
+                                             vtbl2_u8(table, vget_high_u8(index.val))))};
+#elif defined(SIMD_SSE) && defined(__SSSE3__)
+    return {_mm_shuffle_epi8(a.val, index.val)};
+#else
+    uint8_t bytes[16], picked[16];
+    v_store(bytes, a);
+    v_store(picked, index);
+    for (int i = 0; i < 16; i++) {
+        picked[i] = picked[i] < 16 ? bytes[picked[i]] : 0;
+    }
+    v_s16x8 r;
+#if defined(SIMD_SSE)
+    r.val = _mm_loadu_si128((const __m128i *)picked);
+#else
+    memcpy(r.val, picked, 16);
+#endif
+    return r;
+#endif
+}
+
+static inline void v_store(int16_t *p, v_s16x8 a) {
+#if defined(SIMD_NEON)
+    vst1q_s16(p, a.val);
+#elif defined(SIMD_SSE)
+    _mm_storeu_si128((__m128i *)p, a.val);
+#else
+    memcpy(p, a.val, 16);
+#endif
+}
+
+/**
+ * Store lanes 0..3.
+ * */
+static inline void v_store_low(int16_t *p, v_s16x8 a) {
+#if defined(SIMD_NEON)
+    vst1_s16(p, vget_low_s16(a.val));
+#elif defined(SIMD_SSE)
+    _mm_storel_epi64((__m128i *)p, a.val);
+#else
+    memcpy(p, a.val, 8);
+#endif
+}
+
+static inline v_s16x8 v_dup_s16(int16_t n) {
+#if defined(SIMD_NEON)
+    return {vdupq_n_s16(n)};
+#elif defined(SIMD_SSE)
+    return {_mm_set1_epi16(n)};
+#else
+    v_s16x8 r;
+    for (int i = 0; i < 8; i++) {
+        r.val[i] = n;
+    }
+    return r;
+#endif
+}
+
+/**
+ * 8 bytes, zero extended.
+ * */
+static inline v_s16x8 v_load_expand_s16(const uint8_t *p) {
+#if defined(SIMD_NEON)
+    return {vreinterpretq_s16_u16(vmovl_u8(vld1_u8(p)))};
+#elif defined(SIMD_SSE)
+#if defined(__SSE4_1__)
+    return {_mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *)p))};
+#else
+    return {_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)p), _mm_setzero_si128())};
+#endif
+#else
+    v_s16x8 r;
+    for (int i = 0; i < 8; i++) {
+        r.val[i] = p[i];
+    }
+    return r;
+#endif
+}
+
+/**
+ * 4 bytes into lanes 0..3, lanes 4..7 are 0.
+ * */
+static inline v_s16x8 v_load_expand4_s16(const uint8_t *p) {
+    uint32_t bits;
+    memcpy(&bits, p, 4);
+#if defined(SIMD_NEON)
+    uint8x8_t v = vreinterpret_u8_u32(vset_lane_u32(bits, vdup_n_u32(0), 0));
+    return {vreinterpretq_s16_u16(vmovl_u8(v))};
+#elif defined(SIMD_SSE)
+    return {_mm_unpacklo_epi8(_mm_cvtsi32_si128((int)bits), _mm_setzero_si128())};
+#else
+    v_s16x8 r;
+    for (int i = 0; i < 8; i++) {
+        r.val[i] = i < 4 ? p[i] : 0;
+    }
+    return r;
+#endif
+}
+
+/**
+ * Load 16 bytes and zero extend: even = bytes 0, 2, 4 ..., odd = bytes 1, 3, 5 ...
+ * Used for Y (two neighbour pixels share one chroma sample) and interleaved chroma.
+ * */
+static inline void v_load_deinterleave_expand_s16(const uint8_t *p, v_s16x8 &even, v_s16x8 &odd) {
+#if defined(SIMD_NEON)
+    uint8x8x2_t u8_2 = vld2_u8(p);
+    even.val = vreinterpretq_s16_u16(vmovl_u8(u8_2.val[0]));
+    odd.val = vreinterpretq_s16_u16(vmovl_u8(u8_2.val[1]));
+#elif defined(SIMD_SSE)
+    __m128i v = _mm_loadu_si128((const __m128i *)p);
+    even.val = _mm_and_si128(v, _mm_set1_epi16(0x00FF));
+    odd.val = _mm_srli_epi16(v, 8);
+#else
+    for (int i = 0; i < 8; i++) {
+        even.val[i] = p[i * 2];
+        odd.val[i] = p[i * 2 + 1];
+    }
+#endif
+}
+
+/**
+ * Load 16 int16: a = even elements, b = odd elements.
+ * */
+static inline void v_load_deinterleave(const int16_t *p, v_s16x8 &a, v_s16x8 &b) {
+#if defined(SIMD_NEON)
+    int16x8x2_t v = vld2q_s16(p);
+    a.val = v.val[0];
+    b.val = v.val[1];
+#elif defined(SIMD_SSE)
+    __m128i v0 = _mm_loadu_si128((const __m128i *)p);
+    __m128i v1 = _mm_loadu_si128((const __m128i *)(p + 8));
+    a.val = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(v0, 16), 16), _mm_srai_epi32(_mm_slli_epi32(v1, 16), 16));
+    b.val = _mm_packs_epi32(_mm_srai_epi32(v0, 16), _mm_srai_epi32(v1, 16));
+#else
+    for (int i = 0; i < 8; i++) {
+        a.val[i] = p[i * 2];
+        b.val[i] = p[i * 2 + 1];
+    }
+#endif
+}
+
+/**
+ * lo = a0 b0 a1 b1 a2 b2 a3 b3, hi = a4 b4 ... a7 b7
+ * */
+static inline void v_zip(v_s16x8 a, v_s16x8 b, v_s16x8 &lo, v_s16x8 &hi) {
+#if defined(SIMD_NEON)
+    int16x8x2_t z = vzipq_s16(a.val, b.val);
+    lo.val = z.val[0];
+    hi.val = z.val[1];
+#elif defined(SIMD_SSE)
+    lo.val = _mm_unpacklo_epi16(a.val, b.val);
+    hi.val = _mm_unpackhi_epi16(a.val, b.val);
+#else
+    v_s16x8 l, h;
+    for (int i = 0; i < 4; i++) {
+        l.val[i * 2] = a.val[i];
+        l.val[i * 2 + 1] = b.val[i];
+        h.val[i * 2] = a.val[i + 4];
+        h.val[i * 2 + 1] = b.val[i + 4];
+    }
+    lo = l;
+    hi = h;
+#endif
+}
+
+/**
+ * Zero extend bytes 0..7 / 8..15.
+ * */
+static inline v_s16x8 v_expand_lo(v_u8x16 a) {
+#if defined(SIMD_NEON)
+    return {vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(a.val)))};
+#elif defined(SIMD_SSE)
+    return {_mm_unpacklo_epi8(a.val, _mm_setzero_si128())};
+#else
+    v_s16x8 r;
+    for (int i = 0; i < 8; i++) {
+        r.val[i] = a.val[i];
+    }
+    return r;
+#endif
+}
+
+static inline v_s16x8 v_expand_hi(v_u8x16 a) {
+#if defined(SIMD_NEON)
+    return {vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(a.val)))};
+#elif defined(SIMD_SSE)
+    return {_mm_unpackhi_epi8(a.val, _mm_setzero_si128())};
+#else
+    v_s16x8 r;
+    for (int i = 0; i < 8; i++) {
+        r.val[i] = a.val[i + 8];
+    }
+    return r;
+#endif
+}
+
+static inline v_s16x8 v_add(v_s16x8 a, v_s16x8 b) {
+#if defined(SIMD_NEON)
+    return {vaddq_s16(a.val, b.val)};
+#elif defined(SIMD_SSE)
+    return {_mm_add_epi16(a.val, b.val)};
+#else
+    v_s16x8 r;
+    for (int i = 0; i < 8; i++) {
+        r.val[i] = (int16_t)(a.val[i] + b.val[i]);
+    }
+    return r;
+#endif
+}
+
+static inline v_s16x8 v_sub(v_s16x8 a, v_s16x8 b) {
+#if defined(SIMD_NEON)
+    return {vsubq_s16(a.val, b.val)};
+#elif defined(SIMD_SSE)
+    return {_mm_sub_epi16(a.val, b.val)};
+#else
+    v_s16x8 r;
+    for (int i = 0; i < 8; i++) {
+        r.val[i] = (int16_t)(a.val[i] - b.val[i]);
+    }
+    return r;
+#endif
+}
+
+/**
+ * Saturating add / sub.
+ * */
+static inline v_s16x8 v_adds(v_s16x8 a, v_s16x8 b) {
+#if defined(SIMD_NEON)
+    return {vqaddq_s16(a.val, b.val)};
+#elif defined(SIMD_SSE)
+    return {_mm_adds_epi16(a.val, b.val)};
+#else
+    v_s16x8 r;
+    for (int i = 0; i < 8; i++) {
+        r.val[i] = simd_detail::sat_s16((int32_t)a.val[i] + b.val[i]);
+    }
+    return r;
+#endif
+}
+
+static inline v_s16x8 v_subs(v_s16x8 a, v_s16x8 b) {
+#if defined(SIMD_NEON)
+    return {vqsubq_s16(a.val, b.val)};
+#elif defined(SIMD_SSE)
+    return {_mm_subs_epi16(a.val, b.val)};
+#else
+    v_s16x8 r;
+    for (int i = 0; i < 8; i++) {
+        r.val[i] = simd_detail::sat_s16((int32_t)a.val[i] - b.val[i]);
+    }
+    return r;
+#endif
+}
+
+/**
+ * Low 16 bits of the product.
+ * */
+static inline v_s16x8 v_mul(v_s16x8 a, v_s16x8 b) {
+#if defined(SIMD_NEON)
+    return {vmulq_s16(a.val, b.val)};
+#elif defined(SIMD_SSE)
+    return {_mm_mullo_epi16(a.val, b.val)};
+#else
+    v_s16x8 r;
+    for (int i = 0; i < 8; i++) {
+        r.val[i] = (int16_t)(a.val[i] * b.val[i]);
+    }
+    return r;
+#endif
+}
+
+static inline v_s16x8 v_mul_n(v_s16x8 a, int16_t n) {
+#if defined(SIMD_NEON)
+    return {vmulq_n_s16(a.val, n)};
+#else
+    return v_mul(a, v_dup_s16(n));
+#endif
+}
+
+/**
+ * acc + a * n, low 16 bits.
+ * */
+static inline v_s16x8 v_mla_n(v_s16x8 acc, v_s16x8 a, int16_t n) {
+#if defined(SIMD_NEON)
+    return {vmlaq_n_s16(acc.val, a.val, n)};
+#else
+    return v_add(acc, v_mul_n(a, n));
+#endif
+}
+
+static inline v_s16x8 v_min(v_s16x8 a, v_s16x8 b) {
+#if defined(SIMD_NEON)
+    return {vminq_s16(a.val, b.val)};
+#elif defined(SIMD_SSE)
+    return {_mm_min_epi16(a.val, b.val)};
+#else
+    v_s16x8 r;
+    for (int i = 0; i < 8; i++) {
+        r.val[i] = a.val[i] < b.val[i] ? a.val[i] : b.val[i];
+    }
+    return r;
+#endif
+}
+
+static inline v_s16x8 v_max(v_s16x8 a, v_s16x8 b) {
+#if defined(SIMD_NEON)
+    return {vmaxq_s16(a.val, b.val)};
+#elif defined(SIMD_SSE)
+    return {_mm_max_epi16(a.val, b.val)};
+#else
+    v_s16x8 r;
+    for (int i = 0; i < 8; i++) {
+        r.val[i] = a.val[i] > b.val[i] ? a.val[i] : b.val[i];
+    }
+    return r;
+#endif
+}
+
+/**
+ * Arithmetic shift right by a constant.
+ * */
+template<int n>
+static inline v_s16x8 v_shr(v_s16x8 a) {
+#if defined(SIMD_NEON)
+    return {vshrq_n_s16(a.val, n)};
+#elif defined(SIMD_SSE)
+    return {_mm_srai_epi16(a.val, n)};
+#else
+    v_s16x8 r;
+    for (int i = 0; i < 8; i++) {
+        r.val[i] = (int16_t)(a.val[i] >> n);
+    }
+    return r;
+#endif
+}
+
+/**
+ * Logical shift right by a constant, the lanes are treated as uint16.
+ * */
+template<int n>
+static inline v_s16x8 v_shr_u16(v_s16x8 a) {
+#if defined(SIMD_NEON)
+    return {vreinterpretq_s16_u16(vshrq_n_u16(vreinterpretq_u16_s16(a.val), n))};
+#elif defined(SIMD_SSE)
+    return {_mm_srli_epi16(a.val, n)};
+#else
+    v_s16x8 r;
+    for (int i = 0; i < 8; i++) {
+        r.val[i] = (int16_t)((uint16_t)a.val[i] >> n);
+    }
+    return r;
+#endif
+}
+
+/**
+ * Rounding shift right by a constant, (a + (1 << (n - 1))) >> n.
+ * a + (1 << (n - 1)) must not overflow, NEON would get it right but SSE would not.
+ * */
+template<int n>
+static inline v_s16x8 v_rshr(v_s16x8 a) {
+#if defined(SIMD_NEON)
+    return {vrshrq_n_s16(a.val, n)};
+#elif defined(SIMD_SSE)
+    return {_mm_srai_epi16(_mm_add_epi16(a.val, _mm_set1_epi16(1 << (n - 1))), n)};
+#else
+    v_s16x8 r;
+    for (int i = 0; i < 8; i++) {
+        r.val[i] = (int16_t)((a.val[i] + (1 << (n - 1))) >> n);
+    }
+    return r;
+#endif
+}
+
+template<int n>
+static inline v_s16x8 v_shl(v_s16x8 a) {
+#if defined(SIMD_NEON)
+    return {vshlq_n_s16(a.val, n)};
+#elif defined(SIMD_SSE)
+    return {_mm_slli_epi16(a.val, n)};
+#else
+    v_s16x8 r;
+    for (int i = 0; i < 8; i++) {
+        r.val[i] = (int16_t)((uint16_t)a.val[i] << n);
+    }
+    return r;
+#endif
+}
+
+/**
+ * Rounding multiply high, (a * b + (1 << 14)) >> 15, i.e. b is a Q15 factor.
+ * NEON saturates -32768 * -32768 to 32767 while SSE wraps, callers must avoid that pair.
+ * */
+static inline v_s16x8 v_mulhrs(v_s16x8 a, v_s16x8 b) {
+#if defined(SIMD_NEON)
+    return {vqrdmulhq_s16(a.val, b.val)};
+#elif defined(SIMD_SSE) && defined(__SSSE3__)
+    return {_mm_mulhrs_epi16(a.val, b.val)};
+#elif defined(SIMD_SSE)
+    __m128i lo, hi;
+    simd_detail::mul_widen(a.val, b.val, lo, hi);
+    __m128i round = _mm_set1_epi32(1 << 14);
+    lo = _mm_srai_epi32(_mm_add_epi32(lo, round), 15);
+    hi = _mm_srai_epi32(_mm_add_epi32(hi, round), 15);
+    return {_mm_packs_epi32(lo, hi)};
+#else
+    v_s16x8 r;
+    for (int i = 0; i < 8; i++) {
+        r.val[i] = simd_detail::sat_s16((a.val[i] * b.val[i] + (1 << 14)) >> 15);
+    }
+    return r;
+#endif
+}
+
+static inline v_s16x8 v_mulhrs_n(v_s16x8 a, int16_t n) {
+#if defined(SIMD_NEON)
+    return {vqrdmulhq_n_s16(a.val, n)};
+#else
+    return v_mulhrs(a, v_dup_s16(n));
+#endif
+}
+
+/**
+ * Saturate to [0, 255].
+ * */
+static inline v_u8x8 v_narrow_sat_u8(v_s16x8 a) {
+#if defined(SIMD_NEON)
+    return {vqmovun_s16(a.val)};
+#elif defined(SIMD_SSE)
+    return {_mm_packus_epi16(a.val, a.val)};
+#else
+    v_u8x8 r;
+    for (int i = 0; i < 8; i++) {
+        r.val[i] = simd_detail::sat_u8(a.val[i]);
+    }
+    return r;
+#endif
+}
+
+/**
+ * Rounding shift right by a constant, then saturate to [0, 255].
+ * a + (1 << (n - 1)) must not overflow.
+ * */
+template<int n>
+static inline v_u8x8 v_rshr_narrow_sat_u8(v_s16x8 a) {
+#if defined(SIMD_NEON)
+    return {vqrshrun_n_s16(a.val, n)};
+#elif defined(SIMD_SSE)
+    __m128i shifted = _mm_srai_epi16(_mm_add_epi16(a.val, _mm_set1_epi16(1 << (n - 1))), n);
+    return {_mm_packus_epi16(shifted, shifted)};
+#else
+    v_u8x8 r;
+    for (int i = 0; i < 8; i++) {
+        r.val[i] = simd_detail::sat_u8((a.val[i] + (1 << (n - 1))) >> n);
+    }
+    return r;
+#endif
+}
+
+static inline v_u8x16 v_pack_sat_u8(v_s16x8 a, v_s16x8 b) {
+#if defined(SIMD_NEON)
+    return {vcombine_u8(vqmovun_s16(a.val), vqmovun_s16(b.val))};
+#elif defined(SIMD_SSE)
+    return {_mm_packus_epi16(a.val, b.val)};
+#else
+    return v_combine(v_narrow_sat_u8(a), v_narrow_sat_u8(b));
+#endif
+}
+
+/*
+ * ---------------------------------------------------------------------------------------------
+ * v_s32x4
+ * ---------------------------------------------------------------------------------------------
+ * */
+
+static inline v_s32x4 v_load_s32x4(const int32_t *p) {
+#if defined(SIMD_NEON)
+    return {vld1q_s32(p)};
+#elif defined(SIMD_SSE)
+    return {_mm_loadu_si128((const __m128i *)p)};
+#else
+    v_s32x4 r;
+    memcpy(r.val, p, 16);
+    return r;
+#endif
+}
+
+static inline void v_store(int32_t *p, v_s32x4 a) {
+#if defined(SIMD_NEON)
+    vst1q_s32(p, a.val);
+#elif defined(SIMD_SSE)
+    _mm_storeu_si128((__m128i *)p, a.val);
+#else
+    memcpy(p, a.val, 16);
+#endif
+}
+
+static inline v_s32x4 v_dup_s32(int32_t n) {
+#if defined(SIMD_NEON)
+    return {vdupq_n_s32(n)};
+#elif defined(SIMD_SSE)
+    return {_mm_set1_epi32(n)};
+#else
+    v_s32x4 r;
+    for (int i = 0; i < 4; i++) {
+        r.val[i] = n;
+    }
+    return r;
+#endif
+}
+
+static inline v_s32x4 v_add(v_s32x4 a, v_s32x4 b) {
+#if defined(SIMD_NEON)
+    return {vaddq_s32(a.val, b.val)};
+#elif defined(SIMD_SSE)
+    return {_mm_add_epi32(a.val, b.val)};
+#else
+    v_s32x4 r;
+    for (int i = 0; i < 4; i++) {
+        r.val[i] = (int32_t)((uint32_t)a.val[i] + (uint32_t)b.val[i]);
+    }
+    return r;
+#endif
+}
+
+static inline v_s32x4 v_sub(v_s32x4 a, v_s32x4 b) {
+#if defined(SIMD_NEON)
+    return {vsubq_s32(a.val, b.val)};
+#elif defined(SIMD_SSE)
+    return {_mm_sub_epi32(a.val, b.val)};
+#else
+    v_s32x4 r;
+    for (int i = 0; i < 4; i++) {
+        r.val[i] = (int32_t)((uint32_t)a.val[i] - (uint32_t)b.val[i]);
+    }
+    return r;
+#endif
+}
+
+static inline v_s32x4 v_or(v_s32x4 a, v_s32x4 b) {
+#if defined(SIMD_NEON)
+    return {vorrq_s32(a.val, b.val)};
+#elif defined(SIMD_SSE)
+    return {_mm_or_si128(a.val, b.val)};
+#else
+    v_s32x4 r;
+    for (int i = 0; i < 4; i++) {
+        r.val[i] = a.val[i] | b.val[i];
+    }
+    return r;
+#endif
+}
+
+/**
+ * Low 32 bits of the product.
+ * */
+static inline v_s32x4 v_mul(v_s32x4 a, v_s32x4 b) {
+#if defined(SIMD_NEON)
+    return {vmulq_s32(a.val, b.val)};
+#elif defined(SIMD_SSE) && defined(__SSE4_1__)
+    return {_mm_mullo_epi32(a.val, b.val)};
+#elif defined(SIMD_SSE)
+    __m128i even = _mm_mul_epu32(a.val, b.val);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a.val, 32), _mm_srli_epi64(b.val, 32));
+    return {_mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                               _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)))};
+#else
+    v_s32x4 r;
+    for (int i = 0; i < 4; i++) {
+        r.val[i] = (int32_t)((uint32_t)a.val[i] * (uint32_t)b.val[i]);
+    }
+    return r;
+#endif
+}
+
+static inline v_s32x4 v_min(v_s32x4 a, v_s32x4 b) {
+#if defined(SIMD_NEON)
+    return {vminq_s32(a.val, b.val)};
+#elif defined(SIMD_SSE) && defined(__SSE4_1__)
+    return {_mm_min_epi32(a.val, b.val)};
+#elif defined(SIMD_SSE)
+    __m128i gt = _mm_cmpgt_epi32(a.val, b.val);
+    return {_mm_or_si128(_mm_and_si128(gt, b.val), _mm_andnot_si128(gt, a.val))};
+#else
+    v_s32x4 r;
+    for (int i = 0; i < 4; i++) {
+        r.val[i] = a.val[i] < b.val[i] ? a.val[i] : b.val[i];
+    }
+    return r;
+#endif
+}
+
+static inline v_s32x4 v_max(v_s32x4 a, v_s32x4 b) {
+#if defined(SIMD_NEON)
+    return {vmaxq_s32(a.val, b.val)};
+#elif defined(SIMD_SSE) && defined(__SSE4_1__)
+    return {_mm_max_epi32(a.val, b.val)};
+#elif defined(SIMD_SSE)
+    __m128i gt = _mm_cmpgt_epi32(a.val, b.val);
+    return {_mm_or_si128(_mm_and_si128(gt, a.val), _mm_andnot_si128(gt, b.val))};
+#else
+    v_s32x4 r;
+    for (int i = 0; i < 4; i++) {
+        r.val[i] = a.val[i] > b.val[i] ? a.val[i] : b.val[i];
+    }
+    return r;
+#endif
+}
+
+/**
+ * acc + lanes 0..3 (lo) or 4..7 (hi) of a * n, widened to int32.
+ * */
+static inline v_s32x4 v_mlal_lo_n(v_s32x4 acc, v_s16x8 a, int16_t n) {
+#if defined(SIMD_NEON)
+    return {vmlal_n_s16(acc.val, vget_low_s16(a.val), n)};
+#elif defined(SIMD_SSE)
+    __m128i lo, hi;
+    simd_detail::mul_widen(a.val, _mm_set1_epi16(n), lo, hi);
+    return {_mm_add_epi32(acc.val, lo)};
+#else
+    v_s32x4 r;
+    for (int i = 0; i < 4; i++) {
+        r.val[i] = acc.val[i] + a.val[i] * n;
+    }
+    return r;
+#endif
+}
+
+static inline v_s32x4 v_mlal_hi_n(v_s32x4 acc, v_s16x8 a, int16_t n) {
+#if defined(SIMD_NEON)
+    return {vmlal_n_s16(acc.val, vget_high_s16(a.val), n)};
+#elif defined(SIMD_SSE)
+    __m128i lo, hi;
+    simd_detail::mul_widen(a.val, _mm_set1_epi16(n), lo, hi);
+    return {_mm_add_epi32(acc.val, hi)};
+#else
+    v_s32x4 r;
+    for (int i = 0; i < 4; i++) {
+        r.val[i] = acc.val[i] + a.val[i + 4] * n;
+    }
+    return r;
+#endif
+}
+
+/**
+ * acc + lanes 0..3 (lo) or 4..7 (hi) of a * b, widened to int32.
+ * */
+static inline v_s32x4 v_mlal_lo(v_s32x4 acc, v_s16x8 a, v_s16x8 b) {
+#if defined(SIMD_NEON)
+    return {vmlal_s16(acc.val, vget_low_s16(a.val), vget_low_s16(b.val))};
+#elif defined(SIMD_SSE)
+    __m128i lo, hi;
+    simd_detail::mul_widen(a.val, b.val, lo, hi);
+    return {_mm_add_epi32(acc.val, lo)};
+#else
+    v_s32x4 r;
+    for (int i = 0; i < 4; i++) {
+        r.val[i] = acc.val[i] + a.val[i] * b.val[i];
+    }
+    return r;
+#endif
+}
+
+static inline v_s32x4 v_mlal_hi(v_s32x4 acc, v_s16x8 a, v_s16x8 b) {
+#if defined(SIMD_NEON)
+    return {vmlal_s16(acc.val, vget_high_s16(a.val), vget_high_s16(b.val))};
+#elif defined(SIMD_SSE)
+    __m128i lo, hi;
+    simd_detail::mul_widen(a.val, b.val, lo, hi);
+    return {_mm_add_epi32(acc.val, hi)};
+#else
+    v_s32x4 r;
+    for (int i = 0; i < 4; i++) {
+        r.val[i] = acc.val[i] + a.val[i + 4] * b.val[i + 4];
+    }
+    return r;
+#endif
+}
+
+/**
+ * acc plus all 8 products of a * b. Which lane gets which product differs between
+ * backends, only v_reduce_sum of the result is defined.
+ * */
+static inline v_s32x4 v_dotprod(v_s32x4 acc, v_s16x8 a, v_s16x8 b) {
+#if defined(SIMD_NEON)
+    int32x4_t r = vmlal_s16(acc.val, vget_low_s16(a.val), vget_low_s16(b.val));
+    return {vmlal_s16(r, vget_high_s16(a.val), vget_high_s16(b.val))};
+#elif defined(SIMD_SSE)
+    return {_mm_add_epi32(acc.val, _mm_madd_epi16(a.val, b.val))};
+#else
+    v_s32x4 r;
+    for (int i = 0; i < 4; i++) {
+        r.val[i] = acc.val[i] + a.val[i * 2] * b.val[i * 2] + a.val[i * 2 + 1] * b.val[i * 2 + 1];
+    }
+    return r;
+#endif
+}
+
+static inline int32_t v_reduce_sum(v_s32x4 a) {
+#if defined(SIMD_NEON) && defined(__aarch64__)
+    return vaddvq_s32(a.val);
+#elif defined(SIMD_NEON)
+    int32x2_t s = vadd_s32(vget_low_s32(a.val), vget_high_s32(a.val));
+    return vget_lane_s32(vpadd_s32(s, s), 0);
+#elif defined(SIMD_SSE)
+    __m128i s = _mm_add_epi32(a.val, _mm_shuffle_epi32(a.val, _MM_SHUFFLE(1, 0, 3, 2)));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(s);
+#else
+    return a.val[0] + a.val[1] + a.val[2] + a.val[3];
+#endif
+}
+
+template<int n>
+static inline v_s32x4 v_shr(v_s32x4 a) {
+#if defined(SIMD_NEON)
+    return {vshrq_n_s32(a.val, n)};
+#elif defined(SIMD_SSE)
+    return {_mm_srai_epi32(a.val, n)};
+#else
+    v_s32x4 r;
+    for (int i = 0; i < 4; i++) {
+        r.val[i] = a.val[i] >> n;
+    }
+    return r;
+#endif
+}
+
+template<int n>
+static inline v_s32x4 v_shl(v_s32x4 a) {
+#if defined(SIMD_NEON)
+    return {vshlq_n_s32(a.val, n)};
+#elif defined(SIMD_SSE)
+    return {_mm_slli_epi32(a.val, n)};
+#else
+    v_s32x4 r;
+    for (int i = 0; i < 4; i++) {
+        r.val[i] = (int32_t)((uint32_t)a.val[i] << n);
+    }
+    return r;
+#endif
+}
+
+/**
+ * Rounding shift right by a constant, (a + (1 << (n - 1))) >> n.
+ * a + (1 << (n - 1)) must not overflow, NEON would get it right but SSE would not.
+ * */
+template<int n>
+static inline v_s32x4 v_rshr(v_s32x4 a) {
+#if defined(SIMD_NEON)
+    return {vrshrq_n_s32(a.val, n)};
+#elif defined(SIMD_SSE)
+    return {_mm_srai_epi32(_mm_add_epi32(a.val, _mm_set1_epi32(1 << (n - 1))), n)};
+#else
+    v_s32x4 r;
+    for (int i = 0; i < 4; i++) {
+        r.val[i] = (a.val[i] + (1 << (n - 1))) >> n;
+    }
+    return r;
+#endif
+}
+
+/**
+ * Same as v_rshr with a shift only known at runtime, shift in [0, 31].
+ * */
+static inline v_s32x4 v_rshr_var(v_s32x4 a, int shift) {
+    if (shift == 0) {
+        return a;
+    }
+#if defined(SIMD_NEON)
+    return {vrshlq_s32(a.val, vdupq_n_s32(-shift))};
+#elif defined(SIMD_SSE)
+    __m128i rounded = _mm_add_epi32(a.val, _mm_set1_epi32(1 << (shift - 1)));
+    return {_mm_sra_epi32(rounded, _mm_cvtsi32_si128(shift))};
+#else
+    v_s32x4 r;
+    for (int i = 0; i < 4; i++) {
+        r.val[i] = (a.val[i] + (1 << (shift - 1))) >> shift;
+    }
+    return r;
+#endif
+}
+
+/**
+ * Saturate lo into lanes 0..3 and hi into lanes 4..7.
+ * */
+static inline v_s16x8 v_narrow_sat_s16(v_s32x4 lo, v_s32x4 hi) {
+#if defined(SIMD_NEON)
+    return {vcombine_s16(vqmovn_s32(lo.val), vqmovn_s32(hi.val))};
+#elif defined(SIMD_SSE)
+    return {_mm_packs_epi32(lo.val, hi.val)};
+#else
+    v_s16x8 r;
+    for (int i = 0; i < 4; i++) {
+        r.val[i] = simd_detail::sat_s16(lo.val[i]);
+        r.val[i + 4] = simd_detail::sat_s16(hi.val[i]);
+    }
+    return r;
+#endif
+}
+
+/**
+ * Sign extend lanes 0..3 / 4..7 of a.
+ * */
+static inline v_s32x4 v_expand_lo(v_s16x8 a) {
+#if defined(SIMD_NEON)
+    return {vmovl_s16(vget_low_s16(a.val))};
+#elif defined(SIMD_SSE)
+    return {_mm_srai_epi32(_mm_unpacklo_epi16(a.val, a.val), 16)};
+#else
+    v_s32x4 r;
+    for (int i = 0; i < 4; i++) {
+        r.val[i] = a.val[i];
+    }
+    return r;
+#endif
+}
+
+static inline v_s32x4 v_expand_hi(v_s16x8 a) {
+#if defined(SIMD_NEON)
+    return {vmovl_s16(vget_high_s16(a.val))};
+#elif defined(SIMD_SSE)
+    return {_mm_srai_epi32(_mm_unpackhi_epi16(a.val, a.val), 16)};
+#else
+    v_s32x4 r;
+    for (int i = 0; i < 4; i++) {
+        r.val[i] = a.val[i + 4];
+    }
+    return r;
+#endif
+}
+
+/*
+ * ---------------------------------------------------------------------------------------------
+ * v_f32x4
+ * ---------------------------------------------------------------------------------------------
+ * */
+
+static inline v_f32x4 v_load_f32x4(const float *p) {
+#if defined(SIMD_NEON)
+    return {vld1q_f32(p)};
+#elif defined(SIMD_SSE)
+    return {_mm_loadu_ps(p)};
+#else
+    v_f32x4 r;
+    memcpy(r.val, p, 16);
+    return r;
+#endif
+}
+
+static inline void v_store(float *p, v_f32x4 a) {
+#if defined(SIMD_NEON)
+    vst1q_f32(p, a.val);
+#elif defined(SIMD_SSE)
+    _mm_storeu_ps(p, a.val);
+#else
+    memcpy(p, a.val, 16);
+#endif
+}
+
+static inline v_f32x4 v_dup_f32(float n) {
+#if defined(SIMD_NEON)
+    return {vdupq_n_f32(n)};
+#elif defined(SIMD_SSE)
+    return {_mm_set1_ps(n)};
+#else
+    v_f32x4 r;
+    for (int i = 0; i < 4; i++) {
+        r.val[i] = n;
+    }
+    return r;
+#endif
+}
+
+static inline v_f32x4 v_add(v_f32x4 a, v_f32x4 b) {
+#if defined(SIMD_NEON)
+    return {vaddq_f32(a.val, b.val)};
+#elif defined(SIMD_SSE)
+    return {_mm_add_ps(a.val, b.val)};
+#else
+    v_f32x4 r;
+    for (int i = 0; i < 4; i++) {
+        r.val[i] = a.val[i] + b.val[i];
+    }
+    return r;
+#endif
+}
+
+static inline v_f32x4 v_sub(v_f32x4 a, v_f32x4 b) {
+#if defined(SIMD_NEON)
+    return {vsubq_f32(a.val, b.val)};
+#elif defined(SIMD_SSE)
+    return {_mm_sub_ps(a.val, b.val)};
+#else
+    v_f32x4 r;
+    for (int i = 0; i < 4; i++) {
+        r.val[i] = a.val[i] - b.val[i];
+    }
+    return r;
+#endif
+}
+
+static inline v_f32x4 v_mul(v_f32x4 a, v_f32x4 b) {
+#if defined(SIMD_NEON)
+    return {vmulq_f32(a.val, b.val)};
+#elif defined(SIMD_SSE)
+    return {_mm_mul_ps(a.val, b.val)};
+#else
+    v_f32x4 r;
+    for (int i = 0; i < 4; i++) {
+        r.val[i] = a.val[i] * b.val[i];
+    }
+    return r;
+#endif
+}
+
+/**
+ * acc + a * b, rounded twice like a separate multiply and add on every backend.
+ * */
+static inline v_f32x4 v_mla(v_f32x4 acc, v_f32x4 a, v_f32x4 b) {
+    return v_add(acc, v_mul(a, b));
+}
+
+static inline v_f32x4 v_min(v_f32x4 a, v_f32x4 b) {
+#if defined(SIMD_NEON)
+    return {vminq_f32(a.val, b.val)};
+#elif defined(SIMD_SSE)
+    return {_mm_min_ps(a.val, b.val)};
+#else
+    v_f32x4 r;
+    for (int i = 0; i < 4; i++) {
+        r.val[i] = a.val[i] < b.val[i] ? a.val[i] : b.val[i];
+    }
+    return r;
+#endif
+}
+
+static inline v_f32x4 v_max(v_f32x4 a, v_f32x4 b) {
+#if defined(SIMD_NEON)
+    return {vmaxq_f32(a.val, b.val)};
+#elif defined(SIMD_SSE)
+    return {_mm_max_ps(a.val, b.val)};
+#else
+    v_f32x4 r;
+    for (int i = 0; i < 4; i++) {
+        r.val[i] = a.val[i] > b.val[i] ? a.val[i] : b.val[i];
+    }
+    return r;
+#endif
+}
+
+static inline v_f32x4 v_cvt_f32(v_s32x4 a) {
+#if defined(SIMD_NEON)
+    return {vcvtq_f32_s32(a.val)};
+#elif defined(SIMD_SSE)
+    return {_mm_cvtepi32_ps(a.val)};
+#else
+    v_f32x4 r;
+    for (int i = 0; i < 4; i++) {
+        r.val[i] = (float)a.val[i];
+    }
+    return r;
+#endif
+}
+
+/**
+ * Round to nearest, ties to even (lrintf with the default rounding mode).
+ * */
+static inline v_s32x4 v_round_s32(v_f32x4 a) {
+#if defined(SIMD_NEON) && defined(__aarch64__)
+    return {vcvtnq_s32_f32(a.val)};
+#elif defined(SIMD_SSE)
+    return {_mm_cvtps_epi32(a.val)};
+#else
+    float f[4];
+    int32_t n[4];
+    v_store(f, a);
+    for (int i = 0; i < 4; i++) {
+        n[i] = (int32_t)lrintf(f[i]);
+    }
+    return v_load_s32x4(n);
+#endif
+}
+
+#endif //CAMERAUTIL_SIMD_H
@@ -0,0 +1,263 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#include "tone_map.h"
+#include "dispatch.h"
+#include "cpu_features.h"
+#include "simd.h"
+#include "log.h"
+#include <math.h>
+#include <mutex>
+#include <list>
+
+using namespace std;
+
+#define TAG "tone_map.cpp"
+
+// 1.0 of the Q3 10 bit input signal
+#define SIGNAL_ONE (1023 * 8)
+// 1.0 of linear light, Q14
+#define LINEAR_BITS 14
+#define LINEAR_ONE (1 << LINEAR_BITS)
+#define MATRIX_BITS 12
+#define MAX_CACHED_MAPPERS 4
+
+// BT.2100 PQ
+#define PQ_M1 (2610.0 / 16384.0)
+#define PQ_M2 (2523.0 / 4096.0 * 128.0)
+#define PQ_C1 (3424.0 / 4096.0)
+#define PQ_C2 (2413.0 / 4096.0 * 32.0)
+#define PQ_C3 (2392.0 / 4096.0 * 32.0)
+#define PQ_PEAK_NITS 10000.0
+
+// BT.2100 HLG
+#define HLG_A 0.17883277
+#define HLG_B 0.28466892
+#define HLG_C 0.55991073
+
+/**
+ * BT.2087 / BT.2407, linear BT.2020 to linear BT.709.
+ * */
+static const double BT2020_TO_BT709[9] = {
+        1.660491, -0.587641, -0.072850,
+        -0.124550, 1.132900, -0.008349,
+        -0.018151, -0.100579, 1.118730,
+};
+
+static mutex cacheMutex;
+static list<shared_ptr<const ToneMapper>> mapperCache;
+
+static inline int32_t clamp_i32(int32_t n, int32_t max) {
+    return n < 0 ? 0 : (n > max ? max : n);
+}
+
+static inline int16_t sat_s16(int32_t n) {
+    return (int16_t)(n < -32768 ? -32768 : (n > 32767 ? 32767 : n));
+}
+
+static double pq_eotf(double e) {
+    double p = pow(fmax(e, 0.0), 1.0 / PQ_M2);
+    return PQ_PEAK_NITS * pow(fmax(p - PQ_C1, 0.0) / (PQ_C2 - PQ_C3 * p), 1.0 / PQ_M1);
+}
+
+static double pq_inverse_eotf(double nits) {
+    double y = pow(fmax(nits, 0.0) / PQ_PEAK_NITS, PQ_M1);
+    return pow((PQ_C1 + PQ_C2 * y) / (1.0 + PQ_C3 * y), PQ_M2);
+}
+
+/**
+ * HLG inverse OETF and OOTF. The OOTF is applied per channel instead of on luminance.
+ * */
+static double hlg_eotf(double e, double peakNits) {
+    e = fmax(e, 0.0);
+    double scene = e <= 0.5 ? e * e / 3.0 : (exp((e - HLG_C) / HLG_A) + HLG_B) / 12.0;
+    double gamma = 1.2 + 0.42 * log10(peakNits / 1000.0);
+    return peakNits * pow(scene, gamma);
+}
+
+static double srgb_oetf(double x) {
+    x = fmin(fmax(x, 0.0), 1.0);
+    return x <= 0.0031308 ? 12.92 * x : 1.055 * pow(x, 1.0 / 2.4) - 0.055;
+}
+
+/**
+ * Absolute luminance to [0, 1] relative to targetWhiteNits.
+ * */
+static double tone_curve(const ToneMapParams &params, double nits) {
+    double x = nits / params.targetWhiteNits;
+    double peak = params.sourcePeakNits / params.targetWhiteNits;
+    if (params.curve == TONE_CURVE_CLIP || peak <= 1.0) {
+        return fmin(x, 1.0);
+    }
+    if (params.curve == TONE_CURVE_REINHARD) {
+        double knee = fmin(fmax((double)params.knee, 0.0), 0.99);
+        if (x <= knee) {
+            return x;
+        }
+        // Extended Reinhard on what is above the knee, sourcePeakNits lands exactly on 1.
+        double t = (x - knee) / (1.0 - knee);
+        double w = (peak - knee) / (1.0 - knee);
+        return fmin(knee + (1.0 - knee) * t * (1.0 + t / (w * w)) / (1.0 + t), 1.0);
+    }
+    // BT.2390 EETF, Hermite spline roll off in the PQ domain, black level 0.
+    double sourcePq = pq_inverse_eotf(params.sourcePeakNits);
+    double e = fmin(pq_inverse_eotf(nits) / sourcePq, 1.0);
+    double maxLum = pq_inverse_eotf(params.targetWhiteNits) / sourcePq;
+    double ks = 1.5 * maxLum - 0.5;
+    if (e > ks) {
+        double t = (e - ks) / (1.0 - ks);
+        double t2 = t * t, t3 = t2 * t;
+        e = (2.0 * t3 - 3.0 * t2 + 1.0) * ks + (t3 - 2.0 * t2 + t) * (1.0 - ks) + (-2.0 * t3 + 3.0 * t2) * maxLum;
+    }
+    return fmin(pq_eotf(e * sourcePq) / params.targetWhiteNits, 1.0);
+}
+
+/**
+ * Signal of one channel to normalized linear light after the tone curve.
+ * */
+static double signal_to_linear(const ToneMapParams &params, double signal) {
+    double nits = params.transfer == HDR_TRANSFER_HLG ? hlg_eotf(signal, params.sourcePeakNits) : pq_eotf(signal);
+    return tone_curve(params, nits);
+}
+
+void tone_map_reference(const ToneMapParams &params, const double signal[3], double result[3]) {
+    double linear[3];
+    for (int i = 0; i < 3; i++) {
+        linear[i] = signal_to_linear(params, fmin(fmax(signal[i], 0.0), 1.0));
+    }
+    for (int i = 0; i < 3; i++) {
+        double x = 0;
+        for (int k = 0; k < 3; k++) {
+            x += BT2020_TO_BT709[i * 3 + k] * linear[k];
+        }
+        result[i] = srgb_oetf(x);
+    }
+}
+
+/**
+ * In place on three rows, Q14 in and out, saturated to int16.
+ * */
+static void rgb_matrix_c(int16_t *rgb, int width, const int16_t *matrix) {
+    int16_t *r = rgb, *g = rgb + width, *b = rgb + 2 * width;
+    const int32_t round = 1 << (MATRIX_BITS - 1);
+    for (int col = 0; col < width; col++) {
+        int32_t r0 = r[col], g0 = g[col], b0 = b[col];
+        r[col] = sat_s16((matrix[0] * r0 + matrix[1] * g0 + matrix[2] * b0 + round) >> MATRIX_BITS);
+        g[col] = sat_s16((matrix[3] * r0 + matrix[4] * g0 + matrix[5] * b0 + round) >> MATRIX_BITS);
+        b[col] = sat_s16((matrix[6] * r0 + matrix[7] * g0 + matrix[8] * b0 + round) >> MATRIX_BITS);
+    }
+}
+
+#if SIMD_128
+static inline v_s16x8 matrix_row(v_s16x8 r, v_s16x8 g, v_s16x8 b, const int16_t *m) {
+    v_s32x4 lo = v_dup_s32(0), hi = v_dup_s32(0);
+    lo = v_mlal_lo_n(lo, r, m[0]);
+    hi = v_mlal_hi_n(hi, r, m[0]);
+    lo = v_mlal_lo_n(lo, g, m[1]);
+    hi = v_mlal_hi_n(hi, g, m[1]);
+    lo = v_mlal_lo_n(lo, b, m[2]);
+    hi = v_mlal_hi_n(hi, b, m[2]);
+    return v_narrow_sat_s16(v_rshr<MATRIX_BITS>(lo), v_rshr<MATRIX_BITS>(hi));
+}
+
+static void rgb_matrix_simd(int16_t *rgb, int width, const int16_t *matrix) {
+    int16_t *r = rgb, *g = rgb + width, *b = rgb + 2 * width;
+    int col = 0;
+    for (; col + 8 <= width; col += 8) {
+        v_s16x8 r0 = v_load_s16x8(r + col);
+        v_s16x8 g0 = v_load_s16x8(g + col);
+        v_s16x8 b0 = v_load_s16x8(b + col);
+        v_store(r + col, matrix_row(r0, g0, b0, matrix));
+        v_store(g + col, matrix_row(r0, g0, b0, matrix + 3));
+        v_store(b + col, matrix_row(r0, g0, b0, matrix + 6));
+    }
+    if (col < width) {
+        // The tail rows start at different offsets, move them together for the scalar code.
+        int16_t tail[3 * 8];
+        int n = width - col;
+        for (int i = 0; i < n; i++) {
+            tail[i] = r[col + i];
+            tail[n + i] = g[col + i];
+            tail[2 * n + i] = b[col + i];
+        }
+        rgb_matrix_c(tail, n, matrix);
+        for (int i = 0; i < n; i++) {
+            r[col + i] = tail[i];
+            g[col + i] = tail[n + i];
+            b[col + i] = tail[2 * n + i];
+        }
+    }
+}
+#endif
+
+void tone_map_fill_kernels(KernelTable &table, uint32_t features) {
+    table.rgbMatrix = rgb_matrix_c;
+#if SIMD_128
+    if (features & SIMD_128_FEATURE) {
+        table.rgbMatrix = rgb_matrix_simd;
+    }
+#endif
+}
+
+ToneMapper::ToneMapper(const ToneMapParams &params, int outputBits) : params(params), outputBits(outputBits) {
+    linear.reset(new int16_t[SIGNAL_ONE + 1]);
+    for (int i = 0; i <= SIGNAL_ONE; i++) {
+        linear[i] = (int16_t)lround(signal_to_linear(params, (double)i / SIGNAL_ONE) * LINEAR_ONE);
+    }
+
+    // Rounded so every row still sums up to 1, white stays white.
+    for (int row = 0; row < 3; row++) {
+        int sum = 0;
+        for (int col = 0; col < 3; col++) {
+            matrix[row * 3 + col] = (int16_t)lround(BT2020_TO_BT709[row * 3 + col] * (1 << MATRIX_BITS));
+            sum += matrix[row * 3 + col];
+        }
+        matrix[row * 4] = (int16_t)(matrix[row * 4] + (1 << MATRIX_BITS) - sum);
+    }
+
+    double scale = outputBits == 8 ? 255.0 * 16 : 1023.0 * 8;
+    encoded.reset(new int16_t[LINEAR_ONE + 1]);
+    for (int i = 0; i <= LINEAR_ONE; i++) {
+        encoded[i] = (int16_t)lround(srgb_oetf((double)i / LINEAR_ONE) * scale);
+    }
+}
+
+void ToneMapper::apply(int16_t *rgb, int width) const {
+    // Local copies, stores into rgb could otherwise alias the table pointers.
+    const int16_t *toLinear = linear.get();
+    const int16_t *toEncoded = encoded.get();
+    int count = width * 3;
+    for (int i = 0; i < count; i++) {
+        rgb[i] = toLinear[clamp_i32(rgb[i], SIGNAL_ONE)];
+    }
+    kernel_table().rgbMatrix(rgb, width, matrix);
+    for (int i = 0; i < count; i++) {
+        rgb[i] = toEncoded[clamp_i32(rgb[i], LINEAR_ONE)];
+    }
+}
+
+shared_ptr<const ToneMapper> tone_mapper(const ToneMapParams &params, int outputBits) {
+    lock_guard<mutex> lock(cacheMutex);
+    for (auto it = mapperCache.begin(); it != mapperCache.end(); it++) {
+        if ((*it)->getParams() == params && (*it)->getOutputBits() == outputBits) {
+            auto mapper = *it;
+            mapperCache.erase(it);
+            mapperCache.push_front(mapper);
+            return mapper;
+        }
+    }
+    LOGD(TAG, "build tone mapper, transfer = %d, curve = %d, peak = %.0f nits, white = %.0f nits",
+         params.transfer, params.curve, params.sourcePeakNits, params.targetWhiteNits);
+    auto mapper = make_shared<const ToneMapper>(params, outputBits);
+    mapperCache.push_front(mapper);
+    if (mapperCache.size() > MAX_CACHED_MAPPERS) {
+        mapperCache.pop_back();
+    }
+    return mapper;
+}
+
+void tone_map_clear_cache() {
+    lock_guard<mutex> lock(cacheMutex);
+    mapperCache.clear();
+}
@@ -0,0 +1,90 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#ifndef CAMERAUTIL_TONE_MAP_H
+#define CAMERAUTIL_TONE_MAP_H
+
+#include <stdint.h>
+#include <memory>
+
+/**
+ * HDR（BT.2100 PQ/HLG，BT.2020色域）转SDR（sRGB/BT.709）。
+ *
+ * 每个通道依次经过：
+ * 1. EOTF，PQ或HLG信号转成绝对亮度（nits）；
+ * 2. 色调曲线，把[0, sourcePeakNits]压到[0, targetWhiteNits]，再归一化到[0, 1]；
+ * 3. BT.2020到BT.709的3x3矩阵（线性光），超出色域的部分截断；
+ * 4. sRGB OETF。
+ * 1和2合成一张表，4是另一张表，矩阵用定点SIMD计算，所以每个像素只有两次查表和一次矩阵乘法。
+ * 表按参数缓存，参数不变时不会重建。
+ *
+ * 色调曲线按通道计算（不是按亮度），HLG的OOTF也按通道近似为E^gamma，这样才能放进1D表。
+ * */
+
+#define HDR_TRANSFER_PQ 0
+#define HDR_TRANSFER_HLG 1
+
+#define TONE_CURVE_BT2390 0
+#define TONE_CURVE_REINHARD 1
+#define TONE_CURVE_CLIP 2
+
+struct ToneMapParams {
+    int transfer = HDR_TRANSFER_PQ;
+    int curve = TONE_CURVE_BT2390;
+    // Mastering display peak for PQ, nominal display peak (Lw) for HLG.
+    float sourcePeakNits = 1000.0f;
+    // Luminance that becomes SDR white, BT.2408 reference white by default.
+    float targetWhiteNits = 203.0f;
+    // TONE_CURVE_REINHARD: below knee * targetWhiteNits the curve is the identity.
+    float knee = 0.75f;
+
+    bool operator==(const ToneMapParams &other) const {
+        return transfer == other.transfer && curve == other.curve && sourcePeakNits == other.sourcePeakNits &&
+               targetWhiteNits == other.targetWhiteNits && knee == other.knee;
+    }
+};
+
+/**
+ * Input rows are R, G, B in int16, Q3 of 10 bit (yuv10_coefficients with a 10 bit output format),
+ * i.e. 1023 * 8 is signal 1.0. apply() converts them in place to what the yuv10 packers take:
+ * Q4 of 8 bit if outputBits is 8, Q3 of 10 bit if outputBits is 10.
+ * */
+class ToneMapper {
+public:
+    ToneMapper(const ToneMapParams &params, int outputBits);
+
+    void apply(int16_t *rgb, int width) const;
+
+    const ToneMapParams &getParams() const {
+        return params;
+    }
+
+    int getOutputBits() const {
+        return outputBits;
+    }
+
+private:
+    ToneMapParams params;
+    int outputBits;
+    // Q3 signal -> normalized linear light after the tone curve, Q14
+    std::unique_ptr<int16_t[]> linear;
+    // BT.2020 -> BT.709, Q12, row major
+    int16_t matrix[9];
+    // Q14 linear -> sRGB in output precision
+    std::unique_ptr<int16_t[]> encoded;
+};
+
+/**
+ * Cached mapper for the parameters, built the first time they are used.
+ * */
+std::shared_ptr<const ToneMapper> tone_mapper(const ToneMapParams &params, int outputBits);
+
+void tone_map_clear_cache();
+
+/**
+ * Double precision version of the whole chain for one pixel, signal and result in [0, 1].
+ * */
+void tone_map_reference(const ToneMapParams &params, const double signal[3], double result[3]);
+
+#endif //CAMERAUTIL_TONE_MAP_H
@@ -0,0 +1,246 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#include "trace.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__ANDROID__)
+#include <android/trace.h>
+#include <dlfcn.h>
+#else
+#include <pthread.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#endif
+
+using namespace std;
+
+#define TAG "trace.cpp"
+
+#define TRACE_FILE_ENV "CAMERAUTIL_TRACE"
+
+#if CAMERAUTIL_TRACE && defined(__ANDROID__)
+
+bool trace_enabled() {
+    return ATrace_isEnabled();
+}
+
+void trace_begin(const char *name) {
+    ATrace_beginSection(name);
+}
+
+void trace_end(const char *, uint64_t) {
+    ATrace_endSection();
+}
+
+void trace_counter(const char *name, int64_t value) {
+    // API 29, looked up so that older devices still load the library.
+    typedef void (*SetCounter)(const char *, int64_t);
+    static SetCounter setCounter = (SetCounter)dlsym(RTLD_DEFAULT, "ATrace_setCounter");
+    if (setCounter != nullptr && ATrace_isEnabled()) {
+        setCounter(name, value);
+    }
+}
+
+uint64_t trace_now_ns() {
+    // Sections carry their own time in ATrace.
+    return 0;
+}
+
+#elif CAMERAUTIL_TRACE
+
+namespace {
+
+struct TraceEvent {
+    const char *name;
+    uint64_t timeNs;
+    // Duration of a section, value of a counter
+    int64_t value;
+    char phase;
+};
+
+struct ThreadBuffer {
+    int tid;
+    char threadName[32];
+    vector<TraceEvent> events;
+    // Published with release after the event is written, so the writer reads it with acquire.
+    atomic<uint32_t> count{0};
+    atomic<uint32_t> dropped{0};
+};
+
+struct Registry {
+    mutex lock;
+    vector<unique_ptr<ThreadBuffer>> buffers;
+    atomic<bool> recording{false};
+    uint64_t startNs = 0;
+};
+
+// Never destroyed, threads may still trace while the process exits.
+Registry &registry() {
+    static Registry *instance = new Registry();
+    return *instance;
+}
+
+thread_local ThreadBuffer *threadBuffer = nullptr;
+
+ThreadBuffer *thread_buffer() {
+    if (threadBuffer == nullptr) {
+        auto buffer = make_unique<ThreadBuffer>();
+        buffer->tid = (int)gettid();
+        if (pthread_getname_np(pthread_self(), buffer->threadName, sizeof(buffer->threadName)) != 0) {
+            snprintf(buffer->threadName, sizeof(buffer->threadName), "thread %d", buffer->tid);
+        }
+        buffer->events.resize(TRACE_EVENTS_PER_THREAD);
+        threadBuffer = buffer.get();
+        Registry &r = registry();
+        lock_guard<mutex> lock(r.lock);
+        r.buffers.push_back(std::move(buffer));
+    }
+    return threadBuffer;
+}
+
+void record(const char *name, char phase, uint64_t timeNs, int64_t value) {
+    ThreadBuffer *buffer = thread_buffer();
+    uint32_t n = buffer->count.load(memory_order_relaxed);
+    if (n >= TRACE_EVENTS_PER_THREAD) {
+        buffer->dropped.fetch_add(1, memory_order_relaxed);
+        return;
+    }
+    buffer->events[n] = {name, timeNs, value, phase};
+    buffer->count.store(n + 1, memory_order_release);
+}
+
+void write_string(FILE *file, const char *s) {
+    fputc('"', file);
+    for (; *s != '\0'; s++) {
+        if (*s == '"' || *s == '\\') {
+            fputc('\\', file);
+        }
+        fputc(*s, file);
+    }
+    fputc('"', file);
+}
+
+void write_json_at_exit() {
+    const char *path = getenv(TRACE_FILE_ENV);
+    if (path != nullptr && trace_write_json(path)) {
+        LOGD(TAG, "trace written to %s", path);
+    }
+}
+
+bool start_from_environment() {
+    const char *path = getenv(TRACE_FILE_ENV);
+    if (path == nullptr || path[0] == '\0') {
+        return false;
+    }
+    trace_start();
+    atexit(write_json_at_exit);
+    return true;
+}
+
+bool tracingFromEnvironment = start_from_environment();
+
+}
+
+bool trace_enabled() {
+    return registry().recording.load(memory_order_relaxed);
+}
+
+void trace_begin(const char *) {
+    // The section is recorded as one complete event when it ends.
+}
+
+void trace_end(const char *name, uint64_t beginNs) {
+    record(name, 'X', beginNs, (int64_t)(trace_now_ns() - beginNs));
+}
+
+void trace_counter(const char *name, int64_t value) {
+    if (trace_enabled()) {
+        record(name, 'C', trace_now_ns(), value);
+    }
+}
+
+uint64_t trace_now_ns() {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+void trace_start() {
+    Registry &r = registry();
+    r.recording.store(false);
+    lock_guard<mutex> lock(r.lock);
+    for (auto &buffer : r.buffers) {
+        buffer->count.store(0);
+        buffer->dropped.store(0);
+    }
+    r.startNs = trace_now_ns();
+    r.recording.store(true);
+}
+
+bool trace_write_json(const char *path) {
+    Registry &r = registry();
+    r.recording.store(false);
+    FILE *file = fopen(path, "w");
+    if (file == nullptr) {
+        LOGE(TAG, "can not write %s", path);
+        return false;
+    }
+    int pid = (int)getpid();
+    uint64_t dropped = 0;
+    bool first = true;
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", file);
+    lock_guard<mutex> lock(r.lock);
+    for (auto &buffer : r.buffers) {
+        uint32_t count = buffer->count.load(memory_order_acquire);
+        dropped += buffer->dropped.load(memory_order_relaxed);
+        fprintf(file, "%s\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":",
+                first ? "" : ",", pid, buffer->tid);
+        write_string(file, buffer->threadName);
+        fputs("}}", file);
+        first = false;
+        for (uint32_t i = 0; i < count; i++) {
+            const TraceEvent &e = buffer->events[i];
+            // Microseconds since trace_start
+            double ts = (double)(int64_t)(e.timeNs - r.startNs) / 1000.0;
+            fprintf(file, ",\n{\"ph\":\"%c\",\"name\":", e.phase);
+            write_string(file, e.name);
+            if (e.phase == 'X') {
+                fprintf(file, ",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", pid, buffer->tid, ts,
+                        e.value / 1000.0);
+            } else {
+                fprintf(file, ",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"args\":{\"value\":%lld}}", pid, buffer->tid, ts,
+                        (long long)e.value);
+            }
+        }
+    }
+    fputs("\n]}\n", file);
+    bool ok = ferror(file) == 0;
+    ok &= fclose(file) == 0;
+    if (dropped > 0) {
+        LOGE(TAG, "%llu events dropped, more than %d on a thread", (unsigned long long)dropped,
+             TRACE_EVENTS_PER_THREAD);
+    }
+    return ok;
+}
+
+#endif
+
+#if !CAMERAUTIL_TRACE || defined(__ANDROID__)
+
+void trace_start() {
+}
+
+bool trace_write_json(const char *) {
+    return false;
+}
+
+#endif
@@ -0,0 +1,83 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#ifndef CAMERAUTIL_TRACE_H
+#define CAMERAUTIL_TRACE_H
+
+#include <stdint.h>
+
+/**
+ * native帧路径的时间线追踪：ImageProxy准备、Bitmap获取、每个线程上的转换stripe、帧分析、编码封装。
+ *
+ * TRACE_SCOPE(name)在当前作用域内记录一段，TRACE_COUNTER(name, value)记录计数器（队列深度、丢弃数），
+ * name必须是字符串常量。
+ * Android上直接输出ATrace，用Perfetto或systrace抓取（app类别选本应用）。
+ * 其他Linux上写进每个线程自己的缓冲区，不加锁；设置环境变量CAMERAUTIL_TRACE=文件路径后，
+ * 从加载开始记录，进程退出时写成Chrome trace JSON，可以用chrome://tracing或ui.perfetto.dev打开。
+ *
+ * 编译时定义CAMERAUTIL_TRACE=0（CMake选项CAMERAUTIL_TRACE=OFF）后宏展开为空，没有任何开销。
+ * */
+
+#ifndef CAMERAUTIL_TRACE
+#define CAMERAUTIL_TRACE 1
+#endif
+
+// Events kept per thread between trace_start and trace_write_json, later ones are counted and dropped.
+#define TRACE_EVENTS_PER_THREAD (1 << 16)
+
+#if CAMERAUTIL_TRACE
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+#define TRACE_COUNTER(name, value) trace_counter(name, (int64_t)(value))
+
+bool trace_enabled();
+void trace_begin(const char *name);
+void trace_end(const char *name, uint64_t beginNs);
+void trace_counter(const char *name, int64_t value);
+uint64_t trace_now_ns();
+
+class TraceScope {
+public:
+    explicit TraceScope(const char *name) : name(trace_enabled() ? name : nullptr) {
+        if (this->name != nullptr) {
+            beginNs = trace_now_ns();
+            trace_begin(name);
+        }
+    }
+
+    ~TraceScope() {
+        if (name != nullptr) {
+            trace_end(name, beginNs);
+        }
+    }
+
+    TraceScope(TraceScope &) = delete;
+
+private:
+    const char *name;
+    uint64_t beginNs = 0;
+};
+
+#else
+
+#define TRACE_SCOPE(name) ((void)0)
+// sizeof does not evaluate value, it only keeps variables computed for the counter from being unused.
+#define TRACE_COUNTER(name, value) ((void)sizeof(value))
+
+#endif
+
+/**
+ * Linux builds: clear the per thread buffers and start recording. Does nothing on Android.
+ * */
+void trace_start();
+
+/**
+ * Linux builds: stop recording and write what was recorded as Chrome trace JSON.
+ * Return false on Android, in builds without tracing or if the file can not be written.
+ * */
+bool trace_write_json(const char *path);
+
+#endif //CAMERAUTIL_TRACE_H
@@ -0,0 +1,317 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#include "warp.h"
+#include "dispatch.h"
+#include "cpu_features.h"
+#include "parallel.h"
+#include "simd.h"
+#include "frame_arena.h"
+#include "log.h"
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+using namespace std;
+
+#define TAG "warp.cpp"
+
+#define MIN_STRIPE_ROWS 16
+#define FRACTION_BITS WARP_FRACTION_BITS
+// Interpolation runs on pixels scaled to Q6, the blends are Q15 rounding multiplies.
+#define PIXEL_BITS 6
+// Source coordinates are clamped to this, so that they fit Q16 in an int32.
+#define COORD_LIMIT 30000.0
+// Projective spans with w below this are behind the camera or at infinity.
+#define MIN_W 1e-9
+
+static inline int32_t mulhrs(int32_t a, int32_t b) {
+    return (a * b + (1 << 14)) >> 15;
+}
+
+static inline uint8_t blend(int p00, int p01, int p10, int p11, int fx, int fy) {
+    int top = (p00 << PIXEL_BITS) + mulhrs((p01 - p00) << PIXEL_BITS, fx);
+    int bottom = (p10 << PIXEL_BITS) + mulhrs((p11 - p10) << PIXEL_BITS, fx);
+    int r = (top + mulhrs(bottom - top, fy) + (1 << (PIXEL_BITS - 1))) >> PIXEL_BITS;
+    return (uint8_t)(r < 0 ? 0 : (r > 255 ? 255 : r));
+}
+
+static inline int fraction(int32_t coordinate) {
+    return (coordinate >> 1) & 0x7FFF;
+}
+
+/**
+ * Every sample and its right / lower neighbours are inside the source.
+ * */
+static void warp_bilinear_c1_c(const uint8_t *src, int srcStride, int srcPixelStride, int32_t u, int32_t v,
+                               int32_t du, int32_t dv, uint8_t *dst, int count) {
+    for (int i = 0; i < count; i++, u += du, v += dv) {
+        const uint8_t *p = src + (size_t)(v >> FRACTION_BITS) * srcStride + (u >> FRACTION_BITS) * srcPixelStride;
+        dst[i] = blend(p[0], p[srcPixelStride], p[srcStride], p[srcStride + srcPixelStride], fraction(u), fraction(v));
+    }
+}
+
+static void warp_bilinear_c4_c(const uint8_t *src, int srcStride, int32_t u, int32_t v, int32_t du, int32_t dv,
+                               uint8_t *dst, int count) {
+    for (int i = 0; i < count; i++, u += du, v += dv) {
+        const uint8_t *p = src + (size_t)(v >> FRACTION_BITS) * srcStride + (u >> FRACTION_BITS) * 4;
+        int fx = fraction(u), fy = fraction(v);
+        for (int c = 0; c < 4; c++) {
+            dst[i * 4 + c] = blend(p[c], p[4 + c], p[srcStride + c], p[srcStride + 4 + c], fx, fy);
+        }
+    }
+}
+
+#if SIMD_128
+static inline v_u8x8 blend(v_s16x8 p00, v_s16x8 p01, v_s16x8 p10, v_s16x8 p11, v_s16x8 fx, v_s16x8 fy) {
+    v_s16x8 top = v_add(v_shl<PIXEL_BITS>(p00), v_mulhrs(v_shl<PIXEL_BITS>(v_sub(p01, p00)), fx));
+    v_s16x8 bottom = v_add(v_shl<PIXEL_BITS>(p10), v_mulhrs(v_shl<PIXEL_BITS>(v_sub(p11, p10)), fx));
+    return v_rshr_narrow_sat_u8<PIXEL_BITS>(v_add(top, v_mulhrs(v_sub(bottom, top), fy)));
+}
+
+/**
+ * The 4 neighbours of 8 samples are gathered into lanes, the interpolation is vectorized.
+ * */
+static void warp_bilinear_c1_simd(const uint8_t *src, int srcStride, int srcPixelStride, int32_t u, int32_t v,
+                                  int32_t du, int32_t dv, uint8_t *dst, int count) {
+    int16_t p00[8], p01[8], p10[8], p11[8], fx[8], fy[8];
+    int i = 0;
+    if (srcPixelStride == 1) {
+        // Horizontal neighbours are adjacent bytes: gather them in pairs and split them with one deinterleave.
+        uint8_t top[16], bottom[16];
+        for (; i + 8 <= count; i += 8) {
+            for (int j = 0; j < 8; j++, u += du, v += dv) {
+                const uint8_t *p = src + (size_t)(v >> FRACTION_BITS) * srcStride + (u >> FRACTION_BITS);
+                memcpy(top + j * 2, p, 2);
+                memcpy(bottom + j * 2, p + srcStride, 2);
+                fx[j] = (int16_t)fraction(u);
+                fy[j] = (int16_t)fraction(v);
+            }
+            v_s16x8 left0, right0, left1, right1;
+            v_load_deinterleave_expand_s16(top, left0, right0);
+            v_load_deinterleave_expand_s16(bottom, left1, right1);
+            v_store(dst + i, blend(left0, right0, left1, right1, v_load_s16x8(fx), v_load_s16x8(fy)));
+        }
+    }
+    for (; i + 8 <= count; i += 8) {
+        for (int j = 0; j < 8; j++, u += du, v += dv) {
+            const uint8_t *p = src + (size_t)(v >> FRACTION_BITS) * srcStride + (u >> FRACTION_BITS) * srcPixelStride;
+            p00[j] = p[0];
+            p01[j] = p[srcPixelStride];
+            p10[j] = p[srcStride];
+            p11[j] = p[srcStride + srcPixelStride];
+            fx[j] = (int16_t)fraction(u);
+            fy[j] = (int16_t)fraction(v);
+        }
+        v_store(dst + i, blend(v_load_s16x8(p00), v_load_s16x8(p01), v_load_s16x8(p10), v_load_s16x8(p11),
+                               v_load_s16x8(fx), v_load_s16x8(fy)));
+    }
+    warp_bilinear_c1_c(src, srcStride, srcPixelStride, u, v, du, dv, dst + i, count - i);
+}
+
+/**
+ * Two RGBA samples per vector.
+ * */
+static void warp_bilinear_c4_simd(const uint8_t *src, int srcStride, int32_t u, int32_t v, int32_t du, int32_t dv,
+                                  uint8_t *dst, int count) {
+    uint8_t p00[8], p01[8], p10[8], p11[8];
+    int16_t fx[8], fy[8];
+    int i = 0;
+    for (; i + 2 <= count; i += 2) {
+        for (int j = 0; j < 2; j++, u += du, v += dv) {
+            const uint8_t *p = src + (size_t)(v >> FRACTION_BITS) * srcStride + (u >> FRACTION_BITS) * 4;
+            memcpy(p00 + j * 4, p, 4);
+            memcpy(p01 + j * 4, p + 4, 4);
+            memcpy(p10 + j * 4, p + srcStride, 4);
+            memcpy(p11 + j * 4, p + srcStride + 4, 4);
+            for (int c = 0; c < 4; c++) {
+                fx[j * 4 + c] = (int16_t)fraction(u);
+                fy[j * 4 + c] = (int16_t)fraction(v);
+            }
+        }
+        v_store(dst + i * 4, blend(v_load_expand_s16(p00), v_load_expand_s16(p01), v_load_expand_s16(p10),
+                                   v_load_expand_s16(p11), v_load_s16x8(fx), v_load_s16x8(fy)));
+    }
+    warp_bilinear_c4_c(src, srcStride, u, v, du, dv, dst + i * 4, count - i);
+}
+#endif
+
+void warp_fill_kernels(KernelTable &table, uint32_t features) {
+    table.warpBilinearC1 = warp_bilinear_c1_c;
+    table.warpBilinearC4 = warp_bilinear_c4_c;
+#if SIMD_128
+    if (features & SIMD_128_FEATURE) {
+        table.warpBilinearC1 = warp_bilinear_c1_simd;
+        table.warpBilinearC4 = warp_bilinear_c4_simd;
+    }
+#endif
+}
+
+/**
+ * One sample anywhere, neighbours outside the source are the border value or the nearest edge pixel.
+ * */
+static void warp_border_pixel(const WarpSource &s, int64_t u, int64_t v, int border, const uint8_t *borderValue,
+                              uint8_t *out) {
+    int64_t x0 = u >> FRACTION_BITS, y0 = v >> FRACTION_BITS;
+    const uint8_t *p[4];
+    for (int k = 0; k < 4; k++) {
+        int64_t x = x0 + (k & 1), y = y0 + (k >> 1);
+        if (border == WARP_BORDER_REPLICATE) {
+            x = std::min(std::max(x, (int64_t)0), (int64_t)s.width - 1);
+            y = std::min(std::max(y, (int64_t)0), (int64_t)s.height - 1);
+        }
+        if (x < 0 || y < 0 || x >= s.width || y >= s.height) {
+            p[k] = borderValue;
+        } else {
+            p[k] = s.data + (size_t)y * s.stride + (size_t)x * s.pixelStride;
+        }
+    }
+    int fx = fraction((int32_t)(u & 0xFFFF)), fy = fraction((int32_t)(v & 0xFFFF));
+    for (int c = 0; c < s.channels; c++) {
+        out[c] = blend(p[0][c], p[1][c], p[2][c], p[3][c], fx, fy);
+    }
+}
+
+static inline int64_t to_fixed(double coordinate) {
+    return llround(std::min(std::max(coordinate, -COORD_LIMIT), COORD_LIMIT) * (1 << FRACTION_BITS));
+}
+
+/**
+ * Both ends of a span are on the same outer side of the source, so every tap of it is outside.
+ * */
+static inline bool span_outside(int64_t start, int64_t end, int size) {
+    const int64_t one = 1 << FRACTION_BITS;
+    return (start < -one && end < -one) || (start >= size * one && end >= size * one);
+}
+
+static inline bool span_inside(int64_t start, int64_t end, int size) {
+    const int64_t limit = (int64_t)(size - 1) << FRACTION_BITS;
+    return start >= 0 && end >= 0 && start < limit && end < limit;
+}
+
+void warp_span(const WarpSource &s, int64_t u, int64_t v, int64_t du, int64_t dv, int count,
+               int border, const uint8_t *borderValue, uint8_t *dst) {
+    int64_t endU = u + du * (count - 1), endV = v + dv * (count - 1);
+    if (span_inside(u, endU, s.width) && span_inside(v, endV, s.height)) {
+        const KernelTable &kt = kernel_table();
+        if (s.channels == 1) {
+            kt.warpBilinearC1(s.data, s.stride, s.pixelStride, (int32_t)u, (int32_t)v, (int32_t)du, (int32_t)dv,
+                              dst, count);
+        } else {
+            kt.warpBilinearC4(s.data, s.stride, (int32_t)u, (int32_t)v, (int32_t)du, (int32_t)dv, dst, count);
+        }
+    } else if (border == WARP_BORDER_CONSTANT &&
+               (span_outside(u, endU, s.width) || span_outside(v, endV, s.height))) {
+        for (int i = 0; i < count; i++) {
+            memcpy(dst + i * s.channels, borderValue, s.channels);
+        }
+    } else {
+        for (int i = 0; i < count; i++, u += du, v += dv) {
+            warp_border_pixel(s, u, v, border, borderValue, dst + i * s.channels);
+        }
+    }
+}
+
+static void warp_row(const WarpSource &s, uint8_t *out, int y, int dstWidth, const glm::mat3 &m, bool affine,
+                     int border, const uint8_t *borderValue) {
+    const int channels = s.channels;
+    // Source position of (x, y) is (a x + b, c x + d) / (e x + f)
+    double a = m[0][0], b = m[1][0] * y + m[2][0];
+    double c = m[0][1], d = m[1][1] * y + m[2][1];
+    double e = m[0][2], f = m[1][2] * y + m[2][2];
+    int64_t rowU = to_fixed(b), rowV = to_fixed(d);
+    int64_t affineDu = llround(a * (1 << FRACTION_BITS)), affineDv = llround(c * (1 << FRACTION_BITS));
+
+    for (int xs = 0; xs < dstWidth; xs += WARP_SPAN) {
+        int n = std::min(WARP_SPAN, dstWidth - xs);
+        uint8_t *spanOut = out + (size_t)xs * channels;
+        int64_t u, v, du, dv;
+        if (affine) {
+            u = rowU + affineDu * xs;
+            v = rowV + affineDv * xs;
+            du = affineDu;
+            dv = affineDv;
+        } else {
+            double w0 = e * xs + f, w1 = e * (xs + n) + f;
+            if (w0 < MIN_W || w1 < MIN_W) {
+                // Part of the span is behind the camera, no line to step along.
+                for (int i = 0; i < n; i++) {
+                    double x = xs + i, w = e * x + f;
+                    if (w < MIN_W) {
+                        memcpy(spanOut + i * channels, borderValue, channels);
+                    } else {
+                        warp_border_pixel(s, to_fixed((a * x + b) / w), to_fixed((c * x + d) / w), border,
+                                          borderValue, spanOut + i * channels);
+                    }
+                }
+                continue;
+            }
+            u = to_fixed((a * xs + b) / w0);
+            v = to_fixed((c * xs + d) / w0);
+            du = (to_fixed((a * (xs + n) + b) / w1) - u) / n;
+            dv = (to_fixed((c * (xs + n) + d) / w1) - v) / n;
+        }
+        warp_span(s, u, v, du, dv, n, border, borderValue, spanOut);
+    }
+}
+
+static void warp(const WarpSource &s, uint8_t *dst, int dstStride, int dstPixelStride, int dstWidth, int dstHeight,
+                 const glm::mat3 &dstToSrc, int border, uint32_t borderValue) {
+    glm::mat3 m = dstToSrc;
+    bool affine = m[0][2] == 0 && m[1][2] == 0 && m[2][2] != 0;
+    if (affine) {
+        m /= m[2][2];
+    }
+    uint8_t borderBytes[4];
+    memcpy(borderBytes, &borderValue, 4);
+    parallel_for_stripes(dstHeight, MIN_STRIPE_ROWS, [&](int rowStart, int rowEnd) {
+        // Interleaved chroma is warped into a row of its own first.
+        FrameArena scratch;
+        uint8_t *row = dstPixelStride == 1 ? nullptr : scratch.alloc<uint8_t>(dstWidth);
+        for (int y = rowStart; y < rowEnd; y++) {
+            uint8_t *out = dst + (size_t)y * dstStride;
+            warp_row(s, row == nullptr ? out : row, y, dstWidth, m, affine, border, borderBytes);
+            if (row != nullptr) {
+                for (int x = 0; x < dstWidth; x++) {
+                    out[x * dstPixelStride] = row[x];
+                }
+            }
+        }
+    });
+}
+
+bool warp_plane(const uint8_t *src, int srcStride, int srcWidth, int srcHeight,
+                uint8_t *dst, int dstStride, int dstWidth, int dstHeight, int channels,
+                const glm::mat3 &dstToSrc, int border, uint32_t borderValue) {
+    if ((channels != 1 && channels != 4) || srcWidth <= 0 || srcHeight <= 0 || dstWidth <= 0 || dstHeight <= 0) {
+        LOGE(TAG, "can not warp %d channels, %dx%d to %dx%d", channels, srcWidth, srcHeight, dstWidth, dstHeight);
+        return false;
+    }
+    WarpSource s = {src, srcStride, channels, srcWidth, srcHeight, channels};
+    warp(s, dst, dstStride, 1, dstWidth, dstHeight, dstToSrc, border, borderValue);
+    return true;
+}
+
+bool warp_yuv420(const YuvFrame &src, uint8_t *y, int yRowStride, uint8_t *u, uint8_t *v, int uvRowStride,
+                 int uvPixelStride, int dstWidth, int dstHeight, const glm::mat3 &dstToSrc, int border) {
+    if (src.width <= 0 || src.height <= 0 || dstWidth <= 0 || dstHeight <= 0) {
+        LOGE(TAG, "can not warp %dx%d to %dx%d", src.width, src.height, dstWidth, dstHeight);
+        return false;
+    }
+    WarpSource luma = {src.y, src.yRowStride, 1, src.width, src.height, 1};
+    warp(luma, y, yRowStride, 1, dstWidth, dstHeight, dstToSrc, border, 0);
+
+    // Chroma sample (x, y) sits at luma (2x + 0.5, 2y + 0.5), in both frames.
+    const glm::mat3 chromaToLuma(2, 0, 0, 0, 2, 0, 0.5f, 0.5f, 1);
+    const glm::mat3 lumaToChroma(0.5f, 0, 0, 0, 0.5f, 0, -0.25f, -0.25f, 1);
+    glm::mat3 chroma = lumaToChroma * dstToSrc * chromaToLuma;
+    int srcChromaWidth = (src.width + 1) / 2, srcChromaHeight = (src.height + 1) / 2;
+    int chromaWidth = (dstWidth + 1) / 2, chromaHeight = (dstHeight + 1) / 2;
+    const uint32_t neutral = 0x80808080;
+    WarpSource planeU = {src.u, src.uvRowStride, src.uvPixelStride, srcChromaWidth, srcChromaHeight, 1};
+    WarpSource planeV = {src.v, src.uvRowStride, src.uvPixelStride, srcChromaWidth, srcChromaHeight, 1};
+    warp(planeU, u, uvRowStride, uvPixelStride, chromaWidth, chromaHeight, chroma, border, neutral);
+    warp(planeV, v, uvRowStride, uvPixelStride, chromaWidth, chromaHeight, chroma, border, neutral);
+    return true;
+}
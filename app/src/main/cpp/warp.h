@@ -0,0 +1,71 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#ifndef CAMERAUTIL_WARP_H
+#define CAMERAUTIL_WARP_H
+
+#include "yuv_kernels.h"
+#include "glm/mat3x3.hpp"
+#include <stdint.h>
+
+/**
+ * 任意仿射/透视变换（防抖、文档矫正、水平校正），双线性插值。
+ *
+ * 变换矩阵是glm::mat3（列序，见converter.cpp中的说明），把输出像素(x, y, 1)映射到源图像坐标，
+ * 即dst到src的逆变换，通常是glm::inverse(src到dst的变换)。最后一行是(0, 0, 1)时按仿射处理。
+ *
+ * 源坐标不逐像素做矩阵乘法：每行切成WARP_SPAN个像素的段，段内用Q16定点数逐像素累加步长，
+ * 仿射变换的步长是精确的常数，透视变换在每段两端精确计算（一次除法）、段内线性插值。
+ * 一段的源坐标是一条线段，两端都在源图像内时整段走SIMD插值，
+ * 两端在源图像同一侧之外时（WARP_BORDER_CONSTANT）整段直接填边界值，其余的段逐像素处理边界。
+ * 插值的SIMD版本与标量版本逐位一致。
+ * */
+
+// Pixels outside the source are borderValue.
+#define WARP_BORDER_CONSTANT 0
+// Pixels outside the source repeat the nearest edge pixel.
+#define WARP_BORDER_REPLICATE 1
+
+// Output pixels per span, source coordinates are exact at the ends of a projective span.
+#define WARP_SPAN 16
+
+// Source coordinates of warp_span
+#define WARP_FRACTION_BITS 16
+
+struct WarpSource {
+    const uint8_t *data;
+    // Bytes between rows and between the first bytes of two pixels.
+    int stride;
+    int pixelStride;
+    int width;
+    int height;
+    // 1, or 4 with pixelStride 4
+    int channels;
+};
+
+/**
+ * Sample count pixels into dst starting at source position (u, v) and stepping (du, dv), all Q16 pixel
+ * coordinates, for remaps that compute their own source positions. borderValue has channels bytes.
+ * */
+void warp_span(const WarpSource &src, int64_t u, int64_t v, int64_t du, int64_t dv, int count,
+               int border, const uint8_t *borderValue, uint8_t *dst);
+
+/**
+ * Warp a plane of channels 1 (any 8 bit plane) or 4 (RGBA) into dst. For 4 channels borderValue is
+ * the RGBA pixel as stored in memory read as a little endian uint32, for 1 its low byte.
+ * Coordinates are pixel indices. Strides in bytes. Return false for an unsupported channel count or size.
+ * */
+bool warp_plane(const uint8_t *src, int srcStride, int srcWidth, int srcHeight,
+                uint8_t *dst, int dstStride, int dstWidth, int dstHeight, int channels,
+                const glm::mat3 &dstToSrc, int border = WARP_BORDER_CONSTANT, uint32_t borderValue = 0);
+
+/**
+ * Warp all three planes of a YUV 420 frame, chroma with the transform moved to chroma sample
+ * positions. The constant border is black. Output as I420 (uvPixelStride 1) or NV12 / NV21 (2).
+ * */
+bool warp_yuv420(const YuvFrame &src, uint8_t *y, int yRowStride, uint8_t *u, uint8_t *v, int uvRowStride,
+                 int uvPixelStride, int dstWidth, int dstHeight, const glm::mat3 &dstToSrc,
+                 int border = WARP_BORDER_CONSTANT);
+
+#endif //CAMERAUTIL_WARP_H
@@ -0,0 +1,370 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#include "yuv10_kernels.h"
+#include "yuv_kernels.h"
+#include "dispatch.h"
+#include "cpu_features.h"
+#include "parallel.h"
+#include "simd.h"
+#include "frame_arena.h"
+#include <math.h>
+#include <string.h>
+
+using namespace std;
+
+#define MIN_STRIPE_ROWS 16
+
+// 1.0 in the Q3 10 bit intermediate.
+#define Q3_ONE (1023 * 8)
+
+static const int16_t BAYER_4X4[4][4] = {
+        {0, 8, 2, 10},
+        {12, 4, 14, 6},
+        {3, 11, 1, 9},
+        {15, 7, 13, 5},
+};
+
+static inline uint8_t clamp_u8(int32_t n) {
+    return (uint8_t)(n < 0 ? 0 : (n > 255 ? 255 : n));
+}
+
+static inline int32_t clamp_i32(int32_t n, int32_t max) {
+    return n < 0 ? 0 : (n > max ? max : n);
+}
+
+static inline int32_t mulhrs(int32_t a, int32_t b) {
+    return (a * b + (1 << 14)) >> 15;
+}
+
+int yuv10_bytes_per_pixel(int format) {
+    return format == OUTPUT_RGBA_F16 ? 8 : 4;
+}
+
+void yuv10_coefficients(int matrix, int format, int16_t *coefficients) {
+    double kr = 0.299, kb = 0.114;
+    bool limited = false;
+    if (matrix == YUV_MATRIX_BT709_LIMITED) {
+        kr = 0.2126;
+        kb = 0.0722;
+        limited = true;
+    } else if (matrix == YUV_MATRIX_BT2020_LIMITED) {
+        kr = 0.2627;
+        kb = 0.0593;
+        limited = true;
+    }
+    double kg = 1.0 - kr - kb;
+    // Limited range: Y in [64, 940], Cb/Cr in [64, 960].
+    double yScale = limited ? 1023.0 / 876.0 : 1.0;
+    double cScale = limited ? 1023.0 / 896.0 : 1.0;
+    double out = 8192.0 * (format == OUTPUT_RGBA_8888 ? 255.0 / 1023.0 * 2.0 : 1.0);
+
+    coefficients[YUV10_C_Y_OFFSET] = (int16_t)(limited ? 64 : 0);
+    coefficients[YUV10_C_Y] = (int16_t)lround(yScale * out);
+    coefficients[YUV10_C_RV] = (int16_t)lround(2.0 * (1.0 - kr) * cScale * out);
+    coefficients[YUV10_C_GU] = (int16_t)-lround(2.0 * kb * (1.0 - kb) / kg * cScale * out);
+    coefficients[YUV10_C_GV] = (int16_t)-lround(2.0 * kr * (1.0 - kr) / kg * cScale * out);
+    coefficients[YUV10_C_BU] = (int16_t)lround(2.0 * (1.0 - kb) * cScale * out);
+}
+
+/**
+ * rgb holds three rows of width: R, G, B.
+ * */
+template<int shift>
+static inline void yuv10_to_rgb_tail(int col, const uint16_t *y, const uint16_t *u, const uint16_t *v,
+                                     int uvPixelStride, const int16_t *c, int16_t *rgb, int width) {
+    int16_t *r = rgb, *g = rgb + width, *b = rgb + 2 * width;
+    for (; col < width; col++) {
+        int ci = col / 2 * uvPixelStride;
+        int32_t mu = ((u[ci] >> shift) - 512) * 32;
+        int32_t mv = ((v[ci] >> shift) - 512) * 32;
+        int32_t my = ((y[col] >> shift) - c[YUV10_C_Y_OFFSET]) * 32;
+        int32_t yy = mulhrs(my, c[YUV10_C_Y]);
+        r[col] = (int16_t)(yy + mulhrs(mv, c[YUV10_C_RV]));
+        g[col] = (int16_t)(yy + (mulhrs(mu, c[YUV10_C_GU]) + mulhrs(mv, c[YUV10_C_GV])));
+        b[col] = (int16_t)(yy + mulhrs(mu, c[YUV10_C_BU]));
+    }
+}
+
+static void yuv10_to_rgb_c(const uint16_t *y, const uint16_t *u, const uint16_t *v, int uvPixelStride,
+                           int layout, const int16_t *coefficients, int16_t *rgb, int width) {
+    if (layout == YUV10_LAYOUT_MSB) {
+        yuv10_to_rgb_tail<6>(0, y, u, v, uvPixelStride, coefficients, rgb, width);
+    } else {
+        yuv10_to_rgb_tail<0>(0, y, u, v, uvPixelStride, coefficients, rgb, width);
+    }
+}
+
+static inline void rgba8_dither_tail(int col, const int16_t *rgb, int width, int row, uint32_t *dst, int dstStep) {
+    const int16_t *r = rgb, *g = rgb + width, *b = rgb + 2 * width;
+    const int16_t *threshold = BAYER_4X4[row & 3];
+    for (; col < width; col++) {
+        int32_t t = threshold[col & 3];
+        uint8_t r8 = clamp_u8((r[col] + t) >> 4);
+        uint8_t g8 = clamp_u8((g[col] + t) >> 4);
+        uint8_t b8 = clamp_u8((b[col] + t) >> 4);
+        dst[col * dstStep] = (0xFFu << 24) | ((uint32_t)b8 << 16) | ((uint32_t)g8 << 8) | r8;
+    }
+}
+
+static void rgb_to_rgba8_dither_c(const int16_t *rgb, int width, int row, uint32_t *dst, int dstStep) {
+    rgba8_dither_tail(0, rgb, width, row, dst, dstStep);
+}
+
+static inline void rgba1010102_tail(int col, const int16_t *rgb, int width, uint32_t *dst, int dstStep) {
+    const int16_t *r = rgb, *g = rgb + width, *b = rgb + 2 * width;
+    for (; col < width; col++) {
+        uint32_t r10 = (uint32_t)clamp_i32((r[col] + 4) >> 3, 1023);
+        uint32_t g10 = (uint32_t)clamp_i32((g[col] + 4) >> 3, 1023);
+        uint32_t b10 = (uint32_t)clamp_i32((b[col] + 4) >> 3, 1023);
+        dst[col * dstStep] = (3u << 30) | (b10 << 20) | (g10 << 10) | r10;
+    }
+}
+
+static void rgb_to_rgba1010102_c(const int16_t *rgb, int width, uint32_t *dst, int dstStep) {
+    rgba1010102_tail(0, rgb, width, dst, dstStep);
+}
+
+#if SIMD_128
+template<int shift>
+static inline v_s16x8 sample(v_s16x8 a) {
+    if constexpr (shift > 0) {
+        return v_shr_u16<shift>(a);
+    } else {
+        return a;
+    }
+}
+
+/**
+ * 16 pixels per iteration, each chroma result is duplicated for the two pixels sharing it.
+ * */
+template<int shift>
+static void yuv10_to_rgb_simd_impl(const uint16_t *y, const uint16_t *u, const uint16_t *v, int uvPixelStride,
+                                   const int16_t *c, int16_t *rgb, int width) {
+    int16_t *r = rgb, *g = rgb + width, *b = rgb + 2 * width;
+    const v_s16x8 _512 = v_dup_s16(512);
+    const v_s16x8 yOffset = v_dup_s16(c[YUV10_C_Y_OFFSET]);
+    int col = 0;
+    // With interleaved chroma the last block would read one sample past the end of the U plane.
+    int limit = uvPixelStride == 2 ? width - 1 : width;
+    for (; col + 16 <= limit; col += 16) {
+        v_s16x8 u16, v16, unused;
+        if (uvPixelStride == 2) {
+            v_load_deinterleave((const int16_t *)u + col, u16, unused);
+            v_load_deinterleave((const int16_t *)v + col, v16, unused);
+        } else {
+            u16 = v_load_s16x8((const int16_t *)u + col / 2);
+            v16 = v_load_s16x8((const int16_t *)v + col / 2);
+        }
+        v_s16x8 su = v_shl<5>(v_sub(sample<shift>(u16), _512));
+        v_s16x8 sv = v_shl<5>(v_sub(sample<shift>(v16), _512));
+
+        v_s16x8 cr = v_mulhrs_n(sv, c[YUV10_C_RV]);
+        v_s16x8 cg = v_add(v_mulhrs_n(su, c[YUV10_C_GU]), v_mulhrs_n(sv, c[YUV10_C_GV]));
+        v_s16x8 cb = v_mulhrs_n(su, c[YUV10_C_BU]);
+        v_s16x8 cr2[2], cg2[2], cb2[2];
+        v_zip(cr, cr, cr2[0], cr2[1]);
+        v_zip(cg, cg, cg2[0], cg2[1]);
+        v_zip(cb, cb, cb2[0], cb2[1]);
+
+        for (int half = 0; half < 2; half++) {
+            int x = col + half * 8;
+            v_s16x8 sy = v_shl<5>(v_sub(sample<shift>(v_load_s16x8((const int16_t *)y + x)), yOffset));
+            v_s16x8 yy = v_mulhrs_n(sy, c[YUV10_C_Y]);
+            v_store(r + x, v_add(yy, cr2[half]));
+            v_store(g + x, v_add(yy, cg2[half]));
+            v_store(b + x, v_add(yy, cb2[half]));
+        }
+    }
+    yuv10_to_rgb_tail<shift>(col, y, u, v, uvPixelStride, c, rgb, width);
+}
+
+static void yuv10_to_rgb_simd(const uint16_t *y, const uint16_t *u, const uint16_t *v, int uvPixelStride,
+                              int layout, const int16_t *coefficients, int16_t *rgb, int width) {
+    if (layout == YUV10_LAYOUT_MSB) {
+        yuv10_to_rgb_simd_impl<6>(y, u, v, uvPixelStride, coefficients, rgb, width);
+    } else {
+        yuv10_to_rgb_simd_impl<0>(y, u, v, uvPixelStride, coefficients, rgb, width);
+    }
+}
+
+static void rgb_to_rgba8_dither_simd(const int16_t *rgb, int width, int row, uint32_t *dst, int dstStep) {
+    const int16_t *r = rgb, *g = rgb + width, *b = rgb + 2 * width;
+    const int16_t *threshold = BAYER_4X4[row & 3];
+    int16_t pattern[8];
+    for (int i = 0; i < 8; i++) {
+        pattern[i] = threshold[i & 3];
+    }
+    const v_s16x8 t = v_load_s16x8(pattern);
+    const v_u8x8 alpha = v_dup_u8x8(0xFF);
+    uint32_t block[8];
+    int col = 0;
+    for (; col + 8 <= width; col += 8) {
+        v_u8x8 r8 = v_narrow_sat_u8(v_shr<4>(v_add(v_load_s16x8(r + col), t)));
+        v_u8x8 g8 = v_narrow_sat_u8(v_shr<4>(v_add(v_load_s16x8(g + col), t)));
+        v_u8x8 b8 = v_narrow_sat_u8(v_shr<4>(v_add(v_load_s16x8(b + col), t)));
+        uint32_t *out = dstStep == 1 ? dst + col : block;
+        v_store_interleave4((uint8_t *)out, r8, g8, b8, alpha);
+        if (dstStep != 1) {
+            for (int i = 0; i < 8; i++) {
+                dst[(col + i) * dstStep] = block[i];
+            }
+        }
+    }
+    rgba8_dither_tail(col, rgb, width, row, dst, dstStep);
+}
+
+static inline v_s16x8 to_10bit(v_s16x8 a) {
+    const v_s16x8 zero = v_dup_s16(0);
+    const v_s16x8 max = v_dup_s16(1023);
+    return v_min(v_max(v_shr<3>(v_add(a, v_dup_s16(4))), zero), max);
+}
+
+static void rgb_to_rgba1010102_simd(const int16_t *rgb, int width, uint32_t *dst, int dstStep) {
+    const int16_t *r = rgb, *g = rgb + width, *b = rgb + 2 * width;
+    const v_s32x4 alpha = v_dup_s32((int32_t)(3u << 30));
+    int32_t block[8];
+    int col = 0;
+    for (; col + 8 <= width; col += 8) {
+        v_s16x8 r10 = to_10bit(v_load_s16x8(r + col));
+        v_s16x8 g10 = to_10bit(v_load_s16x8(g + col));
+        v_s16x8 b10 = to_10bit(v_load_s16x8(b + col));
+        v_s32x4 lo = v_or(v_or(v_expand_lo(r10), v_shl<10>(v_expand_lo(g10))),
+                          v_or(v_shl<20>(v_expand_lo(b10)), alpha));
+        v_s32x4 hi = v_or(v_or(v_expand_hi(r10), v_shl<10>(v_expand_hi(g10))),
+                          v_or(v_shl<20>(v_expand_hi(b10)), alpha));
+        int32_t *out = dstStep == 1 ? (int32_t *)(dst + col) : block;
+        v_store(out, lo);
+        v_store(out + 4, hi);
+        if (dstStep != 1) {
+            for (int i = 0; i < 8; i++) {
+                dst[(col + i) * dstStep] = (uint32_t)block[i];
+            }
+        }
+    }
+    rgba1010102_tail(col, rgb, width, dst, dstStep);
+}
+#endif
+
+void yuv10_fill_kernels(KernelTable &table, uint32_t features) {
+    table.yuv10ToRgb = yuv10_to_rgb_c;
+    table.rgbToRgba8Dither = rgb_to_rgba8_dither_c;
+    table.rgbToRgba1010102 = rgb_to_rgba1010102_c;
+#if SIMD_128
+    if (features & SIMD_128_FEATURE) {
+        table.yuv10ToRgb = yuv10_to_rgb_simd;
+        table.rgbToRgba8Dither = rgb_to_rgba8_dither_simd;
+        table.rgbToRgba1010102 = rgb_to_rgba1010102_simd;
+    }
+#endif
+}
+
+/**
+ * Round to nearest even, value is finite.
+ * */
+static uint16_t float_to_half(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000;
+    int32_t exponent = (int32_t)((bits >> 23) & 0xFF) - 127 + 15;
+    uint32_t mantissa = bits & 0x7FFFFF;
+    if (exponent >= 31) {
+        return (uint16_t)(sign | 0x7C00);
+    }
+    if (exponent <= 0) {
+        if (exponent < -10) {
+            return (uint16_t)sign;
+        }
+        mantissa |= 0x800000;
+        int shift = 14 - exponent;
+        uint32_t half = mantissa >> shift;
+        uint32_t rest = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (half & 1))) {
+            half++;
+        }
+        return (uint16_t)(sign | half);
+    }
+    uint32_t half = ((uint32_t)exponent << 10) | (mantissa >> 13);
+    uint32_t rest = mantissa & 0x1FFF;
+    // A carry out of the mantissa correctly bumps the exponent.
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) {
+        half++;
+    }
+    return (uint16_t)(sign | half);
+}
+
+/**
+ * Half float of every Q3 value in [0, 1], 16 KB.
+ * */
+struct HalfTable {
+    uint16_t value[Q3_ONE + 1];
+
+    HalfTable() {
+        for (int i = 0; i <= Q3_ONE; i++) {
+            value[i] = float_to_half((float)i / Q3_ONE);
+        }
+    }
+};
+
+static const uint16_t *half_table() {
+    static const HalfTable table;
+    return table.value;
+}
+
+/**
+ * Scalar only: the table lookup is the whole conversion.
+ * */
+static void rgb_to_rgba_f16(const int16_t *rgb, int width, uint64_t *dst, int dstStep) {
+    const int16_t *r = rgb, *g = rgb + width, *b = rgb + 2 * width;
+    const uint16_t *half = half_table();
+    const uint64_t alpha = (uint64_t)float_to_half(1.0f) << 48;
+    for (int col = 0; col < width; col++) {
+        uint64_t r16 = half[clamp_i32(r[col], Q3_ONE)];
+        uint64_t g16 = half[clamp_i32(g[col], Q3_ONE)];
+        uint64_t b16 = half[clamp_i32(b[col], Q3_ONE)];
+        dst[col * dstStep] = alpha | (b16 << 32) | (g16 << 16) | r16;
+    }
+}
+
+void yuv10_to_rgba(const Yuv10Frame &frame, void *dst, int format, int matrix, int rotation, int facing,
+                   const ToneMapParams *toneMap) {
+    if (frame.width <= 0 || frame.height <= 0) {
+        return;
+    }
+    // The tone mapper takes the 10 bit signal and gives back what the packer of format expects.
+    shared_ptr<const ToneMapper> mapper;
+    if (toneMap != nullptr) {
+        mapper = tone_mapper(*toneMap, format == OUTPUT_RGBA_8888 ? 8 : 10);
+    }
+    int16_t coefficients[YUV10_COEFFICIENT_COUNT];
+    yuv10_coefficients(matrix, mapper ? OUTPUT_RGBA_1010102 : format, coefficients);
+    int origin, rowStep, colStep;
+    yuv_output_layout(frame.width, frame.height, rotation, facing, origin, rowStep, colStep);
+    const KernelTable &kt = kernel_table();
+    int width = frame.width;
+    int uvPixelStride = frame.uvPixelStride / (int)sizeof(uint16_t);
+    parallel_for_stripes(frame.height, MIN_STRIPE_ROWS, [&](int rowStart, int rowEnd) {
+        FrameArena scratch;
+        int16_t *rgb = scratch.alloc<int16_t>((size_t)width * 3);
+        for (int row = rowStart; row < rowEnd; row++) {
+            auto y = (const uint16_t *)((const uint8_t *)frame.y + (size_t)row * frame.yRowStride);
+            auto u = (const uint16_t *)((const uint8_t *)frame.u + (size_t)(row / 2) * frame.uvRowStride);
+            auto v = (const uint16_t *)((const uint8_t *)frame.v + (size_t)(row / 2) * frame.uvRowStride);
+            kt.yuv10ToRgb(y, u, v, uvPixelStride, frame.layout, coefficients, rgb, width);
+            if (mapper) {
+                mapper->apply(rgb, width);
+            }
+
+            int index = origin + row * rowStep;
+            if (format == OUTPUT_RGBA_F16) {
+                rgb_to_rgba_f16(rgb, width, (uint64_t *)dst + index, colStep);
+            } else if (format == OUTPUT_RGBA_1010102) {
+                kt.rgbToRgba1010102(rgb, width, (uint32_t *)dst + index, colStep);
+            } else {
+                kt.rgbToRgba8Dither(rgb, width, row, (uint32_t *)dst + index, colStep);
+            }
+        }
+    });
+}
@@ -0,0 +1,71 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#ifndef CAMERAUTIL_YUV10_KERNELS_H
+#define CAMERAUTIL_YUV10_KERNELS_H
+
+#include <stdint.h>
+#include "tone_map.h"
+
+/**
+ * 10位YUV 4:2:0（每个采样占16位）转RGBA，旋转和镜像规则与yuv_kernels相同。
+ * 支持ImageFormat.YCBCR_P010（UV交织，10位数据在高位）和10位planar（I010，数据在低位）。
+ *
+ * 中间结果是int16的RGB行，比输出多3到4位精度，再按输出格式打包：
+ * OUTPUT_RGBA_8888     Bitmap.Config.ARGB_8888，4x4有序抖动，避免10位渐变量化成色带
+ * OUTPUT_RGBA_F16      Bitmap.Config.RGBA_F16，每像素4个half
+ * OUTPUT_RGBA_1010102  Bitmap.Config.RGBA_1010102，R在最低10位，A占最高2位
+ * */
+
+#define YUV10_LAYOUT_MSB 0
+#define YUV10_LAYOUT_LSB 1
+
+#define OUTPUT_RGBA_8888 0
+#define OUTPUT_RGBA_F16 1
+#define OUTPUT_RGBA_1010102 2
+
+#define YUV_MATRIX_BT601_FULL 0
+#define YUV_MATRIX_BT709_LIMITED 1
+#define YUV_MATRIX_BT2020_LIMITED 2
+
+// Index into the coefficients passed to the row kernels.
+#define YUV10_C_Y_OFFSET 0
+#define YUV10_C_Y 1
+#define YUV10_C_RV 2
+#define YUV10_C_GU 3
+#define YUV10_C_GV 4
+#define YUV10_C_BU 5
+#define YUV10_COEFFICIENT_COUNT 6
+
+struct Yuv10Frame {
+    const uint16_t *y = nullptr;
+    const uint16_t *u = nullptr;
+    const uint16_t *v = nullptr;
+    // In bytes, like Image.Plane.getRowStride() and getPixelStride().
+    int yRowStride = 0;
+    int uvRowStride = 0;
+    // 4 for P010, 2 for planar
+    int uvPixelStride = 0;
+    int width = 0;
+    int height = 0;
+    int layout = YUV10_LAYOUT_MSB;
+};
+
+int yuv10_bytes_per_pixel(int format);
+
+/**
+ * Fixed point coefficients of a matrix for an output format: Q13, applied to samples in Q5,
+ * giving Q4 of 8 bit for OUTPUT_RGBA_8888 and Q3 of 10 bit otherwise.
+ * */
+void yuv10_coefficients(int matrix, int format, int16_t *coefficients);
+
+/**
+ * Convert the whole frame into dst, yuv_output_size(width, height, rotation) pixels of
+ * yuv10_bytes_per_pixel(format) bytes, packed.
+ * With toneMap the HDR frame is tone mapped to sRGB in the same pass, see tone_map.h.
+ * */
+void yuv10_to_rgba(const Yuv10Frame &frame, void *dst, int format, int matrix, int rotation, int facing,
+                   const ToneMapParams *toneMap = nullptr);
+
+#endif //CAMERAUTIL_YUV10_KERNELS_H
@@ -0,0 +1,439 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#include "yuv_kernels.h"
+#include "constants.h"
+#include "dispatch.h"
+#include "cpu_features.h"
+#include "parallel.h"
+#include "simd.h"
+#include "lut3d.h"
+#include "frame_arena.h"
+#include <math.h>
+#include <atomic>
+
+#define MIN_STRIPE_ROWS 16
+
+static std::atomic<int> kernelPolicy{YUV_KERNEL_AUTO};
+
+static inline uint8_t clamp_u8(int32_t n) {
+    return (uint8_t)(n < 0 ? 0 : (n > 255 ? 255 : n));
+}
+
+static inline uint32_t pack_color(uint8_t r, uint8_t g, uint8_t b) {
+    return (0xFFu << 24) | ((uint32_t)b << 16) | ((uint32_t)g << 8) | r;
+}
+
+/**
+ * Same arithmetic as yuv2rgb_i32 in converter.cpp.
+ * */
+static inline uint32_t yuv_to_color(uint8_t y, uint8_t u, uint8_t v) {
+    int32_t my = (int32_t)y * 128;
+    int32_t mu = (int32_t)u - 128;
+    int32_t mv = (int32_t)v - 128;
+
+    uint8_t r = clamp_u8((my + 179 * mv) >> 7);
+    uint8_t g = clamp_u8((my - 44 * mu - 91 * mv) >> 7);
+    uint8_t b = clamp_u8((my + 227 * mu) >> 7);
+    return pack_color(r, g, b);
+}
+
+/*
+ * YUV_PRECISION_HIGH: pixels in Q6, coefficients in Q15 applied with a rounding multiply high
+ * (vqrdmulh). Coefficients above 1 are split into 1 + fraction. The largest intermediate is
+ * 16320 + 8128 + 6275, so nothing saturates, and the final shift rounds.
+ * */
+#define PRECISE_SHIFT 6
+// (1.402 - 1) * 32768
+#define PRECISE_R_V 13173
+// 0.344136 * 32768
+#define PRECISE_G_U 11277
+// 0.714136 * 32768
+#define PRECISE_G_V 23401
+// (1.772 - 1) * 32768
+#define PRECISE_B_U 25297
+
+static inline int32_t mulhrs(int32_t a, int32_t b) {
+    return (a * b + (1 << 14)) >> 15;
+}
+
+static inline uint8_t round_precise(int32_t n) {
+    return clamp_u8((n + (1 << (PRECISE_SHIFT - 1))) >> PRECISE_SHIFT);
+}
+
+static inline uint32_t yuv_to_color_precise(uint8_t y, uint8_t u, uint8_t v) {
+    int32_t my = (int32_t)y << PRECISE_SHIFT;
+    int32_t mu = ((int32_t)u - 128) * (1 << PRECISE_SHIFT);
+    int32_t mv = ((int32_t)v - 128) * (1 << PRECISE_SHIFT);
+
+    uint8_t r = round_precise(my + mv + mulhrs(mv, PRECISE_R_V));
+    uint8_t g = round_precise(my - mulhrs(mu, PRECISE_G_U) - mulhrs(mv, PRECISE_G_V));
+    uint8_t b = round_precise(my + mu + mulhrs(mu, PRECISE_B_U));
+    return pack_color(r, g, b);
+}
+
+template<uint32_t (*toColor)(uint8_t, uint8_t, uint8_t)>
+static inline void yuv420_to_rgba_tail(int col, const uint8_t *y, const uint8_t *u, const uint8_t *v,
+                                       int uvPixelStride, uint32_t *dst, int dstStep, int width) {
+    for (; col < width; col++) {
+        int c = col / 2 * uvPixelStride;
+        dst[col * dstStep] = toColor(y[col], u[c], v[c]);
+    }
+}
+
+static void yuv420_to_rgba_c(const uint8_t *y, const uint8_t *u, const uint8_t *v, int uvPixelStride,
+                             uint32_t *dst, int dstStep, int width) {
+    yuv420_to_rgba_tail<yuv_to_color>(0, y, u, v, uvPixelStride, dst, dstStep, width);
+}
+
+static void yuv420_to_rgba_precise_c(const uint8_t *y, const uint8_t *u, const uint8_t *v, int uvPixelStride,
+                                     uint32_t *dst, int dstStep, int width) {
+    yuv420_to_rgba_tail<yuv_to_color_precise>(0, y, u, v, uvPixelStride, dst, dstStep, width);
+}
+
+#if SIMD_128
+/**
+ * 8 chroma samples for 16 pixels, minus 128.
+ * */
+static inline void load_chroma(const uint8_t *u, const uint8_t *v, int col, int uvPixelStride,
+                               v_s16x8 &su, v_s16x8 &sv) {
+    const v_s16x8 _128 = v_dup_s16(128);
+    v_s16x8 u16, v16, unused;
+    if (uvPixelStride == 2) {
+        v_load_deinterleave_expand_s16(u + col, u16, unused);
+        v_load_deinterleave_expand_s16(v + col, v16, unused);
+    } else {
+        u16 = v_load_expand_s16(u + col / 2);
+        v16 = v_load_expand_s16(v + col / 2);
+    }
+    su = v_sub(u16, _128);
+    sv = v_sub(v16, _128);
+}
+
+/**
+ * r/g/b[0] are the even pixels, r/g/b[1] the odd ones.
+ * */
+static inline void store_block(const v_u8x8 *r, const v_u8x8 *g, const v_u8x8 *b,
+                               uint32_t *dst, int col, int dstStep) {
+    const v_u8x8 alpha = v_dup_u8x8(0xFF);
+    // Even and odd pixels back into order.
+    v_u8x8 rz[2], gz[2], bz[2];
+    v_zip(r[0], r[1], rz[0], rz[1]);
+    v_zip(g[0], g[1], gz[0], gz[1]);
+    v_zip(b[0], b[1], bz[0], bz[1]);
+
+    uint32_t block[16];
+    uint8_t *out = dstStep == 1 ? (uint8_t *)(dst + col) : (uint8_t *)block;
+    for (int half = 0; half < 2; half++) {
+        v_store_interleave4(out + half * 32, rz[half], gz[half], bz[half], alpha);
+    }
+    if (dstStep != 1) {
+        for (int i = 0; i < 16; i++) {
+            dst[(col + i) * dstStep] = block[i];
+        }
+    }
+}
+
+/**
+ * 16 pixels per iteration, same int16 arithmetic as convert_YUV_420_888_neon.
+ * */
+static void yuv420_to_rgba_simd(const uint8_t *y, const uint8_t *u, const uint8_t *v, int uvPixelStride,
+                                uint32_t *dst, int dstStep, int width) {
+    int col = 0;
+    // With interleaved chroma the last block would read one byte past the end of the U plane.
+    int limit = uvPixelStride == 2 ? width - 1 : width;
+    for (; col + 16 <= limit; col += 16) {
+        v_s16x8 su, sv;
+        load_chroma(u, v, col, uvPixelStride, su, sv);
+
+        v_s16x8 u2 = v_mul_n(su, 227);
+        v_s16x8 v1 = v_mul_n(sv, 179);
+        v_s16x8 c1 = v_add(v_mul_n(su, 44), v_mul_n(sv, 91));
+
+        v_s16x8 y2[2];
+        v_load_deinterleave_expand_s16(y + col, y2[0], y2[1]);
+        v_u8x8 r[2], g[2], b[2];
+        for (int i = 0; i < 2; i++) {
+            v_s16x8 sy = v_mul_n(y2[i], 128);
+            r[i] = v_narrow_sat_u8(v_shr<7>(v_adds(sy, v1)));
+            g[i] = v_narrow_sat_u8(v_shr<7>(v_subs(sy, c1)));
+            b[i] = v_narrow_sat_u8(v_shr<7>(v_adds(sy, u2)));
+        }
+        store_block(r, g, b, dst, col, dstStep);
+    }
+    yuv420_to_rgba_tail<yuv_to_color>(col, y, u, v, uvPixelStride, dst, dstStep, width);
+}
+
+/**
+ * y << PRECISE_SHIFT is a multiple of the rounding divisor, so
+ * (y << PRECISE_SHIFT) + c rounded down by PRECISE_SHIFT is y + c rounded. The chroma terms are
+ * rounded once per 8 samples, each pixel then only needs an add and a saturating narrow per
+ * channel, fewer instructions than yuv420_to_rgba_simd.
+ * */
+static void yuv420_to_rgba_precise_simd(const uint8_t *y, const uint8_t *u, const uint8_t *v, int uvPixelStride,
+                                        uint32_t *dst, int dstStep, int width) {
+    const v_s16x8 zero = v_dup_s16(0);
+    int col = 0;
+    int limit = uvPixelStride == 2 ? width - 1 : width;
+    for (; col + 16 <= limit; col += 16) {
+        v_s16x8 su, sv;
+        load_chroma(u, v, col, uvPixelStride, su, sv);
+        su = v_shl<PRECISE_SHIFT>(su);
+        sv = v_shl<PRECISE_SHIFT>(sv);
+
+        v_s16x8 cr = v_rshr<PRECISE_SHIFT>(v_add(sv, v_mulhrs_n(sv, PRECISE_R_V)));
+        v_s16x8 cg = v_rshr<PRECISE_SHIFT>(v_sub(v_sub(zero, v_mulhrs_n(su, PRECISE_G_U)),
+                                                 v_mulhrs_n(sv, PRECISE_G_V)));
+        v_s16x8 cb = v_rshr<PRECISE_SHIFT>(v_add(su, v_mulhrs_n(su, PRECISE_B_U)));
+
+        v_s16x8 y2[2];
+        v_load_deinterleave_expand_s16(y + col, y2[0], y2[1]);
+        v_u8x8 r[2], g[2], b[2];
+        for (int i = 0; i < 2; i++) {
+            r[i] = v_narrow_sat_u8(v_add(y2[i], cr));
+            g[i] = v_narrow_sat_u8(v_add(y2[i], cg));
+            b[i] = v_narrow_sat_u8(v_add(y2[i], cb));
+        }
+        store_block(r, g, b, dst, col, dstStep);
+    }
+    yuv420_to_rgba_tail<yuv_to_color_precise>(col, y, u, v, uvPixelStride, dst, dstStep, width);
+}
+#endif
+
+/*
+ * Table driven variants for in-order cores, bit exact with the arithmetic kernels of the same
+ * precision. Every term that depends on a single byte is looked up, e.g.
+ * r = clip[(y[Y] + rv[V]) >> shift], with the rounding folded into y[]. The five tables and
+ * the clip table take 3.5 KB, small enough to stay in L1 next to the rows being converted.
+ * */
+#define CLIP_OFFSET 512
+
+struct YuvLut {
+    int16_t y[256];
+    int16_t rv[256];
+    int16_t gu[256];
+    int16_t gv[256];
+    int16_t bu[256];
+    int shift;
+};
+
+struct ClipTable {
+    uint8_t value[CLIP_OFFSET * 2];
+
+    ClipTable() {
+        for (int i = 0; i < CLIP_OFFSET * 2; i++) {
+            value[i] = clamp_u8(i - CLIP_OFFSET);
+        }
+    }
+};
+
+static YuvLut build_lut(int precision) {
+    YuvLut lut;
+    for (int i = 0; i < 256; i++) {
+        int32_t c = i - 128;
+        if (precision == YUV_PRECISION_HIGH) {
+            int32_t m = c * (1 << PRECISE_SHIFT);
+            lut.y[i] = (int16_t)((i << PRECISE_SHIFT) + (1 << (PRECISE_SHIFT - 1)));
+            lut.rv[i] = (int16_t)(m + mulhrs(m, PRECISE_R_V));
+            lut.gu[i] = (int16_t)-mulhrs(m, PRECISE_G_U);
+            lut.gv[i] = (int16_t)-mulhrs(m, PRECISE_G_V);
+            lut.bu[i] = (int16_t)(m + mulhrs(m, PRECISE_B_U));
+        } else {
+            lut.y[i] = (int16_t)(i * 128);
+            lut.rv[i] = (int16_t)(179 * c);
+            lut.gu[i] = (int16_t)(-44 * c);
+            lut.gv[i] = (int16_t)(-91 * c);
+            lut.bu[i] = (int16_t)(227 * c);
+        }
+    }
+    lut.shift = precision == YUV_PRECISION_HIGH ? PRECISE_SHIFT : 7;
+    return lut;
+}
+
+/**
+ * Built on first use, once per coefficient set.
+ * */
+static const YuvLut &yuv_lut(int precision) {
+    static const YuvLut fastLut = build_lut(YUV_PRECISION_FAST);
+    static const YuvLut preciseLut = build_lut(YUV_PRECISION_HIGH);
+    return precision == YUV_PRECISION_HIGH ? preciseLut : fastLut;
+}
+
+static const uint8_t *clip_table() {
+    static const ClipTable table;
+    return table.value + CLIP_OFFSET;
+}
+
+/**
+ * col must be even. Two pixels per chroma lookup.
+ * */
+template<int precision>
+static inline void yuv420_lut_tail(int col, const uint8_t *y, const uint8_t *u, const uint8_t *v,
+                                   int uvPixelStride, uint32_t *dst, int dstStep, int width) {
+    const YuvLut &lut = yuv_lut(precision);
+    const uint8_t *clip = clip_table();
+    const int shift = lut.shift;
+    for (; col < width; col += 2) {
+        int c = col / 2 * uvPixelStride;
+        int32_t cr = lut.rv[v[c]];
+        int32_t cg = lut.gu[u[c]] + lut.gv[v[c]];
+        int32_t cb = lut.bu[u[c]];
+        int end = col + 2 < width ? col + 2 : width;
+        for (int i = col; i < end; i++) {
+            int32_t my = lut.y[y[i]];
+            dst[i * dstStep] = pack_color(clip[(my + cr) >> shift], clip[(my + cg) >> shift], clip[(my + cb) >> shift]);
+        }
+    }
+}
+
+template<int precision>
+static void yuv420_to_rgba_lut_c(const uint8_t *y, const uint8_t *u, const uint8_t *v, int uvPixelStride,
+                                 uint32_t *dst, int dstStep, int width) {
+    yuv420_lut_tail<precision>(0, y, u, v, uvPixelStride, dst, dstStep, width);
+}
+
+#if SIMD_128
+/**
+ * Chroma terms come from the tables, gathered with scalar loads: NEON TBL can only index
+ * 64 bytes, far less than a 256 entry int16 table. The luma part stays in vectors.
+ * */
+template<int precision>
+static void yuv420_to_rgba_lut_simd(const uint8_t *y, const uint8_t *u, const uint8_t *v, int uvPixelStride,
+                                    uint32_t *dst, int dstStep, int width) {
+    const YuvLut &lut = yuv_lut(precision);
+    int16_t cr[8], cg[8], cb[8];
+    int col = 0;
+    for (; col + 16 <= width; col += 16) {
+        for (int i = 0; i < 8; i++) {
+            int c = (col / 2 + i) * uvPixelStride;
+            cr[i] = lut.rv[v[c]];
+            cg[i] = (int16_t)(lut.gu[u[c]] + lut.gv[v[c]]);
+            cb[i] = lut.bu[u[c]];
+        }
+        v_s16x8 vr = v_load_s16x8(cr);
+        v_s16x8 vg = v_load_s16x8(cg);
+        v_s16x8 vb = v_load_s16x8(cb);
+
+        v_s16x8 y2[2];
+        v_load_deinterleave_expand_s16(y + col, y2[0], y2[1]);
+        v_u8x8 r[2], g[2], b[2];
+        for (int i = 0; i < 2; i++) {
+            if (precision == YUV_PRECISION_HIGH) {
+                v_s16x8 sy = v_shl<PRECISE_SHIFT>(y2[i]);
+                r[i] = v_rshr_narrow_sat_u8<PRECISE_SHIFT>(v_add(sy, vr));
+                g[i] = v_rshr_narrow_sat_u8<PRECISE_SHIFT>(v_add(sy, vg));
+                b[i] = v_rshr_narrow_sat_u8<PRECISE_SHIFT>(v_add(sy, vb));
+            } else {
+                v_s16x8 sy = v_shl<7>(y2[i]);
+                r[i] = v_narrow_sat_u8(v_shr<7>(v_adds(sy, vr)));
+                g[i] = v_narrow_sat_u8(v_shr<7>(v_adds(sy, vg)));
+                b[i] = v_narrow_sat_u8(v_shr<7>(v_adds(sy, vb)));
+            }
+        }
+        store_block(r, g, b, dst, col, dstStep);
+    }
+    yuv420_lut_tail<precision>(col, y, u, v, uvPixelStride, dst, dstStep, width);
+}
+#endif
+
+void yuv_fill_kernels(KernelTable &table, uint32_t features) {
+    table.yuv420ToRgba = yuv420_to_rgba_c;
+    table.yuv420ToRgbaPrecise = yuv420_to_rgba_precise_c;
+    table.yuv420ToRgbaLut = yuv420_to_rgba_lut_c<YUV_PRECISION_FAST>;
+    table.yuv420ToRgbaPreciseLut = yuv420_to_rgba_lut_c<YUV_PRECISION_HIGH>;
+#if SIMD_128
+    if (features & SIMD_128_FEATURE) {
+        table.yuv420ToRgba = yuv420_to_rgba_simd;
+        table.yuv420ToRgbaPrecise = yuv420_to_rgba_precise_simd;
+        table.yuv420ToRgbaLut = yuv420_to_rgba_lut_simd<YUV_PRECISION_FAST>;
+        table.yuv420ToRgbaPreciseLut = yuv420_to_rgba_lut_simd<YUV_PRECISION_HIGH>;
+    }
+#endif
+}
+
+void yuv_set_kernel_policy(int policy) {
+    kernelPolicy.store(policy);
+}
+
+void yuv_output_size(int width, int height, int rotation, int &outWidth, int &outHeight) {
+    if (rotation == ROTATION_0 || rotation == ROTATION_180) {
+        outWidth = height;
+        outHeight = width;
+    } else {
+        outWidth = width;
+        outHeight = height;
+    }
+}
+
+/**
+ * posMat * (row, col, 1) of the i32 converter, flattened to an index.
+ * */
+static int output_index(int width, int height, int rotation, int facing, int row, int col) {
+    if (facing == FACING_FRONT) {
+        col = width - 1 - col;
+    }
+    int bitmapWidth, bitmapHeight;
+    yuv_output_size(width, height, rotation, bitmapWidth, bitmapHeight);
+    if (rotation == ROTATION_0) {
+        return col * bitmapWidth + (bitmapWidth - 1 - row);
+    } else if (rotation == ROTATION_180) {
+        return (bitmapHeight - 1 - col) * bitmapWidth + row;
+    } else if (rotation == ROTATION_90) {
+        return row * bitmapWidth + col;
+    }
+    return (bitmapHeight - 1 - row) * bitmapWidth + (bitmapWidth - 1 - col);
+}
+
+void yuv_output_layout(int width, int height, int rotation, int facing,
+                       int &origin, int &rowStep, int &colStep) {
+    origin = output_index(width, height, rotation, facing, 0, 0);
+    rowStep = output_index(width, height, rotation, facing, 1, 0) - origin;
+    colStep = output_index(width, height, rotation, facing, 0, 1) - origin;
+}
+
+void yuv420_to_rgba(const YuvFrame &frame, uint32_t *dst, int rotation, int facing, int precision,
+                    const Lut3D *grade) {
+    if (frame.width <= 0 || frame.height <= 0) {
+        return;
+    }
+    int origin, rowStep, colStep;
+    yuv_output_layout(frame.width, frame.height, rotation, facing, origin, rowStep, colStep);
+    const KernelTable &kt = kernel_table();
+    auto arithmetic = precision == YUV_PRECISION_HIGH ? kt.yuv420ToRgbaPrecise : kt.yuv420ToRgba;
+    auto lut = precision == YUV_PRECISION_HIGH ? kt.yuv420ToRgbaPreciseLut : kt.yuv420ToRgbaLut;
+    auto kernel = kernelPolicy.load() == YUV_KERNEL_LUT ? lut : arithmetic;
+    parallel_for_stripes(frame.height, MIN_STRIPE_ROWS, [&](int rowStart, int rowEnd) {
+        // Graded rows go through a buffer that stays in cache, dst is still written only once.
+        FrameArena scratch;
+        uint32_t *rgba = grade != nullptr ? scratch.alloc<uint32_t>(frame.width) : nullptr;
+        for (int row = rowStart; row < rowEnd; row++) {
+            uint32_t *out = dst + origin + row * rowStep;
+            kernel(frame.y + row * frame.yRowStride,
+                   frame.u + row / 2 * frame.uvRowStride,
+                   frame.v + row / 2 * frame.uvRowStride,
+                   frame.uvPixelStride,
+                   grade != nullptr ? rgba : out, grade != nullptr ? 1 : colStep, frame.width);
+            if (grade != nullptr) {
+                kt.lut3dApply(rgba, out, colStep, frame.width, grade->getTables());
+            }
+        }
+    });
+}
+
+void yuv420_to_rgba_reference(const YuvFrame &frame, uint32_t *dst, int rotation, int facing) {
+    int origin, rowStep, colStep;
+    yuv_output_layout(frame.width, frame.height, rotation, facing, origin, rowStep, colStep);
+    for (int row = 0; row < frame.height; row++) {
+        for (int col = 0; col < frame.width; col++) {
+            int c = row / 2 * frame.uvRowStride + col / 2 * frame.uvPixelStride;
+            double y = frame.y[row * frame.yRowStride + col];
+            double u = frame.u[c] - 128.0;
+            double v = frame.v[c] - 128.0;
+            uint8_t r = clamp_u8((int32_t)lround(y + 1.402 * v));
+            uint8_t g = clamp_u8((int32_t)lround(y - 0.344136 * u - 0.714136 * v));
+            uint8_t b = clamp_u8((int32_t)lround(y + 1.772 * u));
+            dst[origin + row * rowStep + col * colStep] = pack_color(r, g, b);
+        }
+    }
+}
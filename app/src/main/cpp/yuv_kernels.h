@@ -0,0 +1,74 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#ifndef CAMERAUTIL_YUV_KERNELS_H
+#define CAMERAUTIL_YUV_KERNELS_H
+
+#include <stdint.h>
+
+class Lut3D;
+
+/**
+ * YUV_420_888转RGBA的计算部分，不依赖JNI。converter.cpp负责从Image和Bitmap中取出buffer。
+ * 颜色转换系数与yuv2rgb_i32一致，旋转和镜像规则与getRotationMat、getFacingMat一致。
+ * */
+
+/**
+ * YUV_PRECISION_FAST: 7 bit coefficients in int16, truncating, same result as yuv2rgb_i32.
+ * YUV_PRECISION_HIGH: 15 bit coefficients with rounding, within 1 LSB of the exact BT.601
+ * full range conversion (yuv420_to_rgba_reference), at about the same speed.
+ * */
+#define YUV_PRECISION_FAST 0
+#define YUV_PRECISION_HIGH 1
+
+/**
+ * YUV_KERNEL_AUTO: the arithmetic kernels. The table driven ones were only measured slower on
+ * big cores, they are used when forced with YUV_KERNEL_LUT, e.g. by the _lut benchmark cases.
+ * Both families give bit identical results for the same precision.
+ * */
+#define YUV_KERNEL_AUTO 0
+#define YUV_KERNEL_ARITHMETIC 1
+#define YUV_KERNEL_LUT 2
+
+struct YuvFrame {
+    const uint8_t *y = nullptr;
+    const uint8_t *u = nullptr;
+    const uint8_t *v = nullptr;
+    int yRowStride = 0;
+    int uvRowStride = 0;
+    // 1 for I420, 2 for NV12/NV21
+    int uvPixelStride = 0;
+    int width = 0;
+    int height = 0;
+};
+
+/**
+ * Size of the RGBA output for a rotation, ROTATION_0 and ROTATION_180 swap width and height.
+ * */
+void yuv_output_size(int width, int height, int rotation, int &outWidth, int &outHeight);
+
+/**
+ * Where camera pixel (row, col) goes in the output:
+ * index = origin + row * rowStep + col * colStep.
+ * */
+void yuv_output_layout(int width, int height, int rotation, int facing,
+                       int &origin, int &rowStep, int &colStep);
+
+/**
+ * Convert the whole frame into dst (ARGB_8888 Bitmap memory, R in the lowest byte),
+ * split into stripes across cores. dst is packed, width from yuv_output_size.
+ * With grade every row is colour graded by the 3D LUT before it is written to dst.
+ * */
+void yuv420_to_rgba(const YuvFrame &frame, uint32_t *dst, int rotation, int facing,
+                    int precision = YUV_PRECISION_FAST, const Lut3D *grade = nullptr);
+
+void yuv_set_kernel_policy(int policy);
+
+/**
+ * Single threaded double precision conversion with the exact BT.601 full range matrix,
+ * rounded to nearest. Slow, only for checking the kernels.
+ * */
+void yuv420_to_rgba_reference(const YuvFrame &frame, uint32_t *dst, int rotation, int facing);
+
+#endif //CAMERAUTIL_YUV_KERNELS_H
@@ -0,0 +1,437 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#include "yuv_repack.h"
+#include "dispatch.h"
+#include "cpu_features.h"
+#include "parallel.h"
+#include "simd.h"
+#include "frame_arena.h"
+#include "trace.h"
+#include "log.h"
+#include <string.h>
+#include <algorithm>
+
+using namespace std;
+
+#define TAG "yuv_repack.cpp"
+
+// Every stripe moves at least this much, smaller frames are not worth waking the pool for.
+#define MIN_STRIPE_BYTES (256 << 10)
+
+static void repack_split_uv_c(const uint8_t *uv, uint8_t *u, uint8_t *v, int count) {
+    for (int x = 0; x < count; x++) {
+        u[x] = uv[x * 2];
+        v[x] = uv[x * 2 + 1];
+    }
+}
+
+static void repack_merge_uv_c(const uint8_t *u, const uint8_t *v, uint8_t *uv, int count) {
+    for (int x = 0; x < count; x++) {
+        uv[x * 2] = u[x];
+        uv[x * 2 + 1] = v[x];
+    }
+}
+
+static void repack_swap_uv_c(const uint8_t *src, uint8_t *dst, int count) {
+    for (int x = 0; x < count; x++) {
+        // Both read first, src may be dst.
+        uint8_t a = src[x * 2], b = src[x * 2 + 1];
+        dst[x * 2] = b;
+        dst[x * 2 + 1] = a;
+    }
+}
+
+static void repack_average_c(const uint8_t *a, const uint8_t *b, uint8_t *dst, int count) {
+    for (int x = 0; x < count; x++) {
+        dst[x] = (uint8_t)((a[x] + b[x] + 1) >> 1);
+    }
+}
+
+static void repack_pack422_c(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *dst, int width,
+                             int uyvy) {
+    int yOffset = uyvy ? 1 : 0, cOffset = uyvy ? 0 : 1;
+    for (int x = 0; x < width; x += 2) {
+        uint8_t *d = dst + x * 2;
+        d[yOffset] = y[x];
+        d[cOffset] = u[x / 2];
+        // An odd width repeats the last Y.
+        d[yOffset + 2] = y[x + 1 < width ? x + 1 : x];
+        d[cOffset + 2] = v[x / 2];
+    }
+}
+
+static void repack_unpack422_c(const uint8_t *src, uint8_t *y, uint8_t *u, uint8_t *v, int width, int uyvy) {
+    int yOffset = uyvy ? 1 : 0, cOffset = uyvy ? 0 : 1;
+    for (int x = 0; x < width; x += 2) {
+        const uint8_t *s = src + x * 2;
+        y[x] = s[yOffset];
+        if (x + 1 < width) {
+            y[x + 1] = s[yOffset + 2];
+        }
+        u[x / 2] = s[cOffset];
+        v[x / 2] = s[cOffset + 2];
+    }
+}
+
+#if SIMD_128
+static void repack_split_uv_simd(const uint8_t *uv, uint8_t *u, uint8_t *v, int count) {
+    int x = 0;
+    for (; x + 16 <= count; x += 16) {
+        v_u8x16 a, b;
+        v_load_deinterleave(uv + x * 2, a, b);
+        v_store(u + x, a);
+        v_store(v + x, b);
+    }
+    repack_split_uv_c(uv + x * 2, u + x, v + x, count - x);
+}
+
+static void repack_merge_uv_simd(const uint8_t *u, const uint8_t *v, uint8_t *uv, int count) {
+    int x = 0;
+    for (; x + 16 <= count; x += 16) {
+        v_store_interleave(uv + x * 2, v_load_u8x16(u + x), v_load_u8x16(v + x));
+    }
+    repack_merge_uv_c(u + x, v + x, uv + x * 2, count - x);
+}
+
+static void repack_swap_uv_simd(const uint8_t *src, uint8_t *dst, int count) {
+    int x = 0;
+    for (; x + 16 <= count; x += 16) {
+        v_u8x16 a = v_load_u8x16(src + x * 2), b = v_load_u8x16(src + x * 2 + 16);
+        v_store(dst + x * 2, v_rev16(a));
+        v_store(dst + x * 2 + 16, v_rev16(b));
+    }
+    repack_swap_uv_c(src + x * 2, dst + x * 2, count - x);
+}
+
+static void repack_average_simd(const uint8_t *a, const uint8_t *b, uint8_t *dst, int count) {
+    int x = 0;
+    for (; x + 16 <= count; x += 16) {
+        v_store(dst + x, v_avg(v_load_u8x16(a + x), v_load_u8x16(b + x)));
+    }
+    repack_average_c(a + x, b + x, dst + x, count - x);
+}
+
+/**
+ * 32 pixels a step: even and odd Y, 16 U and 16 V go out as 4 interleaved channels.
+ * */
+static void repack_pack422_simd(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *dst, int width,
+                                int uyvy) {
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        v_u8x16 even, odd;
+        v_load_deinterleave(y + x, even, odd);
+        v_u8x16 cu = v_load_u8x16(u + x / 2), cv = v_load_u8x16(v + x / 2);
+        if (uyvy) {
+            v_store_interleave4(dst + x * 2, cu, even, cv, odd);
+        } else {
+            v_store_interleave4(dst + x * 2, even, cu, odd, cv);
+        }
+    }
+    repack_pack422_c(y + x, u + x / 2, v + x / 2, dst + x * 2, width - x, uyvy);
+}
+
+static void repack_unpack422_simd(const uint8_t *src, uint8_t *y, uint8_t *u, uint8_t *v, int width, int uyvy) {
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        v_u8x16 a, b, c, d;
+        v_load_deinterleave4(src + x * 2, a, b, c, d);
+        if (uyvy) {
+            v_store_interleave(y + x, b, d);
+            v_store(u + x / 2, a);
+            v_store(v + x / 2, c);
+        } else {
+            v_store_interleave(y + x, a, c);
+            v_store(u + x / 2, b);
+            v_store(v + x / 2, d);
+        }
+    }
+    repack_unpack422_c(src + x * 2, y + x, u + x / 2, v + x / 2, width - x, uyvy);
+}
+#endif
+
+void yuv_repack_fill_kernels(KernelTable &table, uint32_t features) {
+    table.repackSplitUv = repack_split_uv_c;
+    table.repackMergeUv = repack_merge_uv_c;
+    table.repackSwapUv = repack_swap_uv_c;
+    table.repackAverage = repack_average_c;
+    table.repackPack422 = repack_pack422_c;
+    table.repackUnpack422 = repack_unpack422_c;
+#if SIMD_128
+    if (features & SIMD_128_FEATURE) {
+        table.repackSplitUv = repack_split_uv_simd;
+        table.repackMergeUv = repack_merge_uv_simd;
+        table.repackSwapUv = repack_swap_uv_simd;
+        table.repackAverage = repack_average_simd;
+        table.repackPack422 = repack_pack422_simd;
+        table.repackUnpack422 = repack_unpack422_simd;
+    }
+#endif
+}
+
+static inline bool is_packed(int layout) {
+    return layout == YUV_LAYOUT_YUYV || layout == YUV_LAYOUT_UYVY;
+}
+
+static inline int plane_count(int layout) {
+    return layout == YUV_LAYOUT_I420 ? 3 : (is_packed(layout) ? 1 : 2);
+}
+
+/**
+ * Bytes of one row of a plane, without padding. -1 if the layout is unknown.
+ * */
+static int row_bytes(int layout, int plane, int width) {
+    int chromaWidth = (width + 1) / 2;
+    switch (layout) {
+        case YUV_LAYOUT_I420:
+            return plane == 0 ? width : chromaWidth;
+        case YUV_LAYOUT_NV12:
+        case YUV_LAYOUT_NV21:
+            return plane == 0 ? width : chromaWidth * 2;
+        case YUV_LAYOUT_YUYV:
+        case YUV_LAYOUT_UYVY:
+            return chromaWidth * 4;
+        default:
+            return -1;
+    }
+}
+
+static inline int plane_rows(int plane, int height) {
+    return plane == 0 ? height : (height + 1) / 2;
+}
+
+static bool check_image(const YuvImage &image, const char *name) {
+    if (image.width <= 0 || image.height <= 0 || row_bytes(image.layout, 0, image.width) < 0) {
+        LOGE(TAG, "%s: can not repack layout %d of %dx%d", name, image.layout, image.width, image.height);
+        return false;
+    }
+    for (int i = 0; i < plane_count(image.layout); i++) {
+        if (image.planes[i] == nullptr || image.strides[i] < row_bytes(image.layout, i, image.width)) {
+            LOGE(TAG, "%s: plane %d of layout %d is missing or its stride %d is too small", name, i, image.layout,
+                 image.strides[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Bytes of the two luma rows and the chroma row of a row pair.
+ * */
+static int pair_bytes(int layout, int width) {
+    int bytes = 0;
+    for (int i = 0; i < plane_count(layout); i++) {
+        bytes += row_bytes(layout, i, width) * (i == 0 ? 2 : 1);
+    }
+    return bytes;
+}
+
+static inline uint8_t *row(const YuvImage &image, int plane, int y) {
+    return image.planes[plane] + (size_t)y * image.strides[plane];
+}
+
+static inline void copy_row(const uint8_t *src, uint8_t *dst, int bytes) {
+    // In place repacking leaves rows of the same layout where they are.
+    if (src != dst) {
+        memcpy(dst, src, bytes);
+    }
+}
+
+/**
+ * U and V of 4:2:0 chroma row p as two planar rows, split into scratch for NV12 / NV21.
+ * */
+static void planar_chroma(const KernelTable &kt, const YuvImage &image, int p, int chromaWidth, uint8_t *scratchU,
+                          uint8_t *scratchV, const uint8_t *&u, const uint8_t *&v) {
+    if (image.layout == YUV_LAYOUT_I420) {
+        u = row(image, 1, p);
+        v = row(image, 2, p);
+        return;
+    }
+    u = scratchU;
+    v = scratchV;
+    if (image.layout == YUV_LAYOUT_NV12) {
+        kt.repackSplitUv(row(image, 1, p), scratchU, scratchV, chromaWidth);
+    } else {
+        kt.repackSplitUv(row(image, 1, p), scratchV, scratchU, chromaWidth);
+    }
+}
+
+/**
+ * Write planar U and V into 4:2:0 chroma row p, which for I420 they may already be.
+ * */
+static void store_chroma(const KernelTable &kt, const YuvImage &image, int p, int chromaWidth, const uint8_t *u,
+                         const uint8_t *v) {
+    if (image.layout == YUV_LAYOUT_I420) {
+        copy_row(u, row(image, 1, p), chromaWidth);
+        copy_row(v, row(image, 2, p), chromaWidth);
+    } else if (image.layout == YUV_LAYOUT_NV12) {
+        kt.repackMergeUv(u, v, row(image, 1, p), chromaWidth);
+    } else {
+        kt.repackMergeUv(v, u, row(image, 1, p), chromaWidth);
+    }
+}
+
+/**
+ * 4:2:0 to 4:2:0, luma rows are copied and one chroma row is copied, split, merged or swapped.
+ * */
+static void repack_420_to_420(const KernelTable &kt, const YuvImage &src, const YuvImage &dst, int p,
+                              int chromaWidth) {
+    int width = src.width;
+    for (int y = p * 2; y < std::min(p * 2 + 2, src.height); y++) {
+        copy_row(row(src, 0, y), row(dst, 0, y), width);
+    }
+    if (src.layout == dst.layout) {
+        for (int i = 1; i < plane_count(src.layout); i++) {
+            copy_row(row(src, i, p), row(dst, i, p), row_bytes(src.layout, i, width));
+        }
+    } else if (src.layout != YUV_LAYOUT_I420 && dst.layout != YUV_LAYOUT_I420) {
+        kt.repackSwapUv(row(src, 1, p), row(dst, 1, p), chromaWidth);
+    } else if (dst.layout == YUV_LAYOUT_I420) {
+        if (src.layout == YUV_LAYOUT_NV12) {
+            kt.repackSplitUv(row(src, 1, p), row(dst, 1, p), row(dst, 2, p), chromaWidth);
+        } else {
+            kt.repackSplitUv(row(src, 1, p), row(dst, 2, p), row(dst, 1, p), chromaWidth);
+        }
+    } else {
+        store_chroma(kt, dst, p, chromaWidth, row(src, 1, p), row(src, 2, p));
+    }
+}
+
+/**
+ * 4:2:0 to 4:2:2, both luma rows of the pair share chroma row p.
+ * */
+static void repack_420_to_422(const KernelTable &kt, const YuvImage &src, const YuvImage &dst, int p,
+                              int chromaWidth, uint8_t *scratchU, uint8_t *scratchV) {
+    const uint8_t *u, *v;
+    planar_chroma(kt, src, p, chromaWidth, scratchU, scratchV, u, v);
+    int uyvy = dst.layout == YUV_LAYOUT_UYVY;
+    for (int y = p * 2; y < std::min(p * 2 + 2, src.height); y++) {
+        kt.repackPack422(row(src, 0, y), u, v, row(dst, 0, y), src.width, uyvy);
+    }
+}
+
+/**
+ * 4:2:2 to 4:2:0, the chroma of the two rows of the pair is averaged into chroma row p.
+ * scratch holds 6 rows of chromaWidth.
+ * */
+static void repack_422_to_420(const KernelTable &kt, const YuvImage &src, const YuvImage &dst, int p,
+                              int chromaWidth, uint8_t *scratch) {
+    int uyvy = src.layout == YUV_LAYOUT_UYVY;
+    uint8_t *u = dst.layout == YUV_LAYOUT_I420 ? row(dst, 1, p) : scratch;
+    uint8_t *v = dst.layout == YUV_LAYOUT_I420 ? row(dst, 2, p) : scratch + chromaWidth;
+    int y = p * 2;
+    if (y + 1 < src.height) {
+        uint8_t *u0 = scratch + chromaWidth * 2, *v0 = u0 + chromaWidth;
+        uint8_t *u1 = v0 + chromaWidth, *v1 = u1 + chromaWidth;
+        kt.repackUnpack422(row(src, 0, y), row(dst, 0, y), u0, v0, src.width, uyvy);
+        kt.repackUnpack422(row(src, 0, y + 1), row(dst, 0, y + 1), u1, v1, src.width, uyvy);
+        kt.repackAverage(u0, u1, u, chromaWidth);
+        kt.repackAverage(v0, v1, v, chromaWidth);
+    } else {
+        kt.repackUnpack422(row(src, 0, y), row(dst, 0, y), u, v, src.width, uyvy);
+    }
+    if (dst.layout != YUV_LAYOUT_I420) {
+        store_chroma(kt, dst, p, chromaWidth, u, v);
+    }
+}
+
+size_t yuv_image_wrap(int layout, int width, int height, uint8_t *data, YuvImage &image) {
+    image = YuvImage();
+    if (width <= 0 || height <= 0 || row_bytes(layout, 0, width) < 0) {
+        return 0;
+    }
+    image.layout = layout;
+    image.width = width;
+    image.height = height;
+    size_t size = 0;
+    for (int i = 0; i < plane_count(layout); i++) {
+        image.planes[i] = data == nullptr ? nullptr : data + size;
+        image.strides[i] = row_bytes(layout, i, width);
+        size += (size_t)image.strides[i] * plane_rows(i, height);
+    }
+    return size;
+}
+
+bool yuv_image_from_frame(const YuvFrame &frame, YuvImage &image) {
+    image = YuvImage();
+    image.width = frame.width;
+    image.height = frame.height;
+    image.planes[0] = (uint8_t *)frame.y;
+    image.strides[0] = frame.yRowStride;
+    if (frame.uvPixelStride == 1) {
+        image.layout = YUV_LAYOUT_I420;
+        image.planes[1] = (uint8_t *)frame.u;
+        image.planes[2] = (uint8_t *)frame.v;
+        image.strides[1] = image.strides[2] = frame.uvRowStride;
+    } else if (frame.uvPixelStride == 2 && frame.v == frame.u + 1) {
+        image.layout = YUV_LAYOUT_NV12;
+        image.planes[1] = (uint8_t *)frame.u;
+        image.strides[1] = frame.uvRowStride;
+    } else if (frame.uvPixelStride == 2 && frame.u == frame.v + 1) {
+        image.layout = YUV_LAYOUT_NV21;
+        image.planes[1] = (uint8_t *)frame.v;
+        image.strides[1] = frame.uvRowStride;
+    } else {
+        LOGE(TAG, "chroma with pixel stride %d is not I420, NV12 or NV21", frame.uvPixelStride);
+        return false;
+    }
+    return true;
+}
+
+bool yuv_repack(const YuvImage &src, const YuvImage &dst) {
+    TRACE_SCOPE("yuv repack");
+    if (!check_image(src, "src") || !check_image(dst, "dst")) {
+        return false;
+    }
+    if (src.width != dst.width || src.height != dst.height) {
+        LOGE(TAG, "src is %dx%d, dst is %dx%d", src.width, src.height, dst.width, dst.height);
+        return false;
+    }
+    const KernelTable &kt = kernel_table();
+    int chromaWidth = (src.width + 1) / 2;
+    bool packedSrc = is_packed(src.layout), packedDst = is_packed(dst.layout);
+    // Stripes are of row pairs, the luma rows that share a 4:2:0 chroma row.
+    int pairs = (src.height + 1) / 2;
+    int pairBytes = pair_bytes(src.layout, src.width) + pair_bytes(dst.layout, src.width);
+    parallel_for_stripes(pairs, std::max(1, MIN_STRIPE_BYTES / pairBytes), [&](int pairStart, int pairEnd) {
+        FrameArena scratch;
+        uint8_t *chroma = scratch.alloc<uint8_t>((size_t)chromaWidth * 6);
+        for (int p = pairStart; p < pairEnd; p++) {
+            if (packedSrc && packedDst) {
+                for (int y = p * 2; y < std::min(p * 2 + 2, src.height); y++) {
+                    if (src.layout == dst.layout) {
+                        copy_row(row(src, 0, y), row(dst, 0, y), chromaWidth * 4);
+                    } else {
+                        // YUYV <-> UYVY is a swap of every byte pair.
+                        kt.repackSwapUv(row(src, 0, y), row(dst, 0, y), chromaWidth * 2);
+                    }
+                }
+            } else if (packedSrc) {
+                repack_422_to_420(kt, src, dst, p, chromaWidth, chroma);
+            } else if (packedDst) {
+                repack_420_to_422(kt, src, dst, p, chromaWidth, chroma, chroma + chromaWidth);
+            } else {
+                repack_420_to_420(kt, src, dst, p, chromaWidth);
+            }
+        }
+    });
+    return true;
+}
+
+void yuv_copy_plane(const uint8_t *src, int srcStride, uint8_t *dst, int dstStride, int rowBytes, int rows) {
+    if (rowBytes <= 0 || rows <= 0) {
+        return;
+    }
+    bool packed = srcStride == rowBytes && dstStride == rowBytes;
+    parallel_for_stripes(rows, std::max(1, MIN_STRIPE_BYTES / rowBytes), [&](int rowStart, int rowEnd) {
+        if (packed) {
+            memcpy(dst + (size_t)rowStart * rowBytes, src + (size_t)rowStart * rowBytes,
+                   (size_t)(rowEnd - rowStart) * rowBytes);
+            return;
+        }
+        for (int y = rowStart; y < rowEnd; y++) {
+            memcpy(dst + (size_t)y * dstStride, src + (size_t)y * srcStride, rowBytes);
+        }
+    });
+}
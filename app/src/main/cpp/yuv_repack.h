@@ -0,0 +1,71 @@
+//
+// Created by zu on 2026/10/19.
+//
+
+#ifndef CAMERAUTIL_YUV_REPACK_H
+#define CAMERAUTIL_YUV_REPACK_H
+
+#include "yuv_kernels.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * YUV各种内存排列之间的直接转换，不经过RGB：编码器、模型和文件格式要求的排列各不相同。
+ *
+ * 4:2:0：I420（Y、U、V三个平面）、NV12（Y + UVUV...）、NV21（Y + VUVU...）；
+ * 4:2:2打包：YUYV（YUY2）、UYVY，每两个像素4字节。
+ * 4:2:0转4:2:2时每行色度重复给上下两行，4:2:2转4:2:0时上下两行的色度取平均（向上舍入），
+ * 与libyuv的做法相同。宽高可以是奇数：色度平面是(width + 1) / 2 x (height + 1) / 2，
+ * 打包格式最后一个像素对的第二个Y重复第一个。
+ *
+ * 源和目标的每个平面都可以有任意的行跨度（不小于一行的字节数），多余的填充不会被读写。
+ * 只有排列相同的平面直接按行memcpy，其余的是逐行SIMD kernel：拆分/合并交错色度、交换U/V、
+ * 打包/解包YUYV、UYVY，都只读写每个字节一次。大帧按行分成stripe在多个核上处理，
+ * 小帧不值得唤醒线程池，在调用线程完成。
+ * */
+
+#define YUV_LAYOUT_I420 0
+#define YUV_LAYOUT_NV12 1
+#define YUV_LAYOUT_NV21 2
+#define YUV_LAYOUT_YUYV 3
+#define YUV_LAYOUT_UYVY 4
+
+/**
+ * One image in a repack layout, strides in bytes.
+ * I420: planes Y, U, V. NV12 / NV21: planes Y and interleaved chroma.
+ * YUYV / UYVY: one plane of (width + 1) / 2 * 4 bytes a row.
+ * */
+struct YuvImage {
+    int layout = YUV_LAYOUT_I420;
+    int width = 0;
+    int height = 0;
+    uint8_t *planes[3] = {};
+    int strides[3] = {};
+};
+
+/**
+ * Lay out a tightly packed image of the layout in data, no padding between rows or planes.
+ * Return the bytes it needs; data may be nullptr to only get the size. 0 if the layout is unknown.
+ * */
+size_t yuv_image_wrap(int layout, int width, int height, uint8_t *data, YuvImage &image);
+
+/**
+ * The layout of a YUV_420_888 frame as an image: pixel stride 1 is I420, pixel stride 2 is NV12
+ * or NV21 depending on which of u and v comes first. Return false for other chroma layouts.
+ * */
+bool yuv_image_from_frame(const YuvFrame &frame, YuvImage &image);
+
+/**
+ * Write src into dst in dst's layout. Both must be the same size. src is only read.
+ * NV12 <-> NV21 and YUYV <-> UYVY may run in place (the same planes and strides), planes that
+ * partly overlap are not allowed. Return false if a layout is unknown or a stride is too small.
+ * */
+bool yuv_repack(const YuvImage &src, const YuvImage &dst);
+
+/**
+ * Copy rows of rowBytes between planes of different strides, e.g. to drop the padding of a camera
+ * buffer. One memcpy when both are tightly packed.
+ * */
+void yuv_copy_plane(const uint8_t *src, int srcStride, uint8_t *dst, int dstStride, int rowBytes, int rows);
+
+#endif //CAMERAUTIL_YUV_REPACK_H
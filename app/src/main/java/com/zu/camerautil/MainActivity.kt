@@ -6,6 +6,7 @@ import androidx.appcompat.app.AppCompatActivity
 import android.os.Bundle
 import android.util.Log
 import com.zu.camerautil.databinding.ActivityMainBinding
+import com.zu.camerautil.util.NativeBenchmark
 import com.zu.camerautil.util.NeonTest
 
 class MainActivity : AppCompatActivity() {
@@ -74,6 +75,12 @@ class MainActivity : AppCompatActivity() {
             NeonTest.doNeonTest()
         }
 
+        binding.btnNativeBenchmark.setOnClickListener {
+            Thread {
+                NativeBenchmark.runBenchmark("")
+            }.start()
+        }
+
         binding.btnSetting.setOnClickListener {
             startActivity(SettingActivity::class.java)
         }
@@ -1,13 +1,9 @@
 package com.zu.camerautil.recorder
 
 import android.annotation.SuppressLint
-import android.content.res.AssetFileDescriptor
 import android.media.MediaCodec
 import android.media.MediaFormat
-import android.media.MediaMuxer
-import android.os.Build
 import android.view.Surface
-import com.zu.camerautil.MyApplication
 import com.zu.camerautil.camera.computeRotation
 import com.zu.camerautil.recorder.encoder.AudioEncoder
 import com.zu.camerautil.recorder.encoder.EncoderCallback
@@ -28,16 +24,17 @@ class CodecRecorder: IRecorder {
         get() {
             val videoReady = videoEncoder.state == EncoderState.PREPARED || videoEncoder.state == EncoderState.STARTED
             val audioReady = audioEncoder.state == EncoderState.PREPARED || audioEncoder.state == EncoderState.STARTED
-            return videoReady && audioReady && muxer != null
+            return videoReady && audioReady && muxer.isOpen
         }
 
     override val isRecording: Boolean
-        get() = videoEncoder.state == EncoderState.STARTED && audioEncoder.state == EncoderState.STARTED && muxer != null
+        get() = videoEncoder.state == EncoderState.STARTED && audioEncoder.state == EncoderState.STARTED && muxer.isOpen
 
     private var videoEncoder = VideoEncoder()
     private var audioEncoder = AudioEncoder()
     private var audioInput = AudioInput()
-    private var muxer: MediaMuxer? = null
+    private var nativeAudioInput = NativeAudioInput()
+    private val muxer = NativeMp4Muxer()
     private var audioTrack = -1
     private var videoTrack = -1
     private val canMux: Boolean
@@ -45,53 +42,32 @@ class CodecRecorder: IRecorder {
 
     private val isMuxRunning = AtomicBoolean(false)
 
-    private var assetFileDescriptor: AssetFileDescriptor? = null
-
     private var videoStartPts = -1L
     private var audioStartPts = -1L
 
     private var videoFormatChangeCount = 0
     private var audioFormatChangeCount = 0
-    private var lastVideoPts = -1L
     private val videoCallback = object : EncoderCallback() {
         override fun onOutputFormatChanged(format: MediaFormat) {
             Timber.d("video onOutputFormatChanged, count: $videoFormatChangeCount")
             videoFormatChangeCount++
-            lastVideoPts = -1L
-            if (muxer != null && videoTrack < 0) {
-                videoTrack = muxer!!.addTrack(format)
+            if (muxer.isOpen && videoTrack < 0) {
+                videoTrack = muxer.addTrack(format)
                 if (canMux) {
                     startMux()
                 }
             }
         }
 
+        // Called for every frame on the encoder thread, keep it free of logging.
         override fun onOutputBufferAvailable(buffer: ByteBuffer, info: MediaCodec.BufferInfo) {
-            //Timber.d("video onBufferAvailable")
+            // The parameter sets already came with the output format.
             if (info.flags and MediaCodec.BUFFER_FLAG_CODEC_CONFIG != 0) {
-                Timber.w("video buffer: codec config")
                 return
             }
-            if (info.flags and MediaCodec.BUFFER_FLAG_KEY_FRAME != 0) {
-                Timber.d("video buffer: key frame")
-            }
-            if (info.flags and MediaCodec.BUFFER_FLAG_PARTIAL_FRAME != 0) {
-                Timber.d("video buffer: partial frame")
-            }
-            if (info.flags and MediaCodec.BUFFER_FLAG_END_OF_STREAM != 0) {
-                Timber.w("video buffer: end of stream")
-            }
-            if (lastVideoPts != -1L) {
-                val cost = (info.presentationTimeUs - lastVideoPts) / 1000
-                Timber.d("frame interval = $cost ms")
-            }
-            lastVideoPts = info.presentationTimeUs
-            if (muxer != null && isMuxRunning.get() && info.size > 0) {
+            if (isMuxRunning.get() && info.size > 0) {
                 handleVideoPts(info)
-                Timber.d("video pts: ${info.presentationTimeUs / 1000}ms")
-                muxer!!.writeSampleData(videoTrack, buffer, info)
-            } else {
-                Timber.w("don't write video frame")
+                muxer.writeSampleData(videoTrack, buffer, info)
             }
         }
     }
@@ -99,8 +75,9 @@ class CodecRecorder: IRecorder {
     private val audioCallback = object : EncoderCallback() {
         override fun onOutputFormatChanged(format: MediaFormat) {
             Timber.d("audio onOutputFormatChanged, count: $audioFormatChangeCount")
-            if (muxer != null && audioTrack < 0) {
-                audioTrack = muxer!!.addTrack(format)
+            audioFormatChangeCount++
+            if (muxer.isOpen && audioTrack < 0) {
+                audioTrack = muxer.addTrack(format)
                 if (canMux) {
                     startMux()
                 }
@@ -108,25 +85,12 @@ class CodecRecorder: IRecorder {
         }
 
         override fun onOutputBufferAvailable(buffer: ByteBuffer, info: MediaCodec.BufferInfo) {
-            //Timber.d("audio onBufferAvailable")
             if (info.flags and MediaCodec.BUFFER_FLAG_CODEC_CONFIG != 0) {
-                Timber.w("audio buffer: codec config")
                 return
             }
-            if (info.flags and MediaCodec.BUFFER_FLAG_KEY_FRAME != 0) {
-                Timber.d("audio buffer: key frame")
-            }
-            if (info.flags and MediaCodec.BUFFER_FLAG_PARTIAL_FRAME != 0) {
-                Timber.d("audio buffer: partial frame")
-            }
-            if (info.flags and MediaCodec.BUFFER_FLAG_END_OF_STREAM != 0) {
-                Timber.w("audio buffer: end of stream")
-            }
-
-            if (muxer != null && isMuxRunning.get() && info.size > 0) {
+            if (isMuxRunning.get() && info.size > 0) {
                 handleAudioPts(info)
-                //Timber.d("audio pts: ${info.presentationTimeUs / 1000}ms")
-                muxer!!.writeSampleData(audioTrack, buffer, info)
+                muxer.writeSampleData(audioTrack, buffer, info)
             }
         }
     }
@@ -144,7 +108,7 @@ class CodecRecorder: IRecorder {
 
 
     override fun prepare(params: RecorderParams): Boolean {
-        if (muxer != null) {
+        if (muxer.isOpen) {
             return false
         }
         if (!videoEncoder.prepare(params)) {
@@ -154,23 +118,23 @@ class CodecRecorder: IRecorder {
             return false
         }
 
-        if (!audioInput.prepare(params)) {
-            return false
+        // OpenSL ES capture drained by the encoder thread, AudioRecord if it is not available.
+        if (nativeAudioInput.prepare(params)) {
+            audioEncoder.pcmInput = nativeAudioInput
+        } else {
+            audioEncoder.pcmInput = null
+            if (!audioInput.prepare(params)) {
+                return false
+            }
+            audioInput.dataCallback = audioDataCallback
         }
-        audioInput.dataCallback = audioDataCallback
 
-        if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.O && params.outputUri != null) {
-            assetFileDescriptor = MyApplication.context.contentResolver.openAssetFileDescriptor(params.outputUri!!, "rw") ?: return false
-            val fileDescriptor = assetFileDescriptor?.fileDescriptor ?: return false
-            muxer = MediaMuxer(fileDescriptor, MediaMuxer.OutputFormat.MUXER_OUTPUT_MPEG_4)
-        } else if (params.outputPath != null){
-            muxer = MediaMuxer(params.outputPath!!, MediaMuxer.OutputFormat.MUXER_OUTPUT_MPEG_4)
-        } else {
+        if (!muxer.open(params)) {
             return false
         }
 
         val orientation = computeRotation(params.sensorOrientation, params.viewOrientation, params.facing)
-        muxer?.setOrientationHint(orientation)
+        muxer.setOrientationHint(orientation)
         isMuxRunning.set(false)
 
         audioTrack = -1
@@ -193,44 +157,45 @@ class CodecRecorder: IRecorder {
         }
         videoEncoder.start()
         audioEncoder.start()
-        audioInput.start()
+        if (audioEncoder.pcmInput != null) {
+            nativeAudioInput.start()
+        } else {
+            audioInput.start()
+        }
         return true
     }
 
     override fun stop() {
         audioInput.stop()
+        nativeAudioInput.stop()
         audioEncoder.stop()
+        nativeAudioInput.release()
         videoEncoder.stop()
 
         isMuxRunning.set(false)
-        muxer?.stop()
-        muxer?.release()
-        muxer = null
+        muxer.release()
         audioTrack = -1
         videoTrack = -1
-        closeFileDescriptor()
     }
 
     override fun release() {
         audioInput.release()
         audioEncoder.release()
+        // After the encoder, whose thread reads from it.
+        nativeAudioInput.release()
         videoEncoder.release()
 
         isMuxRunning.set(false)
-        muxer?.stop()
-        muxer?.release()
-        muxer = null
+        muxer.release()
         audioTrack = -1
         videoTrack = -1
     }
 
     private fun startMux() {
-        muxer?.start()
-        isMuxRunning.set(true)
-    }
-
-    private fun closeFileDescriptor() {
-        assetFileDescriptor?.close()
+        // Both encoder threads may get here, only the first start succeeds.
+        if (muxer.start()) {
+            isMuxRunning.set(true)
+        }
     }
 
     private fun handleAudioPts(info: MediaCodec.BufferInfo) {
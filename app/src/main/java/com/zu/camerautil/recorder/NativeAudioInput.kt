@@ -0,0 +1,104 @@
+package com.zu.camerautil.recorder
+
+import android.Manifest
+import android.content.Context
+import android.media.AudioFormat
+import android.media.AudioManager
+import androidx.annotation.RequiresPermission
+import com.zu.camerautil.MyApplication
+import java.nio.ByteBuffer
+
+/**
+ * @author zuguorui
+ * @date 2026/10/19
+ * @description 原生麦克风采集（OpenSL ES）。采集回调把PCM写进原生的无锁环形缓冲区，
+ * 编码线程用[read]把数据直接拷贝进编码器的输入buffer，没有Java层的中间数组和采集线程。
+ * 麦克风按设备原生采样率采集，原生层重采样并混合成编码器要的采样率和双声道。
+ */
+class NativeAudioInput {
+
+    init {
+        System.loadLibrary("native-lib")
+    }
+
+    private var handle = 0L
+
+    private var sampleRate = 0
+
+    val isReady: Boolean
+        get() = handle != 0L
+
+    /**
+     * Presentation time of the next byte [read] returns, counted from start.
+     */
+    val presentationTimeUs: Long
+        get() = if (handle == 0L) 0L else nGetFramesRead(handle) * 1000_000L / sampleRate
+
+    @RequiresPermission(Manifest.permission.RECORD_AUDIO)
+    @Synchronized
+    fun prepare(params: RecorderParams): Boolean {
+        if (handle != 0L) {
+            return false
+        }
+        val channels = if (params.channelConfig == AudioFormat.CHANNEL_IN_MONO) 1 else 2
+        val audioManager = MyApplication.context.getSystemService(Context.AUDIO_SERVICE) as AudioManager
+        val nativeRate = audioManager.getProperty(AudioManager.PROPERTY_OUTPUT_SAMPLE_RATE)?.toIntOrNull()
+            ?: params.sampleRate
+        // AudioEncoder always encodes stereo.
+        handle = nCreate(nativeRate, channels, params.sampleRate, ENCODER_CHANNELS)
+        sampleRate = params.sampleRate
+        return handle != 0L
+    }
+
+    @Synchronized
+    fun start(): Boolean {
+        return handle != 0L && nStart(handle)
+    }
+
+    @Synchronized
+    fun stop() {
+        if (handle != 0L) {
+            nStop(handle)
+        }
+    }
+
+    @Synchronized
+    fun release() {
+        if (handle != 0L) {
+            nRelease(handle)
+            handle = 0L
+        }
+    }
+
+    /**
+     * Copy whole PCM frames into the direct [buffer], from its position up to its limit, and move
+     * the position past them. Wait at most [timeoutMs] for data. Return the bytes copied,
+     * 0 if there was no data in time.
+     */
+    fun read(buffer: ByteBuffer, timeoutMs: Int): Int {
+        if (handle == 0L) {
+            return 0
+        }
+        val size = nRead(handle, buffer, buffer.position(), buffer.remaining(), timeoutMs)
+        if (size > 0) {
+            buffer.position(buffer.position() + size)
+        }
+        return size
+    }
+
+    private external fun nCreate(captureRate: Int, captureChannels: Int, outputRate: Int, outputChannels: Int): Long
+
+    private external fun nStart(handle: Long): Boolean
+
+    private external fun nStop(handle: Long)
+
+    private external fun nRelease(handle: Long)
+
+    private external fun nRead(handle: Long, buffer: ByteBuffer, offset: Int, size: Int, timeoutMs: Int): Int
+
+    private external fun nGetFramesRead(handle: Long): Long
+
+    companion object {
+        private const val ENCODER_CHANNELS = 2
+    }
+}
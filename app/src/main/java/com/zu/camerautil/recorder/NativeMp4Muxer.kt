@@ -0,0 +1,141 @@
+package com.zu.camerautil.recorder
+
+import android.media.MediaCodec
+import android.media.MediaFormat
+import android.os.ParcelFileDescriptor
+import com.zu.camerautil.MyApplication
+import java.io.File
+import java.nio.ByteBuffer
+
+/**
+ * @author zuguorui
+ * @date 2026/10/19
+ * @description 原生分片MP4封装，接口和MediaMuxer对应。样本只在编码器线程上拷贝进原生缓冲区，
+ * 写文件在原生的I/O线程上；每个分片（约1秒）写完后文件都可以播放，录制中途崩溃不会丢失整个文件。
+ */
+class NativeMp4Muxer {
+
+    init {
+        System.loadLibrary("native-lib")
+    }
+
+    @Volatile
+    private var handle = 0L
+
+    val isOpen: Boolean
+        get() = handle != 0L
+
+    /**
+     * Open [RecorderParams.outputUri], or [RecorderParams.outputPath] if there is no uri.
+     */
+    @Synchronized
+    fun open(params: RecorderParams): Boolean {
+        if (handle != 0L) {
+            return false
+        }
+        val descriptor = try {
+            if (params.outputUri != null) {
+                MyApplication.context.contentResolver.openFileDescriptor(params.outputUri, "rw")
+            } else if (params.outputPath != null) {
+                ParcelFileDescriptor.open(File(params.outputPath), ParcelFileDescriptor.MODE_WRITE_ONLY or
+                        ParcelFileDescriptor.MODE_CREATE or ParcelFileDescriptor.MODE_TRUNCATE)
+            } else {
+                null
+            }
+        } catch (e: Exception) {
+            e.printStackTrace()
+            null
+        } ?: return false
+        // The native muxer owns and closes the descriptor.
+        handle = nCreate(descriptor.detachFd(), FRAGMENT_MS)
+        return handle != 0L
+    }
+
+    /**
+     * Add the track of an encoder's output format, with its codec specific data.
+     * Return the track index, -1 if the format is not supported.
+     */
+    @Synchronized
+    fun addTrack(format: MediaFormat): Int {
+        if (handle == 0L) {
+            return -1
+        }
+        return when (val mime = format.getString(MediaFormat.KEY_MIME)) {
+            MediaFormat.MIMETYPE_VIDEO_AVC, MediaFormat.MIMETYPE_VIDEO_HEVC -> {
+                val config = csd(format, "csd-0") + csd(format, "csd-1")
+                nAddVideoTrack(handle, mime == MediaFormat.MIMETYPE_VIDEO_HEVC,
+                    format.getInteger(MediaFormat.KEY_WIDTH), format.getInteger(MediaFormat.KEY_HEIGHT), config)
+            }
+            MediaFormat.MIMETYPE_AUDIO_AAC -> {
+                nAddAudioTrack(handle, format.getInteger(MediaFormat.KEY_SAMPLE_RATE),
+                    format.getInteger(MediaFormat.KEY_CHANNEL_COUNT), csd(format, "csd-0"))
+            }
+            else -> -1
+        }
+    }
+
+    @Synchronized
+    fun setOrientationHint(degrees: Int) {
+        if (handle != 0L) {
+            nSetRotation(handle, degrees)
+        }
+    }
+
+    @Synchronized
+    fun start(): Boolean {
+        return handle != 0L && nStart(handle)
+    }
+
+    /**
+     * Called on the encoder threads, [buffer] is the encoder's direct output buffer.
+     */
+    fun writeSampleData(track: Int, buffer: ByteBuffer, info: MediaCodec.BufferInfo): Boolean {
+        val handle = handle
+        if (handle == 0L) {
+            return false
+        }
+        val keyFrame = info.flags and MediaCodec.BUFFER_FLAG_KEY_FRAME != 0
+        return nWriteSample(handle, track, buffer, info.offset, info.size, info.presentationTimeUs, keyFrame)
+    }
+
+    /**
+     * Write the last fragment, close the file and free the muxer.
+     */
+    @Synchronized
+    fun release(): Boolean {
+        if (handle == 0L) {
+            return false
+        }
+        val ok = nStop(handle)
+        nRelease(handle)
+        handle = 0L
+        return ok
+    }
+
+    private fun csd(format: MediaFormat, key: String): ByteArray {
+        val buffer = format.getByteBuffer(key)?.duplicate() ?: return ByteArray(0)
+        buffer.rewind()
+        return ByteArray(buffer.remaining()).also { buffer.get(it) }
+    }
+
+    private external fun nCreate(fd: Int, fragmentMs: Int): Long
+
+    private external fun nAddVideoTrack(handle: Long, hevc: Boolean, width: Int, height: Int, config: ByteArray): Int
+
+    private external fun nAddAudioTrack(handle: Long, sampleRate: Int, channels: Int, config: ByteArray): Int
+
+    private external fun nSetRotation(handle: Long, degrees: Int)
+
+    private external fun nStart(handle: Long): Boolean
+
+    private external fun nWriteSample(handle: Long, track: Int, buffer: ByteBuffer, offset: Int, size: Int,
+                                      ptsUs: Long, keyFrame: Boolean): Boolean
+
+    private external fun nStop(handle: Long): Boolean
+
+    private external fun nRelease(handle: Long)
+
+    companion object {
+        private const val FRAGMENT_MS = 1000
+    }
+}
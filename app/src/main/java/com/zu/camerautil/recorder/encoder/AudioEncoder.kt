@@ -3,6 +3,7 @@ package com.zu.camerautil.recorder.encoder
 import android.media.MediaCodec
 import android.media.MediaCodecInfo
 import android.media.MediaFormat
+import com.zu.camerautil.recorder.NativeAudioInput
 import com.zu.camerautil.recorder.RecorderParams
 import timber.log.Timber
 import java.nio.ByteBuffer
@@ -15,6 +16,14 @@ import java.util.concurrent.atomic.AtomicBoolean
  */
 class AudioEncoder: BaseEncoder("AudioEncoder") {
 
+    /**
+     * 设置后，编码线程直接从原生采集读取PCM到输入buffer，不再需要[feed]。
+     * */
+    var pcmInput: NativeAudioInput? = null
+
+    // An input buffer dequeued while the capture ring was empty, filled on the next loop.
+    private var pendingInputId = -1
+
     override fun prepare(params: RecorderParams): Boolean = synchronized(lockObj) {
         val callback = this.callback ?: return false
         if (state != EncoderState.IDLE) {
@@ -35,6 +44,7 @@ class AudioEncoder: BaseEncoder("AudioEncoder") {
             callback.onError()
             return false
         }
+        pendingInputId = -1
         state = EncoderState.PREPARED
         return true
     }
@@ -60,6 +70,25 @@ class AudioEncoder: BaseEncoder("AudioEncoder") {
         encoder.queueInputBuffer(inputBufferId, 0, count, 0, 0)
     }
 
+    override fun feedInput(encoder: MediaCodec) {
+        val input = pcmInput ?: return
+        while (true) {
+            val inputBufferId = if (pendingInputId >= 0) pendingInputId else encoder.dequeueInputBuffer(0)
+            if (inputBufferId < 0) {
+                return
+            }
+            val inputBuffer = encoder.getInputBuffer(inputBufferId) ?: return
+            val pts = input.presentationTimeUs
+            val size = input.read(inputBuffer, 0)
+            if (size <= 0) {
+                pendingInputId = inputBufferId
+                return
+            }
+            pendingInputId = -1
+            encoder.queueInputBuffer(inputBufferId, 0, size, pts, 0)
+        }
+    }
+
     override fun signalEndOfStream() {
         val encoder = encoder ?: return
         var retryTimes = 0
@@ -131,6 +131,7 @@ abstract class BaseEncoder(val name: String) {
         encoder.start()
         callback?.onStart()
         while (!stopFlag.get()) {
+            feedInput(encoder)
             outputBufferId = encoder.dequeueOutputBuffer(outputBufferInfo, 5000)
             if (outputBufferId >= 0) {
                 if (outputBufferInfo.flags and MediaCodec.BUFFER_FLAG_END_OF_STREAM != 0) {
@@ -157,6 +158,11 @@ abstract class BaseEncoder(val name: String) {
         }
     }
 
+    /**
+     * 在编码线程上、每次取输出buffer之前调用，编码器可以在这里自己填充输入buffer。
+     * */
+    protected open fun feedInput(encoder: MediaCodec) {}
+
     // 不同的编码器实现有不同的结束方式。
     // 对于音频编码器，没有surface，只能用传统的传入空的buffer并且flag为[MediaCodec.BUFFER_FLAG_END_OF_STREAM]。
     // 对于视频编码器，有surface，只能用encoder.signalEndOfStream
@@ -0,0 +1,51 @@
+package com.zu.camerautil.util
+
+import android.graphics.Bitmap
+import android.media.Image
+
+/**
+ * 多帧合成降噪，帧格式为YUV_420_888。第一帧作为参考帧，其余每帧在add时对齐并累加，
+ * add返回后Image即可close，所以可以边拍边合成。最多16帧。
+ * 对齐和合成较耗时，不要在主线程调用。
+ * */
+class BurstMerger(val width: Int, val height: Int) : AutoCloseable {
+    private var handle: Long = nCreate(width, height)
+
+    /**
+     * @return 尺寸不符或者已经有16帧时返回false
+     * */
+    fun add(image: Image): Boolean {
+        check(handle != 0L) { "BurstMerger is closed" }
+        return nAdd(handle, image)
+    }
+
+    /**
+     * 输出合成结果，旋转与镜像与ImageConverter.convertYUV_420_888_to_bitmap相同。
+     * 可以继续add，再次merge时包含之后添加的帧。
+     * */
+    fun merge(rotation: Int, facing: Int): Bitmap? {
+        check(handle != 0L) { "BurstMerger is closed" }
+        return nMerge(handle, rotation, facing)
+    }
+
+    override fun close() {
+        if (handle != 0L) {
+            nRelease(handle)
+            handle = 0L
+        }
+    }
+
+    private external fun nCreate(width: Int, height: Int): Long
+
+    private external fun nAdd(handle: Long, image: Image): Boolean
+
+    private external fun nMerge(handle: Long, rotation: Int, facing: Int): Bitmap?
+
+    private external fun nRelease(handle: Long)
+
+    companion object {
+        init {
+            System.loadLibrary("native-lib")
+        }
+    }
+}
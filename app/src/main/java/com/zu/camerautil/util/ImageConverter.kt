@@ -1,7 +1,10 @@
 package com.zu.camerautil.util
 
 import android.graphics.Bitmap
+import android.hardware.camera2.CameraCharacteristics
+import android.hardware.camera2.CaptureResult
 import android.media.Image
+import android.os.Build
 
 /**
  * @author zuguorui
@@ -18,5 +21,130 @@ object ImageConverter {
         return nYUV_420_888_to_bitmap(image, rotation, facing)
     }
 
+    /**
+     * Colour grade converted frames with a .cube 3D LUT, null to turn grading off.
+     * Return false if the file can not be loaded.
+     */
+    fun setGradingLut(cubePath: String?): Boolean {
+        return nSetCubeLut(cubePath)
+    }
+
+    /**
+     * Correct the lens distortion of the camera in frames from convertYUV_420_888_to_bitmap,
+     * null to stop. Call again when the camera changes. Return false if the camera does not
+     * report its distortion (LENS_DISTORTION needs Android P), correction is off then.
+     */
+    fun setLensDistortion(characteristics: CameraCharacteristics?): Boolean {
+        val intrinsics = characteristics?.get(CameraCharacteristics.LENS_INTRINSIC_CALIBRATION)
+        val distortion = if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.P) {
+            characteristics?.get(CameraCharacteristics.LENS_DISTORTION)
+        } else {
+            null
+        }
+        val array = characteristics?.get(CameraCharacteristics.SENSOR_INFO_PRE_CORRECTION_ACTIVE_ARRAY_SIZE)
+        if (intrinsics == null || intrinsics.size < 5 || distortion == null || distortion.size < 5 || array == null) {
+            nSetLensDistortion(null, null, 0, 0)
+            return false
+        }
+        nSetLensDistortion(intrinsics, distortion, array.width(), array.height())
+        return true
+    }
+
+    /**
+     * Fuse 2 to 8 bracketed YUV_420_888 images of the same size (Mertens exposure fusion).
+     * Return null if they can not be fused. Takes a while, do not call on the main thread.
+     */
+    fun fuseExposures(images: Array<Image>, rotation: Int, facing: Int): Bitmap? {
+        return nExposureFusion(images, rotation, facing)
+    }
+
+    /**
+     * Develop a RAW_SENSOR, RAW10 or RAW12 image with the black level, white balance,
+     * colour transform and lens shading map the camera reported for it.
+     */
+    fun convertRawToBitmap(
+        image: Image,
+        rotation: Int,
+        facing: Int,
+        characteristics: CameraCharacteristics,
+        result: CaptureResult
+    ): Bitmap {
+        val cfa = characteristics[CameraCharacteristics.SENSOR_INFO_COLOR_FILTER_ARRANGEMENT]
+            ?: CameraCharacteristics.SENSOR_INFO_COLOR_FILTER_ARRANGEMENT_RGGB
+        val dynamic = Build.VERSION.SDK_INT >= Build.VERSION_CODES.P
+        val blackLevel = (if (dynamic) result[CaptureResult.SENSOR_DYNAMIC_BLACK_LEVEL] else null)
+            ?: FloatArray(4).also {
+                val pattern = characteristics[CameraCharacteristics.SENSOR_BLACK_LEVEL_PATTERN]
+                for (i in 0 until 4) {
+                    it[i] = pattern?.getOffsetForIndex(i % 2, i / 2)?.toFloat() ?: 0f
+                }
+            }
+        val whiteLevel = (if (dynamic) result[CaptureResult.SENSOR_DYNAMIC_WHITE_LEVEL] else null)
+            ?: characteristics[CameraCharacteristics.SENSOR_INFO_WHITE_LEVEL] ?: 1023
+        val wbGains = result[CaptureResult.COLOR_CORRECTION_GAINS]?.let {
+            floatArrayOf(it.red, it.greenEven, it.greenOdd, it.blue)
+        } ?: floatArrayOf(1f, 1f, 1f, 1f)
+        val ccm = FloatArray(9) { if (it % 4 == 0) 1f else 0f }
+        result[CaptureResult.COLOR_CORRECTION_TRANSFORM]?.let {
+            for (i in 0 until 9) {
+                ccm[i] = it.getElement(i % 3, i / 3).toFloat()
+            }
+        }
+        // Only in results of requests with STATISTICS_LENS_SHADING_MAP_MODE_ON
+        val shading = result[CaptureResult.STATISTICS_LENS_SHADING_CORRECTION_MAP]
+        val shadingGains = shading?.let {
+            FloatArray(it.gainFactorCount).apply { it.copyGainFactors(this, 0) }
+        }
+        return nRawToBitmap(
+            image, rotation, facing, cfa, blackLevel, whiteLevel.toFloat(), wbGains, ccm,
+            shadingGains, shading?.columnCount ?: 0, shading?.rowCount ?: 0
+        )
+    }
+
+    /**
+     * Back the large native scratch planes allocated from now on with transparent huge pages,
+     * fewer TLB misses on big frames at the cost of some memory. Off by default.
+     */
+    fun setHugePages(enable: Boolean) {
+        nSetHugePages(enable)
+    }
+
+    /**
+     * Give the native scratch memory kept for the next frames back to the system,
+     * e.g. when the camera is closed or in onTrimMemory.
+     */
+    fun releaseScratchMemory() {
+        nTrimScratchMemory()
+    }
+
     external fun nYUV_420_888_to_bitmap(image: Image, rotation: Int, facing: Int): Bitmap
+
+    external fun nSetCubeLut(path: String?): Boolean
+
+    external fun nSetLensDistortion(
+        intrinsics: FloatArray?,
+        distortion: FloatArray?,
+        arrayWidth: Int,
+        arrayHeight: Int
+    )
+
+    external fun nExposureFusion(images: Array<Image>, rotation: Int, facing: Int): Bitmap?
+
+    external fun nRawToBitmap(
+        image: Image,
+        rotation: Int,
+        facing: Int,
+        cfa: Int,
+        blackLevel: FloatArray,
+        whiteLevel: Float,
+        wbGains: FloatArray,
+        ccm: FloatArray,
+        shadingGains: FloatArray?,
+        shadingColumns: Int,
+        shadingRows: Int
+    ): Bitmap
+
+    external fun nSetHugePages(enable: Boolean)
+
+    external fun nTrimScratchMemory()
 }
\ No newline at end of file
@@ -0,0 +1,35 @@
+package com.zu.camerautil.util
+
+/**
+ * native图像kernel的基准测试，结果输出在logcat中，TAG为benchmark.cpp。
+ * 耗时较长，不要在主线程调用。
+ * */
+object NativeBenchmark {
+    init {
+        System.loadLibrary("native-lib")
+    }
+
+    /**
+     * @param filter 只运行名字中包含filter的测试，为空时运行全部测试。
+     * */
+    external fun runBenchmark(filter: String)
+
+    /**
+     * 和[runBenchmark]相同，另外先测出内存带宽上限，输出每个kernel达到的带宽占上限的比例。
+     * */
+    external fun runRoofline(filter: String)
+
+    /**
+     * YUV转RGBA的一致性测试：所有指令集变体、精度、旋转、镜像和线程数的输出与双精度参考实现
+     * 以及标量实现比较，结果输出在logcat中，TAG为conformance.cpp。
+     * @param filter 只运行名字中包含filter的测试，例如"yuv10"、"NV21"，为空时运行全部测试。
+     * @return 失败的检查数，0表示全部通过
+     * */
+    external fun runConformance(filter: String): Int
+
+    /**
+     * 强制native图像kernel只使用指定的指令集，例如"scalar"、"neon"、"neon,dotprod"，"auto"恢复自动选择。
+     * @return 无法识别时返回false
+     * */
+    external fun setKernelOverride(features: String): Boolean
+}